@@ -228,3 +228,532 @@ int TestAVLTree_Int()
 
 	return 0;
 }
+
+/* Returns the height of a subtree, or -1 if it breaks an AVL invariant */
+template <class Node>
+static int CheckAVLShape(const Node *_node, const Node *_parent)
+{
+	if (!_node)
+		return 0;
+	if (_node->parent != _parent)
+		return -1;
+
+	int left = CheckAVLShape(_node->left, _node);
+	int right = CheckAVLShape(_node->right, _node);
+	if (left < 0 || right < 0 || left - right > 1 || right - left > 1)
+		return -1;
+
+	int balance = (left > right) ? LEFTHEAVY : (left < right) ? RIGHTHEAVY : BALANCED;
+	if (_node->balance != balance)
+		return -1;
+
+	return 1 + (left > right ? left : right);
+}
+
+class CheckedAVLTree : public AVLTree<int, int>
+{
+	public:
+		int height() const
+		{
+			return CheckAVLShape(m_root, (const AVLNode<int, int, true> *)nullptr);
+		}
+};
+
+int TestAVLTree_BuildFromSorted()
+{
+	const uint32_t maxItems = TREE_ITEMS * 512;
+	int *keys = new int[maxItems], *data = new int[maxItems];
+
+	for (uint32_t i = 0; i < maxItems; i++)
+	{
+		keys[i] = (int)i * 3;
+		data[i] = (int)i;
+	}
+
+	/* Every small size, plus one large enough to be built in parallel */
+	for (uint32_t n = 0; n <= maxItems; n = (n < TREE_ITEMS) ? n + 1 : maxItems + (n == maxItems))
+	{
+		CheckedAVLTree *avltree = new CheckedAVLTree();
+		TEST_ASSERT(avltree->insert(-1, -1));
+		TEST_ASSERT(avltree->build_from_sorted(keys, data, n));
+		TEST_ASSERT(avltree->size() == n);
+		TEST_ASSERT(!avltree->exists(-1));
+
+		int height = avltree->height(), minimal = 0;
+		for (uint32_t i = n; i; i >>= 1)
+			minimal++;
+		TEST_ASSERT(height == minimal);
+
+		for (uint32_t i = 0; i < n; i++)
+		{
+			TEST_ASSERT(avltree->find(keys[i], -1) == data[i]);
+			TEST_ASSERT(!avltree->exists(keys[i] + 1));
+		}
+
+		/* The result must be an ordinary tree that can be modified further */
+		for (uint32_t i = 0; i < n && i < TREE_ITEMS; i++)
+		{
+			TEST_ASSERT(avltree->insert(keys[i] + 1, 0));
+			TEST_ASSERT(avltree->erase(keys[i]));
+		}
+		TEST_ASSERT(avltree->height() >= 0);
+
+		delete avltree;
+	}
+
+	/* Unsorted and duplicated keys are rejected without touching the tree */
+	AVLTree<int, int> *avltree = new AVLTree<int, int>();
+	TEST_ASSERT(avltree->insert(-1, -1));
+	keys[TREE_ITEMS / 2] = keys[TREE_ITEMS / 2 - 1];
+	TEST_ASSERT(!avltree->build_from_sorted(keys, data, TREE_ITEMS));
+	keys[TREE_ITEMS / 2] = -5;
+	TEST_ASSERT(!avltree->build_from_sorted(keys, data, TREE_ITEMS));
+	TEST_ASSERT(avltree->size() == 1);
+	TEST_ASSERT(avltree->exists(-1));
+	delete avltree;
+
+	delete [] keys;
+	delete [] data;
+
+	/* Rebuild a tree from its own DArray snapshot */
+	AVLTree<int, int> *source = new AVLTree<int, int>();
+	for (unsigned int i = 0; i < TREE_ITEMS; i++)
+	{
+		int key = (int)RandomNumber();
+		source->insert(key, key / 2);
+	}
+
+	DArray<int> *keyArray = source->ConvertIndexToDArray();
+	DArray<int> *dataArray = source->ConvertToDArray();
+
+	AVLTree<int, int> *copy = new AVLTree<int, int>();
+	TEST_ASSERT(copy->build_from_sorted(keyArray, dataArray));
+	TEST_ASSERT(copy->size() == source->size());
+	for (AVLTree<int, int>::iterator it = source->begin(); it.valid(); ++it)
+	{
+		TEST_ASSERT(copy->find(it.key(), -1) == it.data());
+	}
+
+	/* A key without data is rejected */
+	dataArray->remove(0);
+	TEST_ASSERT(!copy->build_from_sorted(keyArray, dataArray));
+	TEST_ASSERT(copy->size() == source->size());
+
+	delete keyArray;
+	delete dataArray;
+	delete copy;
+	delete source;
+
+	return 0;
+}
+
+/* Returns the size of a subtree, or -1 if a node's count is wrong */
+template <class Node>
+static int CheckSubtreeCounts(const Node *_node)
+{
+	if (!_node)
+		return 0;
+
+	int left = CheckSubtreeCounts(_node->left);
+	int right = CheckSubtreeCounts(_node->right);
+	if (left < 0 || right < 0 || _node->count != (uint32_t)(1 + left + right))
+		return -1;
+
+	return 1 + left + right;
+}
+
+class CountedAVLTree : public AVLTree<int, int, true, true>
+{
+	public:
+		bool countsValid() const
+		{
+			return CheckSubtreeCounts(m_root) == (int)size() &&
+			       CheckAVLShape(m_root, (const AVLNode<int, int, true, true> *)nullptr) >= 0;
+		}
+};
+
+int TestAVLTree_OrderStatistics()
+{
+	const int keySpace = TREE_ITEMS * 4;
+	bool *present = new bool[keySpace];
+	CountedAVLTree *avltree = new CountedAVLTree();
+
+	for (int i = 0; i < keySpace; i++)
+		present[i] = false;
+
+	TEST_ASSERT(!avltree->select(0).valid());
+	TEST_ASSERT(avltree->rank(0) == 0);
+
+	for (int round = 0; round < 16; round++)
+	{
+		/* Mostly inserts early on, mostly erasures later */
+		for (int i = 0; i < TREE_ITEMS; i++)
+		{
+			int key = (int)(RandomNumber() % keySpace);
+			if ((int)(RandomNumber() % 16) >= round)
+			{
+				TEST_ASSERT(avltree->insert(key, -key) == !present[key]);
+				present[key] = true;
+			} else {
+				TEST_ASSERT(avltree->erase(key) == present[key]);
+				present[key] = false;
+			}
+		}
+
+		TEST_ASSERT(avltree->countsValid());
+
+		uint32_t below = 0;
+		for (int key = 0; key < keySpace; key++)
+		{
+			TEST_ASSERT(avltree->rank(key) == below);
+			if (present[key])
+			{
+				AVLTree<int, int, true, true>::iterator it = avltree->select(below);
+				TEST_ASSERT(it.valid() && it.key() == key && it.data() == -key);
+				below++;
+			}
+		}
+		TEST_ASSERT(below == avltree->size());
+		TEST_ASSERT(!avltree->select(below).valid());
+		TEST_ASSERT(avltree->count_range(-1, keySpace) == below);
+
+		int lo = (int)(RandomNumber() % keySpace), hi = (int)(RandomNumber() % keySpace);
+		TEST_ASSERT(avltree->count_range(lo, hi) == avltree->for_each_in_range(lo, hi, [](int const &, int &) {}));
+	}
+
+	/* Bulk-built trees carry counts too */
+	int *keys = new int[TREE_ITEMS], *data = new int[TREE_ITEMS];
+	for (int i = 0; i < TREE_ITEMS; i++)
+	{
+		keys[i] = i * 2;
+		data[i] = i;
+	}
+	TEST_ASSERT(avltree->build_from_sorted(keys, data, TREE_ITEMS));
+	TEST_ASSERT(avltree->countsValid());
+	for (int i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(avltree->select(i).key() == keys[i]);
+		TEST_ASSERT(avltree->rank(keys[i] + 1) == (uint32_t)i + 1);
+	}
+	TEST_ASSERT(avltree->erase(keys[0]));
+	TEST_ASSERT(avltree->countsValid());
+
+	delete [] keys;
+	delete [] data;
+	delete [] present;
+	delete avltree;
+
+	return 0;
+}
+
+static const int Absent = -1;
+
+template <class Tree>
+static bool MatchesReference(Tree *_tree, const int *_ref, int _keySpace)
+{
+	uint32_t count = 0;
+	for (int key = 0; key < _keySpace; key++)
+	{
+		if (_tree->find(key, Absent) != _ref[key])
+			return false;
+		if (_ref[key] != Absent)
+			count++;
+	}
+	return _tree->size() == count;
+}
+
+template <class Tree>
+static void FillRandom(Tree *_tree, int *_ref, int _keySpace, int _items, int _tag)
+{
+	for (int key = 0; key < _keySpace; key++)
+		_ref[key] = Absent;
+	for (int i = 0; i < _items; i++)
+	{
+		int key = (int)(RandomNumber() % _keySpace);
+		if (_tree->insert(key, key * 4 + _tag))
+			_ref[key] = key * 4 + _tag;
+	}
+}
+
+template <class Tree>
+static int TestSetOperations(int _keySpace)
+{
+	int *refA = new int[_keySpace], *refB = new int[_keySpace], *expect = new int[_keySpace];
+	Tree *a = new Tree(), *b = new Tree();
+
+	for (int round = 0; round < 4; round++)
+	{
+		/* Vary the relative sizes, from even to very lopsided */
+		int itemsA = _keySpace / 2, itemsB = _keySpace >> (round * 3 + 1);
+
+		/* Union: every key from both, with b's data winning */
+		FillRandom(a, refA, _keySpace, itemsA, 1);
+		FillRandom(b, refB, _keySpace, itemsB, 2);
+		for (int key = 0; key < _keySpace; key++)
+			expect[key] = (refB[key] != Absent) ? refB[key] : refA[key];
+		a->set_union(*b);
+		TEST_ASSERT(a->valid());
+		TEST_ASSERT(MatchesReference(a, expect, _keySpace));
+		TEST_ASSERT(b->size() == 0 && !b->exists(refB[0]));
+		a->empty();
+
+		/* Intersection: keys in both, with a's data */
+		FillRandom(a, refA, _keySpace, itemsA, 1);
+		FillRandom(b, refB, _keySpace, itemsB, 2);
+		for (int key = 0; key < _keySpace; key++)
+			expect[key] = (refB[key] != Absent) ? refA[key] : Absent;
+		a->set_intersection(*b);
+		TEST_ASSERT(a->valid());
+		TEST_ASSERT(MatchesReference(a, expect, _keySpace));
+		TEST_ASSERT(MatchesReference(b, refB, _keySpace));
+		a->empty();
+		b->empty();
+
+		/* Difference: keys of a which aren't in b */
+		FillRandom(a, refA, _keySpace, itemsA, 1);
+		FillRandom(b, refB, _keySpace, itemsB, 2);
+		for (int key = 0; key < _keySpace; key++)
+			expect[key] = (refB[key] != Absent) ? Absent : refA[key];
+		a->set_difference(*b);
+		TEST_ASSERT(a->valid());
+		TEST_ASSERT(MatchesReference(a, expect, _keySpace));
+		TEST_ASSERT(MatchesReference(b, refB, _keySpace));
+		b->empty();
+
+		/* Split at a random key, then join the halves back together */
+		int pivot = (int)(RandomNumber() % _keySpace);
+		for (int key = 0; key < _keySpace; key++)
+		{
+			refB[key] = (key >= pivot) ? expect[key] : Absent;
+			refA[key] = (key < pivot) ? expect[key] : Absent;
+		}
+		TEST_ASSERT(a->split(pivot, *b));
+		TEST_ASSERT(a->valid() && b->valid());
+		TEST_ASSERT(MatchesReference(a, refA, _keySpace));
+		TEST_ASSERT(MatchesReference(b, refB, _keySpace));
+		if (a->size() && b->size())
+		{
+			TEST_ASSERT(!a->split(pivot, *b));
+			TEST_ASSERT(!b->join(*a));
+		}
+		TEST_ASSERT(a->join(*b));
+		TEST_ASSERT(a->valid());
+		TEST_ASSERT(b->size() == 0);
+		TEST_ASSERT(MatchesReference(a, expect, _keySpace));
+
+		/* The result is an ordinary tree that can be modified further */
+		TEST_ASSERT(a->insert(_keySpace, 0));
+		TEST_ASSERT(a->erase(_keySpace));
+		TEST_ASSERT(a->valid());
+		a->empty();
+	}
+
+	delete a;
+	delete b;
+	delete [] refA;
+	delete [] refB;
+	delete [] expect;
+
+	return 0;
+}
+
+class SetCheckedAVLTree : public AVLTree<int, int>
+{
+	public:
+		bool valid() const
+		{
+			return CheckAVLShape(m_root, (const AVLNode<int, int, true> *)nullptr) >= 0;
+		}
+};
+
+class SetCountedAVLTree : public CountedAVLTree
+{
+	public:
+		bool valid() const
+		{
+			return countsValid();
+		}
+};
+
+int TestAVLTree_SetOperations()
+{
+	AVLTree<const char *, const char *> *a = new AVLTree<const char *, const char *>();
+	AVLTree<const char *, const char *> *b = new AVLTree<const char *, const char *>();
+
+	/* Discarded duplicates free their own copies of the keys */
+	TEST_ASSERT(a->insert("alpha", "a1"));
+	TEST_ASSERT(a->insert("beta", "a2"));
+	TEST_ASSERT(b->insert("beta", "b2"));
+	TEST_ASSERT(b->insert("gamma", "b3"));
+	a->set_union(*b);
+	TEST_ASSERT(a->size() == 3 && b->size() == 0);
+	TEST_ASSERT(strcmp(a->find("beta"), "b2") == 0);
+	TEST_ASSERT(b->insert("alpha", "b1"));
+	a->set_difference(*b);
+	TEST_ASSERT(a->size() == 2 && !a->exists("alpha"));
+	TEST_ASSERT(!a->split("c", *b));
+	b->empty();
+	TEST_ASSERT(a->split("c", *b));
+	TEST_ASSERT(a->size() == 1 && a->exists("beta"));
+	TEST_ASSERT(b->size() == 1 && b->exists("gamma"));
+	delete a;
+	delete b;
+
+	/* Small trees, and trees large enough to be combined in parallel */
+	if (TestSetOperations<SetCountedAVLTree>(TREE_ITEMS * 4))
+		return 1;
+	if (TestSetOperations<SetCheckedAVLTree>(TREE_ITEMS * 4))
+		return 2;
+	if (TestSetOperations<SetCheckedAVLTree>(TREE_ITEMS * 1024))
+		return 3;
+
+	return 0;
+}
+
+int TestAVLTree_SharedPrefixes()
+{
+	/* Keys which tie on their cached prefixes, so lookups must fall back to the full key */
+	AVLTree<const char *, int> *tree = new AVLTree<const char *, int>();
+	char key[32];
+
+	for (int i = 0; i < TREE_ITEMS; i++)
+	{
+		sprintf(key, "/usr/share/%05d", (i * 37) % TREE_ITEMS);
+		TEST_ASSERT(tree->insert(key, i));
+	}
+
+	/* Keys shorter than the prefix, and prefixes of other keys */
+	TEST_ASSERT(tree->insert("/usr", -1));
+	TEST_ASSERT(tree->insert("/usr/sha", -2));
+	TEST_ASSERT(tree->insert("/usr/share/", -3));
+	TEST_ASSERT(tree->size() == TREE_ITEMS + 3);
+
+	/* Matching ignores case unless Compare doesn't */
+	TEST_ASSERT(tree->exists("/USR/SHARE/") == (Compare<const char *>("/USR/SHARE/", "/usr/share/") == 0));
+	TEST_ASSERT(!tree->exists("/usr/shar"));
+	TEST_ASSERT(!tree->exists("/usr/share/0"));
+
+	for (int i = 0; i < TREE_ITEMS; i++)
+	{
+		sprintf(key, "/usr/share/%05d", (i * 37) % TREE_ITEMS);
+		TEST_ASSERT(tree->find(key, -100) == i);
+	}
+
+	/* Iteration is still in Compare order */
+	const char *last = nullptr;
+	uint32_t count = 0;
+	for (AVLTree<const char *, int>::iterator it = tree->begin(); it != tree->end(); ++it)
+	{
+		if (last)
+			TEST_ASSERT(Compare(last, it.key()) < 0);
+		last = it.key();
+		count++;
+	}
+	TEST_ASSERT(count == tree->size());
+
+	/* Erasing moves keys between nodes, which must carry their prefixes along */
+	for (int i = 0; i < TREE_ITEMS; i += 2)
+	{
+		sprintf(key, "/usr/share/%05d", (i * 37) % TREE_ITEMS);
+		TEST_ASSERT(tree->erase(key));
+	}
+	for (int i = 0; i < TREE_ITEMS; i++)
+	{
+		sprintf(key, "/usr/share/%05d", (i * 37) % TREE_ITEMS);
+		TEST_ASSERT(tree->exists(key) == (i % 2 == 1));
+	}
+	TEST_ASSERT(tree->erase("/usr"));
+	TEST_ASSERT(tree->find("/usr/sha", 0) == -2);
+
+	delete tree;
+	return 0;
+}
+
+int TestAVLTree_FindBatch()
+{
+	AVLTree<int, int> *tree = new AVLTree<int, int>();
+	int keys[TREE_ITEMS * 2 + 3], out[TREE_ITEMS * 2 + 3];
+	const size_t count = sizeof(keys) / sizeof(keys[0]);
+
+	/* An empty tree finds nothing */
+	for (size_t i = 0; i < count; i++)
+		keys[i] = (int)i;
+	TEST_ASSERT(tree->find_batch(keys, count, out, -1) == 0);
+	for (size_t i = 0; i < count; i++)
+		TEST_ASSERT(out[i] == -1);
+
+	for (int i = 0; i < TREE_ITEMS; i++)
+		TEST_ASSERT(tree->insert(i * 2, i));
+
+	/* Interleave hits and misses, so searches in a group finish at different depths */
+	for (size_t i = 0; i < count; i++)
+		keys[i] = (int)((i * 31) % count) - 1;
+	TEST_ASSERT(tree->find_batch(keys, count, out, -1) == TREE_ITEMS);
+	for (size_t i = 0; i < count; i++)
+		TEST_ASSERT(out[i] == tree->find(keys[i], -1));
+
+	/* Repeated keys are each answered */
+	for (size_t i = 0; i < count; i++)
+		keys[i] = 42;
+	TEST_ASSERT(tree->find_batch(keys, count, out, -1) == count);
+	for (size_t i = 0; i < count; i++)
+		TEST_ASSERT(out[i] == 21);
+
+	delete tree;
+	return 0;
+}
+
+int TestAVLTree_Hinted()
+{
+	CountedAVLTree *tree = new CountedAVLTree();
+	typedef AVLTree<int, int, true, true>::iterator iterator;
+	const int count = TREE_ITEMS * 4;
+
+	/* An empty tree, with nothing to hint at */
+	TEST_ASSERT(!tree->find_near(tree->end(), 0).valid());
+
+	/* Appends, each hinted with the previous one */
+	iterator hint = tree->end();
+	for (int i = 0; i < count; i++) {
+		hint = tree->insert(hint, i * 4, i);
+		TEST_ASSERT(hint.valid() && hint.key() == i * 4 && hint.data() == i);
+	}
+	TEST_ASSERT(tree->size() == (uint32_t)count);
+	TEST_ASSERT(tree->countsValid());
+
+	/* Filling the gaps in descending order */
+	for (int i = count - 1; i >= 0; i--) {
+		hint = tree->insert(hint, i * 4 + 2, -i);
+		TEST_ASSERT(hint.valid() && hint.key() == i * 4 + 2);
+	}
+	TEST_ASSERT(tree->size() == (uint32_t)count * 2);
+	TEST_ASSERT(tree->countsValid());
+
+	/* An existing key is found, and left alone */
+	hint = tree->insert(tree->begin(), 8, 999);
+	TEST_ASSERT(hint.valid() && hint.key() == 8 && hint.data() == 2);
+	TEST_ASSERT(tree->size() == (uint32_t)count * 2);
+
+	/* Hints far from the key still work, just more slowly */
+	for (int i = 0; i < count; i++) {
+		int key = ((i * 7919) % count) * 4 + 1;
+		hint = tree->insert(tree->select((uint32_t)(i * 31) % tree->size()), key, key);
+		TEST_ASSERT(hint.valid() && hint.key() == key);
+	}
+	TEST_ASSERT(tree->size() == (uint32_t)count * 3);
+	TEST_ASSERT(tree->countsValid());
+
+	/* Lookups from every distance, including past either end */
+	for (int key = -2; key < count * 4 + 2; key++) {
+		bool present = key >= 0 && key < count * 4 && key % 4 != 3;
+		iterator start = tree->select((uint32_t)(key * 13 + 7) % tree->size());
+		iterator it = tree->find_near(start, key);
+		TEST_ASSERT(it.valid() == present);
+		if (present)
+			TEST_ASSERT(it.key() == key && it.data() == tree->find(key, 0));
+		TEST_ASSERT(tree->find_near(tree->end(), key) == it);
+	}
+
+	delete tree;
+	return 0;
+}
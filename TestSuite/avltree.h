@@ -15,5 +15,11 @@
 int TestAVLTree_CString();
 int TestAVLTree_String();
 int TestAVLTree_Int();
+int TestAVLTree_BuildFromSorted();
+int TestAVLTree_OrderStatistics();
+int TestAVLTree_SetOperations();
+int TestAVLTree_SharedPrefixes();
+int TestAVLTree_FindBatch();
+int TestAVLTree_Hinted();
 
 #endif
@@ -0,0 +1,170 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#include "header.h"
+#include "bloomfilter.h"
+#include "testutils.h"
+
+#include <cstdio>
+
+#include <crisscross/avltree.h>
+#include <crisscross/bloomfilter.h>
+#include <crisscross/hashtable.h>
+#include <crisscross/rbtree.h>
+
+using namespace CrissCross::Data;
+using namespace CrissCross::System;
+
+/* Fills a filter to capacity, then checks for false negatives and the false positive rate */
+static int TestRate(double _rate)
+{
+	const int items = TREE_ITEMS * 16;
+	const int probes = TREE_ITEMS * 64;
+	BloomFilter<int> *filter = new BloomFilter<int>(items, _rate);
+
+	TEST_ASSERT(filter->capacity() == (size_t)items);
+	TEST_ASSERT(filter->false_positive_rate() == _rate);
+	TEST_ASSERT(!filter->contains(0));
+
+	/* Even keys go in, odd keys never do */
+	for (int i = 0; i < items; i++) {
+		TEST_ASSERT(!filter->full());
+		filter->insert(2 * i);
+	}
+	TEST_ASSERT(filter->full());
+	TEST_ASSERT(filter->size() == (size_t)items);
+
+	for (int i = 0; i < items; i++)
+		TEST_ASSERT(filter->contains(2 * i));
+
+	int hits = 0;
+	for (int i = 0; i < probes; i++)
+		hits += filter->contains(2 * i + 1) ? 1 : 0;
+
+	/* Allow for noise, but not for a filter that was sized wrong */
+	TEST_ASSERT((double)hits / probes < _rate * 2.0);
+
+	filter->clear();
+	TEST_ASSERT(filter->size() == 0);
+	TEST_ASSERT(!filter->contains(0));
+
+	delete filter;
+	return 0;
+}
+
+int TestBloomFilter_Int()
+{
+	if (TestRate(0.05)) return 1;
+	if (TestRate(0.01)) return 1;
+	if (TestRate(0.001)) return 1;
+	return 0;
+}
+
+int TestBloomFilter_CString()
+{
+	BloomFilter<const char *> *filter = new BloomFilter<const char *>(TREE_ITEMS);
+	char buffer[32];
+
+	for (int i = 0; i < TREE_ITEMS; i++) {
+		sprintf(buffer, "Key%d", i);
+		filter->insert(buffer);
+	}
+
+	for (int i = 0; i < TREE_ITEMS; i++) {
+		sprintf(buffer, "Key%d", i);
+		TEST_ASSERT(filter->contains(buffer));
+
+#ifndef CASE_SENSITIVE_COMPARE
+		/* Keys that Compare as equal must pass the filter too */
+		sprintf(buffer, "KEY%d", i);
+		TEST_ASSERT(filter->contains(buffer));
+#endif
+	}
+
+	/* Resizing starts over */
+	filter->resize(TREE_ITEMS * 4);
+	TEST_ASSERT(filter->capacity() == (size_t)TREE_ITEMS * 4);
+	TEST_ASSERT(filter->size() == 0);
+	TEST_ASSERT(!filter->contains("Key0"));
+
+	delete filter;
+	return 0;
+}
+
+/* Runs a filtered map and a plain one side by side, across several filter rebuilds */
+template <class Filtered, class Plain>
+static int TestFiltered(Filtered *_filtered, Plain *_plain, const char *const *_keys, int _count)
+{
+	for (int round = 0; round < 4; round++) {
+		for (int i = 0; i < _count; i++) {
+			if (RandomNumber() % 2 && !_plain->exists(_keys[i])) {
+				TEST_ASSERT(_filtered->insert(_keys[i], i));
+				_plain->insert(_keys[i], i);
+			}
+		}
+
+		for (int i = 0; i < _count / 4; i++) {
+			const char *key = _keys[RandomNumber() % _count];
+			TEST_ASSERT(_filtered->erase(key) == _plain->erase(key));
+		}
+
+		for (int i = 0; i < _count; i++) {
+			TEST_ASSERT(_filtered->exists(_keys[i]) == _plain->exists(_keys[i]));
+			TEST_ASSERT(_filtered->find(_keys[i], -1) == _plain->find(_keys[i], -1));
+		}
+	}
+
+	/* The filter grew from its initial size as keys came in */
+	TEST_ASSERT(_filtered->filter().capacity() > 16);
+
+	_filtered->empty();
+	for (int i = 0; i < _count; i++)
+		TEST_ASSERT(!_filtered->exists(_keys[i]));
+
+	return 0;
+}
+
+template <class Container>
+static int TestFilteredTree()
+{
+	const int count = TREE_ITEMS;
+	char *keys[count];
+	for (int i = 0; i < count; i++) {
+		char buffer[32];
+		sprintf(buffer, "%d", i);
+		keys[i] = newStr(buffer);
+	}
+
+	FilteredMap<const char *, int, Container> *filtered = new FilteredMap<const char *, int, Container>(16);
+	Container *plain = new Container();
+	int ret = TestFiltered(filtered, plain, keys, count);
+	delete plain;
+	delete filtered;
+
+	for (int i = 0; i < count; i++)
+		delete [] keys[i];
+	return ret;
+}
+
+int TestFilteredMap_AVLTree()
+{
+	return TestFilteredTree< AVLTree<const char *, int> >();
+}
+
+int TestFilteredMap_RedBlackTree()
+{
+	return TestFilteredTree< RedBlackTree<const char *, int> >();
+}
+
+int TestFilteredMap_HashTable()
+{
+	return TestFilteredTree< HashTable<int> >();
+}
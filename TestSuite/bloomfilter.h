@@ -0,0 +1,21 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_bloomfilter_test_h
+#define __included_bloomfilter_test_h
+
+int TestBloomFilter_Int();
+int TestBloomFilter_CString();
+int TestFilteredMap_AVLTree();
+int TestFilteredMap_RedBlackTree();
+int TestFilteredMap_HashTable();
+
+#endif
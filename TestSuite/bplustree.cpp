@@ -0,0 +1,306 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#include "header.h"
+#include "bplustree.h"
+#include "testutils.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <crisscross/bplustree.h>
+
+using namespace CrissCross::Data;
+using namespace CrissCross::System;
+
+int TestBPlusTree_CString()
+{
+	BPlusTree<const char *, const char *> *bplustree = new BPlusTree<const char *, const char *>();
+	char *strings[TREE_ITEMS], *tmp;
+
+	/* Make sure allocation worked */
+	TEST_ASSERT(bplustree != nullptr);
+
+	/* Make sure the size starts at 0 */
+	TEST_ASSERT(bplustree->size() == 0);
+
+	memset(strings, 0, sizeof(strings));
+
+	/* Make sure the tree encapsulates keys properly */
+	tmp = cc_strdup("testkey");
+	bplustree->insert(tmp, "encapsulation test");
+	free(tmp); tmp = nullptr;
+	TEST_ASSERT(bplustree->size() == 1);
+	TEST_ASSERT(bplustree->exists("testkey"));
+	TEST_ASSERT(bplustree->erase("testkey"));
+	TEST_ASSERT(!bplustree->exists("testkey"));
+	TEST_ASSERT(!bplustree->erase("testkey"));
+	TEST_ASSERT(bplustree->size() == 0);
+
+	/* Simplest sanity checks done, now create some random data */
+	for (unsigned int i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(strings[i] == nullptr);
+		strings[i] = new char[20];
+		TEST_ASSERT(strings[i] != nullptr);
+		memset(strings[i], 0, 20);
+		TEST_ASSERT(strlen(strings[i]) == 0);
+		sprintf(strings[i], "%08x", i);
+		TEST_ASSERT(strlen(strings[i]) > 0);
+	}
+
+	/* Fill the tree */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(bplustree->insert(strings[i], strings[(TREE_ITEMS - 1) - i]));
+	}
+
+	/* Verify existence of all the added data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		const char *val = nullptr;
+		TEST_ASSERT(bplustree->exists(strings[i]));
+		TEST_ASSERT((val = bplustree->find(strings[i])) != nullptr);
+		TEST_ASSERT(Compare(val, (const char *)strings[(TREE_ITEMS - 1) - i]) == 0);
+	}
+
+	/* Verify existence of all the added data, in a different order */
+	for (size_t i = TREE_ITEMS - 1; i < TREE_ITEMS; i--)
+	{
+		TEST_ASSERT(bplustree->exists(strings[i]));
+	}
+
+	/* Try to remove all the data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(bplustree->erase(strings[i]));
+		TEST_ASSERT(!bplustree->exists(strings[i]));
+	}
+
+	/* Clean up the random data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		delete [] strings[i];
+		strings[i] = nullptr;
+	}
+
+	/* And finally, clear the tree */
+	delete bplustree;
+
+	/* Borrowed keys may be freed once erased, so separators can't point at them */
+	BPlusTree<const char *, int, false> *borrowed = new BPlusTree<const char *, int, false>();
+	const int count = TREE_ITEMS * 16;
+	char **keys = new char *[count];
+	for (int i = 0; i < count; i++) {
+		keys[i] = (char *)malloc(20);
+		sprintf(keys[i], "%08x", i);
+		TEST_ASSERT(borrowed->insert(keys[i], i));
+	}
+	for (int i = 0; i < count; i += 2) {
+		TEST_ASSERT(borrowed->erase(keys[i]));
+		free(keys[i]);
+		keys[i] = nullptr;
+	}
+	for (int i = 1; i < count; i += 2) {
+		TEST_ASSERT(borrowed->exists(keys[i]));
+		TEST_ASSERT(borrowed->find(keys[i], -1) == i);
+	}
+	for (int i = 1; i < count; i += 2) {
+		TEST_ASSERT(borrowed->erase(keys[i]));
+		free(keys[i]);
+	}
+	TEST_ASSERT(borrowed->size() == 0);
+	delete [] keys;
+	delete borrowed;
+
+	return 0;
+}
+
+int TestBPlusTree_String()
+{
+	BPlusTree<std::string, std::string> *bplustree = new BPlusTree<std::string, std::string>();
+	std::string strings[TREE_ITEMS], tmp;
+
+	/* Make sure allocation worked */
+	TEST_ASSERT(bplustree != nullptr);
+
+	/* Make sure the size starts at 0 */
+	TEST_ASSERT(bplustree->size() == 0);
+
+	/* Make sure the tree encapsulates keys properly */
+	tmp = std::string("testkey");
+	bplustree->insert(tmp, std::string("encapsulation test"));
+	tmp = std::string("");
+	TEST_ASSERT(bplustree->size() == 1);
+	TEST_ASSERT(bplustree->exists("testkey"));
+	TEST_ASSERT(bplustree->erase("testkey"));
+	TEST_ASSERT(!bplustree->exists("testkey"));
+	TEST_ASSERT(!bplustree->erase("testkey"));
+	TEST_ASSERT(bplustree->size() == 0);
+
+	/* Simplest sanity checks done, now create some random data */
+	for (unsigned int i = 0; i < TREE_ITEMS; i++)
+	{
+		char buf[20];
+		buf[0] = (char)0;
+		TEST_ASSERT(strlen(buf) == 0);
+		sprintf(buf, "%08x", i);
+		strings[i] = std::string(buf);
+		TEST_ASSERT(strings[i].length() > 0);
+	}
+
+	/* Fill the tree */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(bplustree->insert(strings[i], strings[(TREE_ITEMS - 1) - i]));
+	}
+
+	/* Verify existence of all the added data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		std::string val;
+		val.clear();
+		TEST_ASSERT(val.length() == 0);
+		TEST_ASSERT(bplustree->exists(strings[i]));
+		TEST_ASSERT((val = bplustree->find<std::string>(strings[i], "")) != std::string(""));
+		TEST_ASSERT(val.length() > 0);
+		TEST_ASSERT(Compare(val, strings[(TREE_ITEMS - 1) - i]) == 0);
+	}
+
+	/* Verify existence of all the added data, in a different order */
+	for (size_t i = TREE_ITEMS - 1; i < TREE_ITEMS; i--)
+	{
+		TEST_ASSERT(bplustree->exists(strings[i]));
+	}
+
+	/* Try to remove all the data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(bplustree->erase(strings[i]));
+		TEST_ASSERT(!bplustree->exists(strings[i]));
+	}
+
+	/* And finally, clear the tree */
+	delete bplustree;
+
+	return 0;
+}
+
+int TestBPlusTree_Int()
+{
+	BPlusTree<int, int> *bplustree = new BPlusTree<int, int>();
+	int data[TREE_ITEMS], tmp;
+
+	/* Make sure allocation worked */
+	TEST_ASSERT(bplustree != nullptr);
+
+	/* Make sure the size starts at 0 */
+	TEST_ASSERT(bplustree->size() == 0);
+
+	/* Make sure the tree encapsulates keys properly */
+	tmp = 256;
+	bplustree->insert(tmp, RandomNumber());
+	tmp = 0;
+	TEST_ASSERT(bplustree->size() == 1);
+	TEST_ASSERT(bplustree->exists(256));
+	TEST_ASSERT(bplustree->erase(256));
+	TEST_ASSERT(!bplustree->exists(256));
+	TEST_ASSERT(!bplustree->erase(256));
+	TEST_ASSERT(bplustree->size() == 0);
+
+	/* Simplest sanity checks done, now create some random data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		data[i] = i;
+	}
+
+	/* Fill the tree */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(bplustree->insert(data[i], data[TREE_ITEMS - 1 - i]));
+	}
+
+	/* Verify existence of all the added data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		int val;
+		TEST_ASSERT(bplustree->exists(data[i]));
+		TEST_ASSERT((val = bplustree->find(data[i], -1)) != -1);
+		TEST_ASSERT(Compare(val, data[TREE_ITEMS - 1 - i]) == 0);
+	}
+
+	/* Verify existence of all the added data, in a different order */
+	for (size_t i = TREE_ITEMS - 1; i < TREE_ITEMS; i--)
+	{
+		TEST_ASSERT(bplustree->exists(data[i]));
+	}
+
+	/* Try to remove all the data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(bplustree->erase(data[i]));
+		TEST_ASSERT(!bplustree->exists(data[i]));
+	}
+	TEST_ASSERT(bplustree->size() == 0);
+
+	/* Now push enough keys through to split and merge nodes several levels deep */
+	const int stressItems = TREE_ITEMS * 256;
+	int *stress = new int[stressItems];
+	for (int i = 0; i < stressItems; i++)
+	{
+		stress[i] = i * 2;
+	}
+	for (int i = stressItems - 1; i > 0; i--)
+	{
+		int j = RandomNumber() % (i + 1);
+		tmp = stress[i]; stress[i] = stress[j]; stress[j] = tmp;
+	}
+
+	for (int i = 0; i < stressItems; i++)
+	{
+		TEST_ASSERT(bplustree->insert(stress[i], stress[i] + 1));
+	}
+	TEST_ASSERT(!bplustree->insert(stress[0], 0));
+	TEST_ASSERT(bplustree->size() == (uint32_t)stressItems);
+
+	/* The leaves must come out in key order */
+	DArray<int> *keys = bplustree->ConvertIndexToDArray();
+	TEST_ASSERT(keys->used() == (uint32_t)stressItems);
+	for (int i = 0; i < stressItems; i++)
+	{
+		TEST_ASSERT(keys->get(i) == i * 2);
+	}
+	delete keys;
+
+	/* Remove every other key, in random order */
+	for (int i = 0; i < stressItems; i += 2)
+	{
+		TEST_ASSERT(bplustree->erase(stress[i]));
+		TEST_ASSERT(!bplustree->erase(stress[i]));
+	}
+	for (int i = 0; i < stressItems; i++)
+	{
+		TEST_ASSERT(bplustree->exists(stress[i]) == (i % 2 == 1));
+		TEST_ASSERT(!bplustree->exists(stress[i] + 1));
+	}
+	for (int i = 1; i < stressItems; i += 2)
+	{
+		TEST_ASSERT(bplustree->find(stress[i], -1) == stress[i] + 1);
+		TEST_ASSERT(bplustree->erase(stress[i]));
+	}
+	TEST_ASSERT(bplustree->size() == 0);
+	delete [] stress;
+
+	/* And finally, clear the tree */
+	delete bplustree;
+
+	return 0;
+}
@@ -0,0 +1,19 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_bplustree_test_h
+#define __included_bplustree_test_h
+
+int TestBPlusTree_CString();
+int TestBPlusTree_String();
+int TestBPlusTree_Int();
+
+#endif
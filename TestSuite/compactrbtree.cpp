@@ -0,0 +1,224 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#include "header.h"
+#include "compactrbtree.h"
+#include "testutils.h"
+
+#include <crisscross/compactrbtree.h>
+#include <crisscross/node.h>
+
+using namespace CrissCross::Data;
+using namespace CrissCross::System;
+
+int TestCompactRedBlackTree_CString()
+{
+	CompactRedBlackTree<const char *, const char *> *rbtree = new CompactRedBlackTree<const char *, const char *>();
+	char *strings[TREE_ITEMS], *tmp;
+
+	/* Make sure allocation worked */
+	TEST_ASSERT(rbtree != nullptr);
+
+	/* Make sure the size starts at 0 */
+	TEST_ASSERT(rbtree->size() == 0);
+
+	memset(strings, 0, sizeof(strings));
+
+	/* Make sure the tree encapsulates keys properly */
+	tmp = cc_strdup("testkey");
+	rbtree->insert(tmp, "encapsulation test");
+	free(tmp); tmp = nullptr;
+	TEST_ASSERT(rbtree->size() == 1);
+	TEST_ASSERT(rbtree->exists("testkey"));
+	TEST_ASSERT(rbtree->erase("testkey"));
+	TEST_ASSERT(!rbtree->exists("testkey"));
+	TEST_ASSERT(!rbtree->erase("testkey"));
+	TEST_ASSERT(rbtree->size() == 0);
+
+	/* Simplest sanity checks done, now create some random data */
+	for (unsigned int i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(strings[i] == nullptr);
+		strings[i] = new char[20];
+		TEST_ASSERT(strings[i] != nullptr);
+		memset(strings[i], 0, 20);
+		sprintf(strings[i], "%08x", i);
+		TEST_ASSERT(strlen(strings[i]) > 0);
+	}
+
+	/* Fill the tree */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(rbtree->insert(strings[i], strings[(TREE_ITEMS - 1) - i]));
+		TEST_ASSERT(!rbtree->insert(strings[i], strings[i]));
+	}
+	TEST_ASSERT(rbtree->size() == TREE_ITEMS);
+
+	/* Verify existence of all the added data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		const char *val = nullptr;
+		TEST_ASSERT(rbtree->exists(strings[i]));
+		TEST_ASSERT((val = rbtree->find(strings[i])) != nullptr);
+		TEST_ASSERT(Compare(val, (const char *)strings[(TREE_ITEMS - 1) - i]) == 0);
+	}
+
+	/* Try to remove the first half, then verify the rest remains */
+	for (size_t i = 0; i < TREE_ITEMS / 2; i++)
+	{
+		TEST_ASSERT(rbtree->erase(strings[i]));
+		TEST_ASSERT(!rbtree->exists(strings[i]));
+	}
+	for (size_t i = TREE_ITEMS / 2; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(rbtree->exists(strings[i]));
+	}
+
+	/* Released nodes are reused without growing the array */
+	uint32_t usage = rbtree->mem_usage();
+	for (size_t i = 0; i < TREE_ITEMS / 2; i++)
+	{
+		TEST_ASSERT(rbtree->insert(strings[i], strings[i]));
+	}
+	TEST_ASSERT(rbtree->mem_usage() == usage);
+	TEST_ASSERT(rbtree->size() == TREE_ITEMS);
+
+	/* Emptying leaves a usable tree */
+	rbtree->empty();
+	TEST_ASSERT(rbtree->size() == 0);
+	TEST_ASSERT(!rbtree->exists(strings[0]));
+	TEST_ASSERT(rbtree->insert(strings[0], "again"));
+	TEST_ASSERT(rbtree->exists(strings[0]));
+
+	/* Clean up the random data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		delete [] strings[i];
+		strings[i] = nullptr;
+	}
+
+	/* And finally, clear the tree */
+	delete rbtree;
+
+	return 0;
+}
+
+class CheckedCompactRedBlackTree : public CompactRedBlackTree<int, int>
+{
+	protected:
+		typedef uint32_t Index;
+
+		int checkShape(Index _node, Index _parent) const
+		{
+			if (!_node)
+				return 1;
+			if (parent(_node) != _parent)
+				return -1;
+
+			const Node &n = m_nodes[_node];
+			if (isRed(_node) && (isRed(n.left) || isRed(n.right)))
+				return -1;
+
+			int left = checkShape(n.left, _node);
+			int right = checkShape(n.right, _node);
+			if (left < 0 || left != right)
+				return -1;
+
+			return left + (isRed(_node) ? 0 : 1);
+		}
+
+	public:
+		bool valid() const
+		{
+			if (isRed(m_root) || isRed(0) || m_nodes[0].left || m_nodes[0].right)
+				return false;
+			return checkShape(m_root, 0) > 0;
+		}
+};
+
+int TestCompactRedBlackTree_Int()
+{
+	const int keySpace = TREE_ITEMS * 4;
+	bool *present = new bool[keySpace];
+	CheckedCompactRedBlackTree *rbtree = new CheckedCompactRedBlackTree();
+	uint32_t count = 0;
+
+	/* The whole point: a node is at most half the size of a RedBlackNode */
+	TEST_ASSERT(sizeof(CompactRedBlackNode<int, int, uint32_t>) * 2 <= sizeof(RedBlackNode<int, int, true>));
+
+	for (int i = 0; i < keySpace; i++)
+		present[i] = false;
+
+	for (int round = 0; round < 16; round++)
+	{
+		/* Mostly inserts early on, mostly erasures later */
+		for (int i = 0; i < TREE_ITEMS; i++)
+		{
+			int key = (int)(RandomNumber() % keySpace);
+			if ((int)(RandomNumber() % 16) >= round)
+			{
+				TEST_ASSERT(rbtree->insert(key, -key) == !present[key]);
+				if (!present[key])
+					count++;
+				present[key] = true;
+			} else {
+				TEST_ASSERT(rbtree->erase(key) == present[key]);
+				if (present[key])
+					count--;
+				present[key] = false;
+			}
+		}
+
+		TEST_ASSERT(rbtree->valid());
+		TEST_ASSERT(rbtree->size() == count);
+
+		for (int key = 0; key < keySpace; key++)
+		{
+			TEST_ASSERT(rbtree->exists(key) == present[key]);
+			TEST_ASSERT(rbtree->find(key, 1) == (present[key] ? -key : 1));
+		}
+
+		/* Range visits come out in order and match the reference */
+		int lo = (int)(RandomNumber() % keySpace), hi = (int)(RandomNumber() % keySpace);
+		int last = -1;
+		uint32_t expected = 0;
+		bool ordered = true;
+		for (int key = lo; key < hi; key++)
+			if (present[key])
+				expected++;
+		uint32_t visited = rbtree->for_each_in_range(lo, hi, [&](int const &_key, int const &_data) {
+			if (_key <= last || _key < lo || _key >= hi || _data != -_key)
+				ordered = false;
+			last = _key;
+		});
+		TEST_ASSERT(ordered);
+		TEST_ASSERT(visited == expected);
+	}
+
+	TEST_ASSERT(rbtree->replace(keySpace + 1, 0) == false);
+	rbtree->empty();
+	TEST_ASSERT(rbtree->size() == 0);
+	TEST_ASSERT(rbtree->valid());
+
+	/* Ordered insertion stays balanced */
+	for (int key = 0; key < keySpace; key++)
+	{
+		TEST_ASSERT(rbtree->insert(key, key));
+	}
+	TEST_ASSERT(rbtree->valid());
+	TEST_ASSERT(rbtree->replace(0, 42));
+	TEST_ASSERT(rbtree->find(0, -1) == 42);
+
+	delete rbtree;
+	delete [] present;
+
+	return 0;
+}
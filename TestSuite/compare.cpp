@@ -62,3 +62,39 @@ int TestComparison_Integer()
 
 	return 0;
 }
+
+int TestComparison_KeyPrefix()
+{
+	const char *strings[] = {
+		"", "a", "A", "ab", "abcdefg", "abcdefgh", "ABCDEFGH", "abcdefghi",
+		"abcdefghij", "abcdefgi", "abd", "b", "zzzzzzzzzz", "\x7f", "\x80", "\xff\xff"
+	};
+	const size_t count = sizeof(strings) / sizeof(strings[0]);
+
+	/* Prefixes must never disagree with Compare, and must tie on equal keys */
+	for (size_t i = 0; i < count; i++)
+	{
+		for (size_t j = 0; j < count; j++)
+		{
+			const char *a = strings[i], *b = strings[j];
+			uint64_t pa = Data::KeyPrefix<const char *>::Make(a), pb = Data::KeyPrefix<const char *>::Make(b);
+			int cmp = Data::Compare(a, b);
+			if (pa < pb)
+				TEST_ASSERT(cmp < 0);
+			if (pa > pb)
+				TEST_ASSERT(cmp > 0);
+			if (cmp == 0)
+				TEST_ASSERT(pa == pb);
+		}
+	}
+
+	/* Only the first eight bytes are kept */
+	TEST_ASSERT(Data::KeyPrefix<const char *>::Make("abcdefgh") == Data::KeyPrefix<const char *>::Make("abcdefghij"));
+	TEST_ASSERT(Data::KeyPrefix<const char *>::Make("abcdefg") != Data::KeyPrefix<const char *>::Make("abcdefgh"));
+
+	/* Other key types don't have a prefix */
+	TEST_ASSERT(!Data::KeyPrefix<int>::Enabled);
+	TEST_ASSERT(!Data::KeyPrefix<std::string>::Enabled);
+
+	return 0;
+}
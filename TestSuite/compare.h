@@ -15,5 +15,6 @@
 int TestComparison_CString();
 int TestComparison_String();
 int TestComparison_Integer();
+int TestComparison_KeyPrefix();
 
 #endif
@@ -0,0 +1,163 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#include "header.h"
+#include "concurrentrbtree.h"
+#include "testutils.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <crisscross/concurrentrbtree.h>
+
+using namespace CrissCross::Data;
+using namespace CrissCross::System;
+
+int TestConcurrentRedBlackTree_CString()
+{
+	ConcurrentRedBlackTree<const char *, const char *> *rbtree = new ConcurrentRedBlackTree<const char *, const char *>();
+	char *strings[TREE_ITEMS], *tmp;
+
+	/* Make sure allocation worked */
+	TEST_ASSERT(rbtree != nullptr);
+
+	/* Make sure the size starts at 0 */
+	TEST_ASSERT(rbtree->size() == 0);
+
+	memset(strings, 0, sizeof(strings));
+
+	/* Make sure the tree encapsulates keys properly */
+	tmp = cc_strdup("testkey");
+	rbtree->insert(tmp, "encapsulation test");
+	free(tmp); tmp = nullptr;
+	TEST_ASSERT(rbtree->size() == 1);
+	TEST_ASSERT(rbtree->exists("testkey"));
+	TEST_ASSERT(rbtree->erase("testkey"));
+	TEST_ASSERT(!rbtree->exists("testkey"));
+	TEST_ASSERT(!rbtree->erase("testkey"));
+	TEST_ASSERT(rbtree->size() == 0);
+
+	/* Simplest sanity checks done, now create some random data */
+	for (unsigned int i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(strings[i] == nullptr);
+		strings[i] = new char[20];
+		TEST_ASSERT(strings[i] != nullptr);
+		memset(strings[i], 0, 20);
+		TEST_ASSERT(strlen(strings[i]) == 0);
+		sprintf(strings[i], "%08x", i);
+		TEST_ASSERT(strlen(strings[i]) > 0);
+	}
+
+	/* Fill the tree */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(rbtree->insert(strings[i], strings[(TREE_ITEMS - 1) - i]));
+	}
+
+	/* Verify existence of all the added data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		const char *val = nullptr;
+		TEST_ASSERT(rbtree->exists(strings[i]));
+		TEST_ASSERT((val = rbtree->find(strings[i])) != nullptr);
+		TEST_ASSERT(Compare(val, (const char *)strings[(TREE_ITEMS - 1) - i]) == 0);
+	}
+
+	/* Verify existence of all the added data, in a different order */
+	for (size_t i = TREE_ITEMS - 1; i < TREE_ITEMS; i--)
+	{
+		TEST_ASSERT(rbtree->exists(strings[i]));
+	}
+
+	/* Try to remove all the data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(rbtree->erase(strings[i]));
+		TEST_ASSERT(!rbtree->exists(strings[i]));
+	}
+
+	/* Clean up the random data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		delete [] strings[i];
+		strings[i] = nullptr;
+	}
+
+	/* And finally, clear the tree */
+	delete rbtree;
+
+	return 0;
+}
+
+int TestConcurrentRedBlackTree_Threads()
+{
+	ConcurrentRedBlackTree<int, int> *rbtree = new ConcurrentRedBlackTree<int, int>();
+	const int keySpace = TREE_ITEMS * 16;
+	const int readerCount = 3;
+	std::atomic<bool> done(false);
+	std::atomic<int> failures(0);
+
+	/* Even keys stay in the tree throughout, and every key k maps to 2k */
+	for (int key = 0; key < keySpace; key += 2)
+	{
+		TEST_ASSERT(rbtree->insert(key, key * 2));
+	}
+
+	std::vector<std::thread> readers;
+	for (int r = 0; r < readerCount; r++)
+	{
+		readers.emplace_back([&, r]() {
+			unsigned int seed = 12345u + (unsigned int)r;
+			while (!done.load(std::memory_order_relaxed))
+			{
+				seed = seed * 1103515245u + 12345u;
+				int key = (int)((seed >> 8) % (unsigned int)keySpace), data = -1;
+				bool found = rbtree->try_find(key, &data);
+				if ((!found && !(key & 1)) || (found && data != key * 2))
+					failures++;
+			}
+		});
+	}
+
+	/* Churn the odd keys underneath the readers */
+	unsigned int seed = 54321u;
+	for (int i = 0; i < TREE_ITEMS * 256; i++)
+	{
+		seed = seed * 1103515245u + 12345u;
+		int key = (int)((seed >> 8) % (unsigned int)keySpace) | 1;
+		if (rbtree->exists(key))
+			rbtree->erase(key);
+		else
+			rbtree->insert(key, key * 2);
+		rbtree->replace(key - 1, (key - 1) * 2);
+	}
+
+	done = true;
+	for (size_t r = 0; r < readers.size(); r++)
+		readers[r].join();
+
+	TEST_ASSERT(failures == 0);
+
+	/* Emptying while nobody else is reading leaves a usable tree */
+	rbtree->empty();
+	TEST_ASSERT(rbtree->size() == 0);
+	TEST_ASSERT(!rbtree->exists(0));
+	TEST_ASSERT(rbtree->find(0, -1) == -1);
+	TEST_ASSERT(rbtree->insert(0, 7));
+	TEST_ASSERT(rbtree->find(0, -1) == 7);
+
+	delete rbtree;
+
+	return 0;
+}
@@ -0,0 +1,18 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_concurrentrbtree_test_h
+#define __included_concurrentrbtree_test_h
+
+int TestConcurrentRedBlackTree_CString();
+int TestConcurrentRedBlackTree_Threads();
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#include "header.h"
+#include "flatmap.h"
+#include "testutils.h"
+
+#include <vector>
+
+#include <crisscross/flatmap.h>
+#include <crisscross/rbtree.h>
+
+using namespace CrissCross::Data;
+using namespace CrissCross::System;
+
+int TestFlatMap_CString()
+{
+	FlatMap<const char *, const char *> *map = new FlatMap<const char *, const char *>();
+	const char *none = "none";
+	char buffer[32];
+
+	TEST_ASSERT(map->size() == 0);
+	TEST_ASSERT(!map->exists("one"));
+	TEST_ASSERT(map->begin() == map->end());
+
+	/* The map keeps its own copies of the keys */
+	strcpy(buffer, "one");
+	TEST_ASSERT(map->insert(buffer, "first"));
+	strcpy(buffer, "two");
+	TEST_ASSERT(map->insert(buffer, "second"));
+	TEST_ASSERT(map->insert("three", "third"));
+	strcpy(buffer, "zzz");
+
+	/* A key which is already staged is refused too */
+	TEST_ASSERT(map->insert("four", "fourth"));
+	TEST_ASSERT(!map->insert("four", "not fourth"));
+	TEST_ASSERT(!map->insert("two", "not second"));
+	TEST_ASSERT(map->size() == 4);
+	TEST_ASSERT(strcmp(map->find("four", none), "fourth") == 0);
+
+	/* Once committed, a key can't be inserted again */
+	TEST_ASSERT(!map->insert("one", "again"));
+	TEST_ASSERT(strcmp(map->find("one", none), "first") == 0);
+	TEST_ASSERT(strcmp(map->find("two", none), "second") == 0);
+	TEST_ASSERT(strcmp(map->find("zzz", none), none) == 0);
+
+	TEST_ASSERT(map->replace("three", "3rd"));
+	TEST_ASSERT(!map->replace("five", "5th"));
+	TEST_ASSERT(strcmp(map->find("three", none), "3rd") == 0);
+
+	/* Keys come out in order */
+	const char *order[] = { "four", "one", "three", "two" };
+	size_t i = 0;
+	for (FlatMap<const char *, const char *>::iterator it = map->begin(); it != map->end(); ++it, i++) {
+		TEST_ASSERT(i < 4);
+		TEST_ASSERT(strcmp(it.key(), order[i]) == 0);
+	}
+	TEST_ASSERT(i == 4);
+
+	TEST_ASSERT(map->erase("one"));
+	TEST_ASSERT(!map->erase("one"));
+	TEST_ASSERT(!map->exists("one"));
+	TEST_ASSERT(map->size() == 3);
+	TEST_ASSERT(strcmp(map->lower_bound("one").key(), "three") == 0);
+	TEST_ASSERT(!map->lower_bound("zzz").valid());
+
+	/* Staged keys are freed with the map, even if they were never merged */
+	TEST_ASSERT(map->insert("five", "fifth"));
+	delete map;
+	return 0;
+}
+
+int TestFlatMap_Int()
+{
+	const int space = TREE_ITEMS * 8;
+	FlatMap<int, int> *map = new FlatMap<int, int>();
+	RedBlackTree<int, int> *tree = new RedBlackTree<int, int>();
+
+	for (int round = 0; round < 8; round++) {
+		/* A batch of inserts, some of them repeats, then one merge */
+		for (int i = 0; i < TREE_ITEMS; i++) {
+			int key = (int)(RandomNumber() % space);
+			TEST_ASSERT(map->insert(key, round) == !tree->exists(key));
+			tree->insert(key, round);
+		}
+		map->commit();
+		TEST_ASSERT(map->size() == tree->size());
+
+		/* Some single erases and replacements */
+		for (int i = 0; i < TREE_ITEMS / 4; i++) {
+			int key = (int)(RandomNumber() % space);
+			TEST_ASSERT(map->erase(key) == tree->erase(key));
+			key = (int)(RandomNumber() % space);
+			TEST_ASSERT(map->replace(key, -key) == tree->replace(key, -key));
+		}
+		TEST_ASSERT(map->size() == tree->size());
+
+		/* Every lookup, lower bound and the full order match the tree */
+		for (int key = -1; key <= space; key++) {
+			TEST_ASSERT(map->exists(key) == tree->exists(key));
+			TEST_ASSERT(map->find(key, space) == tree->find(key, space));
+
+			FlatMap<int, int>::iterator a = map->lower_bound(key);
+			RedBlackTree<int, int>::iterator b = tree->lower_bound(key);
+			TEST_ASSERT(a.valid() == b.valid());
+			TEST_ASSERT(!a.valid() || (a.key() == b.key() && a.data() == b.data()));
+		}
+
+		RedBlackTree<int, int>::iterator b = tree->begin();
+		for (FlatMap<int, int>::iterator a = map->begin(); a != map->end(); ++a, ++b) {
+			TEST_ASSERT(b.valid());
+			TEST_ASSERT(a.key() == b.key() && a.data() == b.data());
+		}
+		TEST_ASSERT(!b.valid());
+	}
+
+	map->empty();
+	TEST_ASSERT(map->size() == 0);
+	TEST_ASSERT(!map->lower_bound(0).valid());
+
+	delete tree;
+	delete map;
+	return 0;
+}
@@ -64,3 +64,41 @@ int TestHashTable_CString()
 
 	return 0;
 }
+
+int TestHashTable_FindBatch()
+{
+	HashTable<int> ht;
+
+	char buffers[100][32];
+	const char *keys[100];
+
+	/* Enough keys to grow the table a few times, and to leave a partial last group */
+	for (int i = 0; i < 100; i++) {
+		sprintf(buffers[i], "%d", i);
+		keys[i] = buffers[i];
+		if (i % 3 != 0)
+			ht.insert(keys[i], i);
+	}
+
+	/* Deleted slots mustn't stop a probe */
+	TEST_ASSERT(ht.erase("1"));
+
+	int out[100];
+	size_t found = ht.find_batch(keys, 100, out, -1);
+	size_t expected = 0;
+	for (int i = 0; i < 100; i++) {
+		TEST_ASSERT(out[i] == ht.find(keys[i], -1));
+		if (out[i] != -1)
+			expected++;
+	}
+	TEST_ASSERT(found == expected);
+	TEST_ASSERT(found == 65);
+
+	/* Nothing is written past the end */
+	out[1] = 12345;
+	TEST_ASSERT(ht.find_batch(keys, 1, out, -1) == 0);
+	TEST_ASSERT(out[0] == -1 && out[1] == 12345);
+	TEST_ASSERT(ht.find_batch(keys, 0, out, -1) == 0);
+
+	return 0;
+}
@@ -13,5 +13,6 @@
 #define __included_hashtable_test_h
 
 int TestHashTable_CString();
+int TestHashTable_FindBatch();
 
 #endif
@@ -0,0 +1,188 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#include "header.h"
+#include "intervaltree.h"
+#include "testutils.h"
+
+#include <vector>
+
+#include <crisscross/intervaltree.h>
+
+using namespace CrissCross::Data;
+using namespace CrissCross::System;
+
+/* Returns the largest high bound in a subtree, or -2 if some node's maxHi is wrong */
+template <class Node>
+static int CheckMaxHi(const Node *_node, const Node *_nil)
+{
+	if (_node == _nil)
+		return -1;
+
+	int left = CheckMaxHi(_node->left, _nil);
+	int right = CheckMaxHi(_node->right, _nil);
+	if (left == -2 || right == -2)
+		return -2;
+
+	int maxHi = _node->id.hi;
+	if (left > maxHi)
+		maxHi = left;
+	if (right > maxHi)
+		maxHi = right;
+	return (_node->data.maxHi == maxHi) ? maxHi : -2;
+}
+
+class CheckedIntervalTree : public IntervalTree<int, int>
+{
+	public:
+		bool valid() const
+		{
+			return CheckMaxHi(rootNode, nullNode) != -2;
+		}
+};
+
+int TestIntervalTree_Int()
+{
+	CheckedIntervalTree *tree = new CheckedIntervalTree();
+
+	TEST_ASSERT(tree->size() == 0);
+	TEST_ASSERT(!tree->overlaps(0, 100));
+	TEST_ASSERT(tree->for_each_containing(5, [](int, int, int) {}) == 0);
+
+	TEST_ASSERT(tree->insert(10, 20, 1));
+	TEST_ASSERT(tree->insert(15, 25, 2));
+	TEST_ASSERT(tree->insert(30, 30, 3));
+	TEST_ASSERT(tree->insert(10, 40, 4));
+	TEST_ASSERT(tree->size() == 4);
+	TEST_ASSERT(tree->valid());
+
+	/* Each interval is stored once, and must not be backwards */
+	TEST_ASSERT(!tree->insert(10, 20, 5));
+	TEST_ASSERT(!tree->insert(20, 10, 5));
+	TEST_ASSERT(tree->size() == 4);
+
+	TEST_ASSERT(tree->exists(10, 20));
+	TEST_ASSERT(!tree->exists(10, 21));
+	TEST_ASSERT(tree->find(15, 25, -1) == 2);
+	TEST_ASSERT(tree->find(15, 26, -1) == -1);
+	TEST_ASSERT(tree->replace(15, 25, 6));
+	TEST_ASSERT(tree->find(15, 25, -1) == 6);
+	TEST_ASSERT(!tree->replace(0, 1, 6));
+	TEST_ASSERT(tree->valid());
+
+	/* Both ends are part of an interval */
+	int seen = 0;
+	bool wrong = false;
+	TEST_ASSERT(tree->for_each_containing(20, [&](int _lo, int _hi, int _data) {
+		if (_lo > 20 || _hi < 20)
+			wrong = true;
+		seen += _data;
+	}) == 3);
+	TEST_ASSERT(!wrong);
+	TEST_ASSERT(seen == 1 + 6 + 4);
+	TEST_ASSERT(tree->for_each_containing(30, [](int, int, int) {}) == 2);
+	TEST_ASSERT(tree->for_each_containing(41, [](int, int, int) {}) == 0);
+	TEST_ASSERT(tree->for_each_overlapping(26, 29, [](int, int, int) {}) == 1);
+	TEST_ASSERT(tree->for_each_overlapping(29, 26, [](int, int, int) {}) == 0);
+	TEST_ASSERT(tree->overlaps(31, 35));
+	TEST_ASSERT(!tree->overlaps(41, 50));
+	TEST_ASSERT(!tree->overlaps(0, 9));
+
+	/* Results come out in order */
+	int last = -1;
+	TEST_ASSERT(tree->for_each_overlapping(0, 100, [&](int _lo, int, int) {
+		if (_lo < last)
+			wrong = true;
+		last = _lo;
+	}) == 4);
+	TEST_ASSERT(!wrong);
+
+	/* Erasing the interval with the largest end shrinks the tree's reach */
+	TEST_ASSERT(tree->erase(10, 40));
+	TEST_ASSERT(!tree->erase(10, 40));
+	TEST_ASSERT(tree->valid());
+	TEST_ASSERT(!tree->overlaps(31, 35));
+	TEST_ASSERT(tree->size() == 3);
+
+	tree->empty();
+	TEST_ASSERT(tree->size() == 0);
+	TEST_ASSERT(!tree->overlaps(0, 100));
+
+	delete tree;
+	return 0;
+}
+
+struct Span
+{
+	int lo, hi;
+	bool used;
+};
+
+int TestIntervalTree_Overlaps()
+{
+	const int space = TREE_ITEMS * 8;
+	CheckedIntervalTree *tree = new CheckedIntervalTree();
+	std::vector<Span> spans(TREE_ITEMS * 4);
+
+	for (int round = 0; round < 8; round++) {
+		/* Insert and erase at random, so rotations happen in both fixups */
+		for (size_t i = 0; i < spans.size(); i++) {
+			size_t slot = RandomNumber() % spans.size();
+			Span &span = spans[slot];
+			if (span.used) {
+				TEST_ASSERT(tree->erase(span.lo, span.hi));
+				span.used = false;
+			} else {
+				span.lo = (int)(RandomNumber() % space);
+				span.hi = span.lo + (int)(RandomNumber() % (RandomNumber() % 4 ? 8 : space / 4));
+				span.used = tree->insert(span.lo, span.hi, (int)slot);
+			}
+		}
+		TEST_ASSERT(tree->valid());
+
+		uint32_t used = 0;
+		for (size_t i = 0; i < spans.size(); i++)
+			used += spans[i].used ? 1 : 0;
+		TEST_ASSERT(tree->size() == used);
+
+		/* Every query matches a linear scan */
+		for (int q = 0; q < TREE_ITEMS; q++) {
+			int lo = (int)(RandomNumber() % space) - 4;
+			int hi = lo + (int)(RandomNumber() % 16);
+
+			uint32_t expected = 0;
+			for (size_t i = 0; i < spans.size(); i++) {
+				if (spans[i].used && spans[i].lo <= hi && spans[i].hi >= lo)
+					expected++;
+			}
+
+			bool wrong = false;
+			uint32_t found = tree->for_each_overlapping(lo, hi, [&](int _lo, int _hi, int _data) {
+				Span const &span = spans[_data];
+				if (!span.used || span.lo != _lo || span.hi != _hi || _lo > hi || _hi < lo)
+					wrong = true;
+			});
+			TEST_ASSERT(!wrong);
+			TEST_ASSERT(found == expected);
+			TEST_ASSERT(tree->overlaps(lo, hi) == (expected != 0));
+
+			uint32_t stabbed = 0;
+			for (size_t i = 0; i < spans.size(); i++) {
+				if (spans[i].used && spans[i].lo <= lo && spans[i].hi >= lo)
+					stabbed++;
+			}
+			TEST_ASSERT(tree->for_each_containing(lo, [](int, int, int) {}) == stabbed);
+		}
+	}
+
+	delete tree;
+	return 0;
+}
@@ -17,14 +17,27 @@
 #include "darray.h"
 #include "dstack.h"
 #include "llist.h"
+#include "nodepool.h"
 #include "splaytree.h"
 #include "stltree.h"
 #include "avltree.h"
+#include "persistentavltree.h"
 #include "rbtree.h"
+#include "compactrbtree.h"
+#include "concurrentrbtree.h"
+#include "intervaltree.h"
 #include "hashtable.h"
 #include "stopwatch.h"
 #include "stree.h"
+#include "bplustree.h"
+#include "radixtree.h"
+#include "staticindex.h"
+#include "priorityqueue.h"
+#include "flatmap.h"
+#include "bloomfilter.h"
+#include "quadtree.h"
 #include "sort.h"
+#include "treeiterator.h"
 
 using namespace CrissCross;
 
@@ -50,14 +63,18 @@ int main(int argc, char * *argv)
 	WritePrefix("char* Compare"); retval |= WriteResult(TestComparison_CString());
 	WritePrefix("std::string Compare"); retval |= WriteResult(TestComparison_String());
 	WritePrefix("Integer Compare"); retval |= WriteResult(TestComparison_Integer());
+	WritePrefix("KeyPrefix"); retval |= WriteResult(TestComparison_KeyPrefix());
 
 	WritePrefix("LList"); retval |= WriteResult(TestLList());
 	WritePrefix("DArray"); retval |= WriteResult(TestDArray());
 	WritePrefix("DStack"); retval |= WriteResult(TestDStack());
+	WritePrefix("NodePool"); retval |= WriteResult(TestNodePool());
 
 	WritePrefix("SplayTree<const char *, const char *>"); retval |= WriteResult(TestSplayTree_CString());
 	WritePrefix("SplayTree<std::string, std::string>"); retval |= WriteResult(TestSplayTree_String());
 	WritePrefix("SplayTree<int, int>"); retval |= WriteResult(TestSplayTree_Int());
+	WritePrefix("SplayTree splay policies"); retval |= WriteResult(TestSplayTree_Policies());
+	WritePrefix("SplayTree<int, int> threaded"); retval |= WriteResult(TestSplayTree_Threads());
 
 #ifdef ENABLE_STLTREE
 	WritePrefix("STLTree<const char *, const char *>"); retval |= WriteResult(TestSTLTree_CString());
@@ -68,18 +85,80 @@ int main(int argc, char * *argv)
 	WritePrefix("AVLTree<const char *, const char *>"); retval |= WriteResult(TestAVLTree_CString());
 	WritePrefix("AVLTree<std::string, std::string>"); retval |= WriteResult(TestAVLTree_String());
 	WritePrefix("AVLTree<int, int>"); retval |= WriteResult(TestAVLTree_Int());
+	WritePrefix("AVLTree::build_from_sorted"); retval |= WriteResult(TestAVLTree_BuildFromSorted());
+	WritePrefix("AVLTree order statistics"); retval |= WriteResult(TestAVLTree_OrderStatistics());
+	WritePrefix("AVLTree set operations"); retval |= WriteResult(TestAVLTree_SetOperations());
+	WritePrefix("AVLTree with shared key prefixes"); retval |= WriteResult(TestAVLTree_SharedPrefixes());
+	WritePrefix("AVLTree batched lookups"); retval |= WriteResult(TestAVLTree_FindBatch());
+	WritePrefix("AVLTree hinted operations"); retval |= WriteResult(TestAVLTree_Hinted());
+
+	WritePrefix("PersistentAVLTree<const char *, const char *>"); retval |= WriteResult(TestPersistentAVLTree_CString());
+	WritePrefix("PersistentAVLTree snapshots"); retval |= WriteResult(TestPersistentAVLTree_Snapshots());
+	WritePrefix("PersistentAVLTree threaded"); retval |= WriteResult(TestPersistentAVLTree_Threads());
 
 	WritePrefix("RedBlackTree<const char *, const char *>"); retval |= WriteResult(TestRedBlackTree_CString());
 	WritePrefix("RedBlackTree<std::string, std::string>"); retval |= WriteResult(TestRedBlackTree_String());
 	WritePrefix("RedBlackTree<int, int>"); retval |= WriteResult(TestRedBlackTree_Int());
+	WritePrefix("RedBlackTree::build_from_sorted"); retval |= WriteResult(TestRedBlackTree_BuildFromSorted());
+	WritePrefix("RedBlackTree order statistics"); retval |= WriteResult(TestRedBlackTree_OrderStatistics());
+	WritePrefix("RedBlackTree with shared key prefixes"); retval |= WriteResult(TestRedBlackTree_SharedPrefixes());
+	WritePrefix("RedBlackTree batched lookups"); retval |= WriteResult(TestRedBlackTree_FindBatch());
+	WritePrefix("RedBlackTree hinted operations"); retval |= WriteResult(TestRedBlackTree_Hinted());
+
+	WritePrefix("IntervalTree<int, int>"); retval |= WriteResult(TestIntervalTree_Int());
+	WritePrefix("IntervalTree overlap queries"); retval |= WriteResult(TestIntervalTree_Overlaps());
+
+	WritePrefix("ConcurrentRedBlackTree<const char *, const char *>"); retval |= WriteResult(TestConcurrentRedBlackTree_CString());
+	WritePrefix("ConcurrentRedBlackTree<int, int> threaded"); retval |= WriteResult(TestConcurrentRedBlackTree_Threads());
+
+	WritePrefix("CompactRedBlackTree<const char *, const char *>"); retval |= WriteResult(TestCompactRedBlackTree_CString());
+	WritePrefix("CompactRedBlackTree<int, int>"); retval |= WriteResult(TestCompactRedBlackTree_Int());
 
 	WritePrefix("STree<const char *, const char *>"); retval |= WriteResult(TestSTree_CString());
 	WritePrefix("STree<std::string, std::string>"); retval |= WriteResult(TestSTree_String());
 	WritePrefix("STree<int, int>"); retval |= WriteResult(TestSTree_Int());
+	WritePrefix("STree balancing"); retval |= WriteResult(TestSTree_Balance());
+
+	WritePrefix("BPlusTree<const char *, const char *>"); retval |= WriteResult(TestBPlusTree_CString());
+	WritePrefix("BPlusTree<std::string, std::string>"); retval |= WriteResult(TestBPlusTree_String());
+	WritePrefix("BPlusTree<int, int>"); retval |= WriteResult(TestBPlusTree_Int());
+
+	WritePrefix("RadixTree<const char *>"); retval |= WriteResult(TestRadixTree_CString());
+	WritePrefix("RadixTree ordering"); retval |= WriteResult(TestRadixTree_Order());
+
+	WritePrefix("StaticIndex<int, int>"); retval |= WriteResult(TestStaticIndex_Int());
+	WritePrefix("StaticIndex save and load"); retval |= WriteResult(TestStaticIndex_File());
+
+	WritePrefix("PriorityQueue<int, int>"); retval |= WriteResult(TestPriorityQueue_Int());
+	WritePrefix("PriorityQueue handles"); retval |= WriteResult(TestPriorityQueue_Handles());
+	WritePrefix("PriorityQueue heapify"); retval |= WriteResult(TestPriorityQueue_Heapify());
+
+	WritePrefix("FlatMap<const char *, const char *>"); retval |= WriteResult(TestFlatMap_CString());
+	WritePrefix("FlatMap<int, int>"); retval |= WriteResult(TestFlatMap_Int());
+
+	WritePrefix("BloomFilter<int>"); retval |= WriteResult(TestBloomFilter_Int());
+	WritePrefix("BloomFilter<const char *>"); retval |= WriteResult(TestBloomFilter_CString());
+	WritePrefix("FilteredMap over AVLTree"); retval |= WriteResult(TestFilteredMap_AVLTree());
+	WritePrefix("FilteredMap over RedBlackTree"); retval |= WriteResult(TestFilteredMap_RedBlackTree());
+	WritePrefix("FilteredMap over HashTable"); retval |= WriteResult(TestFilteredMap_HashTable());
+
+	WritePrefix("Quadtree circle queries"); retval |= WriteResult(TestQuadtree_Circle());
+	WritePrefix("Quadtree removal"); retval |= WriteResult(TestQuadtree_Remove());
+	WritePrefix("Quadtree nearest queries"); retval |= WriteResult(TestQuadtree_Nearest());
+	WritePrefix("Quadtree rectangle queries"); retval |= WriteResult(TestQuadtree_Rect());
+	WritePrefix("Quadtree ray casts"); retval |= WriteResult(TestQuadtree_Ray());
+
+	WritePrefix("AVLTree iterators"); retval |= WriteResult(TestTreeIterator_AVLTree());
+	WritePrefix("RedBlackTree iterators"); retval |= WriteResult(TestTreeIterator_RedBlackTree());
+	WritePrefix("SplayTree iterators"); retval |= WriteResult(TestTreeIterator_SplayTree());
+	WritePrefix("STree iterators"); retval |= WriteResult(TestTreeIterator_STree());
+	WritePrefix("BPlusTree iterators"); retval |= WriteResult(TestTreeIterator_BPlusTree());
 
 	WritePrefix("HashTable<const char *, const char *>"); retval |= WriteResult(TestHashTable_CString());
+	WritePrefix("HashTable batched lookups"); retval |= WriteResult(TestHashTable_FindBatch());
 
 	WritePrefix("LList std::sort"); retval |= WriteResult(TestSort_LList());
+	WritePrefix("LList::sort"); retval |= WriteResult(TestSort_LListNative());
 
 	CrissCross::Data::CombSort<int> cs;
 	WritePrefix("CombSort (integer array)"); retval |= WriteResult(TestSort_IntArray(&cs));
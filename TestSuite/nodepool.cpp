@@ -0,0 +1,77 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#include "header.h"
+#include "nodepool.h"
+#include "testutils.h"
+
+#include <crisscross/nodepool.h>
+
+using namespace CrissCross::Data;
+
+int TestNodePool()
+{
+	NodePool<AVLNode<int, int, false> > pool;
+	AVLNode<int, int, false> *nodes[TREE_ITEMS];
+
+	TEST_ASSERT(pool.used() == 0);
+	TEST_ASSERT(pool.mem_usage() == 0);
+
+	for (size_t i = 0; i < TREE_ITEMS; i++) {
+		nodes[i] = pool.construct();
+		TEST_ASSERT(nodes[i] != nullptr);
+		TEST_ASSERT(nodes[i]->left == nullptr && nodes[i]->right == nullptr);
+		nodes[i]->id = (int)i;
+	}
+
+	TEST_ASSERT(pool.used() == TREE_ITEMS);
+	TEST_ASSERT(pool.mem_usage() >= TREE_ITEMS * sizeof(AVLNode<int, int, false>));
+
+	/* Nothing handed out twice */
+	for (size_t i = 0; i < TREE_ITEMS; i++) {
+		TEST_ASSERT(nodes[i]->id == (int)i);
+	}
+
+	/* Released slots are reused before the pool grows */
+	size_t before = pool.mem_usage();
+	pool.destroy(nodes[TREE_ITEMS / 2]);
+	TEST_ASSERT(pool.used() == TREE_ITEMS - 1);
+	nodes[TREE_ITEMS / 2] = pool.construct();
+	TEST_ASSERT(pool.mem_usage() == before);
+
+	/* Tear down a degenerate (linked list shaped) tree without recursion */
+	for (size_t i = 1; i < TREE_ITEMS; i++) {
+		nodes[i - 1]->right = nodes[i];
+		nodes[i]->parent = nodes[i - 1];
+	}
+	pool.destroyTree(nodes[0]);
+	TEST_ASSERT(pool.used() == 0);
+
+	pool.release();
+	TEST_ASSERT(pool.mem_usage() == 0);
+
+	/* Trees owning C-style string keys must still free them on empty() */
+	AVLTree<const char *, int> *tree = new AVLTree<const char *, int>();
+	TEST_ASSERT(!(AVLNode<const char *, int, true>::TrivialTeardown));
+	TEST_ASSERT((AVLNode<int, int, true>::TrivialTeardown));
+	for (int i = 0; i < TREE_ITEMS; i++) {
+		char buf[20];
+		sprintf(buf, "%08x", i);
+		TEST_ASSERT(tree->insert(buf, i));
+	}
+	tree->empty();
+	TEST_ASSERT(tree->size() == 0);
+	TEST_ASSERT(!tree->exists("00000000"));
+	TEST_ASSERT(tree->insert("00000000", 0));
+	delete tree;
+
+	return 0;
+}
@@ -0,0 +1,270 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#include "header.h"
+#include "persistentavltree.h"
+#include "testutils.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <crisscross/persistentavltree.h>
+
+using namespace CrissCross::Data;
+using namespace CrissCross::System;
+
+int TestPersistentAVLTree_CString()
+{
+	PersistentAVLTree<const char *, const char *> *avltree = new PersistentAVLTree<const char *, const char *>();
+	char *strings[TREE_ITEMS], *tmp;
+
+	/* Make sure allocation worked */
+	TEST_ASSERT(avltree != nullptr);
+
+	/* Make sure the size starts at 0 */
+	TEST_ASSERT(avltree->size() == 0);
+
+	memset(strings, 0, sizeof(strings));
+
+	/* Make sure the tree encapsulates keys properly */
+	tmp = cc_strdup("testkey");
+	avltree->insert(tmp, "encapsulation test");
+	free(tmp); tmp = nullptr;
+	TEST_ASSERT(avltree->size() == 1);
+	TEST_ASSERT(avltree->exists("testkey"));
+	TEST_ASSERT(avltree->erase("testkey"));
+	TEST_ASSERT(!avltree->exists("testkey"));
+	TEST_ASSERT(!avltree->erase("testkey"));
+	TEST_ASSERT(avltree->size() == 0);
+
+	/* Simplest sanity checks done, now create some random data */
+	for (unsigned int i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(strings[i] == nullptr);
+		strings[i] = new char[20];
+		TEST_ASSERT(strings[i] != nullptr);
+		memset(strings[i], 0, 20);
+		TEST_ASSERT(strlen(strings[i]) == 0);
+		sprintf(strings[i], "%08x", i);
+		TEST_ASSERT(strlen(strings[i]) > 0);
+	}
+
+	/* Fill the tree */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(avltree->insert(strings[i], strings[(TREE_ITEMS - 1) - i]));
+	}
+
+	/* Verify existence of all the added data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		const char *val = nullptr;
+		TEST_ASSERT(avltree->exists(strings[i]));
+		TEST_ASSERT((val = avltree->find(strings[i])) != nullptr);
+		TEST_ASSERT(Compare(val, (const char *)strings[(TREE_ITEMS - 1) - i]) == 0);
+	}
+
+	/* Verify existence of all the added data, in a different order */
+	for (size_t i = TREE_ITEMS - 1; i < TREE_ITEMS; i--)
+	{
+		TEST_ASSERT(avltree->exists(strings[i]));
+	}
+
+	/* Nodes rebuilt by a change share their keys with the old version */
+	{
+		PersistentAVLTree<const char *, const char *> before(*avltree);
+		TEST_ASSERT(avltree->replace(strings[0], "replaced"));
+		TEST_ASSERT(avltree->erase(strings[1]));
+
+		std::vector<const char *> oldKeys, newKeys;
+		before.for_each_in_range("", "~", [&](const char *const &_key, const char *const &) { oldKeys.push_back(_key); });
+		avltree->for_each_in_range("", "~", [&](const char *const &_key, const char *const &) { newKeys.push_back(_key); });
+		TEST_ASSERT(oldKeys.size() == TREE_ITEMS);
+		TEST_ASSERT(newKeys.size() == TREE_ITEMS - 1);
+		oldKeys.erase(oldKeys.begin() + 1);
+		TEST_ASSERT(oldKeys == newKeys);
+
+		TEST_ASSERT(avltree->insert(strings[1], strings[TREE_ITEMS - 2]));
+	}
+	TEST_ASSERT(strcmp(avltree->find(strings[0]), "replaced") == 0);
+
+	/* Try to remove all the data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(avltree->erase(strings[i]));
+		TEST_ASSERT(!avltree->exists(strings[i]));
+	}
+
+	/* Clean up the random data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		delete [] strings[i];
+		strings[i] = nullptr;
+	}
+
+	/* And finally, clear the tree */
+	delete avltree;
+
+	return 0;
+}
+
+/* Returns the height of a subtree, or -1 if it is out of order or unbalanced */
+template <class Node>
+static int CheckPersistentShape(const Node *_node, int _lo, int _hi)
+{
+	if (!_node)
+		return 0;
+	if (_node->id < _lo || _node->id > _hi || _node->refs.load() == 0)
+		return -1;
+
+	int left = CheckPersistentShape(_node->left, _lo, _node->id - 1);
+	int right = CheckPersistentShape(_node->right, _node->id + 1, _hi);
+	if (left < 0 || right < 0 || left - right > 1 || right - left > 1)
+		return -1;
+
+	int height = 1 + (left > right ? left : right);
+	if (_node->height != height)
+		return -1;
+
+	return height;
+}
+
+class CheckedPersistentAVLTree : public PersistentAVLTree<int, int>
+{
+	public:
+		bool valid() const
+		{
+			return CheckPersistentShape(m_root, -1, TREE_ITEMS * 4) >= 0;
+		}
+
+		bool sharesLeftWith(const CheckedPersistentAVLTree &_other) const
+		{
+			return m_root && _other.m_root && m_root->left == _other.m_root->left;
+		}
+};
+
+int TestPersistentAVLTree_Snapshots()
+{
+	const int keySpace = TREE_ITEMS * 4;
+	const int versions = 8;
+	std::vector<CheckedPersistentAVLTree> snapshots;
+	std::vector< std::vector<bool> > expected;
+	std::vector<bool> present(keySpace, false);
+	CheckedPersistentAVLTree tree;
+
+	for (int v = 0; v < versions; v++)
+	{
+		for (int i = 0; i < TREE_ITEMS; i++)
+		{
+			int key = (int)(RandomNumber() % keySpace);
+			if ((int)(RandomNumber() % versions) >= v)
+			{
+				TEST_ASSERT(tree.insert(key, key + v) == !present[key]);
+				if (!present[key])
+					present[key] = true;
+				else
+					TEST_ASSERT(tree.replace(key, key + v));
+			} else {
+				TEST_ASSERT(tree.erase(key) == present[key]);
+				present[key] = false;
+			}
+		}
+		TEST_ASSERT(tree.valid());
+
+		snapshots.push_back(tree);
+		TEST_ASSERT(snapshots.back().same_version(tree));
+		expected.push_back(present);
+	}
+
+	/* Changing the tree after the fact didn't disturb any snapshot */
+	tree.empty();
+	TEST_ASSERT(tree.size() == 0);
+	TEST_ASSERT(!tree.exists(0));
+
+	for (int v = 0; v < versions; v++)
+	{
+		CheckedPersistentAVLTree const &snapshot = snapshots[v];
+		uint32_t count = 0;
+		TEST_ASSERT(snapshot.valid());
+		for (int key = 0; key < keySpace; key++)
+		{
+			TEST_ASSERT(snapshot.exists(key) == expected[v][key]);
+			if (expected[v][key])
+			{
+				int data = snapshot.find(key, -1);
+				TEST_ASSERT(data >= key && data <= key + v);
+				count++;
+			}
+		}
+		TEST_ASSERT(snapshot.size() == count);
+		TEST_ASSERT(snapshot.for_each_in_range(-1, keySpace, [](int const &, int const &) {}) == count);
+	}
+
+	/* An update only copies its path, so the untouched half is shared */
+	CheckedPersistentAVLTree before = snapshots.back(), after = before;
+	int high = keySpace;
+	while (after.exists(high))
+		high++;
+	TEST_ASSERT(after.insert(high, 0));
+	TEST_ASSERT(!after.same_version(before));
+	TEST_ASSERT(after.sharesLeftWith(before) || after.size() < 8);
+	TEST_ASSERT(!before.exists(high));
+
+	return 0;
+}
+
+int TestPersistentAVLTree_Threads()
+{
+	SnapshotCell< PersistentAVLTree<int, int> > cell;
+	const int readerCount = 3;
+	const int updates = TREE_ITEMS * 16;
+	std::atomic<bool> done(false);
+	std::atomic<int> failures(0);
+
+	/* Version v holds the keys 0 to v, and key 0 maps to v */
+	PersistentAVLTree<int, int> tree;
+	tree.insert(0, 0);
+	cell.store(tree);
+
+	std::vector<std::thread> readers;
+	for (int r = 0; r < readerCount; r++)
+	{
+		readers.emplace_back([&]() {
+			while (!done.load(std::memory_order_relaxed))
+			{
+				PersistentAVLTree<int, int> snapshot = cell.load();
+				int v = snapshot.find(0, -1);
+				if (v < 0 || snapshot.size() != (uint32_t)v + 1 ||
+				    !snapshot.exists(v) || snapshot.exists(v + 1) ||
+				    snapshot.for_each_in_range(0, v + 1, [](int const &, int const &) {}) != (uint32_t)v + 1)
+					failures++;
+			}
+		});
+	}
+
+	for (int v = 1; v <= updates; v++)
+	{
+		TEST_ASSERT(tree.insert(v, v));
+		TEST_ASSERT(tree.replace(0, v));
+		cell.store(tree);
+	}
+
+	done = true;
+	for (size_t r = 0; r < readers.size(); r++)
+		readers[r].join();
+
+	TEST_ASSERT(failures == 0);
+	TEST_ASSERT(cell.load().size() == (uint32_t)updates + 1);
+
+	return 0;
+}
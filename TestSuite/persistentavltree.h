@@ -0,0 +1,19 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_persistentavltree_test_h
+#define __included_persistentavltree_test_h
+
+int TestPersistentAVLTree_CString();
+int TestPersistentAVLTree_Snapshots();
+int TestPersistentAVLTree_Threads();
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#include "header.h"
+#include "priorityqueue.h"
+#include "testutils.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <crisscross/priorityqueue.h>
+
+using namespace CrissCross::Data;
+using namespace CrissCross::System;
+
+/* Pushes random keys, then checks they come out in order */
+template <unsigned int Arity>
+static int TestOrder()
+{
+	PriorityQueue<int, int, Arity> *queue = new PriorityQueue<int, int, Arity>();
+	std::vector<int> keys;
+
+	TEST_ASSERT(queue->size() == 0);
+	TEST_ASSERT(queue->top_handle() == (PriorityQueue<int, int, Arity>::InvalidHandle));
+
+	for (int i = 0; i < TREE_ITEMS * 4; i++) {
+		/* Plenty of duplicates */
+		int key = (int)(RandomNumber() % (TREE_ITEMS * 2));
+		keys.push_back(key);
+		queue->push(key, -key);
+		TEST_ASSERT(queue->size() == (uint32_t)keys.size());
+	}
+
+	std::sort(keys.begin(), keys.end());
+	for (size_t i = 0; i < keys.size(); i++) {
+		TEST_ASSERT(queue->top_key() == keys[i]);
+		TEST_ASSERT(queue->top() == -keys[i]);
+		TEST_ASSERT(queue->pop() == -keys[i]);
+	}
+	TEST_ASSERT(queue->size() == 0);
+
+	/* Interleaved pushes and pops, as a timer queue sees them */
+	int last = -1;
+	for (int i = 0; i < TREE_ITEMS * 4; i++) {
+		queue->push(last + 1 + (int)(RandomNumber() % 16), i);
+		if (i % 3 == 2) {
+			int key = queue->top_key();
+			TEST_ASSERT(key >= last);
+			last = key;
+			queue->pop();
+		}
+	}
+	while (queue->size()) {
+		TEST_ASSERT(queue->top_key() >= last);
+		last = queue->top_key();
+		queue->pop();
+	}
+
+	delete queue;
+	return 0;
+}
+
+int TestPriorityQueue_Int()
+{
+	TEST_ASSERT(TestOrder<2>() == 0);
+	TEST_ASSERT(TestOrder<3>() == 0);
+	TEST_ASSERT(TestOrder<4>() == 0);
+	TEST_ASSERT(TestOrder<8>() == 0);
+	return 0;
+}
+
+int TestPriorityQueue_Handles()
+{
+	typedef PriorityQueue<int, int> Queue;
+	Queue *queue = new Queue();
+	Queue::Handle handles[TREE_ITEMS];
+
+	for (int i = 0; i < TREE_ITEMS; i++) {
+		handles[i] = queue->push(1000 + i, i);
+		TEST_ASSERT(queue->contains(handles[i]));
+	}
+
+	/* Handles follow their entries around the heap */
+	for (int i = 0; i < TREE_ITEMS; i++) {
+		TEST_ASSERT(queue->key(handles[i]) == 1000 + i);
+		TEST_ASSERT(queue->data(handles[i]) == i);
+	}
+
+	/* Lowering a key moves it to the top */
+	TEST_ASSERT(queue->decrease_key(handles[100], 5));
+	TEST_ASSERT(queue->top_handle() == handles[100]);
+	TEST_ASSERT(queue->top() == 100);
+
+	/* But decrease_key won't raise one */
+	TEST_ASSERT(!queue->decrease_key(handles[100], 2000));
+	TEST_ASSERT(queue->key(handles[100]) == 5);
+
+	/* update_key goes either way */
+	TEST_ASSERT(queue->update_key(handles[100], 5000));
+	TEST_ASSERT(queue->top_handle() == handles[0]);
+	TEST_ASSERT(queue->update_key(handles[50], 1));
+	TEST_ASSERT(queue->top_handle() == handles[50]);
+
+	/* Erase every other entry, including the top */
+	for (int i = 0; i < TREE_ITEMS; i += 2) {
+		TEST_ASSERT(queue->erase(handles[i]));
+		TEST_ASSERT(!queue->contains(handles[i]));
+		TEST_ASSERT(!queue->erase(handles[i]));
+		TEST_ASSERT(!queue->decrease_key(handles[i], 0));
+	}
+	TEST_ASSERT(queue->size() == TREE_ITEMS / 2);
+
+	/* The rest come out in order */
+	int last = -1;
+	for (int i = 1; i < TREE_ITEMS; i += 2) {
+		Queue::Handle top = queue->top_handle();
+		TEST_ASSERT(queue->key(top) > last);
+		last = queue->key(top);
+		TEST_ASSERT(queue->data(top) % 2 == 1);
+		queue->pop();
+		TEST_ASSERT(!queue->contains(top));
+	}
+	TEST_ASSERT(queue->size() == 0);
+
+	/* Freed handles are reused, and the stale ones don't see the new entries' data */
+	Queue::Handle reused = queue->push(7, 7);
+	TEST_ASSERT(reused < (Queue::Handle)TREE_ITEMS);
+	TEST_ASSERT(queue->contains(reused));
+	TEST_ASSERT(queue->size() == 1);
+
+	queue->empty();
+	TEST_ASSERT(!queue->contains(reused));
+	TEST_ASSERT(queue->size() == 0);
+
+	delete queue;
+	return 0;
+}
+
+int TestPriorityQueue_Heapify()
+{
+	PriorityQueue<int, int> *queue = new PriorityQueue<int, int>();
+	DArray<int> keys, data;
+
+	/* Leave some gaps in the arrays */
+	for (int i = 0; i < TREE_ITEMS * 4; i++) {
+		int key = (i * 7919) % (TREE_ITEMS * 4);
+		keys.insert(key, i);
+		data.insert(key * 2, i);
+	}
+	for (int i = 0; i < TREE_ITEMS * 4; i += 5) {
+		keys.remove(i);
+		data.remove(i);
+	}
+
+	queue->push(-1, -1);
+	TEST_ASSERT(queue->heapify(&keys, &data));
+	TEST_ASSERT(queue->size() == keys.used());
+
+	/* Each entry's handle is its index */
+	for (uint32_t i = 0; i < keys.size(); i++) {
+		TEST_ASSERT(queue->contains(i) == keys.valid(i));
+		if (keys.valid(i)) {
+			TEST_ASSERT(queue->key(i) == keys[i]);
+			TEST_ASSERT(queue->data(i) == data[i]);
+		}
+	}
+
+	/* New entries take the unused handles first */
+	PriorityQueue<int, int>::Handle handle = queue->push(TREE_ITEMS * 8, 0);
+	TEST_ASSERT(handle == 0);
+	TEST_ASSERT(queue->erase(handle));
+
+	int last = -1;
+	while (queue->size()) {
+		TEST_ASSERT(queue->top_key() > last);
+		last = queue->top_key();
+		TEST_ASSERT(queue->pop() == last * 2);
+	}
+
+	/* Keys without data are refused, leaving the queue alone */
+	queue->push(3, 3);
+	data.remove(1);
+	TEST_ASSERT(!queue->heapify(&keys, &data));
+	TEST_ASSERT(queue->size() == 1 && queue->top_key() == 3);
+
+	/* An empty array empties the queue */
+	DArray<int> none;
+	TEST_ASSERT(queue->heapify(&none, &none));
+	TEST_ASSERT(queue->size() == 0);
+
+	delete queue;
+	return 0;
+}
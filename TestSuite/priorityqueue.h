@@ -0,0 +1,19 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_priorityqueue_test_h
+#define __included_priorityqueue_test_h
+
+int TestPriorityQueue_Int();
+int TestPriorityQueue_Handles();
+int TestPriorityQueue_Heapify();
+
+#endif
@@ -0,0 +1,472 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#include "header.h"
+#include "quadtree.h"
+#include "testutils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <crisscross/quadtree.h>
+
+using namespace CrissCross::Data;
+using namespace CrissCross::System;
+
+namespace
+{
+	struct Point
+	{
+		float x, y;
+
+		Point() : x(0.0f), y(0.0f)
+		{
+		}
+
+		Point(float _x, float _y) : x(_x), y(_y)
+		{
+		}
+
+		Point operator -(Point const &_other) const
+		{
+			return Point(x - _other.x, y - _other.y);
+		}
+	};
+
+	struct Object
+	{
+		Point pos;
+		float radius;
+		bool live;
+	};
+
+	typedef Quadtree<int, Point, 5, 8> TestTree;
+
+	float RandomFloat(float _max)
+	{
+		return (float)(RandomNumber() % 100000) * _max / 100000.0f;
+	}
+
+	bool Touches(Object const &_object, Point const &_circle, float _radius)
+	{
+		float dx = _object.pos.x - _circle.x, dy = _object.pos.y - _circle.y;
+		return dx * dx + dy * dy <= (_object.radius + _radius) * (_object.radius + _radius);
+	}
+
+	QuadtreeSearchResult Search(TestTree const &_tree, std::vector<int> &_out, Point const &_circle, float _radius, size_t _max)
+	{
+		return _tree.ObjectsInCircle(_out, _circle, _radius, _max
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+		                             , [](int const &) { return QuadtreeCallbackResponse::ACCEPT; }
+		                             , [](int const &) { return QuadtreeCallbackResponse::ACCEPT; }
+#endif
+		                             );
+	}
+
+	float Distance(Object const &_object, Point const &_point)
+	{
+		float dx = _point.x - _object.pos.x, dy = _point.y - _object.pos.y;
+		return std::max(std::sqrt(dx * dx + dy * dy) - _object.radius, 0.0f);
+	}
+
+	QuadtreeSearchResult Nearest(TestTree const &_tree, std::vector<int> &_out, Point const &_point, size_t _k)
+	{
+		return _tree.NearestK(_out, _point, _k
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+		                      , [](int const &) { return QuadtreeCallbackResponse::ACCEPT; }
+#endif
+		                      );
+	}
+
+	QuadtreeSearchResult NearestOne(TestTree const &_tree, int &_out, Point const &_point)
+	{
+		return _tree.Nearest(_out, _point
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+		                     , [](int const &) { return QuadtreeCallbackResponse::ACCEPT; }
+#endif
+		                     );
+	}
+
+	bool TouchesRect(Object const &_object, Point const &_lowerLeft, Point const &_upperRight)
+	{
+		float dx = std::max(std::max(_lowerLeft.x - _object.pos.x, _object.pos.x - _upperRight.x), 0.0f),
+		      dy = std::max(std::max(_lowerLeft.y - _object.pos.y, _object.pos.y - _upperRight.y), 0.0f);
+		return dx * dx + dy * dy <= _object.radius * _object.radius;
+	}
+
+	/* How far along a ray with a normalized direction an object is hit, or -1 if it isn't */
+	float RayHit(Object const &_object, Point const &_origin, float _dx, float _dy, float _maxDistance)
+	{
+		float fx = _origin.x - _object.pos.x,
+		      fy = _origin.y - _object.pos.y,
+		      b = fx * _dx + fy * _dy,
+		      c = fx * fx + fy * fy - _object.radius * _object.radius,
+		      t = 0.0f;
+		if (c > 0.0f) {
+			float discriminant = b * b - c;
+			if (discriminant < 0.0f)
+				return -1.0f;
+			t = -b - std::sqrt(discriminant);
+			if (t < 0.0f)
+				return -1.0f;
+		}
+		return t > _maxDistance ? -1.0f : t;
+	}
+
+	QuadtreeSearchResult SearchRect(TestTree const &_tree, std::vector<int> &_out, Point const &_lowerLeft, Point const &_upperRight, size_t _max)
+	{
+		return _tree.ObjectsInRect(_out, _lowerLeft, _upperRight, _max
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+		                           , [](int const &) { return QuadtreeCallbackResponse::ACCEPT; }
+		                           , [](int const &) { return QuadtreeCallbackResponse::ACCEPT; }
+#endif
+		                           );
+	}
+
+	QuadtreeSearchResult Ray(TestTree const &_tree, std::vector<int> &_out, Point const &_origin, Point const &_direction, float _maxDistance, size_t _max)
+	{
+		return _tree.RayCast(_out, _origin, _direction, _maxDistance, _max
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+		                     , [](int const &) { return QuadtreeCallbackResponse::ACCEPT; }
+		                     , [](int const &) { return QuadtreeCallbackResponse::ACCEPT; }
+#endif
+		                     );
+	}
+
+	bool Segment(TestTree const &_tree, Point const &_from, Point const &_to)
+	{
+		return _tree.SegmentIntersects(_from, _to
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+		                               , [](int const &) { return QuadtreeCallbackResponse::ACCEPT; }
+#endif
+		                               );
+	}
+
+	/* Some objects lie outside the tree's bounds, and still have to be found */
+	TestTree *Scatter(std::vector<Object> &_objects)
+	{
+		TestTree *tree = new TestTree(Point(0.0f, 0.0f), Point(1000.0f, 1000.0f));
+		for (int i = 0; i < TREE_ITEMS * 16; i++) {
+			Object object;
+			object.pos = Point(RandomFloat(1200.0f) - 100.0f, RandomFloat(1200.0f) - 100.0f);
+			object.radius = (i % 16 == 0) ? RandomFloat(80.0f) : RandomFloat(4.0f);
+			object.live = true;
+			_objects.push_back(object);
+			tree->InsertObject(i, object.pos, object.radius);
+		}
+		return tree;
+	}
+
+	/* Checks every object a circle touches is found, and nothing else */
+	int CheckCircles(TestTree const &_tree, std::vector<Object> const &_objects)
+	{
+		for (int i = 0; i < 200; i++) {
+			Point circle(RandomFloat(1000.0f), RandomFloat(1000.0f));
+			float radius = RandomFloat(100.0f);
+
+			std::vector<int> found;
+			Search(_tree, found, circle, radius, _objects.size() + 1);
+			std::sort(found.begin(), found.end());
+
+			std::vector<int> expected;
+			for (size_t j = 0; j < _objects.size(); j++) {
+				if (_objects[j].live && Touches(_objects[j], circle, radius))
+					expected.push_back((int)j);
+			}
+
+			TEST_ASSERT(found == expected);
+		}
+		return 0;
+	}
+}
+
+int TestQuadtree_Circle()
+{
+	TestTree *tree = new TestTree(Point(0.0f, 0.0f), Point(1000.0f, 1000.0f));
+	std::vector<Object> objects;
+
+	TEST_ASSERT(tree->IsEmpty(false));
+
+	/* Mostly small objects, with a few big ones that cross square borders */
+	for (int i = 0; i < TREE_ITEMS * 16; i++) {
+		Object object;
+		object.pos = Point(RandomFloat(1000.0f), RandomFloat(1000.0f));
+		object.radius = (i % 16 == 0) ? RandomFloat(80.0f) : RandomFloat(4.0f);
+		object.live = true;
+		objects.push_back(object);
+		tree->InsertObject(i, object.pos, object.radius);
+	}
+	TEST_ASSERT(!tree->IsEmpty(false));
+
+	if (CheckCircles(*tree, objects))
+		return 1;
+
+	/* Compacting only moves objects around */
+	tree->Compact();
+	if (CheckCircles(*tree, objects))
+		return 1;
+
+	std::vector<int> all;
+	uint32_t maxDepth = 0, maxNodes = 0;
+	tree->Collect(all, maxDepth, maxNodes);
+	TEST_ASSERT(all.size() == objects.size());
+	TEST_ASSERT(maxDepth > 0 && maxDepth <= 5);
+
+	std::vector<TestTree::statstype_t> stats;
+	tree->CollectStats(stats);
+	size_t counted = 0;
+	for (size_t i = 0; i < stats.size(); i++)
+		counted += stats[i].elements;
+	TEST_ASSERT(counted == objects.size());
+
+#ifndef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+	/* The search stops as soon as it has enough results */
+	std::vector<int> some;
+	TEST_ASSERT(Search(*tree, some, Point(500.0f, 500.0f), 1000.0f, 10) == QuadtreeSearchResult::ABORTED);
+	TEST_ASSERT(some.size() == 10);
+#endif
+
+	std::vector<int> none;
+	TEST_ASSERT(Search(*tree, none, Point(-500.0f, -500.0f), 1.0f, 10) == QuadtreeSearchResult::NOT_FOUND);
+
+	tree->Empty();
+	TEST_ASSERT(tree->IsEmpty(false));
+	TEST_ASSERT(Search(*tree, none, Point(500.0f, 500.0f), 1000.0f, 10) == QuadtreeSearchResult::NOT_FOUND);
+
+	delete tree;
+	return 0;
+}
+
+int TestQuadtree_Remove()
+{
+	TestTree *tree = new TestTree(Point(0.0f, 0.0f), Point(1000.0f, 1000.0f));
+	std::vector<Object> objects;
+
+	for (int round = 0; round < 4; round++) {
+		/* Clustered inserts, so squares split deep */
+		float cx = RandomFloat(800.0f) + 100.0f, cy = RandomFloat(800.0f) + 100.0f;
+		for (int i = 0; i < TREE_ITEMS * 4; i++) {
+			Object object;
+			object.pos = Point(cx + RandomFloat(100.0f) - 50.0f, cy + RandomFloat(100.0f) - 50.0f);
+			object.radius = RandomFloat(2.0f);
+			object.live = true;
+			objects.push_back(object);
+			tree->InsertObject((int)objects.size() - 1, object.pos, object.radius);
+		}
+
+		/* Remove most of them, so squares merge again */
+		for (size_t i = 0; i < objects.size(); i++) {
+			if (objects[i].live && RandomNumber() % 4 != 0) {
+				TEST_ASSERT(tree->RemoveObject((int)i, objects[i].pos, objects[i].radius));
+				objects[i].live = false;
+			}
+		}
+
+		/* Objects can't be removed twice */
+		for (size_t i = 0; i < objects.size(); i++) {
+			if (!objects[i].live) {
+				TEST_ASSERT(!tree->RemoveObject((int)i, objects[i].pos, objects[i].radius));
+				break;
+			}
+		}
+
+		if (CheckCircles(*tree, objects))
+			return 1;
+	}
+
+	/* Removing everything leaves no squares behind */
+	for (size_t i = 0; i < objects.size(); i++) {
+		if (objects[i].live)
+			TEST_ASSERT(tree->RemoveObject((int)i, objects[i].pos, objects[i].radius));
+	}
+	TEST_ASSERT(tree->IsEmpty(false));
+
+	std::vector<TestTree::statstype_t> stats;
+	tree->CollectStats(stats);
+	TEST_ASSERT(stats.size() == 1);
+
+	delete tree;
+	return 0;
+}
+
+int TestQuadtree_Nearest()
+{
+	TestTree empty(Point(0.0f, 0.0f), Point(1000.0f, 1000.0f));
+	std::vector<int> found;
+	TEST_ASSERT(Nearest(empty, found, Point(500.0f, 500.0f), 4) == QuadtreeSearchResult::NOT_FOUND);
+
+	std::vector<Object> objects;
+	TestTree *tree = Scatter(objects);
+
+	for (int i = 0; i < 200; i++) {
+		Point point(RandomFloat(1400.0f) - 200.0f, RandomFloat(1400.0f) - 200.0f);
+		size_t k = 1 + RandomNumber() % 20;
+
+		found.clear();
+		TEST_ASSERT(Nearest(*tree, found, point, k) == QuadtreeSearchResult::SUCCESS);
+		TEST_ASSERT(found.size() == k);
+
+		/* Ties make the objects ambiguous, but not their distances */
+		std::vector<float> expected;
+		for (size_t j = 0; j < objects.size(); j++)
+			expected.push_back(Distance(objects[j], point));
+		std::sort(expected.begin(), expected.end());
+		for (size_t j = 0; j < k; j++)
+			TEST_ASSERT(Distance(objects[found[j]], point) == expected[j]);
+
+		int nearest = -1;
+		TEST_ASSERT(NearestOne(*tree, nearest, point) == QuadtreeSearchResult::SUCCESS);
+		TEST_ASSERT(Distance(objects[nearest], point) == expected[0]);
+	}
+
+	/* Asking for more than there are finds them all */
+	found.clear();
+	TEST_ASSERT(Nearest(*tree, found, Point(500.0f, 500.0f), objects.size() * 2) == QuadtreeSearchResult::SUCCESS);
+	TEST_ASSERT(found.size() == objects.size());
+
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+	/* Objects pretest rejects are passed over */
+	for (int i = 0; i < 50; i++) {
+		Point point(RandomFloat(1000.0f), RandomFloat(1000.0f));
+		found.clear();
+		tree->NearestK(found, point, 5, [](int const &_object) {
+			return (_object & 1) ? QuadtreeCallbackResponse::REJECT : QuadtreeCallbackResponse::ACCEPT;
+		});
+		TEST_ASSERT(found.size() == 5);
+
+		std::vector<float> expected;
+		for (size_t j = 0; j < objects.size(); j += 2)
+			expected.push_back(Distance(objects[j], point));
+		std::sort(expected.begin(), expected.end());
+		for (size_t j = 0; j < found.size(); j++) {
+			TEST_ASSERT((found[j] & 1) == 0);
+			TEST_ASSERT(Distance(objects[found[j]], point) == expected[j]);
+		}
+	}
+#endif
+
+	delete tree;
+	return 0;
+}
+
+int TestQuadtree_Rect()
+{
+	std::vector<Object> objects;
+	TestTree *tree = Scatter(objects);
+
+	for (int i = 0; i < 200; i++) {
+		Point lowerLeft(RandomFloat(1400.0f) - 200.0f, RandomFloat(1400.0f) - 200.0f);
+		Point upperRight(lowerLeft.x + RandomFloat(300.0f), lowerLeft.y + RandomFloat(300.0f));
+
+		std::vector<int> found;
+		SearchRect(*tree, found, lowerLeft, upperRight, objects.size() + 1);
+		std::sort(found.begin(), found.end());
+
+		std::vector<int> expected;
+		for (size_t j = 0; j < objects.size(); j++) {
+			if (TouchesRect(objects[j], lowerLeft, upperRight))
+				expected.push_back((int)j);
+		}
+
+		TEST_ASSERT(found == expected);
+	}
+
+#ifndef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+	std::vector<int> some;
+	TEST_ASSERT(SearchRect(*tree, some, Point(0.0f, 0.0f), Point(1000.0f, 1000.0f), 10) == QuadtreeSearchResult::ABORTED);
+	TEST_ASSERT(some.size() == 10);
+#endif
+
+	delete tree;
+	return 0;
+}
+
+int TestQuadtree_Ray()
+{
+	std::vector<Object> objects;
+	TestTree *tree = Scatter(objects);
+
+	for (int i = 0; i < 200; i++) {
+		Point origin(RandomFloat(1400.0f) - 200.0f, RandomFloat(1400.0f) - 200.0f);
+		Point direction(RandomFloat(2.0f) - 1.0f, RandomFloat(2.0f) - 1.0f);
+		if (i % 20 == 0)
+			direction = Point(i % 40 ? 1.0f : 0.0f, i % 40 ? 0.0f : -1.0f);
+		float maxDistance = RandomFloat(1500.0f);
+
+		float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+		float dx = direction.x, dy = direction.y;
+		if (length > 0.0f) {
+			dx /= length;
+			dy /= length;
+		}
+
+		std::vector<float> expected;
+		for (size_t j = 0; j < objects.size(); j++) {
+			float t = RayHit(objects[j], origin, dx, dy, maxDistance);
+			if (t >= 0.0f)
+				expected.push_back(t);
+		}
+		std::sort(expected.begin(), expected.end());
+
+		/* Every object hit is found, nearest first */
+		std::vector<int> found;
+		QuadtreeSearchResult result = Ray(*tree, found, origin, direction, maxDistance, objects.size() + 1);
+		TEST_ASSERT(result == (expected.empty() ? QuadtreeSearchResult::NOT_FOUND : QuadtreeSearchResult::SUCCESS));
+		TEST_ASSERT(found.size() == expected.size());
+		for (size_t j = 0; j < found.size(); j++)
+			TEST_ASSERT(RayHit(objects[found[j]], origin, dx, dy, maxDistance) == expected[j]);
+
+		/* A segment is blocked exactly when a ray along it hits something */
+		Point to(origin.x + dx * maxDistance, origin.y + dy * maxDistance);
+		std::vector<int> first;
+		bool blocked = Ray(*tree, first, origin, direction, maxDistance, 1) != QuadtreeSearchResult::NOT_FOUND;
+		TEST_ASSERT(Segment(*tree, origin, to) == blocked);
+		if (blocked && !expected.empty())
+			TEST_ASSERT(RayHit(objects[first[0]], origin, dx, dy, maxDistance) == expected[0]);
+	}
+
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+	/* Stopping at the first hit pretest lets through */
+	for (int i = 0; i < 50; i++) {
+		Point origin(RandomFloat(1000.0f), RandomFloat(1000.0f));
+		float angle = RandomFloat(6.2831853f);
+		Point direction(std::cos(angle), std::sin(angle));
+
+		std::vector<int> found;
+		int calls = 0;
+		tree->RayCast(found, origin, direction, 2000.0f, 0,
+		              [](int const &_object) { return (_object & 1) ? QuadtreeCallbackResponse::REJECT : QuadtreeCallbackResponse::ACCEPT; },
+		              [&calls](int const &) { calls++; return QuadtreeCallbackResponse::ACCEPT_AND_STOP; });
+		TEST_ASSERT(calls <= 1);
+		TEST_ASSERT(found.size() == (size_t)calls);
+
+		std::vector<int> all;
+		Ray(*tree, all, origin, direction, 2000.0f, 0);
+		for (size_t j = 0; j < all.size(); j++) {
+			if ((all[j] & 1) == 0) {
+				TEST_ASSERT(found.size() == 1 && found[0] == all[j]);
+				break;
+			}
+		}
+	}
+#endif
+
+	/* A ray with no direction only hits what covers its origin */
+	std::vector<int> found;
+	Ray(*tree, found, objects[0].pos, Point(0.0f, 0.0f), 100.0f, objects.size() + 1);
+	TEST_ASSERT(std::find(found.begin(), found.end(), 0) != found.end());
+	for (size_t j = 0; j < found.size(); j++)
+		TEST_ASSERT(Touches(objects[found[j]], objects[0].pos, 0.0f));
+
+	delete tree;
+	return 0;
+}
@@ -0,0 +1,21 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_quadtree_test_h
+#define __included_quadtree_test_h
+
+int TestQuadtree_Circle();
+int TestQuadtree_Remove();
+int TestQuadtree_Nearest();
+int TestQuadtree_Rect();
+int TestQuadtree_Ray();
+
+#endif
@@ -0,0 +1,265 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#include "header.h"
+#include "radixtree.h"
+#include "testutils.h"
+
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <crisscross/radixtree.h>
+
+using namespace CrissCross::Data;
+using namespace CrissCross::System;
+
+int TestRadixTree_CString()
+{
+	RadixTree<const char *> *radixtree = new RadixTree<const char *>();
+	char *strings[TREE_ITEMS], *tmp;
+
+	/* Make sure allocation worked */
+	TEST_ASSERT(radixtree != nullptr);
+
+	/* Make sure the size starts at 0 */
+	TEST_ASSERT(radixtree->size() == 0);
+
+	memset(strings, 0, sizeof(strings));
+
+	/* Make sure the tree encapsulates keys properly */
+	tmp = cc_strdup("testkey");
+	radixtree->insert(tmp, "encapsulation test");
+	free(tmp); tmp = nullptr;
+	TEST_ASSERT(radixtree->size() == 1);
+	TEST_ASSERT(radixtree->exists("testkey"));
+	TEST_ASSERT(!radixtree->exists("testke"));
+	TEST_ASSERT(!radixtree->exists("testkeys"));
+	TEST_ASSERT(radixtree->erase("testkey"));
+	TEST_ASSERT(!radixtree->exists("testkey"));
+	TEST_ASSERT(!radixtree->erase("testkey"));
+	TEST_ASSERT(radixtree->size() == 0);
+
+	/* Keys are case sensitive */
+	TEST_ASSERT(radixtree->insert("Case", "upper"));
+	TEST_ASSERT(radixtree->insert("case", "lower"));
+	TEST_ASSERT(radixtree->size() == 2);
+	TEST_ASSERT(strcmp(radixtree->begin().key(), "Case") == 0);
+	TEST_ASSERT(radixtree->erase("Case"));
+	TEST_ASSERT(radixtree->erase("case"));
+
+	/* Simplest sanity checks done, now create some random data */
+	for (unsigned int i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(strings[i] == nullptr);
+		strings[i] = new char[20];
+		TEST_ASSERT(strings[i] != nullptr);
+		memset(strings[i], 0, 20);
+		TEST_ASSERT(strlen(strings[i]) == 0);
+		sprintf(strings[i], "%08x", i);
+		TEST_ASSERT(strlen(strings[i]) > 0);
+	}
+
+	/* Fill the tree */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(radixtree->insert(strings[i], strings[(TREE_ITEMS - 1) - i]));
+	}
+
+	/* Duplicates are refused */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(!radixtree->insert(strings[i], strings[i]));
+	}
+	TEST_ASSERT(radixtree->size() == TREE_ITEMS);
+
+	/* Verify existence of all the added data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		const char *val = nullptr;
+		TEST_ASSERT(radixtree->exists(strings[i]));
+		TEST_ASSERT((val = radixtree->find(strings[i])) != nullptr);
+		TEST_ASSERT(Compare(val, (const char *)strings[(TREE_ITEMS - 1) - i]) == 0);
+	}
+
+	/* Verify existence of all the added data, in a different order */
+	for (size_t i = TREE_ITEMS - 1; i < TREE_ITEMS; i--)
+	{
+		TEST_ASSERT(radixtree->exists(strings[i]));
+	}
+
+	/* Replace some data */
+	TEST_ASSERT(radixtree->replace(strings[0], "replaced"));
+	TEST_ASSERT(Compare(radixtree->find(strings[0]), (const char *)"replaced") == 0);
+	TEST_ASSERT(!radixtree->replace("missing", "replaced"));
+
+	/* Try to remove all the data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(radixtree->erase(strings[i]));
+		TEST_ASSERT(!radixtree->exists(strings[i]));
+	}
+	TEST_ASSERT(radixtree->size() == 0);
+	TEST_ASSERT(!radixtree->begin().valid());
+
+	/* Clean up the random data */
+	for (size_t i = 0; i < TREE_ITEMS; i++)
+	{
+		delete [] strings[i];
+		strings[i] = nullptr;
+	}
+
+	/* And finally, clear the tree */
+	delete radixtree;
+
+	return 0;
+}
+
+/* Checks every query against a std::set of the same keys */
+template <class Tree>
+static bool MatchesReference(Tree *_tree, std::set<std::string> const &_ref, std::vector<std::string> const &_probes)
+{
+	if (_tree->size() != _ref.size())
+		return false;
+
+	/* Iteration visits the keys in strcmp order */
+	std::set<std::string>::const_iterator expected = _ref.begin();
+	for (typename Tree::iterator it = _tree->begin(); it != _tree->end(); ++it, ++expected)
+	{
+		if (expected == _ref.end() || *expected != it.key() || it.data() != (int)expected->size())
+			return false;
+	}
+	if (expected != _ref.end())
+		return false;
+
+	for (size_t i = 0; i < _probes.size(); i++)
+	{
+		const char *probe = _probes[i].c_str();
+		bool present = _ref.count(_probes[i]) != 0;
+		if (_tree->exists(probe) != present || _tree->find(probe, -1) != (present ? (int)_probes[i].size() : -1))
+			return false;
+
+		std::set<std::string>::const_iterator lower = _ref.lower_bound(_probes[i]);
+		typename Tree::iterator it = _tree->lower_bound(probe);
+		if (lower == _ref.end() ? it.valid() : (!it.valid() || *lower != it.key()))
+			return false;
+
+		/* Everything from the probe up to the next key with the probe as a prefix */
+		uint32_t expectedCount = 0;
+		for (; lower != _ref.end() && lower->compare(0, _probes[i].size(), _probes[i]) == 0; ++lower)
+			expectedCount++;
+		uint32_t count = _tree->for_each_with_prefix(probe, [&](const char *_key, int) {
+			if (strncmp(_key, probe, _probes[i].size()) != 0)
+				expectedCount = (uint32_t)-1;
+		});
+		if (count != expectedCount)
+			return false;
+	}
+
+	/* A range query sees the same keys as the set */
+	if (_probes.size() >= 2)
+	{
+		std::string lo = _probes[0], hi = _probes[1];
+		if (hi < lo)
+			std::swap(lo, hi);
+		uint32_t expectedCount = (uint32_t)std::distance(_ref.lower_bound(lo), _ref.lower_bound(hi));
+		if (_tree->for_each_in_range(lo.c_str(), hi.c_str(), [](const char *, int) {}) != expectedCount)
+			return false;
+	}
+
+	return true;
+}
+
+/* Makes a path-like key, drawn from a small alphabet so keys share long prefixes */
+static std::string RandomKey()
+{
+	static const char *const parts[] = {
+		"/usr", "/usr/local", "/share/", "http://www.example.com/",
+		"a", "b", "\x7f", "\x80", "\xff", "0123456789abcdef"
+	};
+	std::string key;
+	int pieces = RandomNumber() % 5;
+	for (int i = 0; i < pieces; i++)
+		key += parts[RandomNumber() % (sizeof(parts) / sizeof(parts[0]))];
+
+	/* Some keys fan out into every possible byte, to make the biggest nodes */
+	if (RandomNumber() % 2)
+		key += (char)(1 + RandomNumber() % 255);
+	return key;
+}
+
+template <class Tree>
+static int TestRandomized(bool _ownsKeys)
+{
+	Tree *tree = new Tree();
+	std::set<std::string> ref;
+	std::vector<std::string> probes;
+
+	/* Trees which don't own their keys need them kept alive elsewhere */
+	std::set<std::string> storage;
+
+	for (int i = 0; i < 64; i++)
+		probes.push_back(RandomKey());
+	probes.push_back("");
+
+	for (int round = 0; round < 4; round++)
+	{
+		/* Grow, so nodes get promoted all the way to Node256 */
+		for (int i = 0; i < TREE_ITEMS * 8; i++)
+		{
+			std::string key = RandomKey();
+			const char *k = _ownsKeys ? key.c_str() : storage.insert(key).first->c_str();
+			bool added = ref.insert(key).second;
+			TEST_ASSERT(tree->insert(k, (int)key.size()) == added);
+		}
+		TEST_ASSERT(MatchesReference(tree, ref, probes));
+
+		/* Then shrink, so they get demoted and merged again */
+		for (int i = 0; i < TREE_ITEMS * 8; i++)
+		{
+			std::string key = RandomKey();
+			bool removed = ref.erase(key) != 0;
+			TEST_ASSERT(tree->erase(key.c_str()) == removed);
+		}
+		TEST_ASSERT(MatchesReference(tree, ref, probes));
+	}
+
+	/* Draining the tree leaves it empty */
+	for (std::set<std::string>::const_iterator it = ref.begin(); it != ref.end(); ++it)
+	{
+		TEST_ASSERT(tree->erase(it->c_str()));
+	}
+	ref.clear();
+	TEST_ASSERT(MatchesReference(tree, ref, probes));
+
+	/* And it can be refilled after being emptied */
+	for (size_t i = 0; i < probes.size(); i++)
+	{
+		const char *k = _ownsKeys ? probes[i].c_str() : storage.insert(probes[i]).first->c_str();
+		tree->insert(k, (int)probes[i].size());
+		ref.insert(probes[i]);
+	}
+	TEST_ASSERT(MatchesReference(tree, ref, probes));
+	tree->empty();
+	TEST_ASSERT(tree->size() == 0);
+	TEST_ASSERT(!tree->begin().valid());
+
+	delete tree;
+	return 0;
+}
+
+int TestRadixTree_Order()
+{
+	TEST_ASSERT(TestRandomized< RadixTree<int> >(true) == 0);
+	TEST_ASSERT((TestRandomized< RadixTree<int, false> >(false)) == 0);
+	return 0;
+}
@@ -228,3 +228,366 @@ int TestRedBlackTree_Int()
 
 	return 0;
 }
+
+/* Returns the black height of a subtree, or -1 if it breaks a red-black invariant */
+template <class Node>
+static int CheckRedBlackShape(const Node *_node, const Node *_parent, const Node *_nil)
+{
+	if (_node == _nil)
+		return 1;
+	if (_node->parent != _parent)
+		return -1;
+	if (_node->color == RedBlackTree<int, int>::RED &&
+	    (_node->left->color == RedBlackTree<int, int>::RED || _node->right->color == RedBlackTree<int, int>::RED))
+		return -1;
+
+	int left = CheckRedBlackShape(_node->left, _node, _nil);
+	int right = CheckRedBlackShape(_node->right, _node, _nil);
+	if (left < 0 || left != right)
+		return -1;
+
+	return left + (_node->color == RedBlackTree<int, int>::BLACK ? 1 : 0);
+}
+
+class CheckedRedBlackTree : public RedBlackTree<int, int>
+{
+	public:
+		bool valid() const
+		{
+			if (rootNode->color != BLACK || nullNode->color != BLACK)
+				return false;
+			return CheckRedBlackShape(rootNode, nullNode, nullNode) > 0;
+		}
+};
+
+int TestRedBlackTree_BuildFromSorted()
+{
+	const uint32_t maxItems = TREE_ITEMS * 512;
+	int *keys = new int[maxItems], *data = new int[maxItems];
+
+	for (uint32_t i = 0; i < maxItems; i++)
+	{
+		keys[i] = (int)i * 3;
+		data[i] = (int)i;
+	}
+
+	/* Every small size, plus one large enough to be built in parallel */
+	for (uint32_t n = 0; n <= maxItems; n = (n < TREE_ITEMS) ? n + 1 : maxItems + (n == maxItems))
+	{
+		CheckedRedBlackTree *rbtree = new CheckedRedBlackTree();
+		TEST_ASSERT(rbtree->insert(-1, -1));
+		TEST_ASSERT(rbtree->build_from_sorted(keys, data, n));
+		TEST_ASSERT(rbtree->size() == n);
+		TEST_ASSERT(!rbtree->exists(-1));
+		TEST_ASSERT(rbtree->valid());
+
+		for (uint32_t i = 0; i < n; i++)
+		{
+			TEST_ASSERT(rbtree->find(keys[i], -1) == data[i]);
+			TEST_ASSERT(!rbtree->exists(keys[i] + 1));
+		}
+
+		/* The result must be an ordinary tree that can be modified further */
+		for (uint32_t i = 0; i < n && i < TREE_ITEMS; i++)
+		{
+			TEST_ASSERT(rbtree->insert(keys[i] + 1, 0));
+			TEST_ASSERT(rbtree->erase(keys[i]));
+		}
+		TEST_ASSERT(rbtree->valid());
+
+		delete rbtree;
+	}
+
+	/* Unsorted and duplicated keys are rejected without touching the tree */
+	RedBlackTree<int, int> *rbtree = new RedBlackTree<int, int>();
+	TEST_ASSERT(rbtree->insert(-1, -1));
+	keys[TREE_ITEMS / 2] = keys[TREE_ITEMS / 2 - 1];
+	TEST_ASSERT(!rbtree->build_from_sorted(keys, data, TREE_ITEMS));
+	keys[TREE_ITEMS / 2] = -5;
+	TEST_ASSERT(!rbtree->build_from_sorted(keys, data, TREE_ITEMS));
+	TEST_ASSERT(rbtree->size() == 1);
+	TEST_ASSERT(rbtree->exists(-1));
+	delete rbtree;
+
+	delete [] keys;
+	delete [] data;
+
+	/* Rebuild a tree from its own DArray snapshot */
+	RedBlackTree<const char *, const char *> *source = new RedBlackTree<const char *, const char *>();
+	char *strings[TREE_ITEMS];
+	for (unsigned int i = 0; i < TREE_ITEMS; i++)
+	{
+		strings[i] = new char[20];
+		sprintf(strings[i], "%08x", (unsigned int)RandomNumber());
+		source->insert(strings[i], strings[i]);
+	}
+
+	DArray<const char *> *keyArray = source->ConvertIndexToDArray();
+	DArray<const char *> *dataArray = source->ConvertToDArray();
+
+	RedBlackTree<const char *, const char *> *copy = new RedBlackTree<const char *, const char *>();
+	TEST_ASSERT(copy->build_from_sorted(keyArray, dataArray));
+	TEST_ASSERT(copy->size() == source->size());
+	for (unsigned int i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(copy->find(strings[i]) == source->find(strings[i]));
+	}
+
+	delete keyArray;
+	delete dataArray;
+	delete copy;
+	delete source;
+
+	for (unsigned int i = 0; i < TREE_ITEMS; i++)
+		delete [] strings[i];
+
+	return 0;
+}
+
+/* Returns the size of a subtree, or -1 if a node's count is wrong */
+template <class Node>
+static int CheckSubtreeCounts(const Node *_node, const Node *_nil)
+{
+	if (_node == _nil)
+		return 0;
+
+	int left = CheckSubtreeCounts(_node->left, _nil);
+	int right = CheckSubtreeCounts(_node->right, _nil);
+	if (left < 0 || right < 0 || _node->count != (uint32_t)(1 + left + right))
+		return -1;
+
+	return 1 + left + right;
+}
+
+class CountedRedBlackTree : public RedBlackTree<int, int, true, true>
+{
+	public:
+		bool countsValid() const
+		{
+			return nullNode->count == 0 &&
+			       CheckSubtreeCounts(rootNode, nullNode) == (int)size() &&
+			       CheckRedBlackShape(rootNode, nullNode, nullNode) > 0;
+		}
+};
+
+int TestRedBlackTree_OrderStatistics()
+{
+	const int keySpace = TREE_ITEMS * 4;
+	bool *present = new bool[keySpace];
+	CountedRedBlackTree *rbtree = new CountedRedBlackTree();
+
+	for (int i = 0; i < keySpace; i++)
+		present[i] = false;
+
+	TEST_ASSERT(!rbtree->select(0).valid());
+	TEST_ASSERT(rbtree->rank(0) == 0);
+
+	for (int round = 0; round < 16; round++)
+	{
+		/* Mostly inserts early on, mostly erasures later */
+		for (int i = 0; i < TREE_ITEMS; i++)
+		{
+			int key = (int)(RandomNumber() % keySpace);
+			if ((int)(RandomNumber() % 16) >= round)
+			{
+				TEST_ASSERT(rbtree->insert(key, -key) == !present[key]);
+				present[key] = true;
+			} else {
+				TEST_ASSERT(rbtree->erase(key) == present[key]);
+				present[key] = false;
+			}
+		}
+
+		TEST_ASSERT(rbtree->countsValid());
+
+		uint32_t below = 0;
+		for (int key = 0; key < keySpace; key++)
+		{
+			TEST_ASSERT(rbtree->rank(key) == below);
+			if (present[key])
+			{
+				RedBlackTree<int, int, true, true>::iterator it = rbtree->select(below);
+				TEST_ASSERT(it.valid() && it.key() == key && it.data() == -key);
+				below++;
+			}
+		}
+		TEST_ASSERT(below == rbtree->size());
+		TEST_ASSERT(!rbtree->select(below).valid());
+		TEST_ASSERT(rbtree->count_range(-1, keySpace) == below);
+
+		int lo = (int)(RandomNumber() % keySpace), hi = (int)(RandomNumber() % keySpace);
+		TEST_ASSERT(rbtree->count_range(lo, hi) == rbtree->for_each_in_range(lo, hi, [](int const &, int &) {}));
+	}
+
+	/* Bulk-built trees carry counts too */
+	int *keys = new int[TREE_ITEMS], *data = new int[TREE_ITEMS];
+	for (int i = 0; i < TREE_ITEMS; i++)
+	{
+		keys[i] = i * 2;
+		data[i] = i;
+	}
+	TEST_ASSERT(rbtree->build_from_sorted(keys, data, TREE_ITEMS));
+	TEST_ASSERT(rbtree->countsValid());
+	for (int i = 0; i < TREE_ITEMS; i++)
+	{
+		TEST_ASSERT(rbtree->select(i).key() == keys[i]);
+		TEST_ASSERT(rbtree->rank(keys[i] + 1) == (uint32_t)i + 1);
+	}
+	TEST_ASSERT(rbtree->erase(keys[0]));
+	TEST_ASSERT(rbtree->countsValid());
+
+	delete [] keys;
+	delete [] data;
+	delete [] present;
+	delete rbtree;
+
+	return 0;
+}
+
+int TestRedBlackTree_SharedPrefixes()
+{
+	/* Keys which tie on their cached prefixes, so lookups must fall back to the full key */
+	RedBlackTree<const char *, int> *tree = new RedBlackTree<const char *, int>();
+	char key[32];
+
+	for (int i = 0; i < TREE_ITEMS; i++)
+	{
+		sprintf(key, "/usr/share/%05d", (i * 37) % TREE_ITEMS);
+		TEST_ASSERT(tree->insert(key, i));
+	}
+
+	/* Keys shorter than the prefix, and prefixes of other keys */
+	TEST_ASSERT(tree->insert("/usr", -1));
+	TEST_ASSERT(tree->insert("/usr/sha", -2));
+	TEST_ASSERT(tree->insert("/usr/share/", -3));
+	TEST_ASSERT(tree->size() == TREE_ITEMS + 3);
+
+	/* Matching ignores case unless Compare doesn't */
+	TEST_ASSERT(tree->exists("/USR/SHARE/") == (Compare<const char *>("/USR/SHARE/", "/usr/share/") == 0));
+	TEST_ASSERT(!tree->exists("/usr/shar"));
+	TEST_ASSERT(!tree->exists("/usr/share/0"));
+
+	for (int i = 0; i < TREE_ITEMS; i++)
+	{
+		sprintf(key, "/usr/share/%05d", (i * 37) % TREE_ITEMS);
+		TEST_ASSERT(tree->find(key, -100) == i);
+	}
+
+	/* Iteration is still in Compare order */
+	const char *last = nullptr;
+	uint32_t count = 0;
+	for (RedBlackTree<const char *, int>::iterator it = tree->begin(); it != tree->end(); ++it)
+	{
+		if (last)
+			TEST_ASSERT(Compare(last, it.key()) < 0);
+		last = it.key();
+		count++;
+	}
+	TEST_ASSERT(count == tree->size());
+
+	/* Erasing moves keys between nodes, which must carry their prefixes along */
+	for (int i = 0; i < TREE_ITEMS; i += 2)
+	{
+		sprintf(key, "/usr/share/%05d", (i * 37) % TREE_ITEMS);
+		TEST_ASSERT(tree->erase(key));
+	}
+	for (int i = 0; i < TREE_ITEMS; i++)
+	{
+		sprintf(key, "/usr/share/%05d", (i * 37) % TREE_ITEMS);
+		TEST_ASSERT(tree->exists(key) == (i % 2 == 1));
+	}
+	TEST_ASSERT(tree->erase("/usr"));
+	TEST_ASSERT(tree->find("/usr/sha", 0) == -2);
+
+	delete tree;
+	return 0;
+}
+
+int TestRedBlackTree_FindBatch()
+{
+	RedBlackTree<int, int> *tree = new RedBlackTree<int, int>();
+	int keys[TREE_ITEMS * 2 + 3], out[TREE_ITEMS * 2 + 3];
+	const size_t count = sizeof(keys) / sizeof(keys[0]);
+
+	/* An empty tree finds nothing */
+	for (size_t i = 0; i < count; i++)
+		keys[i] = (int)i;
+	TEST_ASSERT(tree->find_batch(keys, count, out, -1) == 0);
+	for (size_t i = 0; i < count; i++)
+		TEST_ASSERT(out[i] == -1);
+
+	for (int i = 0; i < TREE_ITEMS; i++)
+		TEST_ASSERT(tree->insert(i * 2, i));
+
+	/* Interleave hits and misses, so searches in a group finish at different depths */
+	for (size_t i = 0; i < count; i++)
+		keys[i] = (int)((i * 31) % count) - 1;
+	TEST_ASSERT(tree->find_batch(keys, count, out, -1) == TREE_ITEMS);
+	for (size_t i = 0; i < count; i++)
+		TEST_ASSERT(out[i] == tree->find(keys[i], -1));
+
+	/* Repeated keys are each answered */
+	for (size_t i = 0; i < count; i++)
+		keys[i] = 42;
+	TEST_ASSERT(tree->find_batch(keys, count, out, -1) == count);
+	for (size_t i = 0; i < count; i++)
+		TEST_ASSERT(out[i] == 21);
+
+	delete tree;
+	return 0;
+}
+
+int TestRedBlackTree_Hinted()
+{
+	CountedRedBlackTree *tree = new CountedRedBlackTree();
+	typedef RedBlackTree<int, int, true, true>::iterator iterator;
+	const int count = TREE_ITEMS * 4;
+
+	/* An empty tree, with nothing to hint at */
+	TEST_ASSERT(!tree->find_near(tree->end(), 0).valid());
+
+	/* Appends, each hinted with the previous one */
+	iterator hint = tree->end();
+	for (int i = 0; i < count; i++) {
+		hint = tree->insert(hint, i * 4, i);
+		TEST_ASSERT(hint.valid() && hint.key() == i * 4 && hint.data() == i);
+	}
+	TEST_ASSERT(tree->size() == (uint32_t)count);
+	TEST_ASSERT(tree->countsValid());
+
+	/* Filling the gaps in descending order */
+	for (int i = count - 1; i >= 0; i--) {
+		hint = tree->insert(hint, i * 4 + 2, -i);
+		TEST_ASSERT(hint.valid() && hint.key() == i * 4 + 2);
+	}
+	TEST_ASSERT(tree->size() == (uint32_t)count * 2);
+	TEST_ASSERT(tree->countsValid());
+
+	/* An existing key is found, and left alone */
+	hint = tree->insert(tree->begin(), 8, 999);
+	TEST_ASSERT(hint.valid() && hint.key() == 8 && hint.data() == 2);
+	TEST_ASSERT(tree->size() == (uint32_t)count * 2);
+
+	/* Hints far from the key still work, just more slowly */
+	for (int i = 0; i < count; i++) {
+		int key = ((i * 7919) % count) * 4 + 1;
+		hint = tree->insert(tree->select((uint32_t)(i * 31) % tree->size()), key, key);
+		TEST_ASSERT(hint.valid() && hint.key() == key);
+	}
+	TEST_ASSERT(tree->size() == (uint32_t)count * 3);
+	TEST_ASSERT(tree->countsValid());
+
+	/* Lookups from every distance, including past either end */
+	for (int key = -2; key < count * 4 + 2; key++) {
+		bool present = key >= 0 && key < count * 4 && key % 4 != 3;
+		iterator start = tree->select((uint32_t)(key * 13 + 7) % tree->size());
+		iterator it = tree->find_near(start, key);
+		TEST_ASSERT(it.valid() == present);
+		if (present)
+			TEST_ASSERT(it.key() == key && it.data() == tree->find(key, 0));
+		TEST_ASSERT(tree->find_near(tree->end(), key) == it);
+	}
+
+	delete tree;
+	return 0;
+}
@@ -15,5 +15,10 @@
 int TestRedBlackTree_CString();
 int TestRedBlackTree_String();
 int TestRedBlackTree_Int();
+int TestRedBlackTree_BuildFromSorted();
+int TestRedBlackTree_OrderStatistics();
+int TestRedBlackTree_SharedPrefixes();
+int TestRedBlackTree_FindBatch();
+int TestRedBlackTree_Hinted();
 
 #endif
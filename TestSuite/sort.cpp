@@ -65,3 +65,48 @@ int TestSort_LList()
 
 	return 0;
 }
+
+int TestSort_LListNative()
+{
+	LList<int> llist;
+
+	/* Empty and single-element lists are no-ops */
+	llist.sort();
+	TEST_ASSERT(llist.size() == 0);
+	llist.insert(42);
+	llist.sort();
+	TEST_ASSERT(llist.size() == 1 && llist[0] == 42);
+	llist.empty();
+
+	for (int i = 0; i < SORT_ITEMS; i++) {
+		llist.insert(CrissCross::System::RandomNumber() % (SORT_ITEMS / 4));
+	}
+
+	llist.sort();
+	TEST_ASSERT(llist.size() == SORT_ITEMS);
+
+	for (int i = 0; i < SORT_ITEMS - 1; i++) {
+		TEST_ASSERT(llist[i] <= llist[i + 1]);
+	}
+
+	/* Walk backwards to verify the reverse links were rebuilt */
+	for (int i = SORT_ITEMS - 1; i > 0; i--) {
+		TEST_ASSERT(llist[i - 1] <= llist[i]);
+	}
+
+	llist.sort(GreaterThanComparator<int>());
+
+	for (int i = 0; i < SORT_ITEMS - 1; i++) {
+		TEST_ASSERT(llist[i] >= llist[i + 1]);
+	}
+
+	/* The list should still behave normally after being relinked */
+	llist.insert_front(-1);
+	llist.insert_back(SORT_ITEMS);
+	llist.remove(1);
+	TEST_ASSERT(llist.size() == SORT_ITEMS + 1);
+	TEST_ASSERT(llist[0] == -1);
+	TEST_ASSERT(llist[SORT_ITEMS] == SORT_ITEMS);
+
+	return 0;
+}
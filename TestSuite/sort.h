@@ -15,5 +15,6 @@
 int TestSort_IntArray(CrissCross::Data::Sorter<int> *_sorter);
 int TestSort_DArray(CrissCross::Data::Sorter<int> *_sorter);
 int TestSort_LList();
+int TestSort_LListNative();
 
 #endif
@@ -13,7 +13,10 @@
 #include "splaytree.h"
 #include "testutils.h"
 
+#include <atomic>
 #include <cstdio>
+#include <thread>
+#include <vector>
 
 #include <crisscross/splaytree.h>
 
@@ -228,3 +231,180 @@ int TestSplayTree_Int()
 
 	return 0;
 }
+
+/* Returns the number of nodes in a subtree, or -1 if its links or order are broken */
+template <class Node>
+static int CheckSplayShape(const Node *_node, const Node *_parent, int _lo, int _hi)
+{
+	if (!_node)
+		return 0;
+	if (_node->parent != _parent || _node->id < _lo || _node->id > _hi)
+		return -1;
+
+	int left = CheckSplayShape(_node->left, _node, _lo, _node->id - 1);
+	int right = CheckSplayShape(_node->right, _node, _node->id + 1, _hi);
+	if (left < 0 || right < 0)
+		return -1;
+
+	return 1 + left + right;
+}
+
+template <bool ThreadSafe>
+class CheckedSplayTree : public SplayTree<int, int, true, ThreadSafe>
+{
+	public:
+		bool valid() const
+		{
+			return CheckSplayShape(this->root, (const SplayNode<int, int, true> *)nullptr, -1, TREE_ITEMS * 64) == (int)this->size();
+		}
+
+		const SplayNode<int, int, true> *top() const
+		{
+			return this->root;
+		}
+
+		uint32_t depth(int _key) const
+		{
+			uint32_t ret = 0;
+			for (const SplayNode<int, int, true> *node = this->root; node; ret++)
+			{
+				if (node->id == _key)
+					return ret + 1;
+				node = (_key < node->id) ? node->left : node->right;
+			}
+			return 0;
+		}
+};
+
+int TestSplayTree_Policies()
+{
+	const int keySpace = TREE_ITEMS * 4;
+	const double probabilities[] = { 1.0, 0.25, 0.0, 1.0, 0.5 };
+	const uint32_t depths[] = { 0, 0, 0, 3, 2 };
+	bool *present = new bool[keySpace];
+
+	for (size_t policy = 0; policy < sizeof(depths) / sizeof(depths[0]); policy++)
+	{
+		CheckedSplayTree<false> *splaytree = new CheckedSplayTree<false>();
+		splaytree->set_splay_probability(probabilities[policy]);
+		splaytree->set_semi_splay_depth(depths[policy]);
+
+		for (int i = 0; i < keySpace; i++)
+			present[i] = false;
+
+		for (int i = 0; i < TREE_ITEMS * 16; i++)
+		{
+			int key = (int)(RandomNumber() % keySpace);
+			switch (RandomNumber() % 4)
+			{
+			case 0:
+				TEST_ASSERT(splaytree->insert(key, key * 2) == !present[key]);
+				present[key] = true;
+				break;
+			case 1:
+				TEST_ASSERT(splaytree->erase(key) == present[key]);
+				present[key] = false;
+				break;
+			default:
+				TEST_ASSERT(splaytree->exists(key) == present[key]);
+				TEST_ASSERT(splaytree->find(key, -1) == (present[key] ? key * 2 : -1));
+				break;
+			}
+		}
+		TEST_ASSERT(splaytree->valid());
+
+		/* Lookups which never splay leave the tree alone */
+		splaytree->set_splay_probability(0.0);
+		const SplayNode<int, int, true> *top = splaytree->top();
+		for (int key = 0; key < keySpace; key++)
+		{
+			TEST_ASSERT(splaytree->exists(key) == present[key]);
+		}
+		TEST_ASSERT(splaytree->top() == top);
+
+		/* Repeated semi-splays bring a hot key within the threshold */
+		if (depths[policy])
+		{
+			int deepest = -1;
+			uint32_t deepestDepth = 0;
+			for (int key = 0; key < keySpace; key++)
+			{
+				uint32_t depth = splaytree->depth(key);
+				if (depth > deepestDepth)
+				{
+					deepest = key;
+					deepestDepth = depth;
+				}
+			}
+
+			splaytree->set_splay_probability(1.0);
+			for (uint32_t i = 0; i < deepestDepth && deepest >= 0; i++)
+			{
+				TEST_ASSERT(splaytree->exists(deepest));
+			}
+			TEST_ASSERT(deepest < 0 || splaytree->depth(deepest) <= depths[policy]);
+			TEST_ASSERT(splaytree->valid());
+		}
+
+		delete splaytree;
+	}
+
+	delete [] present;
+
+	return 0;
+}
+
+int TestSplayTree_Threads()
+{
+	CheckedSplayTree<true> *splaytree = new CheckedSplayTree<true>();
+	const int keySpace = TREE_ITEMS * 16;
+	const int readerCount = 3;
+	std::atomic<bool> done(false);
+	std::atomic<int> failures(0);
+
+	splaytree->set_splay_probability(0.125);
+	splaytree->set_semi_splay_depth(4);
+
+	/* Even keys stay in the tree throughout, and every key k maps to 2k */
+	for (int key = 0; key < keySpace; key += 2)
+	{
+		TEST_ASSERT(splaytree->insert(key, key * 2));
+	}
+
+	std::vector<std::thread> readers;
+	for (int r = 0; r < readerCount; r++)
+	{
+		readers.emplace_back([&, r]() {
+			unsigned int seed = 12345u + (unsigned int)r;
+			while (!done.load(std::memory_order_relaxed))
+			{
+				seed = seed * 1103515245u + 12345u;
+				int key = (int)((seed >> 8) % (unsigned int)keySpace);
+				int data = splaytree->find(key, -1);
+				if ((data == -1 && !(key & 1)) || (data != -1 && data != key * 2))
+					failures++;
+			}
+		});
+	}
+
+	/* Churn the odd keys underneath the readers */
+	unsigned int seed = 54321u;
+	for (int i = 0; i < TREE_ITEMS * 64; i++)
+	{
+		seed = seed * 1103515245u + 12345u;
+		int key = (int)((seed >> 8) % (unsigned int)keySpace) | 1;
+		if (!splaytree->insert(key, key * 2))
+			TEST_ASSERT(splaytree->erase(key));
+	}
+
+	done = true;
+	for (size_t r = 0; r < readers.size(); r++)
+		readers[r].join();
+
+	TEST_ASSERT(failures == 0);
+	TEST_ASSERT(splaytree->valid());
+
+	delete splaytree;
+
+	return 0;
+}
@@ -15,5 +15,7 @@
 int TestSplayTree_CString();
 int TestSplayTree_String();
 int TestSplayTree_Int();
+int TestSplayTree_Policies();
+int TestSplayTree_Threads();
 
 #endif
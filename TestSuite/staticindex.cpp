@@ -0,0 +1,182 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#include "header.h"
+#include "staticindex.h"
+#include "testutils.h"
+
+#include <cstdio>
+
+#include <crisscross/avltree.h>
+#include <crisscross/rbtree.h>
+#include <crisscross/staticindex.h>
+
+using namespace CrissCross::Data;
+using namespace CrissCross::System;
+
+/* Checks every lookup against the sorted keys 3, 6, 9, ..., 3n, with data -key */
+static bool CheckMultiplesOfThree(StaticIndex<int, int> *_index, int _count)
+{
+	if (_index->size() != (uint32_t)_count)
+		return false;
+
+	for (int key = -1; key <= 3 * _count + 1; key++)
+	{
+		bool present = key > 0 && key % 3 == 0 && key <= 3 * _count;
+		if (_index->exists(key) != present)
+			return false;
+		if (_index->find(key, 1) != (present ? -key : 1))
+			return false;
+
+		/* The lower bound is the next multiple of three, if there is one */
+		int next = (key <= 0) ? 3 : ((key + 2) / 3) * 3;
+		StaticIndex<int, int>::iterator it = _index->lower_bound(key);
+		if (next > 3 * _count)
+		{
+			if (it.valid() || it != _index->end())
+				return false;
+		} else if (!it.valid() || it.key() != next || it.data() != -next) {
+			return false;
+		}
+	}
+
+	/* Iteration visits every key in order */
+	int expected = 3;
+	for (StaticIndex<int, int>::iterator it = _index->begin(); it != _index->end(); ++it)
+	{
+		if (it.key() != expected || it.data() != -expected)
+			return false;
+		expected += 3;
+	}
+	return expected == 3 * _count + 3;
+}
+
+int TestStaticIndex_Int()
+{
+	const int maxItems = TREE_ITEMS * 4;
+	int *keys = new int[maxItems], *data = new int[maxItems];
+	StaticIndex<int, int> *index = new StaticIndex<int, int>();
+
+	for (int i = 0; i < maxItems; i++)
+	{
+		keys[i] = 3 * (i + 1);
+		data[i] = -keys[i];
+	}
+
+	/* An empty index finds nothing */
+	TEST_ASSERT(index->size() == 0);
+	TEST_ASSERT(!index->exists(0));
+	TEST_ASSERT(!index->begin().valid());
+	TEST_ASSERT(CheckMultiplesOfThree(index, 0));
+
+	/* Every size up to a few levels, so each shape of the last level is covered */
+	for (int n = 0; n <= maxItems; n++)
+	{
+		TEST_ASSERT(index->build_from_sorted(keys, data, (uint32_t)n));
+		TEST_ASSERT(CheckMultiplesOfThree(index, n));
+	}
+
+	/* Unsorted input is refused and leaves the index alone */
+	keys[1] = keys[0];
+	TEST_ASSERT(!index->build_from_sorted(keys, data, 4));
+	TEST_ASSERT(CheckMultiplesOfThree(index, maxItems));
+	keys[1] = 6;
+
+	/* Freezing a tree gives the same index */
+	AVLTree<int, int> *avltree = new AVLTree<int, int>();
+	RedBlackTree<int, int> *rbtree = new RedBlackTree<int, int>();
+	for (int i = maxItems - 1; i >= 0; i--)
+	{
+		TEST_ASSERT(avltree->insert(keys[i], data[i]));
+		TEST_ASSERT(rbtree->insert(keys[i], data[i]));
+	}
+	index->build_from_tree(*avltree);
+	TEST_ASSERT(CheckMultiplesOfThree(index, maxItems));
+	index->empty();
+	TEST_ASSERT(index->size() == 0);
+	index->build_from_tree(*rbtree);
+	TEST_ASSERT(CheckMultiplesOfThree(index, maxItems));
+
+	/* And so does a pair of DArrays */
+	DArray<int> *keyArray = avltree->ConvertIndexToDArray();
+	DArray<int> *dataArray = avltree->ConvertToDArray();
+	TEST_ASSERT(index->build_from_sorted(keyArray, dataArray));
+	TEST_ASSERT(CheckMultiplesOfThree(index, maxItems));
+
+	delete keyArray;
+	delete dataArray;
+	delete avltree;
+	delete rbtree;
+	delete index;
+	delete [] keys;
+	delete [] data;
+
+	return 0;
+}
+
+int TestStaticIndex_File()
+{
+	const int count = TREE_ITEMS * 4 + 3;
+	const char *path = "staticindex.tmp";
+	int *keys = new int[count], *data = new int[count];
+	StaticIndex<int, int> *index = new StaticIndex<int, int>();
+
+	for (int i = 0; i < count; i++)
+	{
+		keys[i] = 3 * (i + 1);
+		data[i] = -keys[i];
+	}
+
+	/* Round trip through a file */
+	TEST_ASSERT(index->build_from_sorted(keys, data, count));
+	TEST_ASSERT(index->save(path));
+	index->empty();
+	TEST_ASSERT(index->load(path));
+	TEST_ASSERT(CheckMultiplesOfThree(index, count));
+
+	/* An empty index round trips too */
+	StaticIndex<int, int> *empty = new StaticIndex<int, int>();
+	TEST_ASSERT(empty->save(path));
+	TEST_ASSERT(index->load(path));
+	TEST_ASSERT(CheckMultiplesOfThree(index, 0));
+
+	/* A file saved with a different data size is refused */
+	StaticIndex<int, long long> *wide = new StaticIndex<int, long long>();
+	long long wideData[2] = { 1, 2 };
+	TEST_ASSERT(wide->build_from_sorted(keys, wideData, 2));
+	TEST_ASSERT(wide->save(path));
+	TEST_ASSERT(!index->load(path));
+	TEST_ASSERT(index->size() == 0);
+
+	/* So are missing and truncated files */
+	TEST_ASSERT(index->build_from_sorted(keys, data, count));
+	TEST_ASSERT(index->save(path));
+	char head[200];
+	FILE *file = fopen(path, "rb");
+	TEST_ASSERT(file != nullptr);
+	TEST_ASSERT(fread(head, sizeof(head), 1, file) == 1);
+	fclose(file);
+	file = fopen(path, "wb");
+	TEST_ASSERT(file != nullptr);
+	TEST_ASSERT(fwrite(head, sizeof(head), 1, file) == 1);
+	fclose(file);
+	TEST_ASSERT(!index->load(path));
+	remove(path);
+	TEST_ASSERT(!index->load(path));
+
+	delete wide;
+	delete empty;
+	delete index;
+	delete [] keys;
+	delete [] data;
+
+	return 0;
+}
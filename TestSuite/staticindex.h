@@ -0,0 +1,18 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_staticindex_test_h
+#define __included_staticindex_test_h
+
+int TestStaticIndex_Int();
+int TestStaticIndex_File();
+
+#endif
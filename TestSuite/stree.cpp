@@ -228,3 +228,95 @@ int TestSTree_Int()
 
 	return 0;
 }
+
+/* Returns the height of a subtree, or -1 if its links or order are broken */
+template <class Node>
+static int CheckSTreeShape(const Node *_node, const Node *_parent, int _lo, int _hi)
+{
+	if (!_node)
+		return 0;
+	if (_node->parent != _parent || _node->id < _lo || _node->id > _hi)
+		return -1;
+
+	int left = CheckSTreeShape(_node->left, _node, _lo, _node->id - 1);
+	int right = CheckSTreeShape(_node->right, _node, _node->id + 1, _hi);
+	if (left < 0 || right < 0)
+		return -1;
+
+	return 1 + (left > right ? left : right);
+}
+
+class CheckedSTree : public STree<int, int>
+{
+	public:
+		/* Returns whether the tree is well formed and within the scapegoat height bound */
+		bool balanced() const
+		{
+			int height = CheckSTreeShape(m_root, (const SNode<int, int, true> *)nullptr, -1, 0x7fffffff);
+			if (height < 0)
+				return false;
+			return (uint32_t)height <= heightLimit(m_maxSize) + 2;
+		}
+};
+
+int TestSTree_Balance()
+{
+	const int count = TREE_ITEMS * 64;
+	CheckedSTree *stree = new CheckedSTree();
+
+	/* Ordered input used to degenerate into a list */
+	for (int i = 0; i < count; i++)
+	{
+		TEST_ASSERT(stree->insert(i, i * 2));
+	}
+	TEST_ASSERT(stree->balanced());
+	TEST_ASSERT(stree->size() == (uint32_t)count);
+
+	for (int i = count - 1; i >= 0; i -= 7)
+	{
+		TEST_ASSERT(stree->find(i, -1) == i * 2);
+	}
+
+	/* Descending input, interleaved above the existing keys */
+	for (int i = count * 2; i >= count; i--)
+	{
+		TEST_ASSERT(stree->insert(i, i * 2));
+	}
+	TEST_ASSERT(stree->balanced());
+
+	/* Deleting most of the tree triggers full rebuilds */
+	for (int i = 0; i <= count * 2; i++)
+	{
+		if (i % 8)
+		{
+			TEST_ASSERT(stree->erase(i));
+		}
+	}
+	TEST_ASSERT(stree->balanced());
+	TEST_ASSERT(stree->size() == (uint32_t)(count * 2 / 8 + 1));
+
+	for (int i = 0; i <= count * 2; i++)
+	{
+		TEST_ASSERT(stree->exists(i) == !(i % 8));
+	}
+
+	/* Random churn */
+	for (int i = 0; i < count; i++)
+	{
+		int key = (int)(RandomNumber() % (count * 2));
+		if (!stree->insert(key, key * 2))
+		{
+			TEST_ASSERT(stree->erase(key));
+		}
+	}
+	TEST_ASSERT(stree->balanced());
+
+	stree->empty();
+	TEST_ASSERT(stree->size() == 0);
+	TEST_ASSERT(stree->insert(1, 2));
+	TEST_ASSERT(stree->balanced());
+
+	delete stree;
+
+	return 0;
+}
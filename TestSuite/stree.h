@@ -15,5 +15,6 @@
 int TestSTree_CString();
 int TestSTree_String();
 int TestSTree_Int();
+int TestSTree_Balance();
 
 #endif
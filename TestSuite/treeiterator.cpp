@@ -0,0 +1,155 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#include "header.h"
+#include "treeiterator.h"
+#include "testutils.h"
+
+#include <crisscross/avltree.h>
+#include <crisscross/bplustree.h>
+#include <crisscross/rbtree.h>
+#include <crisscross/splaytree.h>
+#include <crisscross/stree.h>
+
+using namespace CrissCross::Data;
+using namespace CrissCross::System;
+
+template <class Tree>
+static int TestOrderedAccess()
+{
+	Tree *tree = new Tree();
+	const int items = TREE_ITEMS * 8;
+	int data[items], tmp;
+
+	/* An empty tree has nothing to iterate over */
+	TEST_ASSERT(tree->begin() == tree->end());
+	TEST_ASSERT(!tree->lower_bound(0).valid());
+	TEST_ASSERT(!(--tree->end()).valid());
+
+	/* Insert the even numbers below 2 * items, in random order */
+	for (int i = 0; i < items; i++)
+	{
+		data[i] = i * 2;
+	}
+	for (int i = items - 1; i > 0; i--)
+	{
+		int j = RandomNumber() % (i + 1);
+		tmp = data[i]; data[i] = data[j]; data[j] = tmp;
+	}
+	for (int i = 0; i < items; i++)
+	{
+		TEST_ASSERT(tree->insert(data[i], data[i] + 1));
+	}
+
+	/* Walk forwards */
+	int expected = 0;
+	for (typename Tree::iterator it = tree->begin(); it != tree->end(); ++it)
+	{
+		TEST_ASSERT(it.key() == expected);
+		TEST_ASSERT(it.data() == expected + 1);
+		expected += 2;
+	}
+	TEST_ASSERT(expected == items * 2);
+
+	/* And backwards, starting from the end */
+	typename Tree::iterator it = tree->end();
+	for (int i = items - 1; i >= 0; i--)
+	{
+		--it;
+		TEST_ASSERT(it.valid());
+		TEST_ASSERT(it.key() == i * 2);
+	}
+	TEST_ASSERT(--it == tree->end());
+
+	/* Bounds on keys which are present, and keys which fall between them */
+	for (int k = -1; k <= items * 2; k++)
+	{
+		typename Tree::iterator lo = tree->lower_bound(k), hi = tree->upper_bound(k);
+		int lower = (k < 0) ? 0 : (k + 1) / 2 * 2;
+		int upper = (k < 0) ? 0 : k / 2 * 2 + 2;
+		if (lower < items * 2) {
+			TEST_ASSERT(lo.valid() && lo.key() == lower);
+		} else {
+			TEST_ASSERT(lo == tree->end());
+		}
+		if (upper < items * 2) {
+			TEST_ASSERT(hi.valid() && hi.key() == upper);
+		} else {
+			TEST_ASSERT(hi == tree->end());
+		}
+
+		std::pair<typename Tree::iterator, typename Tree::iterator> range = tree->equal_range(k);
+		TEST_ASSERT(range.first == lo && range.second == hi);
+		if (k >= 0 && k < items * 2 && k % 2 == 0) {
+			TEST_ASSERT(range.first != range.second);
+			TEST_ASSERT(++range.first == range.second);
+		} else {
+			TEST_ASSERT(range.first == range.second);
+		}
+	}
+
+	/* Range visits see exactly the keys in [lo, hi) */
+	int visited = 0, sum = 0;
+	uint32_t count = tree->for_each_in_range(11, 41, [&](int const &_key, int &_data) {
+		visited++;
+		sum += _key;
+		_data = -_key;
+	});
+	TEST_ASSERT(count == 15);
+	TEST_ASSERT(visited == 15);
+	TEST_ASSERT(sum == (12 + 40) * 15 / 2);
+	TEST_ASSERT(tree->find(12, 0) == -12);
+	TEST_ASSERT(tree->find(40, 0) == -40);
+	TEST_ASSERT(tree->find(42, 0) == 43);
+	TEST_ASSERT(tree->for_each_in_range(41, 11, [](int const &, int &) {}) == 0);
+
+	/* Erase every other key and make sure iteration still sees the rest in order */
+	for (int i = 0; i < items; i += 2)
+	{
+		TEST_ASSERT(tree->erase(i * 2));
+	}
+	expected = 2;
+	for (typename Tree::iterator it = tree->begin(); it.valid(); it++)
+	{
+		TEST_ASSERT(it.key() == expected);
+		expected += 4;
+	}
+	TEST_ASSERT(expected == items * 2 + 2);
+
+	delete tree;
+
+	return 0;
+}
+
+int TestTreeIterator_AVLTree()
+{
+	return TestOrderedAccess< AVLTree<int, int> >();
+}
+
+int TestTreeIterator_RedBlackTree()
+{
+	return TestOrderedAccess< RedBlackTree<int, int> >();
+}
+
+int TestTreeIterator_SplayTree()
+{
+	return TestOrderedAccess< SplayTree<int, int> >();
+}
+
+int TestTreeIterator_STree()
+{
+	return TestOrderedAccess< STree<int, int> >();
+}
+
+int TestTreeIterator_BPlusTree()
+{
+	return TestOrderedAccess< BPlusTree<int, int> >();
+}
@@ -0,0 +1,21 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_treeiterator_test_h
+#define __included_treeiterator_test_h
+
+int TestTreeIterator_AVLTree();
+int TestTreeIterator_RedBlackTree();
+int TestTreeIterator_SplayTree();
+int TestTreeIterator_STree();
+int TestTreeIterator_BPlusTree();
+
+#endif
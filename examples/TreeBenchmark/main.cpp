@@ -12,6 +12,9 @@
 #include "header.h"
 
 #include <cmath>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 using namespace CrissCross::Data;
 using namespace CrissCross::IO;
@@ -38,6 +41,18 @@ void shuffleElements(ktype_t *_array, size_t size)
 	}
 }
 
+/* Containers which stage their inserts get to merge them before the fill is timed */
+template <class T>
+void Commit(T *_tree)
+{
+}
+
+template <class Key, class Data, bool OwnsKeys>
+void Commit(FlatMap<Key, Data, OwnsKeys> *_tree)
+{
+	_tree->commit();
+}
+
 template <class T>
 void RunTestcase(T _tree, unsigned long _size, bool _ordered_insert)
 {
@@ -67,6 +82,7 @@ void RunTestcase(T _tree, unsigned long _size, bool _ordered_insert)
 			_tree->insert(*p, 1);
 		}
 	}
+	Commit(_tree);
 	sw.Stop();
 	console->Write("%9.5lfs ", sw.Elapsed());
 	delete [] elems;
@@ -132,6 +148,481 @@ void Test(const char *_name, size_t *sizes)
 	console->WriteLine();
 }
 
+/* Shares a single-threaded tree between threads the naive way, for comparison */
+template <class T>
+class LockedTree
+{
+protected:
+	T m_tree;
+	mutable std::mutex m_lock;
+
+public:
+	bool insert(ktype_t _key, char _data)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_tree.insert(_key, _data);
+	}
+
+	char find(ktype_t _key, char _default) const
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_tree.find(_key, _default);
+	}
+
+	void empty()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_tree.empty();
+	}
+};
+
+template <class T>
+void TestThreaded(const char *_name, size_t _size, unsigned int _maxThreads)
+{
+	T *tree = new T();
+	unsigned long realsize = _size * 2;
+
+	console->WriteLine("Testing %s with %lu items...", _name, (unsigned long)_size);
+	console->WriteLine();
+	console->WriteLine("%10s %10s %10s %10s", "threads", "time", "Mfind/s", "scaling");
+
+	for (size_t i = 0; i < _size; i++) {
+		tree->insert(2 * i, 1);
+	}
+
+	double base = 0.0;
+	for (unsigned int threads = 1; threads <= _maxThreads; threads *= 2) {
+		std::vector<std::thread> workers;
+		Stopwatch sw;
+		sw.Start();
+		for (unsigned int t = 0; t < threads; t++) {
+			workers.emplace_back([tree, realsize, _size, t]() {
+				/* RandomNumber() isn't thread-safe, so each thread gets its own generator */
+				unsigned long long seed = 2654435761ull * (t + 1);
+				for (size_t i = 0; i < _size; i++) {
+					seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+					tree->find((seed >> 16) % realsize, 0);
+				}
+			});
+		}
+		for (size_t t = 0; t < workers.size(); t++) {
+			workers[t].join();
+		}
+		sw.Stop();
+
+		double rate = (double)_size * threads / sw.Elapsed() / 1e6;
+		if (threads == 1)
+			base = rate;
+		console->WriteLine("%10u %9.5lfs %10.3lf %9.2lfx", threads, sw.Elapsed(), rate, rate / base);
+	}
+
+	delete tree;
+	console->WriteLine();
+	console->WriteLine("%s tests complete.", _name);
+	console->WriteLine();
+	console->WriteLine();
+}
+
+/* Merges a batch of updates into a base tree, one insert at a time and with set_union() */
+template <class T>
+void TestMerge(const char *_name, size_t *sizes)
+{
+	console->WriteLine("Testing %s merges...", _name);
+	console->WriteLine();
+	console->WriteLine("%10s %10s %10s %10s", "base", "delta", "insert", "union");
+	for (size_t *p = sizes; *p != 0; p++) {
+		size_t base = *p, delta = base / 8;
+		T *a = new T(), *b = new T(), *d = new T();
+		for (size_t i = 0; i < base; i++) {
+			ktype_t key = RandomNumber() % (base * 4);
+			a->insert(key, 1);
+			b->insert(key, 1);
+		}
+		for (size_t i = 0; i < delta; i++) {
+			d->insert(RandomNumber() % (base * 4), 2);
+		}
+
+		Stopwatch sw;
+		sw.Start();
+		for (typename T::iterator it = d->begin(); it != d->end(); ++it) {
+			if (!a->insert(it.key(), it.data()))
+				a->replace(it.key(), it.data());
+		}
+		sw.Stop();
+		double looped = sw.Elapsed();
+
+		sw.Start();
+		b->set_union(*d);
+		sw.Stop();
+		console->WriteLine("%10lu %10lu %9.5lfs %9.5lfs", (unsigned long)base, (unsigned long)delta, looped, sw.Elapsed());
+
+		delete a;
+		delete b;
+		delete d;
+	}
+	console->WriteLine();
+	console->WriteLine("%s merge tests complete.", _name);
+	console->WriteLine();
+	console->WriteLine();
+}
+
+/* Freezes a tree into a StaticIndex and searches the index, to compare with the tree's own searches */
+template <class T>
+void TestStatic(const char *_name, size_t *sizes)
+{
+	console->WriteLine("Testing StaticIndex frozen from %s...", _name);
+	console->WriteLine();
+	console->WriteLine("%10s %10s %10s %10s %10s", "size", "freeze", "srch+", "srch", "srch-");
+	for (size_t *p = sizes; *p != 0; p++) {
+		size_t size = *p, realsize = size * 2;
+		T *tree = new T();
+		for (size_t i = 0; i < size; i++) {
+			tree->insert(2 * i, 1);
+		}
+
+		StaticIndex<ktype_t, char> *index = new StaticIndex<ktype_t, char>();
+		Stopwatch sw;
+		sw.Start();
+		index->build_from_tree(*tree);
+		sw.Stop();
+		console->Write("%10lu %9.5lfs ", (unsigned long)size, sw.Elapsed());
+		delete tree;
+
+		// successful searches
+		sw.Start();
+		for (size_t i = 0; i < size; i++) {
+			index->find((2 * RandomNumber()) % realsize, 0);
+		}
+		sw.Stop();
+		console->Write("%9.5lfs ", sw.Elapsed());
+
+		// mixed success searches
+		sw.Start();
+		for (size_t i = 0; i < size; i++) {
+			index->find(RandomNumber() % realsize, 0);
+		}
+		sw.Stop();
+		console->Write("%9.5lfs ", sw.Elapsed());
+
+		// invalid searches
+		sw.Start();
+		for (size_t i = 0; i < size; i++) {
+			index->find((1 + 2 * RandomNumber()) % realsize, 0);
+		}
+		sw.Stop();
+		console->WriteLine("%9.5lfs", sw.Elapsed());
+
+		delete index;
+	}
+	console->WriteLine();
+	console->WriteLine("StaticIndex tests complete.");
+	console->WriteLine();
+	console->WriteLine();
+}
+
+/* Times string-keyed lookups, with path-like keys that share long prefixes */
+template <class T>
+void TestStrings(const char *_name, size_t *sizes)
+{
+	console->WriteLine("Testing %s with string keys...", _name);
+	console->WriteLine();
+	console->WriteLine("%10s %10s %10s %10s %10s", "size", "add", "srch+", "srch-", "empty");
+	for (size_t *p = sizes; *p != 0; p++) {
+		size_t size = *p;
+		char **keys = new char *[size], **missing = new char *[size];
+		for (size_t i = 0; i < size; i++) {
+			unsigned long r = (unsigned long)RandomNumber();
+			keys[i] = new char[64];
+			missing[i] = new char[64];
+			sprintf(keys[i], "/usr/share/doc/package-%05lu/file-%08lx.html", r % 1000, (unsigned long)i);
+			sprintf(missing[i], "/usr/share/doc/package-%05lu/file-%08lx.htm", r % 1000, (unsigned long)i);
+		}
+
+		T *tree = new T();
+		console->Write("%10lu ", (unsigned long)size);
+
+		Stopwatch sw;
+		sw.Start();
+		for (size_t i = 0; i < size; i++) {
+			tree->insert(keys[i], 1);
+		}
+		sw.Stop();
+		console->Write("%9.5lfs ", sw.Elapsed());
+
+		// successful searches
+		sw.Start();
+		for (size_t i = 0; i < size; i++) {
+			tree->find(keys[RandomNumber() % size], 0);
+		}
+		sw.Stop();
+		console->Write("%9.5lfs ", sw.Elapsed());
+
+		// invalid searches
+		sw.Start();
+		for (size_t i = 0; i < size; i++) {
+			tree->find(missing[RandomNumber() % size], 0);
+		}
+		sw.Stop();
+		console->Write("%9.5lfs ", sw.Elapsed());
+
+		sw.Start();
+		tree->empty();
+		sw.Stop();
+		console->WriteLine("%9.5lfs", sw.Elapsed());
+
+		delete tree;
+		for (size_t i = 0; i < size; i++) {
+			delete [] keys[i];
+			delete [] missing[i];
+		}
+		delete [] keys;
+		delete [] missing;
+	}
+	console->WriteLine();
+	console->WriteLine("%s string tests complete.", _name);
+	console->WriteLine();
+	console->WriteLine();
+}
+
+/* Lookups one at a time, against the same lookups handed over in batches */
+template <class T>
+void TestBatch(const char *_name, size_t *sizes)
+{
+	const size_t batch = 64;
+	console->WriteLine("Testing %s batched lookups...", _name);
+	console->WriteLine();
+	console->WriteLine("%10s %10s %10s", "size", "find", "batch");
+	for (size_t *p = sizes; *p != 0; p++) {
+		size_t size = *p;
+		T *tree = new T();
+		for (size_t i = 0; i < size; i++) {
+			tree->insert(2 * i, 1);
+		}
+
+		/* Half the probes miss */
+		ktype_t *probes = new ktype_t[size];
+		char *out = new char[size];
+		for (size_t i = 0; i < size; i++) {
+			probes[i] = RandomNumber() % (size * 2);
+		}
+
+		console->Write("%10lu ", (unsigned long)size);
+
+		Stopwatch sw;
+		sw.Start();
+		for (size_t i = 0; i < size; i++) {
+			out[i] = tree->find(probes[i], 0);
+		}
+		sw.Stop();
+		console->Write("%9.5lfs ", sw.Elapsed());
+
+		sw.Start();
+		for (size_t i = 0; i < size; i += batch) {
+			tree->find_batch(probes + i, size - i < batch ? size - i : batch, out + i, (char)0);
+		}
+		sw.Stop();
+		console->WriteLine("%9.5lfs", sw.Elapsed());
+
+		delete [] probes;
+		delete [] out;
+		delete tree;
+	}
+	console->WriteLine();
+	console->WriteLine("%s batch tests complete.", _name);
+	console->WriteLine();
+	console->WriteLine();
+}
+
+/* Ordered inserts and lookups from the root, against the same hinted with the previous key */
+template <class T>
+void TestHinted(const char *_name, size_t *sizes)
+{
+	console->WriteLine("Testing %s hinted operations...", _name);
+	console->WriteLine();
+	console->WriteLine("%10s %10s %10s %10s %10s", "size", "add", "add+hint", "srch", "srch+hint");
+	for (size_t *p = sizes; *p != 0; p++) {
+		size_t size = *p;
+		T *tree = new T();
+		console->Write("%10lu ", (unsigned long)size);
+
+		Stopwatch sw;
+		sw.Start();
+		for (size_t i = 0; i < size; i++) {
+			tree->insert(i, 1);
+		}
+		sw.Stop();
+		console->Write("%9.5lfs ", sw.Elapsed());
+		tree->empty();
+
+		typename T::iterator hint = tree->end();
+		sw.Start();
+		for (size_t i = 0; i < size; i++) {
+			hint = tree->insert(hint, i, 1);
+		}
+		sw.Stop();
+		console->Write("%9.5lfs ", sw.Elapsed());
+
+		/* Count the hits, so the lookups can't be optimized away */
+		size_t found = 0;
+		sw.Start();
+		for (size_t i = 0; i < size; i++) {
+			found += tree->find(i, 0);
+		}
+		sw.Stop();
+		console->Write("%9.5lfs ", sw.Elapsed());
+
+		hint = tree->end();
+		sw.Start();
+		for (size_t i = 0; i < size; i++) {
+			hint = tree->find_near(hint, i);
+			found += hint.data();
+		}
+		sw.Stop();
+		console->WriteLine("%9.5lfs", sw.Elapsed());
+		if (found != size * 2)
+			console->WriteLine("Lookups found %lu of %lu keys!", (unsigned long)found, (unsigned long)size * 2);
+
+		delete tree;
+	}
+	console->WriteLine();
+	console->WriteLine("%s hinted tests complete.", _name);
+	console->WriteLine();
+	console->WriteLine();
+}
+
+/* A timer queue: keep size timers pending, repeatedly firing the earliest and scheduling another */
+void TestQueue(size_t *sizes)
+{
+	console->WriteLine("Testing PriorityQueue against RedBlackTree as a timer queue...");
+	console->WriteLine();
+	console->WriteLine("%10s %10s %10s %10s", "size", "rbtree", "pqueue", "heapify");
+	for (size_t *p = sizes; *p != 0; p++) {
+		size_t size = *p;
+		ktype_t *deadlines = new ktype_t[size + 1];
+		for (size_t i = 0; i < size; i++) {
+			deadlines[i] = 2 * i + 2;
+		}
+		deadlines[size] = 0;
+		shuffleElements(deadlines, size);
+
+		console->Write("%10lu ", (unsigned long)size);
+
+		/* The tree needs unique keys, so every new deadline is past every pending one */
+		RedBlackTree<ktype_t, char> *tree = new RedBlackTree<ktype_t, char>();
+		Stopwatch sw;
+		sw.Start();
+		for (size_t i = 0; i < size; i++) {
+			tree->insert(deadlines[i], 1);
+		}
+		ktype_t next = 2 * size + 2;
+		for (size_t i = 0; i < size; i++) {
+			tree->erase(tree->begin().key());
+			tree->insert(next++, 1);
+		}
+		sw.Stop();
+		console->Write("%9.5lfs ", sw.Elapsed());
+		delete tree;
+
+		PriorityQueue<ktype_t, char> *queue = new PriorityQueue<ktype_t, char>();
+		sw.Start();
+		for (size_t i = 0; i < size; i++) {
+			queue->push(deadlines[i], 1);
+		}
+		next = 2 * size + 2;
+		for (size_t i = 0; i < size; i++) {
+			queue->pop();
+			queue->push(next++, 1);
+		}
+		sw.Stop();
+		console->Write("%9.5lfs ", sw.Elapsed());
+
+		/* The same initial fill, all at once */
+		DArray<ktype_t> keys;
+		DArray<char> data;
+		keys.setSize(size);
+		data.setSize(size);
+		for (size_t i = 0; i < size; i++) {
+			keys.insert(deadlines[i]);
+			data.insert(1);
+		}
+		sw.Start();
+		queue->heapify(&keys, &data);
+		sw.Stop();
+		console->WriteLine("%9.5lfs", sw.Elapsed());
+
+		delete queue;
+		delete [] deadlines;
+	}
+	console->WriteLine();
+	console->WriteLine("Timer queue tests complete.");
+	console->WriteLine();
+	console->WriteLine();
+}
+
+/* Short ranges over a space ten times the interval count: a scan of a sorted array against IntervalTree */
+void TestIntervals(size_t *sizes)
+{
+	const size_t queries = 1000;
+
+	console->WriteLine("Testing IntervalTree against a sorted array scan...");
+	console->WriteLine();
+	console->WriteLine("%10s %10s %10s %10s", "size", "add", "scan", "tree");
+	for (size_t *p = sizes; *p != 0; p++) {
+		size_t size = *p;
+		ktype_t *starts = new ktype_t[size + 1];
+		for (size_t i = 0; i < size; i++) {
+			starts[i] = 10 * i;
+		}
+		starts[size] = 0;
+		shuffleElements(starts, size);
+
+		console->Write("%10lu ", (unsigned long)size);
+
+		IntervalTree<ktype_t, char> *tree = new IntervalTree<ktype_t, char>();
+		Stopwatch sw;
+		sw.Start();
+		for (size_t i = 0; i < size; i++) {
+			tree->insert(starts[i], starts[i] + 1 + starts[i] % 97, 1);
+		}
+		sw.Stop();
+		console->Write("%9.5lfs ", sw.Elapsed());
+
+		/* The array is sorted by start, but any earlier interval may still reach the range */
+		ktype_t *ends = new ktype_t[size];
+		for (size_t i = 0; i < size; i++) {
+			ends[i] = 10 * i + 1 + (10 * i) % 97;
+		}
+		size_t found = 0;
+		sw.Start();
+		for (size_t q = 0; q < queries; q++) {
+			ktype_t lo = (ktype_t)(q * 7919 % size) * 10, hi = lo + 50;
+			for (size_t i = 0; i < size && 10 * i <= hi; i++) {
+				if (ends[i] >= lo)
+					found++;
+			}
+		}
+		sw.Stop();
+		console->Write("%9.5lfs ", sw.Elapsed());
+
+		size_t hits = 0;
+		sw.Start();
+		for (size_t q = 0; q < queries; q++) {
+			ktype_t lo = (ktype_t)(q * 7919 % size) * 10, hi = lo + 50;
+			hits += tree->for_each_overlapping(lo, hi, [](ktype_t, ktype_t, char) {});
+		}
+		sw.Stop();
+		console->WriteLine("%9.5lfs%s", sw.Elapsed(), hits == found ? "" : " (mismatch)");
+
+		delete tree;
+		delete [] ends;
+		delete [] starts;
+	}
+	console->WriteLine();
+	console->WriteLine("Interval tests complete.");
+	console->WriteLine();
+	console->WriteLine();
+}
+
 int main(int argc, char * *argv)
 {
 	console = new Console();
@@ -149,12 +640,36 @@ int main(int argc, char * *argv)
 
 	Test< AVLTree<ktype_t, char> >("AVLTree", sizes);
 	Test< RedBlackTree<ktype_t, char> >("RedBlackTree", sizes);
+	Test< CompactRedBlackTree<ktype_t, char> >("CompactRedBlackTree", sizes);
+	Test< BPlusTree<ktype_t, char> >("BPlusTree", sizes);
 	Test< SplayTree<ktype_t, char> >("SplayTree", sizes);
-//	Test< STree<ktype_t, char> >("STree", sizes);
+	Test< STree<ktype_t, char> >("STree", sizes);
+	Test< FlatMap<ktype_t, char> >("FlatMap", sizes);
+	Test< FilteredMap<ktype_t, char, AVLTree<ktype_t, char> > >("AVLTree behind a BloomFilter", sizes);
+	Test< FilteredMap<ktype_t, char, RedBlackTree<ktype_t, char> > >("RedBlackTree behind a BloomFilter", sizes);
+	TestMerge< AVLTree<ktype_t, char> >("AVLTree", sizes);
+	TestStatic< AVLTree<ktype_t, char> >("AVLTree", sizes);
+	TestBatch< AVLTree<ktype_t, char> >("AVLTree", sizes);
+	TestBatch< RedBlackTree<ktype_t, char> >("RedBlackTree", sizes);
+	TestHinted< AVLTree<ktype_t, char> >("AVLTree", sizes);
+	TestHinted< RedBlackTree<ktype_t, char> >("RedBlackTree", sizes);
+	TestQueue(sizes);
+	TestIntervals(sizes);
+	TestStrings< AVLTree<const char *, char> >("AVLTree", sizes);
+	TestStrings< BPlusTree<const char *, char> >("BPlusTree", sizes);
+	TestStrings< RadixTree<char> >("RadixTree", sizes);
 #ifdef ENABLE_STLTREE
 	Test< STLTree<ktype_t, char> >("STLTree", sizes);
 #endif
 
+	/* Lookup scaling across threads, against a lock around the whole tree */
+	unsigned int maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads < 4)
+		maxThreads = 4;
+	Test< ConcurrentRedBlackTree<ktype_t, char> >("ConcurrentRedBlackTree", sizes);
+	TestThreaded< LockedTree< RedBlackTree<ktype_t, char> > >("RedBlackTree with a global lock", sizes[count - 1], maxThreads);
+	TestThreaded< ConcurrentRedBlackTree<ktype_t, char> >("ConcurrentRedBlackTree", sizes[count - 1], maxThreads);
+
 	console->WriteLine();
 
 	/* End your application here. */
@@ -13,6 +13,7 @@
 #include <crisscross/compare.h>
 #include <crisscross/debug.h>
 
+#include <cctype>
 #include <cstring>
 
 #ifdef TARGET_OS_WINDOWS
@@ -60,5 +61,34 @@ namespace CrissCross
 			else
 				return 0;
 		}
+
+		/*! @cond */
+		static uint64_t StringPrefix(const char *_key)
+		{
+			/* Bytes past the terminator count as zero, so shorter strings sort first */
+			uint64_t ret = 0;
+			bool ended = !_key;
+			for (int i = 0; i < 8; i++) {
+				unsigned char c = ended ? 0 : (unsigned char)_key[i];
+				if (!c)
+					ended = true;
+#ifndef CASE_SENSITIVE_COMPARE
+				c = (unsigned char)tolower(c);
+#endif
+				ret = (ret << 8) | c;
+			}
+			return ret;
+		}
+		/*! @endcond */
+
+		uint64_t KeyPrefix<char *>::Make(char *const &_key)
+		{
+			return StringPrefix(_key);
+		}
+
+		uint64_t KeyPrefix<const char *>::Make(const char *const &_key)
+		{
+			return StringPrefix(_key);
+		}
 	}
 }
@@ -13,38 +13,39 @@
 #error "This file shouldn't be compiled directly."
 #endif
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace CrissCross
 {
 	namespace Data
 	{
-		template <class Key, class Data, bool OwnsKeys>
-		AVLTree<Key, Data, OwnsKeys>::AVLTree()
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		AVLTree<Key, Data, OwnsKeys, OrderStatistics>::AVLTree()
 		{
 			m_root = nullptr;
 			m_size = 0;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		AVLTree<Key, Data, OwnsKeys>::~AVLTree()
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		AVLTree<Key, Data, OwnsKeys, OrderStatistics>::~AVLTree()
 		{
-			if (m_root && OwnsKeys)
-				Dealloc(m_root->id);
-
-			delete m_root;
+			m_pool.releaseTree(m_root);
 			m_root = nullptr;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		bool AVLTree<Key, Data, OwnsKeys>::erase(Key const &_key)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool AVLTree<Key, Data, OwnsKeys, OrderStatistics>::erase(Key const &_key)
 		{
-			int ret = erase(&m_root, _key);
+			int ret = erase(&m_root, _key, KeyPrefix<Key>::Make(_key));
 			return (ret == OK || ret == BALANCE);
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		bool AVLTree<Key, Data, OwnsKeys>::replace(Key const &key, Data const &_data)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool AVLTree<Key, Data, OwnsKeys, OrderStatistics>::replace(Key const &key, Data const &_data)
 		{
-			AVLNode<Key, Data, OwnsKeys> *current;
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *current;
 			current = findNode(key);
 			if (!valid(current)) return false;
 
@@ -52,25 +53,34 @@ namespace CrissCross
 			return true;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		int AVLTree<Key, Data, OwnsKeys>::erase(AVLNode<Key, Data, OwnsKeys> **_node, Key const &_key)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		int AVLTree<Key, Data, OwnsKeys, OrderStatistics>::erase(AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_node, Key const &_key, typename KeyPrefix<Key>::Type _prefix)
 		{
 			if (!*_node)
 				return INVALID;
 
 			int result = OK;
 
-			if (Compare(_key, (*_node)->id) != 0) {
-				if (Compare(_key, (*_node)->id) < 0) {
+			int cmp = CompareWithNode(_key, _prefix, *_node);
+			if (cmp != 0) {
+				if (cmp < 0) {
 					if ((*_node)->left) {
-						if ((result = erase(&(*_node)->left, _key)) == BALANCE)
+						result = erase(&(*_node)->left, _key, _prefix);
+						if (result != INVALID)
+							recount(*_node);
+
+						if (result == BALANCE)
 							return balanceLeftShrunk(_node);
 
 						if (result != INVALID)
 							return result;
 					}
 				} else if ((*_node)->right) {
-					if ((result = erase(&(*_node)->right, _key)) == BALANCE)
+					result = erase(&(*_node)->right, _key, _prefix);
+					if (result != INVALID)
+						recount(*_node);
+
+					if (result == BALANCE)
 						return balanceRightShrunk(_node);
 
 					if (result != INVALID)
@@ -88,6 +98,7 @@ namespace CrissCross
 
 			if ((*_node)->left) {
 				if (replaceWithHighest(*_node, &(*_node)->left, &result)) {
+					recount(*_node);
 					if (result == BALANCE)
 						result = balanceLeftShrunk(_node);
 
@@ -97,6 +108,7 @@ namespace CrissCross
 
 			if ((*_node)->right) {
 				if (replaceWithLowest(*_node, &(*_node)->right, &result)) {
+					recount(*_node);
 					if (result == BALANCE)
 						result = balanceRightShrunk(_node);
 
@@ -108,27 +120,29 @@ namespace CrissCross
 			(*_node)->right = nullptr;
 
 			/* Leaf, delete and rebalance */
-			delete *_node, *_node = 0;
+			m_pool.destroy(*_node);
+			*_node = nullptr;
 
 			return BALANCE;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		bool AVLTree<Key, Data, OwnsKeys>::insert(Key const &_key, Data const &_data)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool AVLTree<Key, Data, OwnsKeys, OrderStatistics>::insert(Key const &_key, Data const &_data)
 		{
-			if (insert(nullptr, &m_root, _key, _data) != INVALID) {
+			if (insert(nullptr, &m_root, _key, _data, KeyPrefix<Key>::Make(_key)) != INVALID) {
 				++m_size;
 				return true;
 			} else
 				return false;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		AVLNode<Key, Data, OwnsKeys> *AVLTree<Key, Data, OwnsKeys>::findNode(Key const &_key) const
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		AVLNode<Key, Data, OwnsKeys, OrderStatistics> *AVLTree<Key, Data, OwnsKeys, OrderStatistics>::findNode(Key const &_key) const
 		{
-			AVLNode<Key, Data, OwnsKeys> *p_current = m_root;
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *p_current = m_root;
+			typename KeyPrefix<Key>::Type prefix = KeyPrefix<Key>::Make(_key);
 			while (p_current) {
-				int cmp = Compare(_key, p_current->id);
+				int cmp = CompareWithNode(_key, prefix, p_current);
 				if (cmp < 0)
 					p_current = p_current->left;
 				else if (cmp > 0)
@@ -140,11 +154,11 @@ namespace CrissCross
 			return nullptr;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
 		template <class TypedData>
-		TypedData AVLTree<Key, Data, OwnsKeys>::find(Key const &_key, TypedData const &_default) const
+		TypedData AVLTree<Key, Data, OwnsKeys, OrderStatistics>::find(Key const &_key, TypedData const &_default) const
 		{
-			AVLNode<Key, Data, OwnsKeys> *p_current = findNode(_key);
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *p_current = findNode(_key);
 
 			if (!p_current)
 				return _default;
@@ -152,18 +166,68 @@ namespace CrissCross
 			return (TypedData)(p_current->data);
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		bool AVLTree<Key, Data, OwnsKeys>::exists(Key const &_key) const
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		template <class TypedData>
+		size_t AVLTree<Key, Data, OwnsKeys, OrderStatistics>::find_batch(Key const *_keys, size_t _count, TypedData *_out, TypedData const &_default) const
 		{
-			AVLNode<Key, Data, OwnsKeys> *p_current = findNode(_key);
+			const size_t width = 16;
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *cursor[width];
+			typename KeyPrefix<Key>::Type prefix[width];
+			size_t found = 0;
+
+			for (size_t base = 0; base < _count; base += width) {
+				size_t n = _count - base < width ? _count - base : width;
+				size_t active = n;
+
+				for (size_t i = 0; i < n; i++) {
+					cursor[i] = m_root;
+					prefix[i] = KeyPrefix<Key>::Make(_keys[base + i]);
+					_out[base + i] = _default;
+					if (!cursor[i])
+						active--;
+				}
+
+				/* Every search takes one step per pass, so the node each one reads
+				 * next was prefetched a whole pass earlier. */
+				while (active) {
+					for (size_t i = 0; i < n; i++) {
+						if (!cursor[i])
+							continue;
+
+						int cmp = CompareWithNode(_keys[base + i], prefix[i], cursor[i]);
+						if (cmp == 0) {
+							_out[base + i] = (TypedData)(cursor[i]->data);
+							found++;
+							cursor[i] = nullptr;
+							active--;
+							continue;
+						}
+
+						cursor[i] = cmp < 0 ? cursor[i]->left : cursor[i]->right;
+						if (!cursor[i]) {
+							active--;
+							continue;
+						}
+						cc_prefetch(cursor[i]);
+					}
+				}
+			}
+
+			return found;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool AVLTree<Key, Data, OwnsKeys, OrderStatistics>::exists(Key const &_key) const
+		{
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *p_current = findNode(_key);
 			if (!p_current) return false;
 			else return true;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		void AVLTree<Key, Data, OwnsKeys>::rotateLeft(AVLNode<Key, Data, OwnsKeys> **_node)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		void AVLTree<Key, Data, OwnsKeys, OrderStatistics>::rotateLeft(AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_node)
 		{
-			AVLNode<Key, Data, OwnsKeys> *p_tmp = *_node;
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *p_tmp = *_node;
 			*_node = p_tmp->right;
 			p_tmp->right = (*_node)->left;
 			(*_node)->left = p_tmp;
@@ -171,12 +235,15 @@ namespace CrissCross
 			p_tmp->parent = *_node;
 			if (p_tmp->right)
 				p_tmp->right->parent = (*_node)->left;
+
+			recount(p_tmp);
+			recount(*_node);
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		void AVLTree<Key, Data, OwnsKeys>::rotateRight(AVLNode<Key, Data, OwnsKeys> **_node)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		void AVLTree<Key, Data, OwnsKeys, OrderStatistics>::rotateRight(AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_node)
 		{
-			AVLNode<Key, Data, OwnsKeys> *p_tmp = *_node;
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *p_tmp = *_node;
 			*_node = p_tmp->left;
 			p_tmp->left = (*_node)->right;
 			(*_node)->right = p_tmp;
@@ -185,10 +252,13 @@ namespace CrissCross
 			p_tmp->parent = *_node;
 			if (p_tmp->left)
 				p_tmp->left->parent = (*_node)->right;
+
+			recount(p_tmp);
+			recount(*_node);
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		int AVLTree<Key, Data, OwnsKeys>::balanceLeftGrown(AVLNode<Key, Data, OwnsKeys> **_node)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		int AVLTree<Key, Data, OwnsKeys, OrderStatistics>::balanceLeftGrown(AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_node)
 		{
 			switch ((*_node)->balance)
 			{
@@ -247,8 +317,8 @@ namespace CrissCross
 			return INVALID;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		int AVLTree<Key, Data, OwnsKeys>::balanceRightGrown(AVLNode<Key, Data, OwnsKeys> **_node)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		int AVLTree<Key, Data, OwnsKeys, OrderStatistics>::balanceRightGrown(AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_node)
 		{
 			switch ((*_node)->balance)
 			{
@@ -307,8 +377,8 @@ namespace CrissCross
 			return INVALID;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		int AVLTree<Key, Data, OwnsKeys>::balanceLeftShrunk(AVLNode<Key, Data, OwnsKeys> **_node)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		int AVLTree<Key, Data, OwnsKeys, OrderStatistics>::balanceLeftShrunk(AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_node)
 		{
 			switch ((*_node)->balance)
 			{
@@ -385,8 +455,8 @@ namespace CrissCross
 			return INVALID;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		int AVLTree<Key, Data, OwnsKeys>::balanceRightShrunk(AVLNode<Key, Data, OwnsKeys> **_node)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		int AVLTree<Key, Data, OwnsKeys, OrderStatistics>::balanceRightShrunk(AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_node)
 		{
 			switch ((*_node)->balance)
 			{
@@ -463,10 +533,10 @@ namespace CrissCross
 			return INVALID;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		bool AVLTree<Key, Data, OwnsKeys>::replaceWithHighest(AVLNode<Key, Data, OwnsKeys> * _target, AVLNode<Key, Data, OwnsKeys> **_subtree, int * _result)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool AVLTree<Key, Data, OwnsKeys, OrderStatistics>::replaceWithHighest(AVLNode<Key, Data, OwnsKeys, OrderStatistics> * _target, AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_subtree, int * _result)
 		{
-			AVLNode<Key, Data, OwnsKeys> *p_tmp;
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *p_tmp;
 
 			*_result = BALANCE;
 
@@ -477,6 +547,8 @@ namespace CrissCross
 				if (!replaceWithHighest(_target, &(*_subtree)->right, _result))
 					return false;
 
+				recount(*_subtree);
+
 				if (*_result == BALANCE)
 					*_result = balanceRightShrunk(_subtree);
 
@@ -488,6 +560,7 @@ namespace CrissCross
 				_target->id = Duplicate((*_subtree)->id);
 			else
 				_target->id = (*_subtree)->id;
+			_target->cachePrefix(_target->id);
 
 			p_tmp = *_subtree;
 			*_subtree = p_tmp->left;
@@ -497,18 +570,16 @@ namespace CrissCross
 			if (p_tmp) {
 				if (OwnsKeys)
 					Dealloc(p_tmp->id);
-				p_tmp->left = nullptr;
-				p_tmp->right = nullptr;
-				delete p_tmp;
+				m_pool.destroy(p_tmp);
 			}
 
 			return true;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		bool AVLTree<Key, Data, OwnsKeys>::replaceWithLowest(AVLNode<Key, Data, OwnsKeys> * _target, AVLNode<Key, Data, OwnsKeys> **_subtree, int * _result)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool AVLTree<Key, Data, OwnsKeys, OrderStatistics>::replaceWithLowest(AVLNode<Key, Data, OwnsKeys, OrderStatistics> * _target, AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_subtree, int * _result)
 		{
-			AVLNode<Key, Data, OwnsKeys> *p_tmp;
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *p_tmp;
 
 			*_result = BALANCE;
 
@@ -519,6 +590,8 @@ namespace CrissCross
 				if (!replaceWithLowest(_target, &(*_subtree)->left, _result))
 					return false;
 
+				recount(*_subtree);
+
 				if (*_result == BALANCE)
 					*_result = balanceLeftShrunk(_subtree);
 
@@ -530,6 +603,7 @@ namespace CrissCross
 				_target->id = Duplicate((*_subtree)->id);
 			else
 				_target->id = (*_subtree)->id;
+			_target->cachePrefix(_target->id);
 
 			p_tmp = *_subtree;
 			*_subtree = p_tmp->right;
@@ -539,38 +613,43 @@ namespace CrissCross
 			if (p_tmp) {
 				if (OwnsKeys)
 					Dealloc(p_tmp->id);
-				p_tmp->left = nullptr;
-				p_tmp->right = nullptr;
-				delete p_tmp;
+				m_pool.destroy(p_tmp);
 			}
 
 			return true;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		int AVLTree<Key, Data, OwnsKeys>::insert(AVLNode<Key, Data, OwnsKeys> **pp_parent, AVLNode<Key, Data, OwnsKeys> **_node, Key const &_key, Data const &_data)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		int AVLTree<Key, Data, OwnsKeys, OrderStatistics>::insert(AVLNode<Key, Data, OwnsKeys, OrderStatistics> **pp_parent, AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_node, Key const &_key, Data const &_data, typename KeyPrefix<Key>::Type _prefix)
 		{
 			int result = OK;
 
 			CoreAssert(_node);
 
 			if (!*_node) {
-				*_node = new AVLNode<Key, Data, OwnsKeys>();
+				*_node = m_pool.construct();
 				(*_node)->parent = pp_parent ? *pp_parent : nullptr;
 				if (OwnsKeys)
 					(*_node)->id = Duplicate(_key);
 				else
 					(*_node)->id = _key;
+				(*_node)->cachePrefix((*_node)->id);
 				(*_node)->data = _data;
 				return BALANCE;
 			}
 
-			int ret = Compare(_key, (*_node)->id);
+			int ret = CompareWithNode(_key, _prefix, *_node);
 			if (ret < 0) {
-				if ((result = insert(_node, &(*_node)->left, _key, _data)) == BALANCE)
+				result = insert(_node, &(*_node)->left, _key, _data, _prefix);
+				if (result != INVALID)
+					recount(*_node);
+				if (result == BALANCE)
 					result = balanceLeftGrown(_node);
 			} else if (ret > 0) {           /* obj >= nodeobj */
-				if ((result = insert(_node, &(*_node)->right, _key, _data)) == BALANCE)
+				result = insert(_node, &(*_node)->right, _key, _data, _prefix);
+				if (result != INVALID)
+					recount(*_node);
+				if (result == BALANCE)
 					result = balanceRightGrown(_node);
 			} else {
 				return INVALID;
@@ -579,8 +658,77 @@ namespace CrissCross
 			return result;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		uint32_t AVLTree<Key, Data, OwnsKeys>::mem_usage() const
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		AVLNode<Key, Data, OwnsKeys, OrderStatistics> *AVLTree<Key, Data, OwnsKeys, OrderStatistics>::attach(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_parent, int _side, Key const &_key, Data const &_data)
+		{
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *node = m_pool.construct();
+			node->parent = _parent;
+			if (OwnsKeys)
+				node->id = Duplicate(_key);
+			else
+				node->id = _key;
+			node->cachePrefix(node->id);
+			node->data = _data;
+
+			m_size++;
+
+			if (!_parent) {
+				m_root = node;
+				return node;
+			}
+
+			if (_side < 0)
+				_parent->left = node;
+			else
+				_parent->right = node;
+
+			/* The same retracing the recursive insert does on its way back up */
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *child = node, *current = _parent;
+			int result = BALANCE;
+			while (current && result == BALANCE) {
+				AVLNode<Key, Data, OwnsKeys, OrderStatistics> **link = linkTo(current);
+				recount(current);
+				if (child == current->left)
+					result = balanceLeftGrown(link);
+				else
+					result = balanceRightGrown(link);
+				child = *link;
+				current = child->parent;
+			}
+
+			/* Subtree sizes change all the way up, even once the heights stop changing */
+			if constexpr (OrderStatistics) {
+				for (; current; current = current->parent)
+					recount(current);
+			}
+
+			return node;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		typename AVLTree<Key, Data, OwnsKeys, OrderStatistics>::iterator AVLTree<Key, Data, OwnsKeys, OrderStatistics>::insert(iterator const &_hint, Key const &_key, Data const &_data)
+		{
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *parent;
+			int side;
+
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *node = iterator::fingerSearch(&m_root, nullptr, _hint.node(), _key, &parent, &side);
+			if (!node)
+				node = attach(parent, side, _key, _data);
+
+			return iterator(node, &m_root, nullptr);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		typename AVLTree<Key, Data, OwnsKeys, OrderStatistics>::iterator AVLTree<Key, Data, OwnsKeys, OrderStatistics>::find_near(iterator const &_hint, Key const &_key) const
+		{
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *parent;
+			int side;
+
+			return iterator(iterator::fingerSearch(&m_root, nullptr, _hint.node(), _key, &parent, &side), &m_root, nullptr);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		uint32_t AVLTree<Key, Data, OwnsKeys, OrderStatistics>::mem_usage() const
 		{
 			uint32_t ret = sizeof(*this);
 			if (!m_root) return ret;
@@ -589,9 +737,9 @@ namespace CrissCross
 			return ret;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
 		template <class TypedData>
-		DArray<TypedData> *AVLTree<Key, Data, OwnsKeys>::ConvertToDArray() const
+		DArray<TypedData> *AVLTree<Key, Data, OwnsKeys, OrderStatistics>::ConvertToDArray() const
 		{
 			DArray<TypedData> *darray = new DArray<TypedData>();
 			darray->setSize(m_size);
@@ -599,8 +747,8 @@ namespace CrissCross
 			return darray;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		DArray<Key> *AVLTree<Key, Data, OwnsKeys>::ConvertIndexToDArray() const
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		DArray<Key> *AVLTree<Key, Data, OwnsKeys, OrderStatistics>::ConvertIndexToDArray() const
 		{
 			DArray<Key> *darray = new DArray<Key>();
 			darray->setSize(m_size);
@@ -608,19 +756,19 @@ namespace CrissCross
 			return darray;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
 		template <class TypedData>
-		void AVLTree<Key, Data, OwnsKeys>::RecursiveConvertToDArray(DArray<TypedData> *darray, AVLNode<Key, Data, OwnsKeys> *btree) const
+		void AVLTree<Key, Data, OwnsKeys, OrderStatistics>::RecursiveConvertToDArray(DArray<TypedData> *darray, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *btree) const
 		{
 			if (!btree) return;
 
 			RecursiveConvertToDArray(darray, btree->left);
-			darray->insert(reinterpret_cast<TypedData>(btree->data));
+			darray->insert((TypedData)(btree->data));
 			RecursiveConvertToDArray(darray, btree->right);
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		void AVLTree<Key, Data, OwnsKeys>::RecursiveConvertIndexToDArray(DArray<Key> *darray, AVLNode<Key, Data, OwnsKeys> *btree) const
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		void AVLTree<Key, Data, OwnsKeys, OrderStatistics>::RecursiveConvertIndexToDArray(DArray<Key> *darray, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *btree) const
 		{
 			if (!btree) return;
 
@@ -628,5 +776,642 @@ namespace CrissCross
 			darray->insert(btree->id);
 			RecursiveConvertIndexToDArray(darray, btree->right);
 		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		template <class Source>
+		AVLNode<Key, Data, OwnsKeys, OrderStatistics> *AVLTree<Key, Data, OwnsKeys, OrderStatistics>::buildSubtree(Source const *_src, AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_slots, uint32_t _lo, uint32_t _hi, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_parent)
+		{
+			if (_lo >= _hi)
+				return nullptr;
+
+			uint32_t count = _hi - _lo, leftCount = count / 2, rightCount = count - leftCount - 1;
+			uint32_t mid = _lo + leftCount;
+
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *node = _slots ? new (_slots[mid]) AVLNode<Key, Data, OwnsKeys, OrderStatistics>() : m_pool.construct();
+			node->parent = _parent;
+			if (OwnsKeys)
+				node->id = Duplicate(_src->key(mid));
+			else
+				node->id = _src->key(mid);
+			node->cachePrefix(node->id);
+			node->data = _src->data(mid);
+
+			/* The halves differ by at most one item, which only makes the */
+			/* left side taller when it holds exactly a power of two */
+			node->balance = (leftCount > rightCount && (leftCount & (leftCount - 1)) == 0) ? LEFTHEAVY : BALANCED;
+			if constexpr (OrderStatistics)
+				node->count = count;
+
+#ifdef _OPENMP
+			if (_slots && count >= BuildTaskCutoff) {
+				#pragma omp task
+				node->left = buildSubtree(_src, _slots, _lo, mid, node);
+				node->right = buildSubtree(_src, _slots, mid + 1, _hi, node);
+				#pragma omp taskwait
+				return node;
+			}
+#endif
+
+			node->left = buildSubtree(_src, _slots, _lo, mid, node);
+			node->right = buildSubtree(_src, _slots, mid + 1, _hi, node);
+			return node;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		template <class Source>
+		void AVLTree<Key, Data, OwnsKeys, OrderStatistics>::build(Source const *_src)
+		{
+			uint32_t count = _src->size();
+
+			empty();
+
+#ifdef _OPENMP
+			if (count >= BuildTaskCutoff * 4 && omp_get_max_threads() > 1) {
+				/* The pool isn't thread-safe, so hand out all the storage up front */
+				AVLNode<Key, Data, OwnsKeys, OrderStatistics> **slots = new AVLNode<Key, Data, OwnsKeys, OrderStatistics> *[count];
+				for (uint32_t i = 0; i < count; i++)
+					slots[i] = m_pool.allocate();
+
+				#pragma omp parallel
+				#pragma omp single
+				m_root = buildSubtree(_src, slots, 0, count, (AVLNode<Key, Data, OwnsKeys, OrderStatistics> *)nullptr);
+
+				delete [] slots;
+				m_size = count;
+				return;
+			}
+#endif
+
+			m_root = buildSubtree(_src, (AVLNode<Key, Data, OwnsKeys, OrderStatistics> **)nullptr, 0, count, (AVLNode<Key, Data, OwnsKeys, OrderStatistics> *)nullptr);
+			m_size = count;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool AVLTree<Key, Data, OwnsKeys, OrderStatistics>::build_from_sorted(Key const *_keys, Data const *_data, uint32_t _count)
+		{
+			SortedArraySource<Key, Data> src(_keys, _data, _count);
+			if (!src.sorted())
+				return false;
+
+			build(&src);
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool AVLTree<Key, Data, OwnsKeys, OrderStatistics>::build_from_sorted(DArray<Key> const *_keys, DArray<Data> const *_data)
+		{
+			SortedDArraySource<Key, Data> src(_keys, _data);
+			if (!src.sorted())
+				return false;
+
+			build(&src);
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		typename AVLTree<Key, Data, OwnsKeys, OrderStatistics>::iterator AVLTree<Key, Data, OwnsKeys, OrderStatistics>::select(uint32_t _index) const
+		{
+			static_assert(OrderStatistics, "select() needs a tree with OrderStatistics enabled");
+
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *node = m_root;
+			while (node) {
+				uint32_t left = subtreeSize(node->left);
+				if (_index < left) {
+					node = node->left;
+				} else if (_index > left) {
+					_index -= left + 1;
+					node = node->right;
+				} else {
+					return iterator(node, &m_root);
+				}
+			}
+
+			return end();
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		uint32_t AVLTree<Key, Data, OwnsKeys, OrderStatistics>::rank(Key const &_key) const
+		{
+			static_assert(OrderStatistics, "rank() needs a tree with OrderStatistics enabled");
+
+			uint32_t ret = 0;
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *node = m_root;
+			while (node) {
+				if (Compare(node->id, _key) < 0) {
+					ret += subtreeSize(node->left) + 1;
+					node = node->right;
+				} else {
+					node = node->left;
+				}
+			}
+
+			return ret;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		uint32_t AVLTree<Key, Data, OwnsKeys, OrderStatistics>::count_range(Key const &_lo, Key const &_hi) const
+		{
+			if (Compare(_lo, _hi) >= 0)
+				return 0;
+
+			return rank(_hi) - rank(_lo);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		int AVLTree<Key, Data, OwnsKeys, OrderStatistics>::subtreeHeight(const AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node)
+		{
+			int height = 0;
+			while (_node) {
+				height++;
+				_node = (_node->balance == LEFTHEAVY) ? _node->left : _node->right;
+			}
+			return height;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		AVLNode<Key, Data, OwnsKeys, OrderStatistics> *AVLTree<Key, Data, OwnsKeys, OrderStatistics>::link(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_left, int _lheight, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_right, int _rheight, int *_height)
+		{
+			_node->left = _left;
+			_node->right = _right;
+			if (_left)
+				_left->parent = _node;
+			if (_right)
+				_right->parent = _node;
+			_node->balance = (_lheight > _rheight) ? LEFTHEAVY : (_lheight < _rheight) ? RIGHTHEAVY : BALANCED;
+			recount(_node);
+			*_height = 1 + (_lheight > _rheight ? _lheight : _rheight);
+			return _node;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		AVLNode<Key, Data, OwnsKeys, OrderStatistics> *AVLTree<Key, Data, OwnsKeys, OrderStatistics>::joinRight(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_left, int _lheight, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_right, int _rheight, int *_height)
+		{
+			if (_lheight <= _rheight + 1)
+				return link(_node, _left, _lheight, _right, _rheight, _height);
+
+			/* Walk down the right spine of the taller tree */
+			int ll, lr, h;
+			childHeights(_left, _lheight, &ll, &lr);
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *sub = joinRight(_left->right, lr, _node, _right, _rheight, &h);
+			if (h <= ll + 1)
+				return link(_left, _left->left, ll, sub, h, _height);
+
+			/* The right side grew two taller, so rotate */
+			int sl, sr;
+			childHeights(sub, h, &sl, &sr);
+			if (sl <= sr) {
+				int a;
+				link(_left, _left->left, ll, sub->left, sl, &a);
+				return link(sub, _left, a, sub->right, sr, _height);
+			}
+
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *pivot = sub->left;
+			int pl, pr, a, b;
+			childHeights(pivot, sl, &pl, &pr);
+			link(_left, _left->left, ll, pivot->left, pl, &a);
+			link(sub, pivot->right, pr, sub->right, sr, &b);
+			return link(pivot, _left, a, sub, b, _height);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		AVLNode<Key, Data, OwnsKeys, OrderStatistics> *AVLTree<Key, Data, OwnsKeys, OrderStatistics>::joinLeft(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_left, int _lheight, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_right, int _rheight, int *_height)
+		{
+			if (_rheight <= _lheight + 1)
+				return link(_node, _left, _lheight, _right, _rheight, _height);
+
+			/* Walk down the left spine of the taller tree */
+			int rl, rr, h;
+			childHeights(_right, _rheight, &rl, &rr);
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *sub = joinLeft(_left, _lheight, _node, _right->left, rl, &h);
+			if (h <= rr + 1)
+				return link(_right, sub, h, _right->right, rr, _height);
+
+			/* The left side grew two taller, so rotate */
+			int sl, sr;
+			childHeights(sub, h, &sl, &sr);
+			if (sr <= sl) {
+				int a;
+				link(_right, sub->right, sr, _right->right, rr, &a);
+				return link(sub, sub->left, sl, _right, a, _height);
+			}
+
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *pivot = sub->right;
+			int pl, pr, a, b;
+			childHeights(pivot, sr, &pl, &pr);
+			link(sub, sub->left, sl, pivot->left, pl, &a);
+			link(_right, pivot->right, pr, _right->right, rr, &b);
+			return link(pivot, sub, a, _right, b, _height);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		AVLNode<Key, Data, OwnsKeys, OrderStatistics> *AVLTree<Key, Data, OwnsKeys, OrderStatistics>::join(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_left, int _lheight, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_right, int _rheight, int *_height)
+		{
+			if (_lheight > _rheight + 1)
+				return joinRight(_left, _lheight, _node, _right, _rheight, _height);
+			if (_rheight > _lheight + 1)
+				return joinLeft(_left, _lheight, _node, _right, _rheight, _height);
+			return link(_node, _left, _lheight, _right, _rheight, _height);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		AVLNode<Key, Data, OwnsKeys, OrderStatistics> *AVLTree<Key, Data, OwnsKeys, OrderStatistics>::join2(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_left, int _lheight, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_right, int _rheight, int *_height)
+		{
+			if (!_left) {
+				*_height = _rheight;
+				return _right;
+			}
+			if (!_right) {
+				*_height = _lheight;
+				return _left;
+			}
+
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *last;
+			int h;
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *rest = splitLast(_left, _lheight, &last, &h);
+			return join(rest, h, last, _right, _rheight, _height);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		AVLNode<Key, Data, OwnsKeys, OrderStatistics> *AVLTree<Key, Data, OwnsKeys, OrderStatistics>::splitLast(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, int _nheight, AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_last, int *_height)
+		{
+			int l, r;
+			childHeights(_node, _nheight, &l, &r);
+			if (!_node->right) {
+				*_last = _node;
+				*_height = l;
+				return _node->left;
+			}
+
+			int h;
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *rest = splitLast(_node->right, r, _last, &h);
+			return join(_node->left, l, _node, rest, h, _height);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		void AVLTree<Key, Data, OwnsKeys, OrderStatistics>::split(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, int _nheight, Key const &_key, AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_left, int *_lheight, AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_match, AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_right, int *_rheight)
+		{
+			if (!_node) {
+				*_left = *_right = *_match = nullptr;
+				*_lheight = *_rheight = 0;
+				return;
+			}
+
+			int l, r;
+			childHeights(_node, _nheight, &l, &r);
+
+			int cmp = Compare(_key, _node->id);
+			if (cmp == 0) {
+				*_left = _node->left;
+				*_lheight = l;
+				*_match = _node;
+				*_right = _node->right;
+				*_rheight = r;
+			} else if (cmp < 0) {
+				AVLNode<Key, Data, OwnsKeys, OrderStatistics> *inner;
+				int h;
+				split(_node->left, l, _key, _left, _lheight, _match, &inner, &h);
+				*_right = join(inner, h, _node, _node->right, r, _rheight);
+			} else {
+				AVLNode<Key, Data, OwnsKeys, OrderStatistics> *inner;
+				int h;
+				split(_node->right, r, _key, &inner, &h, _match, _right, _rheight);
+				*_left = join(_node->left, l, _node, inner, h, _lheight);
+			}
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		void AVLTree<Key, Data, OwnsKeys, OrderStatistics>::destroyDiscards(Discards const &_discards)
+		{
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *node = _discards.head;
+			while (node) {
+				AVLNode<Key, Data, OwnsKeys, OrderStatistics> *next = node->parent;
+				m_pool.destroyTree(node);
+				node = next;
+			}
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		AVLNode<Key, Data, OwnsKeys, OrderStatistics> *AVLTree<Key, Data, OwnsKeys, OrderStatistics>::unionNodes(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_a, int _aheight, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_b, int _bheight, int *_height, Discards *_discards, uint32_t *_duplicates)
+		{
+			if (!_b) {
+				*_height = _aheight;
+				return _a;
+			}
+			if (!_a) {
+				*_height = _bheight;
+				return _b;
+			}
+
+			int al, ar;
+			childHeights(_a, _aheight, &al, &ar);
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *aleft = _a->left, *aright = _a->right;
+
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *bleft, *bright, *match;
+			int bl, br;
+			split(_b, _bheight, _a->id, &bleft, &bl, &match, &bright, &br);
+			if (match) {
+				_a->data = match->data;
+				match->left = match->right = nullptr;
+				discard(_discards, match);
+				(*_duplicates)++;
+			}
+
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *left, *right;
+			int lh, rh;
+#ifdef _OPENMP
+			if (al >= SetTaskHeight && bl >= SetTaskHeight && omp_in_parallel()) {
+				Discards leftDiscards = { nullptr, nullptr };
+				uint32_t leftDuplicates = 0;
+				#pragma omp task shared(left, lh, leftDiscards, leftDuplicates)
+				left = unionNodes(aleft, al, bleft, bl, &lh, &leftDiscards, &leftDuplicates);
+				right = unionNodes(aright, ar, bright, br, &rh, _discards, _duplicates);
+				#pragma omp taskwait
+				discard(_discards, leftDiscards);
+				*_duplicates += leftDuplicates;
+				return join(left, lh, _a, right, rh, _height);
+			}
+#endif
+
+			left = unionNodes(aleft, al, bleft, bl, &lh, _discards, _duplicates);
+			right = unionNodes(aright, ar, bright, br, &rh, _discards, _duplicates);
+			return join(left, lh, _a, right, rh, _height);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		AVLNode<Key, Data, OwnsKeys, OrderStatistics> *AVLTree<Key, Data, OwnsKeys, OrderStatistics>::intersectionNodes(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_a, int _aheight, const AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_b, int _bheight, int *_height, Discards *_discards, uint32_t *_kept)
+		{
+			if (!_a) {
+				*_height = 0;
+				return nullptr;
+			}
+			if (!_b) {
+				discard(_discards, _a);
+				*_height = 0;
+				return nullptr;
+			}
+
+			int bl, br;
+			childHeights(_b, _bheight, &bl, &br);
+
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *aleft, *aright, *match;
+			int al, ar;
+			split(_a, _aheight, _b->id, &aleft, &al, &match, &aright, &ar);
+
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *left, *right;
+			int lh, rh;
+#ifdef _OPENMP
+			if (al >= SetTaskHeight && bl >= SetTaskHeight && omp_in_parallel()) {
+				Discards leftDiscards = { nullptr, nullptr };
+				uint32_t leftKept = 0;
+				#pragma omp task shared(left, lh, leftDiscards, leftKept)
+				left = intersectionNodes(aleft, al, _b->left, bl, &lh, &leftDiscards, &leftKept);
+				right = intersectionNodes(aright, ar, _b->right, br, &rh, _discards, _kept);
+				#pragma omp taskwait
+				discard(_discards, leftDiscards);
+				*_kept += leftKept;
+			} else
+#endif
+			{
+				left = intersectionNodes(aleft, al, _b->left, bl, &lh, _discards, _kept);
+				right = intersectionNodes(aright, ar, _b->right, br, &rh, _discards, _kept);
+			}
+
+			if (!match)
+				return join2(left, lh, right, rh, _height);
+
+			(*_kept)++;
+			return join(left, lh, match, right, rh, _height);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		AVLNode<Key, Data, OwnsKeys, OrderStatistics> *AVLTree<Key, Data, OwnsKeys, OrderStatistics>::differenceNodes(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_a, int _aheight, const AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_b, int _bheight, int *_height, Discards *_discards, uint32_t *_removed)
+		{
+			if (!_a || !_b) {
+				*_height = _aheight;
+				return _a;
+			}
+
+			int bl, br;
+			childHeights(_b, _bheight, &bl, &br);
+
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *aleft, *aright, *match;
+			int al, ar;
+			split(_a, _aheight, _b->id, &aleft, &al, &match, &aright, &ar);
+			if (match) {
+				match->left = match->right = nullptr;
+				discard(_discards, match);
+				(*_removed)++;
+			}
+
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *left, *right;
+			int lh, rh;
+#ifdef _OPENMP
+			if (al >= SetTaskHeight && bl >= SetTaskHeight && omp_in_parallel()) {
+				Discards leftDiscards = { nullptr, nullptr };
+				uint32_t leftRemoved = 0;
+				#pragma omp task shared(left, lh, leftDiscards, leftRemoved)
+				left = differenceNodes(aleft, al, _b->left, bl, &lh, &leftDiscards, &leftRemoved);
+				right = differenceNodes(aright, ar, _b->right, br, &rh, _discards, _removed);
+				#pragma omp taskwait
+				discard(_discards, leftDiscards);
+				*_removed += leftRemoved;
+				return join2(left, lh, right, rh, _height);
+			}
+#endif
+
+			left = differenceNodes(aleft, al, _b->left, bl, &lh, _discards, _removed);
+			right = differenceNodes(aright, ar, _b->right, br, &rh, _discards, _removed);
+			return join2(left, lh, right, rh, _height);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool AVLTree<Key, Data, OwnsKeys, OrderStatistics>::join(AVLTree<Key, Data, OwnsKeys, OrderStatistics> &_right)
+		{
+			if (!_right.m_root)
+				return true;
+			if (&_right == this)
+				return false;
+
+			if (m_root) {
+				AVLNode<Key, Data, OwnsKeys, OrderStatistics> *last = m_root, *first = _right.m_root;
+				while (last->right)
+					last = last->right;
+				while (first->left)
+					first = first->left;
+				if (Compare(last->id, first->id) >= 0)
+					return false;
+			}
+
+			m_pool.adopt(_right.m_pool);
+
+			int h, rest;
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *root = _right.m_root;
+			if (m_root) {
+				AVLNode<Key, Data, OwnsKeys, OrderStatistics> *last;
+				root = splitLast(m_root, subtreeHeight(m_root), &last, &rest);
+				root = join(root, rest, last, _right.m_root, subtreeHeight(_right.m_root), &h);
+			}
+			setRoot(root, m_size + _right.m_size);
+			_right.setRoot(nullptr, 0);
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		uint32_t AVLTree<Key, Data, OwnsKeys, OrderStatistics>::countUpTo(const AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, uint32_t _limit)
+		{
+			if constexpr (OrderStatistics)
+				return subtreeSize(_node) < _limit ? subtreeSize(_node) : _limit;
+
+			if (!_node || _limit == 0)
+				return 0;
+
+			uint32_t n = 1 + countUpTo(_node->left, _limit - 1);
+			if (n < _limit)
+				n += countUpTo(_node->right, _limit - n);
+			return n;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		AVLNode<Key, Data, OwnsKeys, OrderStatistics> *AVLTree<Key, Data, OwnsKeys, OrderStatistics>::moveSubtree(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_parent, AVLTree<Key, Data, OwnsKeys, OrderStatistics> &_dest)
+		{
+			if (!_node)
+				return nullptr;
+
+			/* Take the key, and leave the old node nothing to free */
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *node = _dest.m_pool.construct();
+			node->id = std::move(_node->id);
+			_node->id = Key();
+			node->cachePrefix(node->id);
+			node->data = std::move(_node->data);
+			node->balance = _node->balance;
+			node->parent = _parent;
+			if constexpr (OrderStatistics)
+				node->count = _node->count;
+
+			node->left = moveSubtree(_node->left, node, _dest);
+			node->right = moveSubtree(_node->right, node, _dest);
+			m_pool.destroy(_node);
+			return node;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool AVLTree<Key, Data, OwnsKeys, OrderStatistics>::split(Key const &_key, AVLTree<Key, Data, OwnsKeys, OrderStatistics> &_right)
+		{
+			if (&_right == this || _right.m_root)
+				return false;
+
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *left, *match, *right;
+			int lh, rh, h;
+			split(m_root, subtreeHeight(m_root), _key, &left, &lh, &match, &right, &rh);
+			if (match)
+				right = join((AVLNode<Key, Data, OwnsKeys, OrderStatistics> *)nullptr, 0, match, right, rh, &h);
+			if (right)
+				right->parent = nullptr;
+
+			/* Find the smaller side by counting both in step, doubling the limit,
+			   so this costs no more than copying that side does */
+			bool copyLeft;
+			for (uint32_t limit = 64;; limit *= 2) {
+				uint32_t l = countUpTo(left, limit), r = countUpTo(right, limit);
+				if (l < limit || r < limit) {
+					copyLeft = l < r;
+					break;
+				}
+			}
+
+			/* Each tree's nodes have to live in its own pool */
+			if (copyLeft) {
+				_right.m_pool.adopt(m_pool);
+				size_t before = m_pool.used();
+				uint32_t size = m_size;
+				left = _right.moveSubtree(left, nullptr, *this);
+				setRoot(left, (uint32_t)(m_pool.used() - before));
+				_right.setRoot(right, size - m_size);
+			} else {
+				size_t before = _right.m_pool.used();
+				_right.setRoot(moveSubtree(right, nullptr, _right), 0);
+				uint32_t moved = (uint32_t)(_right.m_pool.used() - before);
+				_right.m_size = moved;
+				setRoot(left, m_size - moved);
+			}
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		void AVLTree<Key, Data, OwnsKeys, OrderStatistics>::set_union(AVLTree<Key, Data, OwnsKeys, OrderStatistics> &_other)
+		{
+			if (&_other == this || !_other.m_root)
+				return;
+
+			m_pool.adopt(_other.m_pool);
+
+			Discards discards = { nullptr, nullptr };
+			uint32_t duplicates = 0;
+			int ah = subtreeHeight(m_root), bh = subtreeHeight(_other.m_root), h;
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *root;
+
+#ifdef _OPENMP
+			if (m_size + _other.m_size >= BuildTaskCutoff * 4 && omp_get_max_threads() > 1 && !omp_in_parallel()) {
+				#pragma omp parallel
+				#pragma omp single
+				root = unionNodes(m_root, ah, _other.m_root, bh, &h, &discards, &duplicates);
+			} else
+#endif
+			root = unionNodes(m_root, ah, _other.m_root, bh, &h, &discards, &duplicates);
+
+			destroyDiscards(discards);
+			setRoot(root, m_size + _other.m_size - duplicates);
+			_other.setRoot(nullptr, 0);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		void AVLTree<Key, Data, OwnsKeys, OrderStatistics>::set_intersection(AVLTree<Key, Data, OwnsKeys, OrderStatistics> const &_other)
+		{
+			if (&_other == this)
+				return;
+
+			Discards discards = { nullptr, nullptr };
+			uint32_t kept = 0;
+			int ah = subtreeHeight(m_root), bh = subtreeHeight(_other.m_root), h;
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *root;
+
+#ifdef _OPENMP
+			if (m_size + _other.m_size >= BuildTaskCutoff * 4 && omp_get_max_threads() > 1 && !omp_in_parallel()) {
+				#pragma omp parallel
+				#pragma omp single
+				root = intersectionNodes(m_root, ah, _other.m_root, bh, &h, &discards, &kept);
+			} else
+#endif
+			root = intersectionNodes(m_root, ah, _other.m_root, bh, &h, &discards, &kept);
+
+			destroyDiscards(discards);
+			setRoot(root, kept);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		void AVLTree<Key, Data, OwnsKeys, OrderStatistics>::set_difference(AVLTree<Key, Data, OwnsKeys, OrderStatistics> const &_other)
+		{
+			if (&_other == this) {
+				empty();
+				return;
+			}
+
+			Discards discards = { nullptr, nullptr };
+			uint32_t removed = 0;
+			int ah = subtreeHeight(m_root), bh = subtreeHeight(_other.m_root), h;
+			AVLNode<Key, Data, OwnsKeys, OrderStatistics> *root;
+
+#ifdef _OPENMP
+			if (m_size + _other.m_size >= BuildTaskCutoff * 4 && omp_get_max_threads() > 1 && !omp_in_parallel()) {
+				#pragma omp parallel
+				#pragma omp single
+				root = differenceNodes(m_root, ah, _other.m_root, bh, &h, &discards, &removed);
+			} else
+#endif
+			root = differenceNodes(m_root, ah, _other.m_root, bh, &h, &discards, &removed);
+
+			destroyDiscards(discards);
+			setRoot(root, m_size - removed);
+		}
 	}
 }
@@ -16,6 +16,11 @@
 #include <crisscross/internal_mem.h>
 #include <crisscross/darray.h>
 #include <crisscross/node.h>
+#include <crisscross/nodepool.h>
+#include <crisscross/sortedsource.h>
+#include <crisscross/treeiterator.h>
+
+#include <utility>
 
 namespace CrissCross
 {
@@ -26,7 +31,7 @@ namespace CrissCross
 		 * well-balanced trees. Due to the ruleset implemented internally,
 		 * AVL trees enforce a maximum height of 1.44*log(n).
 		 */
-		template <class Key, class Data, bool OwnsKeys = true>
+		template <class Key, class Data, bool OwnsKeys = true, bool OrderStatistics = false>
 		class AVLTree
 		{
 			private:
@@ -36,7 +41,7 @@ namespace CrissCross
 				 * the code wrong. A tree copy is generally unnecessary, and in cases that it
 				 * is, it can be achieved by other means.
 				 */
-				AVLTree(const AVLTree<Key, Data, OwnsKeys> &);
+				AVLTree(const AVLTree<Key, Data, OwnsKeys, OrderStatistics> &);
 
 				/*! \brief Private assignment operator. */
 				/*!
@@ -44,15 +49,18 @@ namespace CrissCross
 				 * the code wrong. A tree copy is generally unnecessary, and in cases that it
 				 * is, it can be achieved by other means.
 				 */
-				AVLTree<Key, Data, OwnsKeys> &operator=(const AVLTree<Key, Data, OwnsKeys> &);
+				AVLTree<Key, Data, OwnsKeys, OrderStatistics> &operator=(const AVLTree<Key, Data, OwnsKeys, OrderStatistics> &);
 
 			protected:
 				/*! \brief The root node. */
-				AVLNode<Key, Data, OwnsKeys> *m_root;
+				AVLNode<Key, Data, OwnsKeys, OrderStatistics> *m_root;
 
 				/*! \brief The current tree size. */
 				uint32_t m_size;
 
+				/*! \brief The allocator for the tree's nodes. */
+				NodePool<AVLNode<Key, Data, OwnsKeys, OrderStatistics> > m_pool;
+
 				/*! \brief Result of tree operation */
 				enum {
 					/*! \brief None of the subtrees has grown in height, entire tree is still balanced */
@@ -65,19 +73,43 @@ namespace CrissCross
 					INVALID
 				};
 
+				/*! \brief Gets the number of nodes in a subtree. */
+				/*!
+				 * \param _node The root of the subtree, or nullptr.
+				 * \return The subtree size, or 0 if the tree doesn't track order statistics.
+				 */
+				static inline uint32_t subtreeSize(const AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node)
+				{
+					if constexpr (OrderStatistics)
+						return _node ? _node->count : 0;
+					else
+						return 0;
+				}
+
+				/*! \brief Recomputes a node's subtree size from its children. */
+				/*!
+				 * Does nothing if the tree doesn't track order statistics.
+				 * \param _node The node to update.
+				 */
+				static inline void recount(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node)
+				{
+					if constexpr (OrderStatistics)
+						_node->count = 1 + subtreeSize(_node->left) + subtreeSize(_node->right);
+				}
+
 				/*! \brief Rotate tree left */
 				/*!
 				 * Rotate tree left around the given node
 				 * \param _node Pointer to current node pointer to rotate
 				 */
-				inline void rotateLeft(AVLNode<Key, Data, OwnsKeys> **_node);
+				inline void rotateLeft(AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_node);
 
 				/*! \brief Rotate tree right */
 				/*!
 				 * Rotate tree right around the given node
 				 * \param _node Pointer to current node pointer to rotate
 				 */
-				inline void rotateRight(AVLNode<Key, Data, OwnsKeys> **_node);
+				inline void rotateRight(AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_node);
 
 				/*! \brief Rebalance tree */
 				/*!
@@ -85,7 +117,7 @@ namespace CrissCross
 				 * \param _node Pointer to current node pointer to balance
 				 * \return OK if tree is balanced (entire tree is valid), BALANCE if local tree is balanced but has grown in height (entire tree not guaranteed to be valid)
 				 */
-				inline int balanceLeftGrown(AVLNode<Key, Data, OwnsKeys> **_node);
+				inline int balanceLeftGrown(AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_node);
 
 				/*! \brief Rebalance tree */
 				/*!
@@ -93,7 +125,7 @@ namespace CrissCross
 				 * \param _node Pointer to current node pointer to balance
 				 * \return OK if tree is balanced (entire tree is valid), BALANCE if local tree is balanced but has grown in height (entire tree not guaranteed to be valid)
 				 */
-				inline int balanceRightGrown(AVLNode<Key, Data, OwnsKeys> **_node);
+				inline int balanceRightGrown(AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_node);
 
 				/*! \brief Rebalance tree */
 				/*!
@@ -101,7 +133,7 @@ namespace CrissCross
 				 * \param _node Pointer to current node pointer to balance
 				 * \return OK if tree is balanced (entire tree is valid), BALANCE if local tree is balanced but has shrunk in height (entire tree not guaranteed to be valid)
 				 */
-				inline int balanceLeftShrunk(AVLNode<Key, Data, OwnsKeys> **_node);
+				inline int balanceLeftShrunk(AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_node);
 
 				/*! \brief Rebalance tree */
 				/*!
@@ -109,7 +141,7 @@ namespace CrissCross
 				 * \param _node Pointer to current node pointer to balance
 				 * \return OK if tree is balanced (entire tree is valid), BALANCE if local tree is balanced but has shrunk in height (entire tree not guaranteed to be valid)
 				 */
-				inline int balanceRightShrunk(AVLNode<Key, Data, OwnsKeys> **_node);
+				inline int balanceRightShrunk(AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_node);
 
 				/*! \brief Replace node */
 				/*!
@@ -119,7 +151,7 @@ namespace CrissCross
 				 * \param _result Pointer to result variable to tell caller if further checks are needed
 				 * \return true if node found, false if not
 				 */
-				inline bool replaceWithHighest(AVLNode<Key, Data, OwnsKeys> *_target, AVLNode<Key, Data, OwnsKeys> **_subtree, int *_result);
+				inline bool replaceWithHighest(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_target, AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_subtree, int *_result);
 
 				/*! \brief Replace node */
 				/*!
@@ -129,7 +161,7 @@ namespace CrissCross
 				 * \param _result Pointer to result variable to tell caller if further checks are needed
 				 * \return true if node found, false if not
 				 */
-				inline bool replaceWithLowest(AVLNode<Key, Data, OwnsKeys> *_target, AVLNode<Key, Data, OwnsKeys> **_subtree, int *_result);
+				inline bool replaceWithLowest(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_target, AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_subtree, int *_result);
 
 				/*! \brief Add object */
 				/*!
@@ -138,18 +170,46 @@ namespace CrissCross
 				 * \param _node Pointer to current node pointer
 				 * \param _key Key to insert
 				 * \param _data Data to insert
+				 * \param _prefix KeyPrefix<Key>::Make(_key), so it's only computed once
 				 * \return int of addition (OK if subtree is balanced, BALANCE if tree is heavy on either side)
 				 */
-				int insert(AVLNode<Key, Data, OwnsKeys> **_parent, AVLNode<Key, Data, OwnsKeys> **_node, Key const &_key, Data const &_data);
+				int insert(AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_parent, AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_node, Key const &_key, Data const &_data, typename KeyPrefix<Key>::Type _prefix);
+
+				/*! \brief Add object below a known parent */
+				/*!
+				 * Links a new node under the node found by a search, then rebalances by
+				 * walking up the parent links, stopping as soon as a subtree's height
+				 * doesn't change.
+				 * \param _parent The new node's parent, or nullptr for an empty tree
+				 * \param _side Negative to attach to the left of _parent, positive for the right
+				 * \param _key Key to insert
+				 * \param _data Data to insert
+				 * \return The new node
+				 */
+				AVLNode<Key, Data, OwnsKeys, OrderStatistics> *attach(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_parent, int _side, Key const &_key, Data const &_data);
+
+				/*! \brief Gets the link which points at a node */
+				/*!
+				 * \param _node The node
+				 * \return The address of _node's parent's left or right link, or of m_root
+				 */
+				inline AVLNode<Key, Data, OwnsKeys, OrderStatistics> **linkTo(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node)
+				{
+					AVLNode<Key, Data, OwnsKeys, OrderStatistics> *parent = _node->parent;
+					if (!parent)
+						return &m_root;
+					return parent->left == _node ? &parent->left : &parent->right;
+				}
 
 				/*! \brief Remove object */
 				/*!
 				 * Remove object from tree and rebalance
 				 * \param _node Pointer to current node pointer
 				 * \param _key Identifier of node to remove
+				 * \param _prefix KeyPrefix<Key>::Make(_key), so it's only computed once
 				 * \return int of removal (OK if subtree is balanced, BALANCE if tree is heavy on either side)
 				 */
-				int erase(AVLNode<Key, Data, OwnsKeys> **_node, Key const &_key);
+				int erase(AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_node, Key const &_key, typename KeyPrefix<Key>::Type _prefix);
 
 				/*! \brief Find a node in the tree */
 				/*!
@@ -157,14 +217,191 @@ namespace CrissCross
 				 * \param _key Identifier of node to remove
 				 * \return Address of the node. If not found, returns nullptr.
 				 */
-				AVLNode<Key, Data, OwnsKeys> *findNode(Key const &_key) const;
+				AVLNode<Key, Data, OwnsKeys, OrderStatistics> *findNode(Key const &_key) const;
+
+				/*! \brief Subtrees at least this large are built as separate tasks. */
+				static constexpr uint32_t BuildTaskCutoff = 8192;
+
+				/*! \brief Recursively builds a perfectly balanced subtree from presorted items */
+				/*!
+				 * The middle item becomes the root, so the left side is never smaller than the right.
+				 * \param _src The presorted items.
+				 * \param _slots Storage for every node, by item index, or nullptr to allocate from the pool.
+				 * \param _lo The first item of the subtree.
+				 * \param _hi One past the last item of the subtree.
+				 * \param _parent The parent of the subtree.
+				 * \return The root of the subtree.
+				 */
+				template <class Source>
+				AVLNode<Key, Data, OwnsKeys, OrderStatistics> *buildSubtree(Source const *_src, AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_slots, uint32_t _lo, uint32_t _hi, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_parent);
+
+				/*! \brief Replaces the tree's contents with presorted items */
+				/*!
+				 * \param _src The presorted items. Must already be checked with sorted().
+				 */
+				template <class Source>
+				void build(Source const *_src);
+
+				/*! \brief Subtrees cut out of a tree by a set operation, to be destroyed once it is done. */
+				/*!
+				 * The subtrees are chained through their roots' parent pointers. Parallel
+				 * tasks each collect their own list, so the pool is only touched afterwards.
+				 */
+				struct Discards
+				{
+					AVLNode<Key, Data, OwnsKeys, OrderStatistics> *head;
+					AVLNode<Key, Data, OwnsKeys, OrderStatistics> *tail;
+				};
+
+				/*! \brief Subtrees at least this tall are combined as separate tasks by the set operations. */
+				static constexpr int SetTaskHeight = 12;
+
+				/*! \brief Gets the height of a subtree by following its taller side. */
+				static int subtreeHeight(const AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node);
+
+				/*! \brief Gets the heights of a node's subtrees from the node's own height. */
+				static inline void childHeights(const AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, int _height, int *_left, int *_right)
+				{
+					*_left = _height - (_node->balance == RIGHTHEAVY ? 2 : 1);
+					*_right = _height - (_node->balance == LEFTHEAVY ? 2 : 1);
+				}
+
+				/*! \brief Makes two subtrees the children of a node, whose heights differ by at most one. */
+				/*!
+				 * \param _node The new root.
+				 * \param _left The left subtree, or nullptr.
+				 * \param _lheight The height of the left subtree.
+				 * \param _right The right subtree, or nullptr.
+				 * \param _rheight The height of the right subtree.
+				 * \param _height Set to the height of the result.
+				 * \return _node.
+				 */
+				static AVLNode<Key, Data, OwnsKeys, OrderStatistics> *link(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_left, int _lheight, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_right, int _rheight, int *_height);
+
+				/*! \brief Joins two subtrees around a middle node, when the left one is taller. */
+				static AVLNode<Key, Data, OwnsKeys, OrderStatistics> *joinRight(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_left, int _lheight, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_right, int _rheight, int *_height);
+
+				/*! \brief Joins two subtrees around a middle node, when the right one is taller. */
+				static AVLNode<Key, Data, OwnsKeys, OrderStatistics> *joinLeft(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_left, int _lheight, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_right, int _rheight, int *_height);
+
+				/*! \brief Joins two subtrees around a middle node. */
+				/*!
+				 * Every key in _left must be less than _node's, and every key in _right
+				 * greater. Runs in O(|_lheight - _rheight| + 1).
+				 * \param _left The left subtree, or nullptr.
+				 * \param _lheight The height of the left subtree.
+				 * \param _node The middle node. Its old links are ignored.
+				 * \param _right The right subtree, or nullptr.
+				 * \param _rheight The height of the right subtree.
+				 * \param _height Set to the height of the result.
+				 * \return The root of the joined subtree.
+				 */
+				static AVLNode<Key, Data, OwnsKeys, OrderStatistics> *join(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_left, int _lheight, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_right, int _rheight, int *_height);
+
+				/*! \brief Joins two subtrees with no middle node. */
+				static AVLNode<Key, Data, OwnsKeys, OrderStatistics> *join2(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_left, int _lheight, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_right, int _rheight, int *_height);
+
+				/*! \brief Detaches the largest node from a non-empty subtree. */
+				/*!
+				 * \param _node The subtree.
+				 * \param _nheight The height of the subtree.
+				 * \param _last Set to the detached node.
+				 * \param _height Set to the height of the rest of the subtree.
+				 * \return The rest of the subtree.
+				 */
+				static AVLNode<Key, Data, OwnsKeys, OrderStatistics> *splitLast(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, int _nheight, AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_last, int *_height);
+
+				/*! \brief Splits a subtree into the keys below and above a key. */
+				/*!
+				 * \param _node The subtree.
+				 * \param _nheight The height of the subtree.
+				 * \param _key The key to split at.
+				 * \param _left Set to the subtree of keys less than _key.
+				 * \param _lheight Set to the height of _left.
+				 * \param _match Set to the node holding _key, or nullptr. Its links are stale.
+				 * \param _right Set to the subtree of keys greater than _key.
+				 * \param _rheight Set to the height of _right.
+				 */
+				static void split(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, int _nheight, Key const &_key, AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_left, int *_lheight, AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_match, AVLNode<Key, Data, OwnsKeys, OrderStatistics> **_right, int *_rheight);
+
+				/*! \brief Adds a subtree to a discard list. */
+				static inline void discard(Discards *_discards, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node)
+				{
+					if (!_node)
+						return;
+					_node->parent = nullptr;
+					if (_discards->tail)
+						_discards->tail->parent = _node;
+					else
+						_discards->head = _node;
+					_discards->tail = _node;
+				}
+
+				/*! \brief Appends one discard list to another. */
+				static inline void discard(Discards *_discards, Discards const &_more)
+				{
+					if (!_more.head)
+						return;
+					if (_discards->tail)
+						_discards->tail->parent = _more.head;
+					else
+						_discards->head = _more.head;
+					_discards->tail = _more.tail;
+				}
+
+				/*! \brief Destroys every subtree on a discard list. */
+				void destroyDiscards(Discards const &_discards);
+
+				/*! \brief Recursively merges two subtrees, with _b's data winning for keys in both. */
+				/*!
+				 * \param _duplicates Incremented for each key found in both.
+				 */
+				static AVLNode<Key, Data, OwnsKeys, OrderStatistics> *unionNodes(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_a, int _aheight, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_b, int _bheight, int *_height, Discards *_discards, uint32_t *_duplicates);
+
+				/*! \brief Recursively keeps the keys of _a which are also in _b, which is left untouched. */
+				/*!
+				 * \param _kept Incremented for each key kept.
+				 */
+				static AVLNode<Key, Data, OwnsKeys, OrderStatistics> *intersectionNodes(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_a, int _aheight, const AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_b, int _bheight, int *_height, Discards *_discards, uint32_t *_kept);
+
+				/*! \brief Recursively removes the keys of _b from _a. _b is left untouched. */
+				/*!
+				 * \param _removed Incremented for each key removed.
+				 */
+				static AVLNode<Key, Data, OwnsKeys, OrderStatistics> *differenceNodes(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_a, int _aheight, const AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_b, int _bheight, int *_height, Discards *_discards, uint32_t *_removed);
+
+				/*! \brief Counts the nodes of a subtree, giving up at a limit. */
+				/*!
+				 * \param _node The root of the subtree, or nullptr.
+				 * \param _limit The most nodes to count.
+				 * \return The subtree size, or _limit if it is at least that big.
+				 */
+				static uint32_t countUpTo(const AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, uint32_t _limit);
+
+				/*! \brief Moves a subtree's items into new nodes from another tree's pool. */
+				/*!
+				 * \param _node The subtree, whose nodes are destroyed.
+				 * \param _parent The parent of the new subtree.
+				 * \param _dest The tree whose pool provides the new nodes.
+				 * \return The root of the new subtree.
+				 */
+				AVLNode<Key, Data, OwnsKeys, OrderStatistics> *moveSubtree(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_parent, AVLTree<Key, Data, OwnsKeys, OrderStatistics> &_dest);
+
+				/*! \brief Makes a subtree the whole tree. */
+				inline void setRoot(AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_root, uint32_t _size)
+				{
+					m_root = _root;
+					if (_root)
+						_root->parent = nullptr;
+					m_size = _size;
+				}
 
 				/*! \brief Recursively convert the tree's keys into a DArray */
 				/*!
 				 * \param _darray Array to insert keys into
 				 * \param _btree The node being traversed
 				 */
-				void RecursiveConvertIndexToDArray(DArray<Key> *_darray, AVLNode<Key, Data, OwnsKeys> *_btree) const;
+				void RecursiveConvertIndexToDArray(DArray<Key> *_darray, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_btree) const;
 
 				/*! \brief Recursively convert the tree's data into a DArray */
 				/*!
@@ -172,14 +409,14 @@ namespace CrissCross
 				 * \param _btree The node being traversed
 				 */
 				template <class TypedData>
-				void RecursiveConvertToDArray(DArray<TypedData> *_darray, AVLNode<Key, Data, OwnsKeys> *_btree) const;
+				void RecursiveConvertToDArray(DArray<TypedData> *_darray, AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_btree) const;
 
 				/*! \brief Verifies that a node is valid. */
 				/*!
 				 * \param _node A node pointer.
 				 * \return True if the node is a valid node, false otherwise.
 				 */
-				inline bool valid(const AVLNode<Key, Data, OwnsKeys> *_node) const
+				inline bool valid(const AVLNode<Key, Data, OwnsKeys, OrderStatistics> *_node) const
 				{
 					return (_node != nullptr);
 				}
@@ -225,6 +462,21 @@ namespace CrissCross
 				template <class TypedData = Data>
 				TypedData find(Key const &_key, TypedData const &_default = nullptr) const;
 
+				/*! \brief Finds many keys at once. */
+				/*!
+				 * Equivalent to calling find() on each key, but a group of searches descends
+				 * the tree together, one level per pass. Each pass prefetches the next node
+				 * of every search before any of them is read, so the cache misses of the
+				 * whole group overlap instead of being taken one after another.
+				 * \param _keys The keys to find.
+				 * \param _count The number of keys.
+				 * \param _out Receives the data for each key, or _default if it wasn't found.
+				 * \param _default The value to store for keys which couldn't be found.
+				 * \return The number of keys found.
+				 */
+				template <class TypedData = Data>
+				size_t find_batch(Key const *_keys, size_t _count, TypedData *_out, TypedData const &_default = nullptr) const;
+
 				/*! \brief Tests whether a key is in the tree or not. */
 				/*!
 				 * \param _key The key of the node to find.
@@ -241,7 +493,7 @@ namespace CrissCross
 				 */
 				inline void empty()
 				{
-					delete m_root;
+					m_pool.releaseTree(m_root);
 					m_root = nullptr;
 					m_size = 0;
 				}
@@ -263,6 +515,189 @@ namespace CrissCross
 				 */
 				bool replace(Key const &_key, Data const &_data);
 
+				/*! \brief Replaces the tree's contents with presorted data, in linear time. */
+				/*!
+				 * Builds a perfectly balanced tree directly, without searching or
+				 * rebalancing. Large trees are built in parallel when OpenMP is enabled.
+				 * \param _keys The keys, in strictly ascending order.
+				 * \param _data The data for each key.
+				 * \param _count The number of items in both arrays.
+				 * \return True on success, false if the keys aren't strictly ascending. On
+				 *    failure, the tree is left unchanged.
+				 */
+				bool build_from_sorted(Key const *_keys, Data const *_data, uint32_t _count);
+
+				/*! \brief Replaces the tree's contents with presorted data, in linear time. */
+				/*!
+				 * \param _keys The keys, in strictly ascending order. Unused slots are skipped.
+				 * \param _data The data for each key, at the same indices as the keys.
+				 * \return True on success, false if the keys aren't strictly ascending or
+				 *    some key has no data. On failure, the tree is left unchanged.
+				 */
+				bool build_from_sorted(DArray<Key> const *_keys, DArray<Data> const *_data);
+
+				/*! \brief A bidirectional in-order iterator over the tree. */
+				typedef TreeIterator<AVLNode<Key, Data, OwnsKeys, OrderStatistics>, Key, Data> iterator;
+
+				/*! \brief Gets an iterator at the smallest key. */
+				/*!
+				 * \return An iterator at the first key, or end() if the tree is empty.
+				 */
+				inline iterator begin() const
+				{
+					return iterator::first(&m_root, nullptr);
+				}
+
+				/*! \brief Gets the past-the-end iterator. */
+				/*!
+				 * \return An iterator which points past the last key.
+				 */
+				inline iterator end() const
+				{
+					return iterator(nullptr, &m_root, nullptr);
+				}
+
+				/*! \brief Finds the first key not less than the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return An iterator at the first key >= _key, or end() if there is none.
+				 */
+				inline iterator lower_bound(Key const &_key) const
+				{
+					return iterator::lowerBound(&m_root, nullptr, _key);
+				}
+
+				/*! \brief Finds the first key greater than the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return An iterator at the first key > _key, or end() if there is none.
+				 */
+				inline iterator upper_bound(Key const &_key) const
+				{
+					return iterator::upperBound(&m_root, nullptr, _key);
+				}
+
+				/*! \brief Finds the range of keys equal to the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return The pair lower_bound(_key), upper_bound(_key).
+				 */
+				inline std::pair<iterator, iterator> equal_range(Key const &_key) const
+				{
+					return std::make_pair(lower_bound(_key), upper_bound(_key));
+				}
+
+				/*! \brief Inserts data into the tree, searching from a nearby key instead of the root. */
+				/*!
+				 * Inserting keys in order, or clustered together, costs amortized O(1) each
+				 * when every insert is hinted with the iterator returned by the one before.
+				 * \param _hint An iterator at a key near _key. end() searches from the root.
+				 * \param _key The key of the data.
+				 * \param _data The data to insert.
+				 * \return An iterator at the key, whether it was inserted or already in the tree.
+				 *    Only size() tells the two apart, as an existing key's data isn't changed.
+				 */
+				iterator insert(iterator const &_hint, Key const &_key, Data const &_data);
+
+				/*! \brief Finds a key, searching from a nearby key instead of the root. */
+				/*!
+				 * \param _hint An iterator at a key near _key. end() searches from the root.
+				 * \param _key The key to search for.
+				 * \return An iterator at the key, or end() if it isn't in the tree.
+				 */
+				iterator find_near(iterator const &_hint, Key const &_key) const;
+
+				/*! \brief Visits the keys in [_lo, _hi) in order, without copying the tree. */
+				/*!
+				 * \param _lo The smallest key to visit.
+				 * \param _hi The key to stop at. It isn't visited.
+				 * \param _fn Called as _fn(key, data) for each key in the range.
+				 * \return The number of keys visited.
+				 */
+				template <class Visitor>
+				inline uint32_t for_each_in_range(Key const &_lo, Key const &_hi, Visitor _fn) const
+				{
+					return iterator::forEachInRange(&m_root, nullptr, _lo, _hi, _fn);
+				}
+
+				/*! \brief Finds the key at the given position in sorted order. */
+				/*!
+				 * Runs in O(log n). Only available when OrderStatistics is enabled.
+				 * \param _index The zero-based position, so 0 is the smallest key.
+				 * \return An iterator at the key, or end() if _index is out of range.
+				 */
+				iterator select(uint32_t _index) const;
+
+				/*! \brief Counts the keys less than the given key. */
+				/*!
+				 * Runs in O(log n). Only available when OrderStatistics is enabled.
+				 * \param _key The key to rank. It doesn't need to be in the tree.
+				 * \return The number of keys less than _key.
+				 */
+				uint32_t rank(Key const &_key) const;
+
+				/*! \brief Counts the keys in [_lo, _hi). */
+				/*!
+				 * Runs in O(log n). Only available when OrderStatistics is enabled.
+				 * \param _lo The smallest key to count.
+				 * \param _hi The key to stop at. It isn't counted.
+				 * \return The number of keys k with _lo <= k < _hi.
+				 */
+				uint32_t count_range(Key const &_lo, Key const &_hi) const;
+
+				/*! \brief Appends another tree whose keys are all greater than this one's. */
+				/*!
+				 * Moves the nodes over without copying them, in O(log n) time. The other
+				 * tree is left empty.
+				 * \param _right The tree to append.
+				 * \return True on success, false if some key in _right isn't greater than
+				 *    every key in this tree. On failure, neither tree is changed.
+				 */
+				bool join(AVLTree<Key, Data, OwnsKeys, OrderStatistics> &_right);
+
+				/*! \brief Moves the keys not less than a key into another tree. */
+				/*!
+				 * Finding the split takes O(log n). Each tree's nodes live in its own
+				 * pool, and the pool's blocks hold nodes from both sides of the split,
+				 * so one side has to be copied into new nodes. The smaller side is the
+				 * one copied, with the other pool handed over whole, so splitting off k
+				 * of n items costs O(log n + min(k, n - k)) rather than O(log n).
+				 * \param _key The key to split at. It goes to _right if it is in the tree.
+				 * \param _right An empty tree to receive the keys.
+				 * \return True on success, false if _right wasn't empty.
+				 */
+				bool split(Key const &_key, AVLTree<Key, Data, OwnsKeys, OrderStatistics> &_right);
+
+				/*! \brief Moves every item of another tree into this one. */
+				/*!
+				 * Takes the other tree's nodes rather than copying them, and does
+				 * O(m log(n/m + 1)) work for trees of sizes m <= n. Large trees are
+				 * merged in parallel when OpenMP is enabled. Where both trees hold a
+				 * key, the other tree's data replaces this tree's, so merging a batch
+				 * of updates into a base tree applies them. The other tree is left empty.
+				 * \warning This won't free the memory occupied by replaced data.
+				 * \param _other The tree to merge in.
+				 */
+				void set_union(AVLTree<Key, Data, OwnsKeys, OrderStatistics> &_other);
+
+				/*! \brief Removes every key that isn't also in another tree. */
+				/*!
+				 * Does O(m log(n/m + 1)) work, in parallel for large trees when OpenMP
+				 * is enabled. The other tree isn't modified.
+				 * \warning This won't free the memory occupied by the removed data.
+				 * \param _other The tree to intersect with.
+				 */
+				void set_intersection(AVLTree<Key, Data, OwnsKeys, OrderStatistics> const &_other);
+
+				/*! \brief Removes every key that is also in another tree. */
+				/*!
+				 * Does O(m log(n/m + 1)) work, in parallel for large trees when OpenMP
+				 * is enabled. The other tree isn't modified.
+				 * \warning This won't free the memory occupied by the removed data.
+				 * \param _other The tree whose keys to remove.
+				 */
+				void set_difference(AVLTree<Key, Data, OwnsKeys, OrderStatistics> const &_other);
+
 				/*! \brief Converts the tree data into a linearized DArray. */
 				/*!
 				 * \return A DArray containing the data of the tree.
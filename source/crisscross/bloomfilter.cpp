@@ -0,0 +1,212 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_bloomfilter_h
+#error "This file shouldn't be compiled directly."
+#endif
+
+#include <cmath>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		template <class Key>
+		BloomFilter<Key>::BloomFilter(size_t _capacity, double _falsePositiveRate)
+			: m_capacity(0), m_rate(0.01), m_size(0)
+		{
+			resize(_capacity, _falsePositiveRate);
+		}
+
+		template <class Key>
+		BloomFilter<Key>::~BloomFilter()
+		{
+		}
+
+		template <class Key>
+		size_t BloomFilter<Key>::blocksFor(size_t _capacity, double _rate)
+		{
+			/*
+			 * Keys land in blocks as a Poisson process. A block holding j keys has
+			 * j bits set per word, so a stray key gets through it with probability
+			 * (1 - (63/64)^j)^8. Search for the most keys per block whose expected
+			 * rate is still within _rate.
+			 */
+			double lo = 0.0, hi = 256.0;
+			for (int step = 0; step < 40; step++) {
+				double load = (lo + hi) / 2.0;
+				double term = exp(-load), rate = 0.0, unset = 1.0;
+				int last = (int)(load * 2.0) + 64;
+				for (int j = 0; j <= last; j++) {
+					rate += term * pow(1.0 - unset, 8);
+					unset *= 63.0 / 64.0;
+					term *= load / (j + 1);
+				}
+				if (rate <= _rate)
+					lo = load;
+				else
+					hi = load;
+			}
+
+			double blocks = ceil((double)_capacity / (lo > 0.0 ? lo : 1.0));
+			return blocks < 1.0 ? 1 : (size_t)blocks;
+		}
+
+		template <class Key>
+		void BloomFilter<Key>::insert(Key const &_key)
+		{
+			uint64_t hash = mix(_key);
+			uint64_t bits[8];
+			masks(hash, bits);
+
+			Block &target = m_blocks[blockIndex(hash)];
+			for (int i = 0; i < 8; i++)
+				target.words[i] |= bits[i];
+			m_size++;
+		}
+
+		template <class Key>
+		bool BloomFilter<Key>::contains(Key const &_key) const
+		{
+			uint64_t hash = mix(_key);
+			Block const &target = m_blocks[blockIndex(hash)];
+
+#if defined(CC_BLOOMFILTER_AVX2)
+			/* The same salted multiplies as masks(), eight lanes at once */
+			const __m256i salt = _mm256_setr_epi32(
+				0x47b6137b, 0x44974d91, (int)0x8824ad5b, (int)0xa2b7289d,
+				0x705495c7, 0x2df1424b, (int)0x9efc4947, 0x5c6bfb31);
+			__m256i shift = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32((int)(uint32_t)hash), salt), 26);
+			const __m256i one = _mm256_set1_epi64x(1);
+			__m256i lo = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(shift)));
+			__m256i hi = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(shift, 1)));
+			__m256i words_lo = _mm256_load_si256((const __m256i *)&target.words[0]);
+			__m256i words_hi = _mm256_load_si256((const __m256i *)&target.words[4]);
+			return _mm256_testc_si256(words_lo, lo) & _mm256_testc_si256(words_hi, hi);
+#elif defined(CC_BLOOMFILTER_SSE2)
+			/* SSE2 can't shift each lane by its own amount, so only the check is vectorized */
+			alignas(16) uint64_t bits[8];
+			masks(hash, bits);
+			__m128i missing = _mm_setzero_si128();
+			for (int i = 0; i < 8; i += 2) {
+				__m128i want = _mm_load_si128((const __m128i *)&bits[i]);
+				__m128i have = _mm_load_si128((const __m128i *)&target.words[i]);
+				missing = _mm_or_si128(missing, _mm_andnot_si128(have, want));
+			}
+			return _mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) == 0xFFFF;
+#else
+			uint64_t bits[8];
+			masks(hash, bits);
+			uint64_t missing = 0;
+			for (int i = 0; i < 8; i++)
+				missing |= bits[i] & ~target.words[i];
+			return missing == 0;
+#endif
+		}
+
+		template <class Key>
+		void BloomFilter<Key>::clear()
+		{
+			if (!m_blocks.empty())
+				memset((void *)m_blocks.data(), 0, m_blocks.size() * sizeof(Block));
+			m_size = 0;
+		}
+
+		template <class Key>
+		void BloomFilter<Key>::resize(size_t _capacity, double _falsePositiveRate)
+		{
+			if (_falsePositiveRate > 0.0) {
+				if (_falsePositiveRate < 0.000001)
+					_falsePositiveRate = 0.000001;
+				if (_falsePositiveRate > 0.5)
+					_falsePositiveRate = 0.5;
+				m_rate = _falsePositiveRate;
+			}
+			if (_capacity < 1)
+				_capacity = 1;
+
+			m_capacity = _capacity;
+			m_blocks.clear();
+			m_blocks.resize(blocksFor(m_capacity, m_rate));
+			clear();
+		}
+
+		template <class Key>
+		size_t BloomFilter<Key>::mem_usage() const
+		{
+			return sizeof(*this) + m_blocks.capacity() * sizeof(Block);
+		}
+
+		template <class Key, class Data, class Container>
+		FilteredMap<Key, Data, Container>::FilteredMap(size_t _capacity, double _falsePositiveRate)
+			: m_filter(_capacity, _falsePositiveRate)
+		{
+		}
+
+		template <class Key, class Data, class Container>
+		FilteredMap<Key, Data, Container>::~FilteredMap()
+		{
+		}
+
+		template <class Key, class Data, class Container>
+		void FilteredMap<Key, Data, Container>::rebuild()
+		{
+			/* Twice the live keys, so the next rebuild is as far off as the map has keys */
+			size_t keys = live(m_map);
+			m_filter.resize(keys * 2 > m_filter.capacity() / 2 ? keys * 2 : m_filter.capacity() / 2);
+			fill(m_filter, m_map);
+		}
+
+		template <class Key, class Data, class Container>
+		bool FilteredMap<Key, Data, Container>::insert(Key const &_key, Data const &_data)
+		{
+			if (!insertInto(m_map, _key, _data))
+				return false;
+
+			if (m_filter.full())
+				rebuild();
+			else
+				m_filter.insert(_key);
+			return true;
+		}
+
+		template <class Key, class Data, class Container>
+		bool FilteredMap<Key, Data, Container>::erase(Key const &_key)
+		{
+			if (!m_filter.contains(_key))
+				return false;
+			return m_map.erase(_key);
+		}
+
+		template <class Key, class Data, class Container>
+		Data FilteredMap<Key, Data, Container>::find(Key const &_key, Data const &_default) const
+		{
+			if (!m_filter.contains(_key))
+				return _default;
+			return m_map.find(_key, _default);
+		}
+
+		template <class Key, class Data, class Container>
+		bool FilteredMap<Key, Data, Container>::exists(Key const &_key) const
+		{
+			if (!m_filter.contains(_key))
+				return false;
+			return m_map.exists(_key);
+		}
+
+		template <class Key, class Data, class Container>
+		void FilteredMap<Key, Data, Container>::empty()
+		{
+			m_map.empty();
+			m_filter.clear();
+		}
+	}
+}
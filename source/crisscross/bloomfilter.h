@@ -0,0 +1,402 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_bloomfilter_h
+#define __included_cc_bloomfilter_h
+
+#include <crisscross/cc_attr.h>
+#include <crisscross/hashtable.h>
+#include <crisscross/hash.h>
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__)
+#define CC_BLOOMFILTER_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CC_BLOOMFILTER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		/*! \brief Hashes a key for a BloomFilter. */
+		/*!
+		 * Keys which Compare as equal must hash the same, so unlike Hash, the
+		 * C-style string versions ignore case unless CASE_SENSITIVE_COMPARE is
+		 * defined.
+		 */
+		template <class T>
+		struct FilterHash
+		{
+			static inline uint64_t Make(T const &_key)
+			{
+				return Hash<T>(_key);
+			}
+		};
+
+		/*! @cond */
+		static inline uint64_t FilterHashString(const char *_key)
+		{
+			CoreAssert(_key);
+			uint64_t hash = 0xcbf29ce484222325ULL;
+			for (; *_key; _key++) {
+#ifdef CASE_SENSITIVE_COMPARE
+				hash ^= (unsigned char)*_key;
+#else
+				hash ^= (unsigned char)tolower((unsigned char)*_key);
+#endif
+				hash *= 0x100000001b3ULL;
+			}
+			return hash;
+		}
+		/*! @endcond */
+
+		/*! \brief C-style string CrissCross::Data::FilterHash. */
+		template <>
+		struct FilterHash<char *>
+		{
+			static inline uint64_t Make(char *const &_key)
+			{
+				return FilterHashString(_key);
+			}
+		};
+
+		/*! \brief C-style string CrissCross::Data::FilterHash. */
+		template <>
+		struct FilterHash<const char *>
+		{
+			static inline uint64_t Make(const char *const &_key)
+			{
+				return FilterHashString(_key);
+			}
+		};
+
+		/*! \brief A blocked Bloom filter, for ruling out keys before a real lookup. */
+		/*!
+		 * A Bloom filter answers "is this key in the set?" with either "definitely
+		 * not" or "maybe". A "maybe" for a key that was never inserted is a false
+		 * positive, and happens at about the rate the filter was built for, as long
+		 * as no more keys are inserted than it was built for.
+		 *
+		 * The filter is split into 64-byte blocks, each aligned to a cache line.
+		 * A key picks one block, and sets one bit in each of the block's eight
+		 * 64-bit words, so a lookup touches exactly one cache line. The bits are
+		 * checked with AVX2 or SSE2 where they're available.
+		 *
+		 * Keys can't be removed. To drop keys or make room for more, clear() or
+		 * resize() the filter and insert the remaining keys again.
+		 */
+		template <class Key>
+		class BloomFilter
+		{
+			private:
+				/*! \brief Private copy constructor. */
+				/*!
+				 * If your code needs to invoke the copy constructor, you've probably written
+				 * the code wrong. A filter copy is generally unnecessary, and in cases that it
+				 * is, it can be achieved by other means.
+				 */
+				BloomFilter(const BloomFilter<Key> &) = delete;
+
+				/*! \brief Private assignment operator. */
+				/*!
+				 * If your code needs to invoke the assignment operator, you've probably written
+				 * the code wrong. A filter copy is generally unnecessary, and in cases that it
+				 * is, it can be achieved by other means.
+				 */
+				BloomFilter<Key> &operator =(const BloomFilter<Key> &) = delete;
+
+			protected:
+				/*! \brief A cache line of filter bits. */
+				struct alignas(64) Block
+				{
+					uint64_t words[8];
+				};
+
+				/*! \brief The filter bits. */
+				std::vector<Block> m_blocks;
+
+				/*! \brief The number of keys the filter was sized for. */
+				size_t m_capacity;
+
+				/*! \brief The false positive rate the filter was sized for. */
+				double m_rate;
+
+				/*! \brief The number of keys inserted since the filter was last cleared. */
+				size_t m_size;
+
+				/*! \brief Picks a block for a hash. */
+				inline size_t blockIndex(uint64_t _hash) const
+				{
+					return (size_t)(((_hash >> 32) * m_blocks.size()) >> 32);
+				}
+
+				/*! \brief Computes the eight bit masks for a hash, one per word. */
+				static inline void masks(uint64_t _hash, uint64_t *_masks)
+				{
+					static const uint32_t salt[8] = {
+						0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+						0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+					};
+					uint32_t low = (uint32_t)_hash;
+					for (int i = 0; i < 8; i++)
+						_masks[i] = 1ULL << ((uint32_t)(low * salt[i]) >> 26);
+				}
+
+				/*! \brief Mixes a key's hash so every bit depends on every input bit. */
+				static inline uint64_t mix(Key const &_key)
+				{
+					uint64_t hash = FilterHash<Key>::Make(_key);
+					hash ^= hash >> 33;
+					hash *= 0xff51afd7ed558ccdULL;
+					hash ^= hash >> 33;
+					hash *= 0xc4ceb9fe1a85ec53ULL;
+					hash ^= hash >> 33;
+					return hash;
+				}
+
+				/*! \brief Works out how many blocks hold _capacity keys at the given rate. */
+				static size_t blocksFor(size_t _capacity, double _rate);
+
+			public:
+				/*! \brief The constructor. */
+				/*!
+				 * \param _capacity The number of keys the filter should hold.
+				 * \param _falsePositiveRate The fraction of absent keys which may be
+				 *    reported as present while the filter holds no more than _capacity
+				 *    keys. Clamped to between 0.000001 and 0.5.
+				 */
+				BloomFilter(size_t _capacity = 1024, double _falsePositiveRate = 0.01);
+
+				/*! \brief The destructor. */
+				~BloomFilter();
+
+				/*! \brief Adds a key to the filter. */
+				/*!
+				 * \param _key The key to add.
+				 */
+				void insert(Key const &_key);
+
+				/*! \brief Tests whether a key might be in the filter. */
+				/*!
+				 * \param _key The key to test.
+				 * \return False if the key was definitely never inserted, true if it may have been.
+				 */
+				bool contains(Key const &_key) const;
+
+				/*! \brief Removes every key from the filter. */
+				void clear();
+
+				/*! \brief Removes every key from the filter and resizes it. */
+				/*!
+				 * \param _capacity The number of keys the filter should hold.
+				 * \param _falsePositiveRate The new false positive rate, or zero to keep the current one.
+				 */
+				void resize(size_t _capacity, double _falsePositiveRate = 0.0);
+
+				/*! \brief Whether as many keys have been inserted as the filter was sized for. */
+				/*!
+				 * Past this point, the false positive rate climbs above the one the filter
+				 * was built for.
+				 */
+				inline bool full() const
+				{
+					return m_size >= m_capacity;
+				}
+
+				/*! \brief Indicates the number of keys inserted since the filter was last cleared. */
+				/*!
+				 * Keys inserted more than once are counted each time.
+				 */
+				inline size_t size() const
+				{
+					return m_size;
+				}
+
+				/*! \brief Indicates the number of keys the filter was sized for. */
+				inline size_t capacity() const
+				{
+					return m_capacity;
+				}
+
+				/*! \brief Indicates the false positive rate the filter was sized for. */
+				inline double false_positive_rate() const
+				{
+					return m_rate;
+				}
+
+				/*! \brief Returns the memory usage of the filter. */
+				/*!
+				 * \return Memory usage in bytes.
+				 */
+				size_t mem_usage() const;
+		};
+
+		/*! \brief Puts a BloomFilter in front of a map, so lookups of absent keys usually return early. */
+		/*!
+		 * Every key in the map is also in the filter. find() and exists() check the
+		 * filter first, and only search the map when the filter says the key may be
+		 * there, which saves a whole tree descent or probe chain on most misses.
+		 *
+		 * Container may be a HashTable, or any of the trees with an iterator, such as
+		 * AVLTree or RedBlackTree. Once more keys have been inserted than the filter
+		 * was sized for, the filter is rebuilt from the map's keys at twice the map's
+		 * size. Erased keys stay in the filter until then, and only cost a wasted
+		 * search when they're looked up.
+		 *
+		 * \warning The map must only be changed through this class, or the filter
+		 *    will wrongly rule out keys.
+		 */
+		template <class Key, class Data, class Container>
+		class FilteredMap
+		{
+			private:
+				/*! \brief Private copy constructor. */
+				FilteredMap(const FilteredMap<Key, Data, Container> &) = delete;
+
+				/*! \brief Private assignment operator. */
+				FilteredMap<Key, Data, Container> &operator =(const FilteredMap<Key, Data, Container> &) = delete;
+
+			protected:
+				/*! \brief The map being filtered. */
+				Container m_map;
+
+				/*! \brief The filter holding every key in the map. */
+				BloomFilter<Key> m_filter;
+
+				/*! \brief Rebuilds the filter from the map's keys. */
+				void rebuild();
+
+				/*! @cond */
+				template <class C>
+				static inline bool insertInto(C &_map, Key const &_key, Data const &_data)
+				{
+					return _map.insert(_key, _data);
+				}
+
+				template <class D, bool OwnsKeys>
+				static inline bool insertInto(HashTable<D, OwnsKeys> &_map, Key const &_key, Data const &_data)
+				{
+					_map.insert(_key, _data);
+					return true;
+				}
+
+				template <class C>
+				static inline size_t live(C const &_map)
+				{
+					return (size_t)_map.size();
+				}
+
+				template <class D, bool OwnsKeys>
+				static inline size_t live(HashTable<D, OwnsKeys> const &_map)
+				{
+					return _map.used();
+				}
+
+				template <class C>
+				static inline void fill(BloomFilter<Key> &_filter, C const &_map)
+				{
+					for (typename C::iterator it = _map.begin(); it.valid(); ++it)
+						_filter.insert(it.key());
+				}
+
+				template <class D, bool OwnsKeys>
+				static inline void fill(BloomFilter<Key> &_filter, HashTable<D, OwnsKeys> const &_map)
+				{
+					for (size_t i = 0; i < _map.size(); i++) {
+						if (_map.valid(i))
+							_filter.insert(_map.key(i));
+					}
+				}
+				/*! @endcond */
+
+			public:
+				/*! \brief The constructor. */
+				/*!
+				 * \param _capacity The number of keys to size the filter for at first.
+				 * \param _falsePositiveRate The fraction of absent keys which may still be searched for.
+				 */
+				FilteredMap(size_t _capacity = 1024, double _falsePositiveRate = 0.01);
+
+				/*! \brief The destructor. */
+				~FilteredMap();
+
+				/*! \brief Inserts data into the map. */
+				/*!
+				 * \param _key The key of the data.
+				 * \param _data The data to insert.
+				 * \return True on success, false if the map refused the key.
+				 */
+				bool insert(Key const &_key, Data const &_data);
+
+				/*! \brief Deletes a key from the map. */
+				/*!
+				 * \warning This won't free the memory occupied by the data, so the data must be freed separately.
+				 * \param _key The key to delete.
+				 * \return True on success, false if the key isn't in the map.
+				 */
+				bool erase(Key const &_key);
+
+				/*! \brief Finds a key and returns its data. */
+				/*!
+				 * \param _key The key to find.
+				 * \param _default The value to return if the key couldn't be found.
+				 * \return If found, returns the data for the key, otherwise _default is returned.
+				 */
+				Data find(Key const &_key, Data const &_default = nullptr) const;
+
+				/*! \brief Tests whether a key is in the map or not. */
+				/*!
+				 * \param _key The key to find.
+				 * \return True if the key is in the map, false if not.
+				 */
+				bool exists(Key const &_key) const;
+
+				/*! \brief Empties the map and the filter. */
+				/*!
+				 * \warning This won't free the memory occupied by the data, so the data must be freed separately.
+				 */
+				void empty();
+
+				/*! \brief Gives read access to the map, for anything this class doesn't wrap. */
+				inline Container const &map() const
+				{
+					return m_map;
+				}
+
+				/*! \brief Gives read access to the filter. */
+				inline BloomFilter<Key> const &filter() const
+				{
+					return m_filter;
+				}
+
+				/*! \brief Returns the memory usage of the filter. */
+				/*!
+				 * The map's own memory isn't counted, since not every container reports it.
+				 * \return Memory usage in bytes.
+				 */
+				inline size_t mem_usage() const
+				{
+					return sizeof(*this) - sizeof(m_filter) + m_filter.mem_usage();
+				}
+		};
+	}
+}
+
+#include <crisscross/bloomfilter.cpp>
+
+#endif
@@ -0,0 +1,583 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_bplustree_h
+#error "This file shouldn't be compiled directly."
+#endif
+
+#include <utility>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		template <class Key, class Data, bool OwnsKeys>
+		BPlusTree<Key, Data, OwnsKeys>::BPlusTree()
+		{
+			m_root = nullptr;
+			m_height = 0;
+			m_size = 0;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		BPlusTree<Key, Data, OwnsKeys>::~BPlusTree()
+		{
+			empty();
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		inline uint32_t BPlusTree<Key, Data, OwnsKeys>::lowerBound(const Key *_keys, uint32_t _count, Key const &_key)
+		{
+			if (_count == 0)
+				return 0;
+
+			/* Branchless: the loop runs log2(_count) times regardless of the keys */
+			const Key *base = _keys;
+			while (_count > 1) {
+				uint32_t half = _count / 2;
+				base = (Compare(base[half], _key) < 0) ? base + half : base;
+				_count -= half;
+			}
+
+			return (uint32_t)(base - _keys) + (Compare(*base, _key) < 0);
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		inline uint32_t BPlusTree<Key, Data, OwnsKeys>::upperBound(const Key *_keys, uint32_t _count, Key const &_key)
+		{
+			if (_count == 0)
+				return 0;
+
+			const Key *base = _keys;
+			while (_count > 1) {
+				uint32_t half = _count / 2;
+				base = (Compare(base[half], _key) <= 0) ? base + half : base;
+				_count -= half;
+			}
+
+			return (uint32_t)(base - _keys) + (Compare(*base, _key) <= 0);
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		typename BPlusTree<Key, Data, OwnsKeys>::Leaf *BPlusTree<Key, Data, OwnsKeys>::findLeaf(Key const &_key, uint32_t &_slot) const
+		{
+			void *node = m_root;
+			if (!node)
+				return nullptr;
+
+			for (uint32_t level = m_height; level > 0; level--) {
+				Inner *inner = (Inner *)node;
+				node = inner->children[upperBound(inner->keys, inner->count, _key)];
+			}
+
+			Leaf *leaf = (Leaf *)node;
+			uint32_t pos = lowerBound(leaf->keys, leaf->count, _key);
+			if (pos < leaf->count && Compare(leaf->keys[pos], _key) == 0) {
+				_slot = pos;
+				return leaf;
+			}
+
+			return nullptr;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		typename BPlusTree<Key, Data, OwnsKeys>::Leaf *BPlusTree<Key, Data, OwnsKeys>::firstLeaf() const
+		{
+			void *node = m_root;
+			if (!node)
+				return nullptr;
+
+			for (uint32_t level = m_height; level > 0; level--)
+				node = ((Inner *)node)->children[0];
+
+			return (Leaf *)node;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		typename BPlusTree<Key, Data, OwnsKeys>::Leaf *BPlusTree<Key, Data, OwnsKeys>::lastLeaf() const
+		{
+			void *node = m_root;
+			if (!node)
+				return nullptr;
+
+			for (uint32_t level = m_height; level > 0; level--) {
+				Inner *inner = (Inner *)node;
+				node = inner->children[inner->count];
+			}
+
+			return (Leaf *)node;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		typename BPlusTree<Key, Data, OwnsKeys>::iterator BPlusTree<Key, Data, OwnsKeys>::lower_bound(Key const &_key) const
+		{
+			void *node = m_root;
+			if (!node)
+				return end();
+
+			for (uint32_t level = m_height; level > 0; level--) {
+				Inner *inner = (Inner *)node;
+				node = inner->children[upperBound(inner->keys, inner->count, _key)];
+			}
+
+			Leaf *leaf = (Leaf *)node;
+			return iterator(this, leaf, lowerBound(leaf->keys, leaf->count, _key));
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		typename BPlusTree<Key, Data, OwnsKeys>::iterator BPlusTree<Key, Data, OwnsKeys>::upper_bound(Key const &_key) const
+		{
+			void *node = m_root;
+			if (!node)
+				return end();
+
+			for (uint32_t level = m_height; level > 0; level--) {
+				Inner *inner = (Inner *)node;
+				node = inner->children[upperBound(inner->keys, inner->count, _key)];
+			}
+
+			Leaf *leaf = (Leaf *)node;
+			return iterator(this, leaf, upperBound(leaf->keys, leaf->count, _key));
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		template <class Visitor>
+		uint32_t BPlusTree<Key, Data, OwnsKeys>::for_each_in_range(Key const &_lo, Key const &_hi, Visitor _fn) const
+		{
+			uint32_t count = 0;
+			for (iterator it = lower_bound(_lo); it.valid() && Compare(it.key(), _hi) < 0; ++it) {
+				_fn(it.key(), it.data());
+				count++;
+			}
+			return count;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool BPlusTree<Key, Data, OwnsKeys>::insert(Key const &_key, Data const &_data)
+		{
+			if (!m_root) {
+				m_root = m_leafPool.construct();
+				m_height = 0;
+			}
+
+			Key splitKey;
+			void *splitNode = nullptr;
+
+			int result = insert(m_root, m_height, _key, _data, splitKey, splitNode);
+			if (result == INVALID)
+				return false;
+
+			if (result == SPLIT) {
+				/* The root split, so the tree grows a level */
+				Inner *root = m_innerPool.construct();
+				root->count = 1;
+				root->keys[0] = std::move(splitKey);
+				root->children[0] = m_root;
+				root->children[1] = splitNode;
+				m_root = root;
+				m_height++;
+			}
+
+			m_size++;
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		int BPlusTree<Key, Data, OwnsKeys>::insert(void *_node, uint32_t _level, Key const &_key, Data const &_data, Key &_splitKey, void *&_splitNode)
+		{
+			if (_level == 0) {
+				Leaf *leaf = (Leaf *)_node;
+				uint32_t pos = lowerBound(leaf->keys, leaf->count, _key);
+				if (pos < leaf->count && Compare(leaf->keys[pos], _key) == 0)
+					return INVALID;
+
+				Leaf *target = leaf;
+				int result = OK;
+
+				if (leaf->count == LeafSlots) {
+					/* Full, so split it in half and link in the new right sibling */
+					Leaf *right = m_leafPool.construct();
+					uint32_t mid = (LeafSlots + 1) / 2;
+					for (uint32_t i = mid; i < leaf->count; i++) {
+						right->keys[i - mid] = std::move(leaf->keys[i]);
+						right->data[i - mid] = std::move(leaf->data[i]);
+					}
+					right->count = leaf->count - mid;
+					leaf->count = mid;
+
+					right->next = leaf->next;
+					if (right->next)
+						right->next->prev = right;
+					right->prev = leaf;
+					leaf->next = right;
+
+					if (pos > mid) {
+						target = right;
+						pos -= mid;
+					}
+
+					_splitNode = right;
+					result = SPLIT;
+				}
+
+				for (uint32_t i = target->count; i > pos; i--) {
+					target->keys[i] = std::move(target->keys[i - 1]);
+					target->data[i] = std::move(target->data[i - 1]);
+				}
+				if (OwnsKeys)
+					target->keys[pos] = Duplicate(_key);
+				else
+					target->keys[pos] = _key;
+				target->data[pos] = _data;
+				target->count++;
+
+				if (result == SPLIT) {
+					/* Separators are always the tree's own copies, since the leaf key may be erased and freed */
+					Leaf *right = (Leaf *)_splitNode;
+					_splitKey = Duplicate(right->keys[0]);
+				}
+
+				return result;
+			}
+
+			Inner *inner = (Inner *)_node;
+			uint32_t idx = upperBound(inner->keys, inner->count, _key);
+
+			Key childKey;
+			void *childNode = nullptr;
+			int result = insert(inner->children[idx], _level - 1, _key, _data, childKey, childNode);
+			if (result != SPLIT)
+				return result;
+
+			if (inner->count < InnerSlots) {
+				for (uint32_t i = inner->count; i > idx; i--) {
+					inner->keys[i] = std::move(inner->keys[i - 1]);
+					inner->children[i + 1] = inner->children[i];
+				}
+				inner->keys[idx] = std::move(childKey);
+				inner->children[idx + 1] = childNode;
+				inner->count++;
+				return OK;
+			}
+
+			/* Full, so lay out all InnerSlots + 1 keys in order and push the middle one up */
+			Key keys[InnerSlots + 1];
+			void *children[InnerSlots + 2];
+			for (uint32_t i = 0, j = 0; i <= InnerSlots; i++)
+				keys[i] = (i == idx) ? std::move(childKey) : std::move(inner->keys[j++]);
+			for (uint32_t i = 0, j = 0; i <= InnerSlots + 1; i++)
+				children[i] = (i == idx + 1) ? childNode : inner->children[j++];
+
+			const uint32_t total = InnerSlots + 1;
+			const uint32_t mid = total / 2;
+
+			Inner *right = m_innerPool.construct();
+			for (uint32_t i = 0; i < mid; i++) {
+				inner->keys[i] = std::move(keys[i]);
+				inner->children[i] = children[i];
+			}
+			inner->children[mid] = children[mid];
+			inner->count = mid;
+
+			for (uint32_t i = mid + 1; i < total; i++) {
+				right->keys[i - mid - 1] = std::move(keys[i]);
+				right->children[i - mid - 1] = children[i];
+			}
+			right->children[total - mid - 1] = children[total];
+			right->count = total - mid - 1;
+
+			_splitKey = std::move(keys[mid]);
+			_splitNode = right;
+			return SPLIT;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool BPlusTree<Key, Data, OwnsKeys>::erase(Key const &_key)
+		{
+			if (!m_root)
+				return false;
+
+			if (erase(m_root, m_height, _key) == INVALID)
+				return false;
+
+			m_size--;
+
+			if (m_height > 0) {
+				Inner *root = (Inner *)m_root;
+				if (root->count == 0) {
+					/* The root lost its last separator, so the tree shrinks a level */
+					m_root = root->children[0];
+					m_innerPool.destroy(root);
+					m_height--;
+				}
+			} else if (((Leaf *)m_root)->count == 0) {
+				m_leafPool.destroy((Leaf *)m_root);
+				m_root = nullptr;
+			}
+
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		int BPlusTree<Key, Data, OwnsKeys>::erase(void *_node, uint32_t _level, Key const &_key)
+		{
+			if (_level == 0) {
+				Leaf *leaf = (Leaf *)_node;
+				uint32_t pos = lowerBound(leaf->keys, leaf->count, _key);
+				if (pos >= leaf->count || Compare(leaf->keys[pos], _key) != 0)
+					return INVALID;
+
+				if (OwnsKeys)
+					Dealloc(leaf->keys[pos]);
+
+				for (uint32_t i = pos + 1; i < leaf->count; i++) {
+					leaf->keys[i - 1] = std::move(leaf->keys[i]);
+					leaf->data[i - 1] = std::move(leaf->data[i]);
+				}
+				leaf->count--;
+
+				return leaf->count < LeafMin ? UNDERFLOW : OK;
+			}
+
+			Inner *inner = (Inner *)_node;
+			uint32_t idx = upperBound(inner->keys, inner->count, _key);
+
+			int result = erase(inner->children[idx], _level - 1, _key);
+			if (result != UNDERFLOW)
+				return result;
+
+			rebalance(inner, idx, _level - 1);
+			return inner->count < InnerMin ? UNDERFLOW : OK;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		void BPlusTree<Key, Data, OwnsKeys>::rebalance(Inner *_parent, uint32_t _index, uint32_t _childLevel)
+		{
+			if (_childLevel == 0) {
+				Leaf *child = (Leaf *)_parent->children[_index];
+				Leaf *left = _index > 0 ? (Leaf *)_parent->children[_index - 1] : nullptr;
+				Leaf *right = _index < _parent->count ? (Leaf *)_parent->children[_index + 1] : nullptr;
+
+				if (left && left->count > LeafMin) {
+					/* Borrow the largest key of the left sibling */
+					for (uint32_t i = child->count; i > 0; i--) {
+						child->keys[i] = std::move(child->keys[i - 1]);
+						child->data[i] = std::move(child->data[i - 1]);
+					}
+					left->count--;
+					child->keys[0] = std::move(left->keys[left->count]);
+					child->data[0] = std::move(left->data[left->count]);
+					child->count++;
+
+					Dealloc(_parent->keys[_index - 1]);
+					_parent->keys[_index - 1] = Duplicate(child->keys[0]);
+					return;
+				}
+
+				if (right && right->count > LeafMin) {
+					/* Borrow the smallest key of the right sibling */
+					child->keys[child->count] = std::move(right->keys[0]);
+					child->data[child->count] = std::move(right->data[0]);
+					child->count++;
+					for (uint32_t i = 1; i < right->count; i++) {
+						right->keys[i - 1] = std::move(right->keys[i]);
+						right->data[i - 1] = std::move(right->data[i]);
+					}
+					right->count--;
+
+					Dealloc(_parent->keys[_index]);
+					_parent->keys[_index] = Duplicate(right->keys[0]);
+					return;
+				}
+
+				/* Neither sibling can spare a key, so merge with one of them */
+				uint32_t sep = left ? _index - 1 : _index;
+				Leaf *dst = left ? left : child;
+				Leaf *src = left ? child : right;
+
+				for (uint32_t i = 0; i < src->count; i++) {
+					dst->keys[dst->count + i] = std::move(src->keys[i]);
+					dst->data[dst->count + i] = std::move(src->data[i]);
+				}
+				dst->count += src->count;
+
+				dst->next = src->next;
+				if (dst->next)
+					dst->next->prev = dst;
+
+				Dealloc(_parent->keys[sep]);
+				for (uint32_t i = sep + 1; i < _parent->count; i++) {
+					_parent->keys[i - 1] = std::move(_parent->keys[i]);
+					_parent->children[i] = _parent->children[i + 1];
+				}
+				_parent->count--;
+
+				m_leafPool.destroy(src);
+				return;
+			}
+
+			Inner *child = (Inner *)_parent->children[_index];
+			Inner *left = _index > 0 ? (Inner *)_parent->children[_index - 1] : nullptr;
+			Inner *right = _index < _parent->count ? (Inner *)_parent->children[_index + 1] : nullptr;
+
+			if (left && left->count > InnerMin) {
+				/* Rotate through the parent: its separator comes down, the left sibling's last key goes up */
+				child->children[child->count + 1] = child->children[child->count];
+				for (uint32_t i = child->count; i > 0; i--) {
+					child->keys[i] = std::move(child->keys[i - 1]);
+					child->children[i] = child->children[i - 1];
+				}
+				child->keys[0] = std::move(_parent->keys[_index - 1]);
+				child->children[0] = left->children[left->count];
+				child->count++;
+
+				left->count--;
+				_parent->keys[_index - 1] = std::move(left->keys[left->count]);
+				return;
+			}
+
+			if (right && right->count > InnerMin) {
+				child->keys[child->count] = std::move(_parent->keys[_index]);
+				child->children[child->count + 1] = right->children[0];
+				child->count++;
+
+				_parent->keys[_index] = std::move(right->keys[0]);
+				for (uint32_t i = 1; i < right->count; i++) {
+					right->keys[i - 1] = std::move(right->keys[i]);
+					right->children[i - 1] = right->children[i];
+				}
+				right->children[right->count - 1] = right->children[right->count];
+				right->count--;
+				return;
+			}
+
+			/* Merge, pulling the separator down between the two halves */
+			uint32_t sep = left ? _index - 1 : _index;
+			Inner *dst = left ? left : child;
+			Inner *src = left ? child : right;
+
+			dst->keys[dst->count] = std::move(_parent->keys[sep]);
+			for (uint32_t i = 0; i < src->count; i++) {
+				dst->keys[dst->count + 1 + i] = std::move(src->keys[i]);
+				dst->children[dst->count + 1 + i] = src->children[i];
+			}
+			dst->children[dst->count + 1 + src->count] = src->children[src->count];
+			dst->count += 1 + src->count;
+
+			for (uint32_t i = sep + 1; i < _parent->count; i++) {
+				_parent->keys[i - 1] = std::move(_parent->keys[i]);
+				_parent->children[i] = _parent->children[i + 1];
+			}
+			_parent->count--;
+
+			m_innerPool.destroy(src);
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		template <class TypedData>
+		TypedData BPlusTree<Key, Data, OwnsKeys>::find(Key const &_key, TypedData const &_default) const
+		{
+			uint32_t slot;
+			Leaf *leaf = findLeaf(_key, slot);
+
+			if (!leaf)
+				return _default;
+
+			return (TypedData)(leaf->data[slot]);
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool BPlusTree<Key, Data, OwnsKeys>::exists(Key const &_key) const
+		{
+			uint32_t slot;
+			return findLeaf(_key, slot) != nullptr;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool BPlusTree<Key, Data, OwnsKeys>::replace(Key const &_key, Data const &_data)
+		{
+			uint32_t slot;
+			Leaf *leaf = findLeaf(_key, slot);
+			if (!leaf)
+				return false;
+
+			leaf->data[slot] = _data;
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		void BPlusTree<Key, Data, OwnsKeys>::destroy(void *_node, uint32_t _level)
+		{
+			if (_level == 0) {
+				Leaf *leaf = (Leaf *)_node;
+				if (OwnsKeys) {
+					for (uint32_t i = 0; i < leaf->count; i++)
+						Dealloc(leaf->keys[i]);
+				}
+				m_leafPool.destroy(leaf);
+				return;
+			}
+
+			Inner *inner = (Inner *)_node;
+			for (uint32_t i = 0; i <= inner->count; i++)
+				destroy(inner->children[i], _level - 1);
+			for (uint32_t i = 0; i < inner->count; i++)
+				Dealloc(inner->keys[i]);
+			m_innerPool.destroy(inner);
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		void BPlusTree<Key, Data, OwnsKeys>::empty()
+		{
+			/* Separators are owned even when the leaf keys aren't */
+			if (m_root && !TrivialNodeTeardown<Key, Data, true>::value)
+				destroy(m_root, m_height);
+
+			m_leafPool.release();
+			m_innerPool.release();
+
+			m_root = nullptr;
+			m_height = 0;
+			m_size = 0;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		uint32_t BPlusTree<Key, Data, OwnsKeys>::mem_usage() const
+		{
+			return (uint32_t)(sizeof(*this) + m_leafPool.mem_usage() + m_innerPool.mem_usage());
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		template <class TypedData>
+		DArray<TypedData> *BPlusTree<Key, Data, OwnsKeys>::ConvertToDArray() const
+		{
+			DArray<TypedData> *darray = new DArray<TypedData>();
+			darray->setSize(m_size);
+			for (Leaf *leaf = firstLeaf(); leaf; leaf = leaf->next) {
+				for (uint32_t i = 0; i < leaf->count; i++)
+					darray->insert((TypedData)(leaf->data[i]));
+			}
+			return darray;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		DArray<Key> *BPlusTree<Key, Data, OwnsKeys>::ConvertIndexToDArray() const
+		{
+			DArray<Key> *darray = new DArray<Key>();
+			darray->setSize(m_size);
+			for (Leaf *leaf = firstLeaf(); leaf; leaf = leaf->next) {
+				for (uint32_t i = 0; i < leaf->count; i++)
+					darray->insert(leaf->keys[i]);
+			}
+			return darray;
+		}
+	}
+}
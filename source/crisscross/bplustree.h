@@ -0,0 +1,472 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_bplustree_h
+#define __included_cc_bplustree_h
+
+#include <crisscross/cc_attr.h>
+#include <crisscross/compare.h>
+#include <crisscross/internal_mem.h>
+#include <crisscross/darray.h>
+#include <crisscross/node.h>
+#include <crisscross/nodepool.h>
+
+#include <utility>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		/*! \brief A cache-friendly B+tree implementation. */
+		/*!
+		 * Unlike the binary trees, each node of a B+tree holds many keys stored
+		 * contiguously, sized to fill a handful of cache lines. A lookup touches
+		 * about log_B(n) nodes instead of log_2(n), and each node is searched with
+		 * a branchless binary search. All data lives in the leaves, which are
+		 * linked together for fast in-order scans.
+		 *
+		 * The interface matches AVLTree and RedBlackTree.
+		 */
+		template <class Key, class Data, bool OwnsKeys = true>
+		class BPlusTree
+		{
+			private:
+				/*! \brief Private copy constructor. */
+				/*!
+				 * If your code needs to invoke the copy constructor, you've probably written
+				 * the code wrong. A tree copy is generally unnecessary, and in cases that it
+				 * is, it can be achieved by other means.
+				 */
+				BPlusTree(const BPlusTree<Key, Data, OwnsKeys> &) = delete;
+
+				/*! \brief Private assignment operator. */
+				/*!
+				 * If your code needs to invoke the assignment operator, you've probably written
+				 * the code wrong. A tree copy is generally unnecessary, and in cases that it
+				 * is, it can be achieved by other means.
+				 */
+				BPlusTree<Key, Data, OwnsKeys> &operator =(const BPlusTree<Key, Data, OwnsKeys> &) = delete;
+
+			protected:
+				/*! \brief The target size of a node, in bytes. */
+				static constexpr size_t NodeBytes = 512;
+
+				/*! \brief The number of keys held by a full leaf. */
+				static constexpr int LeafSlots = (NodeBytes - 2 * sizeof(void *) - sizeof(uint16_t)) / (sizeof(Key) + sizeof(Data)) > 4 ?
+				                                 (NodeBytes - 2 * sizeof(void *) - sizeof(uint16_t)) / (sizeof(Key) + sizeof(Data)) : 4;
+
+				/*! \brief The number of keys held by a full inner node. */
+				static constexpr int InnerSlots = (NodeBytes - sizeof(void *) - sizeof(uint16_t)) / (sizeof(Key) + sizeof(void *)) > 4 ?
+				                                  (NodeBytes - sizeof(void *) - sizeof(uint16_t)) / (sizeof(Key) + sizeof(void *)) : 4;
+
+				/*! \brief A leaf must hold at least this many keys, unless it's the root. */
+				static constexpr int LeafMin = LeafSlots / 2;
+
+				/*! \brief An inner node must hold at least this many keys, unless it's the root. */
+				static constexpr int InnerMin = InnerSlots / 2;
+
+				/*! \brief A leaf node, holding the keys and the data. */
+				struct Leaf
+				{
+					uint16_t count;
+					Key keys[LeafSlots];
+					Data data[LeafSlots];
+					Leaf *prev;
+					Leaf *next;
+
+					Leaf() : count(0), prev(nullptr), next(nullptr)
+					{
+					}
+				};
+
+				/*! \brief An inner node, holding separator keys and child pointers. */
+				/*!
+				 * children[i] holds the keys k with keys[i - 1] <= k < keys[i]. The
+				 * children are leaves when the node sits directly above the leaf level.
+				 * The separator keys are always copies the tree owns, even when
+				 * OwnsKeys is false, since a separator can outlive the leaf key it was
+				 * copied from.
+				 */
+				struct Inner
+				{
+					uint16_t count;
+					Key keys[InnerSlots];
+					void *children[InnerSlots + 1];
+
+					Inner() : count(0)
+					{
+					}
+				};
+
+				/*! \brief Result of a recursive tree operation */
+				enum {
+					/*! \brief The operation succeeded and the node is still valid */
+					OK,
+
+					/*! \brief The node was split, and the caller must link in the new sibling */
+					SPLIT,
+
+					/*! \brief The node dropped below its minimum fill, and the caller must fix it */
+					UNDERFLOW,
+
+					/*! \brief Key not found (erase) or already present (insert) */
+					INVALID
+				};
+
+				/*! \brief The root node. A Leaf if m_height is 0, otherwise an Inner. */
+				void *m_root;
+
+				/*! \brief The number of inner levels above the leaves. */
+				uint32_t m_height;
+
+				/*! \brief The current tree size. */
+				uint32_t m_size;
+
+				/*! \brief The allocator for leaf nodes. */
+				NodePool<Leaf> m_leafPool;
+
+				/*! \brief The allocator for inner nodes. */
+				NodePool<Inner> m_innerPool;
+
+				/*! \brief Finds the first key not less than _key. */
+				/*!
+				 * \param _keys A sorted array of keys.
+				 * \param _count The number of keys in the array.
+				 * \param _key The key to search for.
+				 * \return The index of the first key not less than _key, or _count.
+				 */
+				static cc_forceinline uint32_t lowerBound(const Key *_keys, uint32_t _count, Key const &_key);
+
+				/*! \brief Finds the first key greater than _key. */
+				/*!
+				 * \param _keys A sorted array of keys.
+				 * \param _count The number of keys in the array.
+				 * \param _key The key to search for.
+				 * \return The index of the first key greater than _key, or _count.
+				 */
+				static cc_forceinline uint32_t upperBound(const Key *_keys, uint32_t _count, Key const &_key);
+
+				/*! \brief Find the leaf and slot holding a key */
+				/*!
+				 * \param _key The key to search for.
+				 * \param _slot Set to the key's index within the returned leaf.
+				 * \return The leaf holding the key. If not found, returns nullptr.
+				 */
+				Leaf *findLeaf(Key const &_key, uint32_t &_slot) const;
+
+				/*! \brief Find the leftmost leaf */
+				/*!
+				 * \return The leaf with the smallest keys, or nullptr if the tree is empty.
+				 */
+				Leaf *firstLeaf() const;
+
+				/*! \brief Find the rightmost leaf */
+				/*!
+				 * \return The leaf with the largest keys, or nullptr if the tree is empty.
+				 */
+				Leaf *lastLeaf() const;
+
+				/*! \brief Add object */
+				/*!
+				 * \param _node The subtree to insert into.
+				 * \param _level The height of _node above the leaves.
+				 * \param _key Key to insert
+				 * \param _data Data to insert
+				 * \param _splitKey On SPLIT, receives the first key of the new sibling.
+				 * \param _splitNode On SPLIT, receives the new right-hand sibling.
+				 * \return OK, SPLIT or INVALID.
+				 */
+				int insert(void *_node, uint32_t _level, Key const &_key, Data const &_data, Key &_splitKey, void *&_splitNode);
+
+				/*! \brief Remove object */
+				/*!
+				 * \param _node The subtree to remove from.
+				 * \param _level The height of _node above the leaves.
+				 * \param _key Identifier of node to remove
+				 * \return OK, UNDERFLOW or INVALID.
+				 */
+				int erase(void *_node, uint32_t _level, Key const &_key);
+
+				/*! \brief Fixes an underfull child by borrowing from or merging with a sibling. */
+				/*!
+				 * \param _parent The parent of the underfull child.
+				 * \param _index The index of the underfull child within _parent.
+				 * \param _childLevel The height of the child above the leaves.
+				 */
+				void rebalance(Inner *_parent, uint32_t _index, uint32_t _childLevel);
+
+				/*! \brief Destroys a subtree. */
+				/*!
+				 * \param _node The subtree to destroy.
+				 * \param _level The height of _node above the leaves.
+				 */
+				void destroy(void *_node, uint32_t _level);
+
+			public:
+				/*! \brief A bidirectional in-order iterator over the tree. */
+				/*!
+				 * Steps through the linked leaves, so a range scan reads keys
+				 * sequentially from memory.
+				 * \warning Inserting into or erasing from the tree invalidates its iterators.
+				 */
+				class iterator
+				{
+					protected:
+						/*! \brief The tree being walked, used to step back from the end. */
+						const BPlusTree *m_tree;
+
+						/*! \brief The current leaf, or nullptr past the end. */
+						Leaf *m_leaf;
+
+						/*! \brief The current position within m_leaf. */
+						uint32_t m_slot;
+
+					public:
+						/*! \brief The default constructor. */
+						iterator() : m_tree(nullptr), m_leaf(nullptr), m_slot(0)
+						{
+						}
+
+						/*! \brief The constructor. */
+						/*!
+						 * \param _tree The tree being walked.
+						 * \param _leaf The leaf to start at, or nullptr for the end.
+						 * \param _slot The position within _leaf. If it's past the leaf's
+						 *    last key, the iterator moves on to the next leaf.
+						 */
+						iterator(const BPlusTree *_tree, Leaf *_leaf, uint32_t _slot)
+							: m_tree(_tree), m_leaf(_leaf), m_slot(_slot)
+						{
+							if (m_leaf && m_slot >= m_leaf->count) {
+								m_leaf = m_leaf->next;
+								m_slot = 0;
+							}
+						}
+
+						/*! \brief Tests whether the iterator points at a key. */
+						/*!
+						 * \return False when the iterator is past the end.
+						 */
+						inline bool valid() const
+						{
+							return m_leaf != nullptr;
+						}
+
+						/*! \brief Gets the current key. */
+						inline Key const &key() const
+						{
+							return m_leaf->keys[m_slot];
+						}
+
+						/*! \brief Gets the data stored with the current key. */
+						inline Data &data() const
+						{
+							return m_leaf->data[m_slot];
+						}
+
+						/*! \brief Steps to the next key in order. */
+						iterator &operator ++()
+						{
+							if (++m_slot >= m_leaf->count) {
+								m_leaf = m_leaf->next;
+								m_slot = 0;
+							}
+							return *this;
+						}
+
+						/*! \brief Steps to the previous key in order. */
+						/*!
+						 * Stepping back from the end gives the last key in the tree.
+						 */
+						iterator &operator --()
+						{
+							if (!m_leaf) {
+								m_leaf = m_tree->lastLeaf();
+								m_slot = m_leaf ? m_leaf->count - 1 : 0;
+							} else if (m_slot > 0) {
+								m_slot--;
+							} else {
+								m_leaf = m_leaf->prev;
+								m_slot = m_leaf ? m_leaf->count - 1 : 0;
+							}
+							return *this;
+						}
+
+						/*! \brief Steps to the next key in order. */
+						iterator operator ++(int)
+						{
+							iterator ret = *this;
+							++*this;
+							return ret;
+						}
+
+						/*! \brief Steps to the previous key in order. */
+						iterator operator --(int)
+						{
+							iterator ret = *this;
+							--*this;
+							return ret;
+						}
+
+						inline bool operator ==(iterator const &_other) const
+						{
+							return m_leaf == _other.m_leaf && m_slot == _other.m_slot;
+						}
+
+						inline bool operator !=(iterator const &_other) const
+						{
+							return !(*this == _other);
+						}
+				};
+
+				/*! \brief The default constructor. */
+				BPlusTree();
+
+				/*! \brief The destructor. */
+				~BPlusTree();
+
+				/*! \brief Inserts data into the tree. */
+				/*!
+				 * \param _key The key of the data.
+				 * \param _data The data to insert.
+				 * \return True on success, false on failure.
+				 */
+				bool insert(Key const &_key, Data const &_data);
+
+				/*! \brief Deletes a node from the tree, specified by the node's key. */
+				/*!
+				 * \warning This won't free the memory occupied by the data, so the data must be freed separately.
+				 * \param _key The key of the node to delete.
+				 * \return True on success, false on failure
+				 */
+				bool erase(Key const &_key);
+
+				/*! \brief Finds a node in the tree and returns the data at that node. */
+				/*!
+				 * \param _key The key of the node to find.
+				 * \param _default The value to return if the item couldn't be found.
+				 * \return If found, returns the data at the node, otherwise _default is returned.
+				 */
+				template <class TypedData = Data>
+				TypedData find(Key const &_key, TypedData const &_default = nullptr) const;
+
+				/*! \brief Tests whether a key is in the tree or not. */
+				/*!
+				 * \param _key The key of the node to find.
+				 * \return True if the key is in the tree, false if not.
+				 */
+				bool exists(Key const &_key) const;
+
+				/*! \brief Change the data at the given node. */
+				/*!
+				 * \param _key The key of the node to be modified.
+				 * \param _data The data to insert.
+				 * \return True on success, false on failure.
+				 */
+				bool replace(Key const &_key, Data const &_data);
+
+				/*! \brief Empties the entire tree. */
+				/*!
+				 * \warning This won't free the memory occupied by the data, so the data must be freed
+				 *    separately. The preferred way to do this is to serialize the data into a DArray
+				 *    with ConvertToDArray() and then iterate through it to delete the data in whatever
+				 *    way is proper.
+				 */
+				void empty();
+
+				/*! \brief Indicates the size of the tree. */
+				/*!
+				 * \return Size of the tree.
+				 */
+				inline uint32_t size() const
+				{
+					return m_size;
+				}
+
+				/*! \brief Gets an iterator at the smallest key. */
+				/*!
+				 * \return An iterator at the first key, or end() if the tree is empty.
+				 */
+				inline iterator begin() const
+				{
+					return iterator(this, firstLeaf(), 0);
+				}
+
+				/*! \brief Gets the past-the-end iterator. */
+				/*!
+				 * \return An iterator which points past the last key.
+				 */
+				inline iterator end() const
+				{
+					return iterator(this, nullptr, 0);
+				}
+
+				/*! \brief Finds the first key not less than the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return An iterator at the first key >= _key, or end() if there is none.
+				 */
+				iterator lower_bound(Key const &_key) const;
+
+				/*! \brief Finds the first key greater than the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return An iterator at the first key > _key, or end() if there is none.
+				 */
+				iterator upper_bound(Key const &_key) const;
+
+				/*! \brief Finds the range of keys equal to the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return The pair lower_bound(_key), upper_bound(_key).
+				 */
+				inline std::pair<iterator, iterator> equal_range(Key const &_key) const
+				{
+					return std::make_pair(lower_bound(_key), upper_bound(_key));
+				}
+
+				/*! \brief Visits the keys in [_lo, _hi) in order, without copying the tree. */
+				/*!
+				 * \param _lo The smallest key to visit.
+				 * \param _hi The key to stop at. It isn't visited.
+				 * \param _fn Called as _fn(key, data) for each key in the range.
+				 * \return The number of keys visited.
+				 */
+				template <class Visitor>
+				uint32_t for_each_in_range(Key const &_lo, Key const &_hi, Visitor _fn) const;
+
+				/*! \brief Converts the tree data into a linearized DArray. */
+				/*!
+				 * \return A DArray containing the data of the tree.
+				 * \warning Delete the returned DArray when done with it.
+				 */
+				template <class TypedData = Data>
+				DArray<TypedData> *ConvertToDArray() const;
+
+				/*! \brief Converts the tree keys into a linearized DArray. */
+				/*!
+				 * \return A DArray containing the keys in the tree.
+				 * \warning Delete the returned DArray when done with it.
+				 */
+				DArray<Key> *ConvertIndexToDArray() const;
+
+				/*! \brief Returns the overhead caused by the data structure. */
+				/*!
+				 * \return Memory usage in bytes.
+				 */
+				uint32_t mem_usage() const;
+		};
+	}
+}
+
+#include <crisscross/bplustree.cpp>
+
+#endif
@@ -25,11 +25,16 @@
 #define cc_likely(x)        __builtin_expect(!!(x), 1)
 #define cc_uncc_likely(x)   __builtin_expect(!!(x), 0)
 #define cc_assume(x)        do { if (!(x)) __builtin_unreachable(); } while (0)
+#define cc_prefetch(p)      __builtin_prefetch((const void *)(p))
 
 #elif defined(_MSC_VER)
 
 #define cc_assume(x)        __assume(x)
 #define cc_forceinline      __forceinline
+#if defined(_M_IX86) || defined(_M_X64)
+#include <xmmintrin.h>
+#define cc_prefetch(p)      _mm_prefetch((const char *)(p), _MM_HINT_T0)
+#endif
 
 #endif
 
@@ -85,6 +90,10 @@
 #define cc_assume(x)
 #endif
 
+#ifndef cc_prefetch
+#define cc_prefetch(p)    ((void)(p))
+#endif
+
 #if defined (TARGET_COMPILER_GCC)
 #if (__GNUC__ >= 4)
 #define _CC_DEPRECATE_TEXT(_Text)  __attribute__((__deprecated__))
@@ -0,0 +1,428 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_compactrbtree_h
+#error "This file shouldn't be compiled directly."
+#endif
+
+#include <crisscross/compare.h>
+#include <crisscross/compactrbtree.h>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		CompactRedBlackTree<Key, Data, OwnsKeys, Index>::CompactRedBlackTree()
+			: m_nodes(1), m_root(0), m_free(0), m_size(0)
+		{
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		CompactRedBlackTree<Key, Data, OwnsKeys, Index>::~CompactRedBlackTree()
+		{
+			releaseKeys();
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		void CompactRedBlackTree<Key, Data, OwnsKeys, Index>::releaseKeys()
+		{
+			if (!OwnsKeys)
+				return;
+
+			/* Nodes on the free list were already released, and Dealloc nulls them */
+			for (size_t i = 1; i < m_nodes.size(); i++)
+				Dealloc(m_nodes[i].id);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		Index CompactRedBlackTree<Key, Data, OwnsKeys, Index>::allocate()
+		{
+			Index node = m_free;
+			if (node) {
+				m_free = m_nodes[node].left;
+			} else {
+				if (m_nodes.size() >= (size_t)RedBit)
+					return 0;
+				node = (Index)m_nodes.size();
+				m_nodes.emplace_back();
+			}
+
+			Node &n = m_nodes[node];
+			n.left = n.right = n.parentColor = 0;
+			return node;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		void CompactRedBlackTree<Key, Data, OwnsKeys, Index>::release(Index _node)
+		{
+			Node &n = m_nodes[_node];
+			if (OwnsKeys)
+				Dealloc(n.id);
+			n.left = m_free;
+			m_free = _node;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		void CompactRedBlackTree<Key, Data, OwnsKeys, Index>::rotateLeft(Index _x)
+		{
+			Index y = right(_x);
+
+			right(_x) = left(y);
+			if (left(y))
+				setParent(left(y), _x);
+
+			Index p = parent(_x);
+			setParent(y, p);
+			if (!p)
+				m_root = y;
+			else if (_x == left(p))
+				left(p) = y;
+			else
+				right(p) = y;
+
+			left(y) = _x;
+			setParent(_x, y);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		void CompactRedBlackTree<Key, Data, OwnsKeys, Index>::rotateRight(Index _x)
+		{
+			Index y = left(_x);
+
+			left(_x) = right(y);
+			if (right(y))
+				setParent(right(y), _x);
+
+			Index p = parent(_x);
+			setParent(y, p);
+			if (!p)
+				m_root = y;
+			else if (_x == right(p))
+				right(p) = y;
+			else
+				left(p) = y;
+
+			right(y) = _x;
+			setParent(_x, y);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		void CompactRedBlackTree<Key, Data, OwnsKeys, Index>::insertFixup(Index _x)
+		{
+			while (_x != m_root && isRed(parent(_x))) {
+				Index p = parent(_x), g = parent(p);
+				if (p == left(g)) {
+					Index y = right(g);
+					if (isRed(y)) {
+						setRed(p, false);
+						setRed(y, false);
+						setRed(g, true);
+						_x = g;
+					} else {
+						if (_x == right(p)) {
+							_x = p;
+							rotateLeft(_x);
+							p = parent(_x);
+						}
+						setRed(p, false);
+						setRed(g, true);
+						rotateRight(g);
+					}
+				} else {
+					Index y = left(g);
+					if (isRed(y)) {
+						setRed(p, false);
+						setRed(y, false);
+						setRed(g, true);
+						_x = g;
+					} else {
+						if (_x == left(p)) {
+							_x = p;
+							rotateRight(_x);
+							p = parent(_x);
+						}
+						setRed(p, false);
+						setRed(g, true);
+						rotateLeft(g);
+					}
+				}
+			}
+			setRed(m_root, false);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		void CompactRedBlackTree<Key, Data, OwnsKeys, Index>::transplant(Index _u, Index _v)
+		{
+			Index p = parent(_u);
+			if (!p)
+				m_root = _v;
+			else if (_u == left(p))
+				left(p) = _v;
+			else
+				right(p) = _v;
+
+			/* May write the sentinel's parent, which deleteFixup relies on */
+			setParent(_v, p);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		void CompactRedBlackTree<Key, Data, OwnsKeys, Index>::deleteFixup(Index _x)
+		{
+			while (_x != m_root && !isRed(_x)) {
+				Index p = parent(_x);
+				if (_x == left(p)) {
+					Index w = right(p);
+					if (isRed(w)) {
+						setRed(w, false);
+						setRed(p, true);
+						rotateLeft(p);
+						w = right(p);
+					}
+					if (!isRed(left(w)) && !isRed(right(w))) {
+						setRed(w, true);
+						_x = p;
+					} else {
+						if (!isRed(right(w))) {
+							setRed(left(w), false);
+							setRed(w, true);
+							rotateRight(w);
+							w = right(p);
+						}
+						setRed(w, isRed(p));
+						setRed(p, false);
+						setRed(right(w), false);
+						rotateLeft(p);
+						_x = m_root;
+					}
+				} else {
+					Index w = left(p);
+					if (isRed(w)) {
+						setRed(w, false);
+						setRed(p, true);
+						rotateRight(p);
+						w = left(p);
+					}
+					if (!isRed(right(w)) && !isRed(left(w))) {
+						setRed(w, true);
+						_x = p;
+					} else {
+						if (!isRed(left(w))) {
+							setRed(right(w), false);
+							setRed(w, true);
+							rotateLeft(w);
+							w = left(p);
+						}
+						setRed(w, isRed(p));
+						setRed(p, false);
+						setRed(left(w), false);
+						rotateRight(p);
+						_x = m_root;
+					}
+				}
+			}
+			setRed(_x, false);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		Index CompactRedBlackTree<Key, Data, OwnsKeys, Index>::findIndex(Key const &_key) const
+		{
+			Index node = m_root;
+			while (node) {
+				const Node &n = m_nodes[node];
+				int cmp = Compare(_key, n.id);
+				if (cmp < 0)
+					node = n.left;
+				else if (cmp > 0)
+					node = n.right;
+				else
+					return node;
+			}
+			return 0;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		bool CompactRedBlackTree<Key, Data, OwnsKeys, Index>::insert(Key const &_key, Data const &_rec)
+		{
+			Index p = 0, node = m_root;
+			int cmp = 0;
+			while (node) {
+				p = node;
+				cmp = Compare(_key, m_nodes[node].id);
+				if (cmp < 0)
+					node = left(node);
+				else if (cmp > 0)
+					node = right(node);
+				else
+					return false;
+			}
+
+			/* Allocate before taking any references, as the array may move */
+			Index x = allocate();
+			if (!x)
+				return false;
+
+			Node &n = m_nodes[x];
+			if (OwnsKeys)
+				n.id = Duplicate(_key);
+			else
+				n.id = _key;
+			n.data = _rec;
+			n.parentColor = p | RedBit;
+
+			if (!p)
+				m_root = x;
+			else if (cmp < 0)
+				left(p) = x;
+			else
+				right(p) = x;
+
+			insertFixup(x);
+			m_size++;
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		bool CompactRedBlackTree<Key, Data, OwnsKeys, Index>::replace(Key const &_key, Data const &_rec)
+		{
+			Index node = findIndex(_key);
+			if (!node)
+				return false;
+
+			m_nodes[node].data = _rec;
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		bool CompactRedBlackTree<Key, Data, OwnsKeys, Index>::erase(Key const &_key)
+		{
+			Index z = findIndex(_key);
+			if (!z)
+				return false;
+
+			Index x, y = z;
+			bool wasRed = isRed(y);
+			if (!left(z)) {
+				x = right(z);
+				transplant(z, x);
+			} else if (!right(z)) {
+				x = left(z);
+				transplant(z, x);
+			} else {
+				y = right(z);
+				while (left(y))
+					y = left(y);
+				wasRed = isRed(y);
+				x = right(y);
+				if (parent(y) == z) {
+					setParent(x, y);
+				} else {
+					transplant(y, x);
+					right(y) = right(z);
+					setParent(right(y), y);
+				}
+				transplant(z, y);
+				left(y) = left(z);
+				setParent(left(y), y);
+				setRed(y, isRed(z));
+			}
+
+			if (!wasRed)
+				deleteFixup(x);
+
+			/* The sentinel must look like an empty black leaf again */
+			m_nodes[0].parentColor = 0;
+
+			release(z);
+			m_size--;
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		template <class TypedData>
+		TypedData CompactRedBlackTree<Key, Data, OwnsKeys, Index>::find(Key const &_key, TypedData const &_default) const
+		{
+			Index node = findIndex(_key);
+			if (!node)
+				return _default;
+
+			return (TypedData)(m_nodes[node].data);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		bool CompactRedBlackTree<Key, Data, OwnsKeys, Index>::exists(Key const &_key) const
+		{
+			return findIndex(_key) != 0;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		void CompactRedBlackTree<Key, Data, OwnsKeys, Index>::empty()
+		{
+			releaseKeys();
+			m_nodes.resize(1);
+			m_nodes[0] = Node();
+			m_root = 0;
+			m_free = 0;
+			m_size = 0;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		void CompactRedBlackTree<Key, Data, OwnsKeys, Index>::reserve(uint32_t _count)
+		{
+			m_nodes.reserve((size_t)_count + 1);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		template <class Visitor>
+		uint32_t CompactRedBlackTree<Key, Data, OwnsKeys, Index>::for_each_in_range(Key const &_lo, Key const &_hi, Visitor _fn) const
+		{
+			/* Find the first node not less than _lo */
+			Index node = m_root, first = 0;
+			while (node) {
+				const Node &n = m_nodes[node];
+				if (Compare(n.id, _lo) >= 0) {
+					first = node;
+					node = n.left;
+				} else {
+					node = n.right;
+				}
+			}
+
+			uint32_t count = 0;
+			node = first;
+			while (node && Compare(m_nodes[node].id, _hi) < 0) {
+				_fn(m_nodes[node].id, m_nodes[node].data);
+				count++;
+
+				/* Step to the in-order successor */
+				if (m_nodes[node].right) {
+					node = m_nodes[node].right;
+					while (m_nodes[node].left)
+						node = m_nodes[node].left;
+				} else {
+					Index p = parent(node);
+					while (p && node == m_nodes[p].right) {
+						node = p;
+						p = parent(p);
+					}
+					node = p;
+				}
+			}
+			return count;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, class Index>
+		uint32_t CompactRedBlackTree<Key, Data, OwnsKeys, Index>::mem_usage() const
+		{
+			return (uint32_t)(sizeof(*this) + m_nodes.capacity() * sizeof(Node));
+		}
+	}
+}
@@ -0,0 +1,234 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_compactrbtree_h
+#define __included_cc_compactrbtree_h
+
+#include <crisscross/cc_attr.h>
+#include <crisscross/internal_mem.h>
+#include <crisscross/compare.h>
+#include <crisscross/node.h>
+
+#include <type_traits>
+#include <vector>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		/*! \brief A red-black tree with small, index-linked nodes. */
+		/*!
+		 * All nodes live in one array and refer to each other by index. With the
+		 * default 32-bit indices, and the color kept in the spare top bit of the
+		 * parent link, a node for \<int, int\> takes 20 bytes where a RedBlackNode
+		 * takes 40, so twice as many fit in each cache line.
+		 *
+		 * Index 0 is a black sentinel which stands for every missing child, as
+		 * nullNode does in RedBlackTree. A tree can hold up to half the range of
+		 * Index, less one, items.
+		 *
+		 * \warning Inserting into the tree may move every node, so don't hold on to
+		 *    references to data across insertions.
+		 */
+		template <class Key, class Data, bool OwnsKeys = true, class Index = uint32_t>
+		class CompactRedBlackTree
+		{
+			static_assert(std::is_unsigned<Index>::value, "CompactRedBlackTree needs an unsigned index type");
+
+			private:
+				/*! \brief Private copy constructor. */
+				CompactRedBlackTree(const CompactRedBlackTree<Key, Data, OwnsKeys, Index> &) = delete;
+
+				/*! \brief Private assignment operator. */
+				CompactRedBlackTree<Key, Data, OwnsKeys, Index> &operator =(const CompactRedBlackTree<Key, Data, OwnsKeys, Index> &) = delete;
+
+			protected:
+				/*! \brief The tree's node type. */
+				typedef CompactRedBlackNode<Key, Data, Index> Node;
+
+				/*! \brief The bit of parentColor which marks a node red. */
+				static constexpr Index RedBit = (Index)((Index)1 << (sizeof(Index) * 8 - 1));
+
+				/*! \brief Every node, with the sentinel at index 0. */
+				std::vector<Node> m_nodes;
+
+				/*! \brief The index of the root node, or 0 if the tree is empty. */
+				Index m_root;
+
+				/*! \brief The head of the list of released nodes, linked through their left fields. */
+				Index m_free;
+
+				/*! \brief The number of items in the tree. */
+				uint32_t m_size;
+
+				/*! \brief Gets a node's left child index, for reading or writing. */
+				cc_forceinline Index &left(Index _node)
+				{
+					return m_nodes[_node].left;
+				}
+
+				/*! \brief Gets a node's right child index, for reading or writing. */
+				cc_forceinline Index &right(Index _node)
+				{
+					return m_nodes[_node].right;
+				}
+
+				/*! \brief Gets a node's parent index, which is parentColor without RedBit. */
+				cc_forceinline Index parent(Index _node) const
+				{
+					return m_nodes[_node].parentColor & ~RedBit;
+				}
+
+				/*! \brief Sets a node's parent index, keeping its color bit. */
+				cc_forceinline void setParent(Index _node, Index _parent)
+				{
+					m_nodes[_node].parentColor = (m_nodes[_node].parentColor & RedBit) | _parent;
+				}
+
+				/*! \brief Tests whether a node is red, which is RedBit of parentColor being set. */
+				cc_forceinline bool isRed(Index _node) const
+				{
+					return (m_nodes[_node].parentColor & RedBit) != 0;
+				}
+
+				/*! \brief Colors a node red or black, keeping its parent index. */
+				cc_forceinline void setRed(Index _node, bool _red)
+				{
+					if (_red)
+						m_nodes[_node].parentColor |= RedBit;
+					else
+						m_nodes[_node].parentColor &= ~RedBit;
+				}
+
+				/*! \brief Gets a node from the free list, or the end of the array. */
+				/*!
+				 * \return The new node's index, or 0 if the tree is full.
+				 */
+				Index allocate();
+
+				/*! \brief Puts a node on the free list. */
+				void release(Index _node);
+
+				/*! \brief Rotates _x down to the left, lifting its right child into its place. */
+				void rotateLeft(Index _x);
+
+				/*! \brief Rotates _x down to the right, lifting its left child into its place. */
+				void rotateRight(Index _x);
+
+				/*! \brief Restores the red-black properties after _x is inserted red. */
+				void insertFixup(Index _x);
+
+				/*! \brief Restores the red-black properties after a black node is removed, starting from _x which took its place. */
+				void deleteFixup(Index _x);
+
+				/*! \brief Puts _v where _u was in _u's parent. */
+				void transplant(Index _u, Index _v);
+
+				/*! \brief Finds the node holding a key. */
+				/*!
+				 * \return The node's index, or 0 if the key isn't in the tree.
+				 */
+				Index findIndex(Key const &_key) const;
+
+				/*! \brief Frees every key held by the tree, if it owns them. */
+				void releaseKeys();
+
+			public:
+				/*! \brief The constructor. */
+				CompactRedBlackTree();
+
+				/*! \brief The destructor. */
+				~CompactRedBlackTree();
+
+				/*! \brief Inserts data into the tree. */
+				/*!
+				 * \param _key The key of the data.
+				 * \param _rec The data to insert.
+				 * \return True on success, false if the key was already there or the tree is full.
+				 */
+				bool insert(Key const &_key, Data const &_rec);
+
+				/*! \brief Change the data at the given node. */
+				/*!
+				 * \param _key The key of the node to be modified.
+				 * \param _rec The data to insert.
+				 * \return True on success, false on failure.
+				 */
+				bool replace(Key const &_key, Data const &_rec);
+
+				/*! \brief Deletes a node from the tree, specified by the node's key. */
+				/*!
+				 * \warning This won't free the memory occupied by the data, so the data must be freed separately.
+				 * \param _key The key of the node to delete.
+				 * \return True on success, false on failure
+				 */
+				bool erase(Key const &_key);
+
+				/*! \brief Finds a node in the tree and returns the data at that node. */
+				/*!
+				 * \param _key The key of the node to find.
+				 * \param _default The value to return if the item couldn't be found.
+				 * \return If found, returns the data at the node, otherwise _default is returned.
+				 */
+				template <class TypedData = Data>
+				TypedData find(Key const &_key, TypedData const &_default = nullptr) const;
+
+				/*! \brief Tests whether a key is in the tree or not. */
+				/*!
+				 * \param _key The key of the node to find.
+				 * \return True if the key is in the tree, false if not.
+				 */
+				bool exists(Key const &_key) const;
+
+				/*! \brief Empties the entire tree. */
+				/*!
+				 * The node array keeps its capacity for reuse.
+				 * \warning This won't free the memory occupied by the data.
+				 */
+				void empty();
+
+				/*! \brief Makes room for a number of items without reallocating. */
+				/*!
+				 * \param _count The number of items to make room for.
+				 */
+				void reserve(uint32_t _count);
+
+				/*! \brief Indicates the size of the tree. */
+				/*!
+				 * \return Size of the tree.
+				 */
+				cc_forceinline uint32_t size() const
+				{
+					return m_size;
+				}
+
+				/*! \brief Visits the keys in [_lo, _hi) in order. */
+				/*!
+				 * \param _lo The smallest key to visit.
+				 * \param _hi The key to stop at. It isn't visited.
+				 * \param _fn Called as _fn(key, data) for each key in the range.
+				 * \return The number of keys visited.
+				 */
+				template <class Visitor>
+				uint32_t for_each_in_range(Key const &_lo, Key const &_hi, Visitor _fn) const;
+
+				/*! \brief Returns the overhead caused by the data structure. */
+				/*!
+				 * \return Memory usage in bytes, including spare capacity in the node array.
+				 */
+				uint32_t mem_usage() const;
+		};
+	}
+}
+
+#include <crisscross/compactrbtree.cpp>
+
+#endif
@@ -15,6 +15,8 @@
 #include <crisscross/cc_attr.h>
 #include <crisscross/debug.h>
 
+#include <cstdint>
+
 namespace CrissCross
 {
 	namespace Data
@@ -45,6 +47,49 @@ namespace CrissCross
 		template <>
 		int Compare<const char *>(const char *const &_first, const char *const &_second);
 
+		/*! \brief A fixed-size integer summary of the start of a key. */
+		/*!
+		 * Prefixes order the same way as Compare: if two keys' prefixes differ,
+		 * the keys compare the same way the prefixes do, and only keys with equal
+		 * prefixes need a full Compare. Trees keyed by C strings cache the prefix
+		 * in each node, so most steps of a search never touch the key's memory.
+		 *
+		 * Key types without a useful prefix leave Enabled false, and cost nothing.
+		 */
+		template <class T>
+		struct KeyPrefix
+		{
+			/*! \brief Whether keys of this type have a prefix. */
+			static constexpr bool Enabled = false;
+
+			/*! \brief The type of the prefix. */
+			typedef unsigned char Type;
+
+			/*! \brief Computes the prefix of a key. */
+			static inline Type Make(cc_unused_param T const &_key)
+			{
+				return 0;
+			}
+		};
+
+		/*! \brief The first eight bytes of a C-style string, packed big-endian. */
+		template <>
+		struct KeyPrefix<char *>
+		{
+			static constexpr bool Enabled = true;
+			typedef uint64_t Type;
+			static uint64_t Make(char *const &_key);
+		};
+
+		/*! \brief The first eight bytes of a C-style string, packed big-endian. */
+		template <>
+		struct KeyPrefix<const char *>
+		{
+			static constexpr bool Enabled = true;
+			typedef uint64_t Type;
+			static uint64_t Make(const char *const &_key);
+		};
+
 		/*! \brief An STL-compatible comparator class which makes use of Compare */
 		template <class T>
 		class LessThanComparator
@@ -0,0 +1,161 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_concurrentrbtree_h
+#error "This file shouldn't be compiled directly."
+#endif
+
+#include <mutex>
+#include <thread>
+
+#include <crisscross/compare.h>
+#include <crisscross/concurrentrbtree.h>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		template <class Key, class Data, bool OwnsKeys>
+		ConcurrentRedBlackTree<Key, Data, OwnsKeys>::ConcurrentRedBlackTree()
+			: m_version(0)
+		{
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		ConcurrentRedBlackTree<Key, Data, OwnsKeys>::~ConcurrentRedBlackTree()
+		{
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool ConcurrentRedBlackTree<Key, Data, OwnsKeys>::optimisticLookup(Key const &_key, Data *_data, bool *_found) const
+		{
+			uint32_t version = m_version.load(std::memory_order_acquire);
+			if (version & 1)
+				return false;
+
+			Node *node = this->rootNode, *match = nullptr;
+			Data data = Data();
+			uint32_t steps = 0;
+			while (this->valid(node) && steps++ < MaxPathLength) {
+				int cmp = Compare(_key, node->id);
+				if (cmp < 0) {
+					node = node->left;
+				} else if (cmp > 0) {
+					node = node->right;
+				} else {
+					match = node;
+					data = node->data;
+					break;
+				}
+			}
+
+			/* Everything read above must be checked against the version */
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (steps > MaxPathLength || m_version.load(std::memory_order_relaxed) != version)
+				return false;
+
+			*_found = (match != nullptr);
+			if (match && _data)
+				*_data = data;
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool ConcurrentRedBlackTree<Key, Data, OwnsKeys>::lookup(Key const &_key, Data *_data) const
+		{
+			if constexpr (OptimisticReads) {
+				bool found;
+				for (int attempt = 0; attempt < OptimisticRetries; attempt++) {
+					if (optimisticLookup(_key, _data, &found))
+						return found;
+					std::this_thread::yield();
+				}
+			}
+
+			std::shared_lock<std::shared_mutex> lock(m_lock);
+			Node *node = this->findNode(_key);
+			if (!this->valid(node))
+				return false;
+			if (_data)
+				*_data = node->data;
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool ConcurrentRedBlackTree<Key, Data, OwnsKeys>::insert(Key const &_key, Data const &_rec)
+		{
+			std::unique_lock<std::shared_mutex> lock(m_lock);
+			beginWrite();
+			bool ret = Base::insert(_key, _rec);
+			endWrite();
+			return ret;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool ConcurrentRedBlackTree<Key, Data, OwnsKeys>::replace(Key const &_key, Data const &_rec)
+		{
+			std::unique_lock<std::shared_mutex> lock(m_lock);
+			beginWrite();
+			bool ret = Base::replace(_key, _rec);
+			endWrite();
+			return ret;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool ConcurrentRedBlackTree<Key, Data, OwnsKeys>::erase(Key const &_key)
+		{
+			std::unique_lock<std::shared_mutex> lock(m_lock);
+			beginWrite();
+			bool ret = Base::erase(_key);
+			endWrite();
+			return ret;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		Data ConcurrentRedBlackTree<Key, Data, OwnsKeys>::find(Key const &_key, Data const &_default) const
+		{
+			Data ret;
+			if (!lookup(_key, &ret))
+				return _default;
+			return ret;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool ConcurrentRedBlackTree<Key, Data, OwnsKeys>::try_find(Key const &_key, Data *_data) const
+		{
+			return lookup(_key, _data);
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool ConcurrentRedBlackTree<Key, Data, OwnsKeys>::exists(Key const &_key) const
+		{
+			return lookup(_key, nullptr);
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		void ConcurrentRedBlackTree<Key, Data, OwnsKeys>::empty()
+		{
+			std::unique_lock<std::shared_mutex> lock(m_lock);
+			beginWrite();
+			this->m_pool.destroyTree(this->rootNode, this->nullNode);
+			this->rootNode = this->nullNode;
+			this->m_size = 0;
+			endWrite();
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		uint32_t ConcurrentRedBlackTree<Key, Data, OwnsKeys>::size() const
+		{
+			std::shared_lock<std::shared_mutex> lock(m_lock);
+			return Base::size();
+		}
+	}
+}
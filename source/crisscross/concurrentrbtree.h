@@ -0,0 +1,190 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_concurrentrbtree_h
+#define __included_cc_concurrentrbtree_h
+
+#include <crisscross/cc_attr.h>
+#include <crisscross/rbtree.h>
+
+#include <atomic>
+#include <shared_mutex>
+#include <type_traits>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		/*! \brief A red-black tree which many threads can search at once. */
+		/*!
+		 * Writers are serialized by a lock, and bump a version counter before and
+		 * after each change. Lookups don't take any lock at all: they walk the
+		 * tree optimistically and then check that the version didn't move while
+		 * they did. Readers never write to shared memory, so lookup throughput
+		 * scales with the number of cores instead of bouncing a lock's cache line
+		 * between them. Under heavy write traffic a lookup which keeps getting
+		 * invalidated falls back to a shared lock, so it can't starve.
+		 *
+		 * Optimistic lookups may read a node while a writer is changing it. That
+		 * is only safe if comparing keys and copying data never follows a pointer,
+		 * so it is only done for arithmetic or enum keys and trivially copyable
+		 * data. Other types always search under the shared lock, which is still
+		 * safe and still lets readers run side by side. Nodes stay in the tree's
+		 * NodePool for its whole lifetime, so a stale link always leads to node
+		 * memory, and empty() doesn't hand the pool's blocks back.
+		 *
+		 * Iteration and bulk operations aren't offered, since they can't be made
+		 * consistent without holding the lock for their whole duration.
+		 */
+		template <class Key, class Data, bool OwnsKeys = true>
+		class ConcurrentRedBlackTree : protected RedBlackTree<Key, Data, OwnsKeys>
+		{
+			private:
+				/*! \brief Private copy constructor. */
+				ConcurrentRedBlackTree(const ConcurrentRedBlackTree<Key, Data, OwnsKeys> &) = delete;
+
+				/*! \brief Private assignment operator. */
+				ConcurrentRedBlackTree<Key, Data, OwnsKeys> &operator =(const ConcurrentRedBlackTree<Key, Data, OwnsKeys> &) = delete;
+
+			protected:
+				/*! \brief The single-threaded tree underneath. */
+				typedef RedBlackTree<Key, Data, OwnsKeys> Base;
+
+				/*! \brief The tree's node type. */
+				typedef RedBlackNode<Key, Data, OwnsKeys> Node;
+
+				/*! \brief Whether lookups may read nodes without holding the lock. */
+				static constexpr bool OptimisticReads = (std::is_arithmetic<Key>::value || std::is_enum<Key>::value) &&
+				                                        std::is_trivially_copyable<Data>::value;
+
+				/*! \brief How many times a lookup is retried before it takes the shared lock. */
+				static constexpr int OptimisticRetries = 8;
+
+				/*! \brief The longest path a valid tree can have. */
+				/*!
+				 * A red-black tree is at most 2*log2(n+1) deep, and n fits in 32 bits.
+				 * An optimistic walk that goes further is following a half-made change.
+				 */
+				static constexpr uint32_t MaxPathLength = 64;
+
+				/*! \brief Serializes writers, and readers which gave up on optimism. */
+				mutable std::shared_mutex m_lock;
+
+				/*! \brief Bumped before and after every change, so it is odd mid-change. */
+				std::atomic<uint32_t> m_version;
+
+				/*! \brief Marks the start of a change. Call with m_lock held exclusively. */
+				inline void beginWrite()
+				{
+					m_version.store(m_version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_release);
+				}
+
+				/*! \brief Marks the end of a change. Call with m_lock held exclusively. */
+				inline void endWrite()
+				{
+					m_version.store(m_version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+				}
+
+				/*! \brief Searches the tree without taking the lock. */
+				/*!
+				 * \param _key The key to search for.
+				 * \param _data Receives the key's data if it was found. May be nullptr.
+				 * \param _found Receives whether the key was found.
+				 * \return True if the search saw a consistent tree, false if it has to be retried.
+				 */
+				bool optimisticLookup(Key const &_key, Data *_data, bool *_found) const;
+
+				/*! \brief Searches the tree, falling back to the shared lock if need be. */
+				/*!
+				 * \param _key The key to search for.
+				 * \param _data Receives the key's data if it was found. May be nullptr.
+				 * \return True if the key was found.
+				 */
+				bool lookup(Key const &_key, Data *_data) const;
+
+			public:
+				/*! \brief The constructor. */
+				ConcurrentRedBlackTree();
+
+				/*! \brief The destructor. */
+				/*!
+				 * \warning No other thread may be using the tree.
+				 */
+				~ConcurrentRedBlackTree();
+
+				/*! \brief Inserts data into the tree. */
+				/*!
+				 * \param _key The key of the data.
+				 * \param _rec The data to insert.
+				 * \return True on success, false if the key was already in the tree.
+				 */
+				bool insert(Key const &_key, Data const &_rec);
+
+				/*! \brief Change the data at the given node. */
+				/*!
+				 * \param _key The key of the node to be modified.
+				 * \param _rec The data to insert.
+				 * \return True on success, false if the key isn't in the tree.
+				 */
+				bool replace(Key const &_key, Data const &_rec);
+
+				/*! \brief Deletes a node from the tree, specified by the node's key. */
+				/*!
+				 * \warning This won't free the memory occupied by the data, so the data must be freed separately.
+				 * \param _key The key of the node to delete.
+				 * \return True on success, false if the key isn't in the tree.
+				 */
+				bool erase(Key const &_key);
+
+				/*! \brief Finds a node in the tree and returns the data at that node. */
+				/*!
+				 * \param _key The key of the node to find.
+				 * \param _default The value to return if the item couldn't be found.
+				 * \return If found, returns a copy of the data at the node, otherwise _default is returned.
+				 */
+				Data find(Key const &_key, Data const &_default = Data()) const;
+
+				/*! \brief Finds a node in the tree and copies out the data at that node. */
+				/*!
+				 * \param _key The key of the node to find.
+				 * \param _data Receives the data, if the key was found.
+				 * \return True if the key was found.
+				 */
+				bool try_find(Key const &_key, Data *_data) const;
+
+				/*! \brief Tests whether a key is in the tree or not. */
+				/*!
+				 * \param _key The key of the node to find.
+				 * \return True if the key is in the tree, false if not.
+				 */
+				bool exists(Key const &_key) const;
+
+				/*! \brief Empties the entire tree. */
+				/*!
+				 * The nodes go back to the tree's pool rather than to the system, so that
+				 * lookups running at the same time never touch freed memory.
+				 * \warning This won't free the memory occupied by the data.
+				 */
+				void empty();
+
+				/*! \brief Indicates the size of the tree. */
+				/*!
+				 * \return Size of the tree. Other threads may change it at any time.
+				 */
+				uint32_t size() const;
+		};
+	}
+}
+
+#include <crisscross/concurrentrbtree.cpp>
+
+#endif
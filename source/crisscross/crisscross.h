@@ -25,17 +25,31 @@
 #include <crisscross/string_utils.h>
 #include <crisscross/sort.h>
 #include <crisscross/filesystem.h>
+#include <crisscross/mappedfile.h>
 #include <crisscross/dstack.h>
 #include <crisscross/darray.h>
 #include <crisscross/llist.h>
 #include <crisscross/node.h>
+#include <crisscross/nodepool.h>
+#include <crisscross/treeiterator.h>
+#include <crisscross/sortedsource.h>
 #include <crisscross/hash.h>
 #include <crisscross/hashtable.h>
 #include <crisscross/stltree.h>
 #include <crisscross/splaytree.h>
 #include <crisscross/avltree.h>
+#include <crisscross/persistentavltree.h>
 #include <crisscross/rbtree.h>
+#include <crisscross/concurrentrbtree.h>
+#include <crisscross/compactrbtree.h>
+#include <crisscross/intervaltree.h>
 #include <crisscross/stree.h>
+#include <crisscross/bplustree.h>
+#include <crisscross/radixtree.h>
+#include <crisscross/staticindex.h>
+#include <crisscross/priorityqueue.h>
+#include <crisscross/flatmap.h>
+#include <crisscross/bloomfilter.h>
 #include <crisscross/error.h>
 #include <crisscross/core_io.h>
 #include <crisscross/console.h>
@@ -0,0 +1,218 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_flatmap_h
+#error "This file shouldn't be compiled directly."
+#endif
+
+#include <algorithm>
+#include <utility>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		template <class Key, class Data, bool OwnsKeys>
+		FlatMap<Key, Data, OwnsKeys>::FlatMap()
+		{
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		FlatMap<Key, Data, OwnsKeys>::~FlatMap()
+		{
+			empty();
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		size_t FlatMap<Key, Data, OwnsKeys>::lowerBound(Key const &_key) const
+		{
+			const Key *keys = m_keys.data();
+			const Key *base = keys;
+			size_t n = m_keys.size();
+			if (!n)
+				return 0;
+
+			/* The next probe is a quarter of the way into one half or the other */
+			while (n > 1) {
+				size_t half = n / 2;
+				cc_prefetch(base + half / 2);
+				cc_prefetch(base + half + half / 2);
+				base = (Compare(base[half], _key) < 0) ? base + half : base;
+				n -= half;
+			}
+
+			return (size_t)(base - keys) + (Compare(*base, _key) < 0);
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool FlatMap<Key, Data, OwnsKeys>::isPending(Key const &_key) const
+		{
+			/* Binary search each run, longest first */
+			size_t count = m_pendingOrder.size(), start = 0;
+			for (size_t run = ((size_t)1 << (sizeof(size_t) * 8 - 1)); run; run >>= 1) {
+				if (!(count & run))
+					continue;
+
+				const uint32_t *lo = m_pendingOrder.data() + start;
+				const uint32_t *found = std::lower_bound(lo, lo + run, _key, [this](uint32_t _index, Key const &_k) {
+					return Compare(m_pendingKeys[_index], _k) < 0;
+				});
+				if (found != lo + run && Compare(m_pendingKeys[*found], _key) == 0)
+					return true;
+				start += run;
+			}
+			return false;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		void FlatMap<Key, Data, OwnsKeys>::merge() const
+		{
+			if (m_pendingKeys.empty())
+				return;
+
+			/* Fold the runs together, shortest first, into one sorted order */
+			auto less = [this](uint32_t _a, uint32_t _b) {
+				return pendingLess(_a, _b);
+			};
+			std::vector<uint32_t> &order = m_pendingOrder;
+			size_t count = order.size(), start = count;
+			for (size_t run = 1; run && run <= count; run <<= 1) {
+				if (!(count & run))
+					continue;
+				if (start != count)
+					std::inplace_merge(order.begin() + (start - run), order.begin() + start, order.end(), less);
+				start -= run;
+			}
+
+			/* Merge from the back, so every item moves at most once */
+			size_t added = order.size();
+			size_t committed = m_keys.size();
+			size_t out = committed + added;
+			m_keys.resize(out);
+			m_data.resize(out);
+			while (added) {
+				uint32_t next = order[added - 1];
+				if (committed && Compare(m_keys[committed - 1], m_pendingKeys[next]) > 0) {
+					committed--;
+					out--;
+					m_keys[out] = std::move(m_keys[committed]);
+					m_data[out] = std::move(m_data[committed]);
+				} else {
+					added--;
+					out--;
+					m_keys[out] = std::move(m_pendingKeys[next]);
+					m_data[out] = std::move(m_pendingData[next]);
+				}
+			}
+
+			m_pendingKeys.clear();
+			m_pendingData.clear();
+			m_pendingOrder.clear();
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool FlatMap<Key, Data, OwnsKeys>::insert(Key const &_key, Data const &_data)
+		{
+			if (indexOf(_key) != m_keys.size() || isPending(_key))
+				return false;
+
+			m_pendingKeys.push_back(OwnsKeys ? Duplicate(_key) : _key);
+			m_pendingData.push_back(_data);
+
+			/* Add a run of one, then merge runs of equal length */
+			auto less = [this](uint32_t _a, uint32_t _b) {
+				return pendingLess(_a, _b);
+			};
+			std::vector<uint32_t> &order = m_pendingOrder;
+			order.push_back((uint32_t)(m_pendingKeys.size() - 1));
+			for (size_t run = 1; !(order.size() & run); run <<= 1)
+				std::inplace_merge(order.end() - 2 * run, order.end() - run, order.end(), less);
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool FlatMap<Key, Data, OwnsKeys>::replace(Key const &_key, Data const &_data)
+		{
+			merge();
+
+			size_t index = indexOf(_key);
+			if (index == m_keys.size())
+				return false;
+
+			m_data[index] = _data;
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool FlatMap<Key, Data, OwnsKeys>::erase(Key const &_key)
+		{
+			merge();
+
+			size_t index = indexOf(_key);
+			if (index == m_keys.size())
+				return false;
+
+			if (OwnsKeys)
+				Dealloc(m_keys[index]);
+			m_keys.erase(m_keys.begin() + index);
+			m_data.erase(m_data.begin() + index);
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		template <class TypedData>
+		TypedData FlatMap<Key, Data, OwnsKeys>::find(Key const &_key, TypedData const &_default) const
+		{
+			merge();
+
+			size_t index = indexOf(_key);
+			if (index == m_keys.size())
+				return _default;
+
+			return (TypedData)m_data[index];
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool FlatMap<Key, Data, OwnsKeys>::exists(Key const &_key) const
+		{
+			merge();
+			return indexOf(_key) != m_keys.size();
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		void FlatMap<Key, Data, OwnsKeys>::empty()
+		{
+			if (OwnsKeys) {
+				for (size_t i = 0; i < m_keys.size(); i++)
+					Dealloc(m_keys[i]);
+				for (size_t i = 0; i < m_pendingKeys.size(); i++)
+					Dealloc(m_pendingKeys[i]);
+			}
+
+			m_keys.clear();
+			m_data.clear();
+			m_pendingKeys.clear();
+			m_pendingData.clear();
+			m_pendingOrder.clear();
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		size_t FlatMap<Key, Data, OwnsKeys>::mem_usage() const
+		{
+			return sizeof(*this) +
+			       m_keys.capacity() * sizeof(Key) +
+			       m_data.capacity() * sizeof(Data) +
+			       m_pendingKeys.capacity() * sizeof(Key) +
+			       m_pendingData.capacity() * sizeof(Data) +
+			       m_pendingOrder.capacity() * sizeof(uint32_t);
+		}
+	}
+}
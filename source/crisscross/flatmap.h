@@ -0,0 +1,294 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_flatmap_h
+#define __included_cc_flatmap_h
+
+#include <crisscross/cc_attr.h>
+#include <crisscross/compare.h>
+#include <crisscross/internal_mem.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		/*! \brief An ordered map kept in two sorted arrays, for data which is read far more than it changes. */
+		/*!
+		 * Keys and data are held in separate contiguous arrays, so a search only
+		 * touches keys and there's no per-item allocation or pointer overhead.
+		 * Lookups are a branchless binary search, which prefetches both of the
+		 * next step's candidates while it compares.
+		 *
+		 * Inserted keys are staged, and merged into the arrays all at once the next
+		 * time the map is read, or when commit() is called. Merging m staged keys into
+		 * n costs O(n + m log m), so a batch of inserts is much cheaper than one tree
+		 * insert per key. The staged keys are indexed by sorted runs of power-of-two
+		 * lengths, so insert() can refuse a repeat in O(log^2 m). erase() and
+		 * replace() work on the arrays directly, and erase() costs O(n).
+		 *
+		 * \warning Because reads may merge staged keys, a map with uncommitted
+		 *    inserts must not be read from several threads at once. Call commit()
+		 *    before sharing it.
+		 */
+		template <class Key, class Data, bool OwnsKeys = true>
+		class FlatMap
+		{
+			private:
+				/*! \brief Private copy constructor. */
+				/*!
+				 * If your code needs to invoke the copy constructor, you've probably written
+				 * the code wrong. A map copy is generally unnecessary, and in cases that it
+				 * is, it can be achieved by other means.
+				 */
+				FlatMap(const FlatMap<Key, Data, OwnsKeys> &) = delete;
+
+				/*! \brief Private assignment operator. */
+				/*!
+				 * If your code needs to invoke the assignment operator, you've probably written
+				 * the code wrong. A map copy is generally unnecessary, and in cases that it
+				 * is, it can be achieved by other means.
+				 */
+				FlatMap<Key, Data, OwnsKeys> &operator =(const FlatMap<Key, Data, OwnsKeys> &) = delete;
+
+			protected:
+				/*! \brief The committed keys, in ascending order. */
+				mutable std::vector<Key> m_keys;
+
+				/*! \brief The data for each committed key, at the same index. */
+				mutable std::vector<Data> m_data;
+
+				/*! \brief Keys inserted since the last merge, in the order they were inserted. */
+				mutable std::vector<Key> m_pendingKeys;
+
+				/*! \brief The data for each staged key, at the same index. */
+				mutable std::vector<Data> m_pendingData;
+
+				/*! \brief Indexes into m_pendingKeys, as sorted runs. */
+				/*!
+				 * There is one run for each bit set in the number of staged keys,
+				 * longest first, with the run's length given by the bit. Staging a
+				 * key appends a run of one, then merges equal runs like a binary
+				 * counter carries.
+				 */
+				mutable std::vector<uint32_t> m_pendingOrder;
+
+				/*! \brief Orders two staged keys by their index in m_pendingKeys. */
+				inline bool pendingLess(uint32_t _a, uint32_t _b) const
+				{
+					return Compare(m_pendingKeys[_a], m_pendingKeys[_b]) < 0;
+				}
+
+				/*! \brief Tests whether a key is staged. */
+				bool isPending(Key const &_key) const;
+
+				/*! \brief Merges the staged keys into the committed arrays. */
+				void merge() const;
+
+				/*! \brief Finds the first committed key not less than the given key. */
+				/*!
+				 * Doesn't merge staged keys first.
+				 * \return The index of the key, or size of the array if every key is less than _key.
+				 */
+				size_t lowerBound(Key const &_key) const;
+
+				/*! \brief Finds a committed key. */
+				/*!
+				 * Doesn't merge staged keys first.
+				 * \return The index of the key, or the size of the array if it isn't there.
+				 */
+				inline size_t indexOf(Key const &_key) const
+				{
+					size_t index = lowerBound(_key);
+					if (index < m_keys.size() && Compare(m_keys[index], _key) != 0)
+						return m_keys.size();
+					return index;
+				}
+
+			public:
+				/*! \brief A bidirectional iterator over the map, in key order. */
+				/*!
+				 * \warning Inserting into or erasing from the map invalidates its iterators.
+				 */
+				class iterator
+				{
+					protected:
+						const FlatMap<Key, Data, OwnsKeys> *m_map;
+						size_t m_index;
+
+					public:
+						iterator(const FlatMap<Key, Data, OwnsKeys> *_map, size_t _index)
+							: m_map(_map), m_index(_index)
+						{
+						}
+
+						/*! \brief Whether the iterator points at an item. */
+						inline bool valid() const
+						{
+							return m_index < m_map->m_keys.size();
+						}
+
+						/*! \brief Gets the key at the iterator. */
+						inline Key const &key() const
+						{
+							return m_map->m_keys[m_index];
+						}
+
+						/*! \brief Gets the data at the iterator. */
+						inline Data &data() const
+						{
+							return m_map->m_data[m_index];
+						}
+
+						/*! \brief Steps to the next key. */
+						inline iterator &operator ++()
+						{
+							m_index++;
+							return *this;
+						}
+
+						/*! \brief Steps to the previous key. */
+						inline iterator &operator --()
+						{
+							m_index--;
+							return *this;
+						}
+
+						inline bool operator ==(iterator const &_other) const
+						{
+							return m_index == _other.m_index;
+						}
+
+						inline bool operator !=(iterator const &_other) const
+						{
+							return m_index != _other.m_index;
+						}
+				};
+
+				/*! \brief The constructor. */
+				FlatMap();
+
+				/*! \brief The destructor. */
+				~FlatMap();
+
+				/*! \brief Stages data to be inserted into the map. */
+				/*!
+				 * \param _key The key of the data.
+				 * \param _data The data to insert.
+				 * \return True on success, false if the key is already in the map,
+				 *    whether committed or still staged.
+				 */
+				bool insert(Key const &_key, Data const &_data);
+
+				/*! \brief Merges every staged insert into the map now. */
+				/*!
+				 * Reads do this on their own, but a map which is shared between
+				 * threads must be committed before they start reading.
+				 */
+				inline void commit()
+				{
+					merge();
+				}
+
+				/*! \brief Changes the data for an existing key. */
+				/*!
+				 * \param _key The key to change the data for.
+				 * \param _data The new data.
+				 * \return True on success, false if the key isn't in the map.
+				 */
+				bool replace(Key const &_key, Data const &_data);
+
+				/*! \brief Deletes a key from the map. */
+				/*!
+				 * Shifts every later item down one place, so this costs O(n).
+				 * \warning This won't free the memory occupied by the data, so the data must be freed separately.
+				 * \param _key The key to delete.
+				 * \return True on success, false if the key isn't in the map.
+				 */
+				bool erase(Key const &_key);
+
+				/*! \brief Finds a key and returns its data. */
+				/*!
+				 * \param _key The key to find.
+				 * \param _default The value to return if the key couldn't be found.
+				 * \return If found, returns the data for the key, otherwise _default is returned.
+				 */
+				template <class TypedData = Data>
+				TypedData find(Key const &_key, TypedData const &_default = nullptr) const;
+
+				/*! \brief Tests whether a key is in the map or not. */
+				/*!
+				 * \param _key The key to find.
+				 * \return True if the key is in the map, false if not.
+				 */
+				bool exists(Key const &_key) const;
+
+				/*! \brief Gets an iterator at the smallest key. */
+				/*!
+				 * \return An iterator at the first key, or end() if the map is empty.
+				 */
+				inline iterator begin() const
+				{
+					merge();
+					return iterator(this, 0);
+				}
+
+				/*! \brief Gets the past-the-end iterator. */
+				/*!
+				 * \return An iterator which points past the last key.
+				 */
+				inline iterator end() const
+				{
+					merge();
+					return iterator(this, m_keys.size());
+				}
+
+				/*! \brief Finds the first key not less than the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return An iterator at the first key >= _key, or end() if there is none.
+				 */
+				inline iterator lower_bound(Key const &_key) const
+				{
+					merge();
+					return iterator(this, lowerBound(_key));
+				}
+
+				/*! \brief Empties the entire map. */
+				/*!
+				 * \warning This won't free the memory occupied by the data, so the data must be freed separately.
+				 */
+				void empty();
+
+				/*! \brief Indicates the size of the map. */
+				/*!
+				 * \return The number of keys, including staged ones.
+				 */
+				inline uint32_t size() const
+				{
+					merge();
+					return (uint32_t)m_keys.size();
+				}
+
+				/*! \brief Returns the memory usage of the map. */
+				/*!
+				 * \return Memory usage in bytes.
+				 */
+				size_t mem_usage() const;
+		};
+	}
+}
+
+#include <crisscross/flatmap.cpp>
+
+#endif
@@ -13,6 +13,7 @@
 #error "This file shouldn't be compiled directly."
 #endif
 
+#include <crisscross/cc_attr.h>
 #include <crisscross/compare.h>
 #include <crisscross/hash.h>
 #include <crisscross/internal_mem.h>
@@ -59,7 +60,7 @@ namespace CrissCross
 			memset(m_data, 0, sizeof(Data) * m_size);
 
 			for (size_t i = 0; i < oldSize; ++i) {
-				if (oldKeys[i] != nullptr) {
+				if (oldKeys[i] != nullptr && oldKeys[i] != (char *)-1) {
 					size_t newIndex = findInsertIndex(oldKeys[i]);
 					m_keys[newIndex] = oldKeys[i];
 					m_data[newIndex] = oldData[i];
@@ -90,7 +91,13 @@ namespace CrissCross
 		template <class Data, bool OwnsKeys>
 		size_t HashTable<Data, OwnsKeys>::findIndex(const char *_key) const
 		{
-			size_t index = Hash<const char *>(_key) & m_mask;
+			return findIndexFrom(_key, Hash<const char *>(_key) & m_mask);
+		}
+
+		template <class Data, bool OwnsKeys>
+		size_t HashTable<Data, OwnsKeys>::findIndexFrom(const char *_key, size_t _index) const
+		{
+			size_t index = _index;
 
 			if (m_keys[index] == nullptr) {
 				return -1;
@@ -123,10 +130,50 @@ namespace CrissCross
 			return _default;
 		}
 
+		template <class Data, bool OwnsKeys>
+		size_t HashTable<Data, OwnsKeys>::find_batch(const char *const *_keys, size_t _count, Data *_out, Data const &_default) const
+		{
+			const size_t width = 16;
+			size_t index[width];
+			size_t found = 0;
+
+			for (size_t base = 0; base < _count; base += width) {
+				size_t n = _count - base < width ? _count - base : width;
+
+				/* Hash the whole group, and start fetching each key's first slot */
+				for (size_t i = 0; i < n; i++) {
+					index[i] = Hash<const char *>(_keys[base + i]) & m_mask;
+					cc_prefetch(&m_keys[index[i]]);
+				}
+
+				/* Then the keys stored in those slots, which the probes compare against */
+				for (size_t i = 0; i < n; i++) {
+					const char *stored = m_keys[index[i]];
+					if (stored != nullptr && stored != (char *)-1) {
+						cc_prefetch(stored);
+						cc_prefetch(&m_data[index[i]]);
+					}
+				}
+
+				/* By now most of the group's probes should hit the cache */
+				for (size_t i = 0; i < n; i++) {
+					size_t slot = findIndexFrom(_keys[base + i], index[i]);
+					if (slot != (size_t)-1) {
+						_out[base + i] = m_data[slot];
+						found++;
+					} else {
+						_out[base + i] = _default;
+					}
+				}
+			}
+
+			return found;
+		}
+
 		template <class Data, bool OwnsKeys>
 		bool HashTable<Data, OwnsKeys>::exists(const char * _key) const
 		{
-			return findIndex(_key) != -1;
+			return findIndex(_key) != (size_t)-1;
 		}
 
 		template <class Data, bool OwnsKeys>
@@ -154,6 +201,7 @@ namespace CrissCross
 
 			memset(m_keys, 0, sizeof(const char *) * m_size);
 			memset(m_data, 0, sizeof(Data) * m_size);
+			m_slotsFree = m_size;
 		}
 
 		template <class Data, bool OwnsKeys>
@@ -31,6 +31,7 @@ namespace CrissCross
 
 				size_t findInsertIndex(const char *_key) const;
 				size_t findIndex(const char *_key) const;
+				size_t findIndexFrom(const char *_key, size_t _index) const;
 				virtual void   grow();
 
 			public:
@@ -57,6 +58,19 @@ namespace CrissCross
 				 */
 				Data find(const char *_key, Data const &_default = nullptr) const;
 
+				/*! \brief Finds many keys at once. */
+				/*!
+				 * Equivalent to calling find() on each key, but the keys are hashed and their
+				 * slots prefetched in groups before any slot is read, so the cache misses of
+				 * a group overlap instead of being taken one after another.
+				 * \param _keys The keys to find.
+				 * \param _count The number of keys.
+				 * \param _out Receives the data for each key, or _default if it wasn't found.
+				 * \param _default The value to store for keys which couldn't be found.
+				 * \return The number of keys found.
+				 */
+				size_t find_batch(const char *const *_keys, size_t _count, Data *_out, Data const &_default = nullptr) const;
+
 				/*! \brief Deletes a node from the table, specified by the node's key. */
 				/*!
 				 * \warning This won't free the memory occupied by the data, so the data must be freed separately.
@@ -108,6 +122,17 @@ namespace CrissCross
 					       m_keys[_index] != (char *)-1;
 				}
 
+				/*! \brief Gets the key stored in a slot. */
+				/*!
+				 * \param _index The index of the slot, which must be valid().
+				 * \return The key in the slot.
+				 */
+				const char *key(size_t _index) const
+				{
+					CoreAssert(valid(_index));
+					return m_keys[_index];
+				}
+
 				Data const &operator [](size_t _index) const
 				{
 					CoreAssert(_index < m_size);
@@ -0,0 +1,130 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_intervaltree_h
+#error "This file shouldn't be compiled directly."
+#endif
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		template <class Bound, class Data>
+		IntervalTree<Bound, Data>::IntervalTree()
+		{
+		}
+
+		template <class Bound, class Data>
+		IntervalTree<Bound, Data>::~IntervalTree()
+		{
+		}
+
+		template <class Bound, class Data>
+		bool IntervalTree<Bound, Data>::insert(Bound const &_lo, Bound const &_hi, Data const &_data)
+		{
+			if (Compare(_hi, _lo) < 0)
+				return false;
+
+			/* The tree works out maxHi itself as the node is linked in */
+			IntervalEntry<Bound, Data> entry;
+			entry.data = _data;
+			entry.maxHi = _hi;
+			return Base::insert(makeInterval(_lo, _hi), entry);
+		}
+
+		template <class Bound, class Data>
+		bool IntervalTree<Bound, Data>::replace(Bound const &_lo, Bound const &_hi, Data const &_data)
+		{
+			/* Only the data changes, so maxHi needs no update */
+			Node *node = this->findNode(makeInterval(_lo, _hi));
+			if (!this->valid(node))
+				return false;
+
+			node->data.data = _data;
+			return true;
+		}
+
+		template <class Bound, class Data>
+		bool IntervalTree<Bound, Data>::erase(Bound const &_lo, Bound const &_hi)
+		{
+			return Base::erase(makeInterval(_lo, _hi));
+		}
+
+		template <class Bound, class Data>
+		template <class TypedData>
+		TypedData IntervalTree<Bound, Data>::find(Bound const &_lo, Bound const &_hi, TypedData const &_default) const
+		{
+			Node *node = this->findNode(makeInterval(_lo, _hi));
+			if (!this->valid(node))
+				return _default;
+
+			return (TypedData)(node->data.data);
+		}
+
+		template <class Bound, class Data>
+		bool IntervalTree<Bound, Data>::exists(Bound const &_lo, Bound const &_hi) const
+		{
+			return Base::exists(makeInterval(_lo, _hi));
+		}
+
+		template <class Bound, class Data>
+		template <class Visitor>
+		uint32_t IntervalTree<Bound, Data>::visitOverlapping(const Node *_node, Bound const &_lo, Bound const &_hi, Visitor &_fn) const
+		{
+			uint32_t count = 0;
+
+			/* Only the right spine is walked iteratively, so the recursion is
+			 * bounded by the tree's height. */
+			while (this->valid(_node)) {
+				/* Nothing down here reaches _lo */
+				if (Compare(_node->data.maxHi, _lo) < 0)
+					break;
+
+				count += visitOverlapping(_node->left, _lo, _hi, _fn);
+
+				/* This interval and everything to its right start after _hi */
+				if (Compare(_node->id.lo, _hi) > 0)
+					break;
+
+				if (Compare(_node->id.hi, _lo) >= 0) {
+					_fn(_node->id.lo, _node->id.hi, _node->data.data);
+					count++;
+				}
+
+				_node = _node->right;
+			}
+
+			return count;
+		}
+
+		template <class Bound, class Data>
+		bool IntervalTree<Bound, Data>::overlaps(Bound const &_lo, Bound const &_hi) const
+		{
+			if (Compare(_hi, _lo) < 0)
+				return false;
+
+			const Node *node = this->rootNode;
+			while (this->valid(node)) {
+				if (Compare(node->id.lo, _hi) <= 0 && Compare(node->id.hi, _lo) >= 0)
+					return true;
+
+				/* If anything on the left reaches _lo, then either something there
+				 * overlaps, or it all starts after _hi and so does the right side. */
+				if (this->valid(node->left) && Compare(node->left->data.maxHi, _lo) >= 0)
+					node = node->left;
+				else
+					node = node->right;
+			}
+
+			return false;
+		}
+	}
+}
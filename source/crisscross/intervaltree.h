@@ -0,0 +1,253 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_intervaltree_h
+#define __included_cc_intervaltree_h
+
+#include <crisscross/cc_attr.h>
+#include <crisscross/compare.h>
+#include <crisscross/node.h>
+#include <crisscross/rbtree.h>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		/*! \brief A closed interval [lo, hi]. */
+		/*!
+		 * Intervals order by their low bound, then by their high bound.
+		 */
+		template <class Bound>
+		struct Interval
+		{
+			/*! \brief The low end of the interval. */
+			Bound lo;
+
+			/*! \brief The high end of the interval, which is part of it. */
+			Bound hi;
+
+			inline bool operator <(Interval const &_other) const
+			{
+				int cmp = Compare(lo, _other.lo);
+				return cmp < 0 || (cmp == 0 && Compare(hi, _other.hi) < 0);
+			}
+
+			inline bool operator >(Interval const &_other) const
+			{
+				return _other < *this;
+			}
+		};
+
+		/*! \brief What an IntervalTree stores in each RedBlackTree node. */
+		template <class Bound, class Data>
+		struct IntervalEntry
+		{
+			/*! \brief The data stored with the interval. */
+			Data data;
+
+			/*! \brief The largest high bound of any interval in this node's subtree. */
+			Bound maxHi;
+		};
+
+		/*! \brief Keeps each IntervalTree node's maxHi up to date. */
+		template <class Bound, class Data>
+		struct NodeAugment<Interval<Bound>, IntervalEntry<Bound, Data> >
+		{
+			static constexpr bool Enabled = true;
+
+			template <class Node>
+			static inline void update(Node *_node, const Node *_left, const Node *_right)
+			{
+				Bound const *maxHi = &_node->id.hi;
+				if (_left && Compare(_left->data.maxHi, *maxHi) > 0)
+					maxHi = &_left->data.maxHi;
+				if (_right && Compare(_right->data.maxHi, *maxHi) > 0)
+					maxHi = &_right->data.maxHi;
+				_node->data.maxHi = *maxHi;
+			}
+		};
+
+		/*! \brief A red-black tree of intervals, for finding the ones which overlap a range. */
+		/*!
+		 * Each node also records the largest high bound in its subtree, which is kept
+		 * up to date through rotations and the insert and erase fixups. Queries use it
+		 * to skip every subtree which ends before the range they're looking for, so
+		 * finding the k intervals overlapping a range costs O(log n + k).
+		 *
+		 * Queries report intervals in order, and allocate nothing. Each distinct
+		 * interval is stored once, just as the other trees store each key once.
+		 */
+		template <class Bound, class Data>
+		class IntervalTree : protected RedBlackTree<Interval<Bound>, IntervalEntry<Bound, Data> >
+		{
+			private:
+				/*! \brief Private copy constructor. */
+				/*!
+				 * If your code needs to invoke the copy constructor, you've probably written
+				 * the code wrong. A tree copy is generally unnecessary, and in cases that it
+				 * is, it can be achieved by other means.
+				 */
+				IntervalTree(const IntervalTree<Bound, Data> &) = delete;
+
+				/*! \brief Private assignment operator. */
+				/*!
+				 * If your code needs to invoke the assignment operator, you've probably written
+				 * the code wrong. A tree copy is generally unnecessary, and in cases that it
+				 * is, it can be achieved by other means.
+				 */
+				IntervalTree<Bound, Data> &operator =(const IntervalTree<Bound, Data> &) = delete;
+
+			protected:
+				/*! \brief The underlying tree. */
+				typedef RedBlackTree<Interval<Bound>, IntervalEntry<Bound, Data> > Base;
+
+				/*! \brief The underlying tree's nodes. */
+				typedef RedBlackNode<Interval<Bound>, IntervalEntry<Bound, Data>, true, false> Node;
+
+				/*! \brief Visits the intervals in a subtree which overlap [_lo, _hi], in order. */
+				/*!
+				 * Recurses at most as deep as the tree, and skips any subtree whose maxHi
+				 * is below _lo, or whose intervals all start after _hi.
+				 * \return The number of intervals visited.
+				 */
+				template <class Visitor>
+				uint32_t visitOverlapping(const Node *_node, Bound const &_lo, Bound const &_hi, Visitor &_fn) const;
+
+				/*! \brief Makes the key for an interval. */
+				static inline Interval<Bound> makeInterval(Bound const &_lo, Bound const &_hi)
+				{
+					Interval<Bound> ret;
+					ret.lo = _lo;
+					ret.hi = _hi;
+					return ret;
+				}
+
+			public:
+				/*! \brief The constructor. */
+				IntervalTree();
+
+				/*! \brief The destructor. */
+				~IntervalTree();
+
+				/*! \brief Inserts an interval into the tree. */
+				/*!
+				 * \param _lo The low end of the interval.
+				 * \param _hi The high end of the interval, which is part of it.
+				 * \param _data The data to store with it.
+				 * \return True on success, false if the interval is already in the tree or _hi is less than _lo.
+				 */
+				bool insert(Bound const &_lo, Bound const &_hi, Data const &_data);
+
+				/*! \brief Changes the data stored with an interval. */
+				/*!
+				 * \param _lo The low end of the interval.
+				 * \param _hi The high end of the interval.
+				 * \param _data The new data.
+				 * \return True on success, false if the interval isn't in the tree.
+				 */
+				bool replace(Bound const &_lo, Bound const &_hi, Data const &_data);
+
+				/*! \brief Deletes an interval from the tree. */
+				/*!
+				 * \warning This won't free the memory occupied by the data, so the data must be freed separately.
+				 * \param _lo The low end of the interval.
+				 * \param _hi The high end of the interval.
+				 * \return True on success, false if the interval isn't in the tree.
+				 */
+				bool erase(Bound const &_lo, Bound const &_hi);
+
+				/*! \brief Finds an interval and returns the data stored with it. */
+				/*!
+				 * \param _lo The low end of the interval.
+				 * \param _hi The high end of the interval.
+				 * \param _default The value to return if the interval couldn't be found.
+				 * \return If found, returns the data stored with the interval, otherwise _default is returned.
+				 */
+				template <class TypedData = Data>
+				TypedData find(Bound const &_lo, Bound const &_hi, TypedData const &_default = nullptr) const;
+
+				/*! \brief Tests whether an interval is in the tree. */
+				/*!
+				 * \param _lo The low end of the interval.
+				 * \param _hi The high end of the interval.
+				 * \return True if the interval is in the tree, false if not.
+				 */
+				bool exists(Bound const &_lo, Bound const &_hi) const;
+
+				/*! \brief Visits every interval which overlaps [_lo, _hi], in order. */
+				/*!
+				 * \param _lo The low end of the range.
+				 * \param _hi The high end of the range, which is part of it.
+				 * \param _fn Called as _fn(lo, hi, data) for each overlapping interval.
+				 * \return The number of intervals visited.
+				 */
+				template <class Visitor>
+				inline uint32_t for_each_overlapping(Bound const &_lo, Bound const &_hi, Visitor _fn) const
+				{
+					if (Compare(_hi, _lo) < 0)
+						return 0;
+					return visitOverlapping(this->rootNode, _lo, _hi, _fn);
+				}
+
+				/*! \brief Visits every interval which contains a point, in order. */
+				/*!
+				 * \param _point The point to stab the intervals with.
+				 * \param _fn Called as _fn(lo, hi, data) for each interval containing _point.
+				 * \return The number of intervals visited.
+				 */
+				template <class Visitor>
+				inline uint32_t for_each_containing(Bound const &_point, Visitor _fn) const
+				{
+					return visitOverlapping(this->rootNode, _point, _point, _fn);
+				}
+
+				/*! \brief Tests whether any interval overlaps [_lo, _hi]. */
+				/*!
+				 * Runs in O(log n), however many intervals overlap.
+				 * \param _lo The low end of the range.
+				 * \param _hi The high end of the range, which is part of it.
+				 * \return True if some interval overlaps the range.
+				 */
+				bool overlaps(Bound const &_lo, Bound const &_hi) const;
+
+				/*! \brief Empties the entire tree. */
+				/*!
+				 * \warning This won't free the memory occupied by the data, so the data must be freed separately.
+				 */
+				inline void empty()
+				{
+					Base::empty();
+				}
+
+				/*! \brief Indicates the number of intervals in the tree. */
+				/*!
+				 * \return Number of intervals in the tree.
+				 */
+				inline uint32_t size() const
+				{
+					return Base::size();
+				}
+
+				/*! \brief Returns the memory usage of the tree. */
+				/*!
+				 * \return Memory usage in bytes.
+				 */
+				inline uint32_t mem_usage() const
+				{
+					return Base::mem_usage();
+				}
+		};
+	}
+}
+
+#include <crisscross/intervaltree.cpp>
+
+#endif
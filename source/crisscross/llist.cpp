@@ -78,7 +78,7 @@ namespace CrissCross
 
 		template <class T> T &LList <T>::insert_new()
 		{
-			LListNode <T> *li = new LListNode <T> ();
+			LListNode <T> *li = m_pool.construct();
 			li->m_next = nullptr;
 			li->m_previous = m_last;
 			++m_numItems;
@@ -99,7 +99,7 @@ namespace CrissCross
 
 		template <class T> void LList <T>::insert_back(const T & newdata)
 		{
-			LListNode <T> *li = new LListNode <T> ();
+			LListNode <T> *li = m_pool.construct();
 			li->m_data = newdata;
 			li->m_next = nullptr;
 			li->m_previous = m_last;
@@ -119,7 +119,7 @@ namespace CrissCross
 
 		template <class T> void LList <T>::insert_front(const T & newdata)
 		{
-			LListNode <T> *li = new LListNode <T> ();
+			LListNode <T> *li = m_pool.construct();
 			li->m_data = newdata;
 			li->m_previous = nullptr;
 			++m_numItems;
@@ -162,7 +162,7 @@ namespace CrissCross
 					return;
 				}
 
-				LListNode <T> *li = new LListNode <T> ();
+				LListNode <T> *li = m_pool.construct();
 				li->m_data = newdata;
 				li->m_previous = current;
 				li->m_next = current->m_next;
@@ -261,14 +261,18 @@ namespace CrissCross
 
 		template <class T> void LList <T>::empty()
 		{
-			LListNode <T> *current = m_first;
-			while (current)	{
-				LListNode <T> *m_next = current->m_next;
-				delete current;
+			if (!NodePool<LListNode <T> >::TrivialTeardown) {
+				LListNode <T> *current = m_first;
+				while (current)	{
+					LListNode <T> *m_next = current->m_next;
+					m_pool.destroy(current);
 
-				current = m_next;
+					current = m_next;
+				}
 			}
 
+			m_pool.release();
+
 			m_first = nullptr;
 			m_last = nullptr;
 			m_numItems = 0;
@@ -276,6 +280,82 @@ namespace CrissCross
 			m_previousIndex = (uint32_t)-1;
 		}
 
+		template <class T>
+		template <class Comparator>
+		LListNode <T> *LList <T>::mergeRuns(LListNode <T> *_a, LListNode <T> *_b, Comparator const &_cmp)
+		{
+			LListNode <T> *head = nullptr, **tail = &head;
+
+			/* Take from _a on ties to keep the sort stable */
+			while (_a && _b) {
+				if (_cmp(_b->m_data, _a->m_data)) {
+					*tail = _b;
+					_b = _b->m_next;
+				} else {
+					*tail = _a;
+					_a = _a->m_next;
+				}
+				tail = &(*tail)->m_next;
+			}
+
+			*tail = _a ? _a : _b;
+			return head;
+		}
+
+		template <class T>
+		template <class Comparator>
+		void LList <T>::sort(Comparator const &_cmp)
+		{
+			if (m_numItems < 2)
+				return;
+
+			/* Bottom-up natural merge sort. The list is cut into its */
+			/* ascending runs in a single pass, and the runs are merged */
+			/* like a binary counter: bin k holds the merge of 2^k runs. */
+			/* Small merges happen while the nodes are still hot in cache, */
+			/* and only the m_next chain is maintained until the end. */
+
+			LListNode <T> *bins[32] = { nullptr };
+			LListNode <T> *current = m_first;
+
+			while (current) {
+				LListNode <T> *run = current;
+				while (current->m_next && !_cmp(current->m_next->m_data, current->m_data))
+					current = current->m_next;
+
+				LListNode <T> *next = current->m_next;
+				current->m_next = nullptr;
+				current = next;
+
+				/* Older runs live in higher bins and go on the left */
+				uint32_t k;
+				for (k = 0; k < 31 && bins[k]; k++) {
+					run = mergeRuns(bins[k], run, _cmp);
+					bins[k] = nullptr;
+				}
+				bins[k] = bins[k] ? mergeRuns(bins[k], run, _cmp) : run;
+			}
+
+			LListNode <T> *head = nullptr;
+			for (uint32_t k = 0; k < 32; k++) {
+				if (bins[k])
+					head = mergeRuns(bins[k], head, _cmp);
+			}
+
+			/* Rebuild the back links and the list ends */
+			LListNode <T> *prev = nullptr;
+			for (LListNode <T> *node = head; node; node = node->m_next) {
+				node->m_previous = prev;
+				prev = node;
+			}
+
+			m_first = head;
+			m_last = prev;
+
+			m_previous = m_first;
+			m_previousIndex = 0;
+		}
+
 		template <class T> void LList <T>::remove(uint32_t index)
 		{
 			LListNode <T> *current = getItem(index);
@@ -308,7 +388,7 @@ namespace CrissCross
 				m_previousIndex--;
 			}
 
-			delete current;
+			m_pool.destroy(current);
 
 			--m_numItems;
 		}
@@ -15,6 +15,8 @@
 #include <cstdint>
 
 #include <crisscross/cc_attr.h>
+#include <crisscross/compare.h>
+#include <crisscross/nodepool.h>
 
 namespace CrissCross
 {
@@ -230,9 +232,22 @@ namespace CrissCross
 				/*! \brief The number of nodes in the list. */
 				uint32_t m_numItems;
 
+				/*! \brief The allocator for the list's nodes. */
+				NodePool<LListNode <T> > m_pool;
+
 			protected:
 				inline LListNode <T> *getItem(uint32_t index) const;
 
+				/*! \brief Merges two nullptr-terminated runs of nodes linked through m_next. */
+				/*!
+				 * \param _a The first run. Wins ties, so it should precede _b in the original order.
+				 * \param _b The second run.
+				 * \param _cmp The less-than predicate.
+				 * \return The head of the merged run.
+				 */
+				template <class Comparator>
+				static LListNode <T> *mergeRuns(LListNode <T> *_a, LListNode <T> *_b, Comparator const &_cmp);
+
 			public:
 
 				/*! \brief The default constructor. */
@@ -341,6 +356,17 @@ namespace CrissCross
 				/*! \brief Deletes all nodes in the list, but does not free memory allocated by data. */
 				void empty();
 
+				/*! \brief Sorts the list in place. */
+				/*!
+				 *  Performs a bottom-up natural merge sort directly on the node
+				 *  links. No elements are copied or moved and no memory is
+				 *  allocated; only the m_next and m_previous pointers change.
+				 *  The sort is stable.
+				 * \param _cmp A less-than predicate, called as _cmp(a, b).
+				 */
+				template <class Comparator = LessThanComparator<T> >
+				void sort(Comparator const &_cmp = Comparator());
+
 				/*! \brief Gets the data at the given index. */
 				/*!
 				 * \param _index The index of the node to get data from.
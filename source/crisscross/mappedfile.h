@@ -0,0 +1,97 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_mappedfile_h
+#define __included_cc_mappedfile_h
+
+#include <cstddef>
+
+namespace CrissCross
+{
+	namespace IO
+	{
+		struct MappedFileImpl;
+
+		/*! \brief A read-only view of a whole file, mapped into memory. */
+		/*!
+		 * Pages are read in by the operating system as they are touched, so
+		 * opening even a large file is cheap, and several processes mapping the
+		 * same file share its pages.
+		 */
+		class MappedFile
+		{
+			private:
+				/*! \brief Private copy constructor. */
+				MappedFile(const MappedFile &) = delete;
+
+				/*! \brief Private assignment operator. */
+				MappedFile &operator =(const MappedFile &) = delete;
+
+			protected:
+				/*! \brief The platform mapping, or nullptr when nothing is mapped. */
+				MappedFileImpl *m_impl;
+
+				/*! \brief The start of the mapping, or nullptr if no file is open. */
+				const void *m_data;
+
+				/*! \brief The size of the file in bytes. */
+				size_t m_size;
+
+			public:
+				/*! \brief The constructor. */
+				MappedFile();
+
+				/*! \brief The destructor. */
+				/*!
+				 * Unmaps the file, if one is open.
+				 */
+				~MappedFile();
+
+				/*! \brief Maps a file into memory. */
+				/*!
+				 * Closes any file which was already open.
+				 * \param _path The path to the file.
+				 * \return True on success, false if the file couldn't be opened or mapped.
+				 *    Empty files can't be mapped.
+				 */
+				bool Open(const char *_path);
+
+				/*! \brief Unmaps the file. */
+				void Close();
+
+				/*! \brief Determines whether a file is mapped. */
+				inline bool IsOpen() const
+				{
+					return m_data != nullptr;
+				}
+
+				/*! \brief Gets the contents of the file. */
+				/*!
+				 * \return The start of the mapping, aligned to a page, or nullptr if no file is open.
+				 */
+				inline const void *Data() const
+				{
+					return m_data;
+				}
+
+				/*! \brief Gets the size of the file. */
+				/*!
+				 * \return The size in bytes, or 0 if no file is open.
+				 */
+				inline size_t Size() const
+				{
+					return m_size;
+				}
+		};
+	}
+}
+
+#endif
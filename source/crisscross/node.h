@@ -12,17 +12,148 @@
 #ifndef __included_cc_node_h
 #define __included_cc_node_h
 
+#include <atomic>
+#include <type_traits>
+
+#include <crisscross/cc_attr.h>
+#include <crisscross/compare.h>
 #include <crisscross/internal_mem.h>
 
 namespace CrissCross
 {
 	namespace Data
 	{
+		/*! \brief Indicates whether a tree node can be discarded without running its destructor. */
+		/*!
+		 * True when neither the key nor the data need destruction and the node
+		 * doesn't own a heap-allocated key.
+		 */
+		template <class Key, class Data, bool OwnsKeys>
+		struct TrivialNodeTeardown : std::integral_constant<bool,
+		                                                    std::is_trivially_destructible<Key>::value &&
+		                                                    std::is_trivially_destructible<Data>::value &&
+		                                                    !(OwnsKeys && std::is_pointer<Key>::value)>
+		{
+		};
+
+		/*! \brief The subtree size kept by nodes of trees which track order statistics. */
+		/*!
+		 * Nodes derive from this so that trees which don't track order statistics
+		 * pay nothing for it.
+		 */
+		template <bool Enabled>
+		struct SubtreeCount
+		{
+		};
+
+		/*! \brief The subtree size kept by nodes of trees which track order statistics. */
+		template <>
+		struct SubtreeCount<true>
+		{
+			/*! \brief The number of nodes in the subtree rooted here, including this one. */
+			uint32_t count;
+
+			SubtreeCount() : count(1)
+			{
+			}
+		};
+
+		/*! \brief Extra state a tree node keeps about its whole subtree. */
+		/*!
+		 * Trees which support it call update() on a node whenever its subtree changes:
+		 * after a rotation, and along the path of an insert or erase, children before
+		 * parents. Specialize this for a Key and Data pair to augment the trees using
+		 * them, as IntervalTree does. Other trees pay nothing.
+		 */
+		template <class Key, class Data>
+		struct NodeAugment
+		{
+			/*! \brief Whether nodes with this Key and Data are augmented. */
+			static constexpr bool Enabled = false;
+
+			/*! \brief Recomputes a node's augmented state from its children. */
+			/*!
+			 * \param _node The node to update.
+			 * \param _left The node's left child, or nullptr.
+			 * \param _right The node's right child, or nullptr.
+			 */
+			template <class Node>
+			static inline void update(cc_unused_param Node *_node, cc_unused_param const Node *_left, cc_unused_param const Node *_right)
+			{
+			}
+		};
+
+		/*! \brief The key prefix cached by nodes of trees keyed by C strings. */
+		/*!
+		 * Nodes derive from this so that trees with other key types pay nothing
+		 * for it. A tree must call cachePrefix() whenever it sets a node's key.
+		 */
+		template <class Key, bool Enabled = KeyPrefix<Key>::Enabled>
+		struct CachedKeyPrefix
+		{
+			cc_forceinline void cachePrefix(cc_unused_param Key const &_key)
+			{
+			}
+
+			cc_forceinline int comparePrefix(cc_unused_param typename KeyPrefix<Key>::Type _prefix) const
+			{
+				return 0;
+			}
+		};
+
+		/*! \brief The key prefix cached by nodes of trees keyed by C strings. */
+		template <class Key>
+		struct CachedKeyPrefix<Key, true>
+		{
+			/*! \brief KeyPrefix<Key>::Make() of the node's key. */
+			typename KeyPrefix<Key>::Type prefix;
+
+			CachedKeyPrefix() : prefix(0)
+			{
+			}
+
+			/*! \brief Recomputes the prefix after the node's key changes. */
+			inline void cachePrefix(Key const &_key)
+			{
+				prefix = KeyPrefix<Key>::Make(_key);
+			}
+
+			/*! \brief Compares another key's prefix with this node's. */
+			/*!
+			 * \return Less than, equal to or greater than 0 as _prefix is less than,
+			 *    equal to or greater than the node's prefix. 0 means the keys must be
+			 *    compared in full.
+			 */
+			cc_forceinline int comparePrefix(typename KeyPrefix<Key>::Type _prefix) const
+			{
+				return (_prefix > prefix) - (_prefix < prefix);
+			}
+		};
+
+		/*! \brief Compares a key with a node's key, trying the node's cached prefix first. */
+		/*!
+		 * \param _key The key to compare.
+		 * \param _prefix KeyPrefix<Key>::Make(_key).
+		 * \param _node The node to compare against.
+		 * \return The same as Compare(_key, _node->id).
+		 */
+		template <class Key, class Node>
+		inline int CompareWithNode(Key const &_key, typename KeyPrefix<Key>::Type _prefix, const Node *_node)
+		{
+			int cmp = _node->comparePrefix(_prefix);
+			if (cmp)
+				return cmp;
+			return Compare(_key, _node->id);
+		}
+
 		/*! \brief A binary tree node used for SplayTree. */
 		template <class Key, class Data, bool OwnsKeys>
 		class SplayNode
 		{
 			public:
+				/*! \brief Whether the node's destructor can be skipped when discarding the tree. */
+				static constexpr bool TrivialTeardown = TrivialNodeTeardown<Key, Data, OwnsKeys>::value;
+
 				/*! \brief The key for this node. */
 				Key id;
 
@@ -77,10 +208,12 @@ namespace CrissCross
 		} AVLBalance;
 
 		/*! \brief A binary tree node used for AVLTree. */
-		template <class Key, class Data, bool OwnsKeys>
-		class AVLNode
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics = false>
+		class AVLNode : public SubtreeCount<OrderStatistics>, public CachedKeyPrefix<Key>
 		{
 			public:
+				/*! \brief Whether the node's destructor can be skipped when discarding the tree. */
+				static constexpr bool TrivialTeardown = TrivialNodeTeardown<Key, Data, OwnsKeys>::value;
 
 				/*! \brief The left branch of the tree from this node. */
 				AVLNode *left;
@@ -110,8 +243,6 @@ namespace CrissCross
 				{
 					if (OwnsKeys)
 						Dealloc(id);
-					delete left; left = nullptr;
-					delete right; right = nullptr;
 				}
 
 				/*! \brief Returns the overhead caused by the node. */
@@ -127,11 +258,94 @@ namespace CrissCross
 				}
 		};
 
+		/*! \brief An immutable, reference-counted binary tree node used for PersistentAVLTree. */
+		/*!
+		 * Nodes are shared between every version of a tree that contains them,
+		 * so they have no parent link and are never modified once built.
+		 *
+		 * A node which is rebuilt from an older one shares that node's key
+		 * rather than duplicating it. When the tree owns heap-allocated keys,
+		 * keyRefs counts the nodes sharing the key, and the last one frees it.
+		 */
+		template <class Key, class Data, bool OwnsKeys>
+		class PersistentAVLNode
+		{
+			public:
+				/*! \brief The left branch of the tree from this node. */
+				PersistentAVLNode *left;
+
+				/*! \brief The right branch of the tree from this node. */
+				PersistentAVLNode *right;
+
+				/*! \brief The key for this node. */
+				Key id;
+
+				/*! \brief The data held at this node. */
+				Data data;
+
+				/*! \brief The number of trees and parent nodes referring to this node. */
+				std::atomic<uint32_t> refs;
+
+				/*! \brief The number of nodes sharing this key, or nullptr if keys aren't shared. */
+				std::atomic<uint32_t> *keyRefs;
+
+				/*! \brief The height of the subtree rooted here, counting this node. */
+				unsigned char height;
+
+				/*! \brief Whether copies of a node share one heap-allocated key. */
+				static constexpr bool SharesKeys = OwnsKeys && std::is_pointer<Key>::value;
+
+				/*! \brief The constructor. */
+				PersistentAVLNode() : left(nullptr), right(nullptr), refs(1), keyRefs(nullptr), height(1)
+				{
+				}
+
+				/*! \brief The destructor. */
+				~PersistentAVLNode()
+				{
+					if (keyRefs) {
+						if (keyRefs->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+							Dealloc(id);
+							delete keyRefs;
+						}
+					} else if (OwnsKeys) {
+						Dealloc(id);
+					}
+				}
+		};
+
+		/*! \brief A compact binary tree node used for CompactRedBlackTree. */
+		/*!
+		 * Links are indices into the tree's node array rather than pointers, and
+		 * the node's color lives in the top bit of the parent link, so for small
+		 * keys and data a node is half the size of a RedBlackNode.
+		 */
+		template <class Key, class Data, class Index>
+		struct CompactRedBlackNode
+		{
+			/*! \brief The index of the left child, or 0 for none. */
+			Index left;
+
+			/*! \brief The index of the right child, or 0 for none. */
+			Index right;
+
+			/*! \brief The index of the parent, with the color in the top bit (set for red). */
+			Index parentColor;
+
+			/*! \brief The key for this node. */
+			Key id;
+
+			/*! \brief The data held at this node. */
+			Data data;
+		};
+
 		/*! \brief A binary tree node used for STree. */
 		template <class Key, class Data, bool OwnsKeys>
 		class SNode
 		{
 			public:
+				/*! \brief Whether the node's destructor can be skipped when discarding the tree. */
+				static constexpr bool TrivialTeardown = TrivialNodeTeardown<Key, Data, OwnsKeys>::value;
 
 				/*! \brief The left branch of the tree from this node. */
 				SNode *left;
@@ -158,8 +372,6 @@ namespace CrissCross
 				{
 					if (OwnsKeys)
 						Dealloc(id);
-					delete left; left = nullptr;
-					delete right; right = nullptr;
 				}
 
 				/*! \brief Returns the overhead caused by the node. */
@@ -176,10 +388,12 @@ namespace CrissCross
 		};
 
 		/*! \brief A binary tree node used for RedBlackTree. */
-		template <class Key, class Data, bool OwnsKeys>
-		class RedBlackNode
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics = false>
+		class RedBlackNode : public SubtreeCount<OrderStatistics>, public CachedKeyPrefix<Key>
 		{
 			public:
+				/*! \brief Whether the node's destructor can be skipped when discarding the tree. */
+				static constexpr bool TrivialTeardown = TrivialNodeTeardown<Key, Data, OwnsKeys>::value;
 
 				/*! \brief The left branch of the tree from this node. */
 				RedBlackNode *left;
@@ -209,8 +423,6 @@ namespace CrissCross
 				{
 					if (OwnsKeys)
 						Dealloc(id);
-					delete left; left = nullptr;
-					delete right; right = nullptr;
 				}
 		};
 	}
@@ -0,0 +1,311 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_nodepool_h
+#define __included_cc_nodepool_h
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <crisscross/cc_attr.h>
+#include <crisscross/debug.h>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		/*! \brief A slab allocator for fixed-size container nodes. */
+		/*!
+		 * Nodes are carved out of large cache-aligned blocks. Freed nodes go onto an
+		 * intrusive free list and are handed out again before any new block space is
+		 * touched. Block sizes start small and double up to MaxBlockSize, so small
+		 * containers don't pay for a full slab.
+		 *
+		 * Since every node lives in one of the pool's blocks, a container can throw
+		 * all of its nodes away at once with release(), without walking them.
+		 *
+		 * \warning A pool is not thread-safe, and is meant to be owned by a single container.
+		 */
+		template <class T, size_t MaxBlockSize = 65536>
+		class NodePool
+		{
+			private:
+				/*! \brief Private copy constructor. */
+				NodePool(const NodePool<T, MaxBlockSize> &) = delete;
+
+				/*! \brief Private assignment operator. */
+				NodePool<T, MaxBlockSize> &operator =(const NodePool<T, MaxBlockSize> &) = delete;
+
+			protected:
+				/*! \brief Storage for a single node, or a free list link once the node is released. */
+				union Slot
+				{
+					Slot *next;
+					alignas(T) unsigned char storage[sizeof(T)];
+				};
+
+				/*! \brief Header placed at the start of each block. */
+				struct Block
+				{
+					Block *next;
+					size_t size;
+				};
+
+				/*! \brief The alignment of each block. */
+				static constexpr size_t CacheLineSize = 64;
+
+				/*! \brief Offset of the first slot within a block. */
+				static constexpr size_t SlotOffset = (sizeof(Block) + alignof(Slot) - 1) & ~(alignof(Slot) - 1);
+
+				/*! \brief The size of the first block allocated. */
+				static constexpr size_t MinBlockSize = SlotOffset + sizeof(Slot) * 16 > 1024 ? SlotOffset + sizeof(Slot) * 16 : 1024;
+
+				/*! \brief The list of blocks owned by this pool, newest first. */
+				Block *m_blocks;
+
+				/*! \brief The oldest block, so adopt() can splice in O(1). */
+				Block *m_lastBlock;
+
+				/*! \brief Released slots available for reuse. */
+				Slot *m_freeList;
+
+				/*! \brief The last slot on the free list. Only meaningful while m_freeList is set. */
+				Slot *m_freeTail;
+
+				/*! \brief The next never-used slot in the newest block. */
+				Slot *m_cursor;
+
+				/*! \brief The end of the newest block. */
+				Slot *m_end;
+
+				/*! \brief The size of the next block to allocate. */
+				size_t m_nextBlockSize;
+
+				/*! \brief The number of nodes currently handed out. */
+				size_t m_used;
+
+				/*! \brief Allocates a fresh block and points the bump cursor at it. */
+				void grow()
+				{
+					size_t size = m_nextBlockSize;
+					Block *block = (Block *)::operator new(size, std::align_val_t(CacheLineSize));
+					block->next = m_blocks;
+					block->size = size;
+					if (!m_blocks)
+						m_lastBlock = block;
+					m_blocks = block;
+
+					m_cursor = (Slot *)((char *)block + SlotOffset);
+					m_end = m_cursor + (size - SlotOffset) / sizeof(Slot);
+
+					if (m_nextBlockSize < MaxBlockSize)
+						m_nextBlockSize *= 2;
+				}
+
+			public:
+				/*! \brief Whether nodes can be thrown away without running their destructors. */
+				static constexpr bool TrivialTeardown = std::is_trivially_destructible<T>::value;
+
+				/*! \brief The constructor. */
+				NodePool()
+					: m_blocks(nullptr), m_lastBlock(nullptr), m_freeList(nullptr), m_freeTail(nullptr),
+					m_cursor(nullptr), m_end(nullptr),
+					m_nextBlockSize(MinBlockSize), m_used(0)
+				{
+				}
+
+				/*! \brief The destructor. */
+				/*!
+				 * \warning Frees the pool's memory without destroying any nodes still in it.
+				 */
+				~NodePool()
+				{
+					release();
+				}
+
+				/*! \brief Gets uninitialized storage for one node. */
+				/*!
+				 * \return A pointer to storage suitably sized and aligned for T.
+				 */
+				cc_forceinline T *allocate()
+				{
+					Slot *slot;
+					if (m_freeList) {
+						slot = m_freeList;
+						m_freeList = slot->next;
+					} else {
+						if (cc_unlikely(m_cursor == m_end))
+							grow();
+						slot = m_cursor++;
+					}
+					m_used++;
+					return (T *)slot->storage;
+				}
+
+				/*! \brief Returns storage obtained with allocate() to the pool. */
+				/*!
+				 * \param _node The node storage. Must already be destroyed.
+				 */
+				cc_forceinline void deallocate(T *_node)
+				{
+					CoreAssert(m_used > 0);
+					Slot *slot = (Slot *)_node;
+					if (!m_freeList)
+						m_freeTail = slot;
+					slot->next = m_freeList;
+					m_freeList = slot;
+					m_used--;
+				}
+
+				/*! \brief Allocates and constructs a node. */
+				/*!
+				 * \param _args Arguments forwarded to T's constructor.
+				 * \return The new node.
+				 */
+				template <class ... Args>
+				cc_forceinline T *construct(Args && ... _args)
+				{
+					return new (allocate()) T(std::forward<Args>(_args) ...);
+				}
+
+				/*! \brief Destroys a node and returns its storage to the pool. */
+				/*!
+				 * \param _node The node to destroy.
+				 */
+				cc_forceinline void destroy(T *_node)
+				{
+					_node->~T();
+					deallocate(_node);
+				}
+
+				/*! \brief Destroys every node of a binary tree. */
+				/*!
+				 * Flattens the tree with right rotations as it goes, so it needs neither
+				 * recursion nor parent pointers, and copes with degenerate trees.
+				 * \param _root The root of the tree.
+				 * \param _nil The node used as the null leaf, if any.
+				 */
+				void destroyTree(T *_root, T *_nil = nullptr)
+				{
+					T *node = _root;
+					while (node && node != _nil) {
+						T *left = node->left;
+						if (left && left != _nil) {
+							node->left = left->right;
+							left->right = node;
+							node = left;
+						} else {
+							T *right = node->right;
+							node->left = nullptr;
+							node->right = nullptr;
+							destroy(node);
+							node = right;
+						}
+					}
+				}
+
+				/*! \brief Discards every node of a binary tree and frees the pool's memory. */
+				/*!
+				 * When T::TrivialTeardown is set the nodes aren't visited at all.
+				 * \param _root The root of the tree.
+				 * \param _nil The node used as the null leaf, if any.
+				 */
+				void releaseTree(T *_root, T *_nil = nullptr)
+				{
+					if (!T::TrivialTeardown)
+						destroyTree(_root, _nil);
+					release();
+				}
+
+				/*! \brief Frees all blocks at once. */
+				/*!
+				 * \warning Nodes still allocated from the pool are not destroyed. Use
+				 *    destroy() on them first unless TrivialTeardown is set.
+				 */
+				void release()
+				{
+					Block *block = m_blocks;
+					while (block) {
+						Block *next = block->next;
+						::operator delete((void *)block, std::align_val_t(CacheLineSize));
+						block = next;
+					}
+
+					m_blocks = m_lastBlock = nullptr;
+					m_freeList = m_freeTail = nullptr;
+					m_cursor = m_end = nullptr;
+					m_nextBlockSize = MinBlockSize;
+					m_used = 0;
+				}
+
+				/*! \brief Takes over every block of another pool. */
+				/*!
+				 * Nodes allocated from _other now belong to this pool and can be
+				 * destroyed through it. _other is left empty. Runs in constant time,
+				 * since both the block list and the free list are spliced at their
+				 * tails; the unused tail of _other's newest block is given up rather
+				 * than reused.
+				 * \param _other The pool to take the blocks from.
+				 */
+				void adopt(NodePool<T, MaxBlockSize> &_other)
+				{
+					if (&_other == this || !_other.m_blocks)
+						return;
+
+					_other.m_lastBlock->next = m_blocks;
+					if (!m_blocks)
+						m_lastBlock = _other.m_lastBlock;
+					m_blocks = _other.m_blocks;
+
+					if (_other.m_freeList) {
+						_other.m_freeTail->next = m_freeList;
+						if (!m_freeList)
+							m_freeTail = _other.m_freeTail;
+						m_freeList = _other.m_freeList;
+					}
+
+					m_used += _other.m_used;
+
+					_other.m_blocks = _other.m_lastBlock = nullptr;
+					_other.m_freeList = _other.m_freeTail = nullptr;
+					_other.m_cursor = _other.m_end = nullptr;
+					_other.m_nextBlockSize = MinBlockSize;
+					_other.m_used = 0;
+				}
+
+				/*! \brief Indicates the number of nodes currently allocated. */
+				/*!
+				 * \return Number of live nodes.
+				 */
+				inline size_t used() const
+				{
+					return m_used;
+				}
+
+				/*! \brief Returns the memory held by the pool. */
+				/*!
+				 * \return Memory usage in bytes.
+				 */
+				size_t mem_usage() const
+				{
+					size_t ret = 0;
+					for (Block *block = m_blocks; block; block = block->next)
+						ret += block->size;
+					return ret;
+				}
+		};
+	}
+}
+
+#endif
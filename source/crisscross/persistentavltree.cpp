@@ -0,0 +1,354 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_persistentavltree_h
+#error "This file shouldn't be compiled directly."
+#endif
+
+#include <crisscross/compare.h>
+#include <crisscross/persistentavltree.h>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		template <class Key, class Data, bool OwnsKeys>
+		PersistentAVLTree<Key, Data, OwnsKeys>::PersistentAVLTree()
+			: m_root(nullptr), m_size(0)
+		{
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		PersistentAVLTree<Key, Data, OwnsKeys>::PersistentAVLTree(const PersistentAVLTree<Key, Data, OwnsKeys> &_other)
+			: m_root(retain(_other.m_root)), m_size(_other.m_size)
+		{
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		PersistentAVLTree<Key, Data, OwnsKeys>::PersistentAVLTree(PersistentAVLTree<Key, Data, OwnsKeys> &&_other)
+			: m_root(_other.m_root), m_size(_other.m_size)
+		{
+			_other.m_root = nullptr;
+			_other.m_size = 0;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		PersistentAVLTree<Key, Data, OwnsKeys> &PersistentAVLTree<Key, Data, OwnsKeys>::operator =(const PersistentAVLTree<Key, Data, OwnsKeys> &_other)
+		{
+			Node *old = m_root;
+			m_root = retain(_other.m_root);
+			m_size = _other.m_size;
+			release(old);
+			return *this;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		PersistentAVLTree<Key, Data, OwnsKeys> &PersistentAVLTree<Key, Data, OwnsKeys>::operator =(PersistentAVLTree<Key, Data, OwnsKeys> &&_other)
+		{
+			if (this != &_other) {
+				release(m_root);
+				m_root = _other.m_root;
+				m_size = _other.m_size;
+				_other.m_root = nullptr;
+				_other.m_size = 0;
+			}
+			return *this;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		PersistentAVLTree<Key, Data, OwnsKeys>::~PersistentAVLTree()
+		{
+			release(m_root);
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		void PersistentAVLTree<Key, Data, OwnsKeys>::release(Node *_node)
+		{
+			while (_node && _node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				Node *right = _node->right;
+				release(_node->left);
+				delete _node;
+
+				/* Loop rather than recurse down one side */
+				_node = right;
+			}
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		typename PersistentAVLTree<Key, Data, OwnsKeys>::Node *PersistentAVLTree<Key, Data, OwnsKeys>::create(Key const &_key, Data const &_data, Node *_left, Node *_right)
+		{
+			Node *node = new Node();
+			if (OwnsKeys)
+				node->id = Duplicate(_key);
+			else
+				node->id = _key;
+			if (Node::SharesKeys)
+				node->keyRefs = new std::atomic<uint32_t>(1);
+			node->data = _data;
+			node->left = _left;
+			node->right = _right;
+
+			int left = height(_left), right = height(_right);
+			node->height = (unsigned char)(1 + (left > right ? left : right));
+			return node;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		typename PersistentAVLTree<Key, Data, OwnsKeys>::Node *PersistentAVLTree<Key, Data, OwnsKeys>::copy(const Node *_from, Data const &_data, Node *_left, Node *_right)
+		{
+			Node *node = new Node();
+			node->id = _from->id;
+			if (Node::SharesKeys) {
+				node->keyRefs = _from->keyRefs;
+				node->keyRefs->fetch_add(1, std::memory_order_relaxed);
+			}
+			node->data = _data;
+			node->left = _left;
+			node->right = _right;
+
+			int left = height(_left), right = height(_right);
+			node->height = (unsigned char)(1 + (left > right ? left : right));
+			return node;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		typename PersistentAVLTree<Key, Data, OwnsKeys>::Node *PersistentAVLTree<Key, Data, OwnsKeys>::balance(const Node *_from, Data const &_data, Node *_left, Node *_right)
+		{
+			int left = height(_left), right = height(_right);
+
+			if (left > right + 1) {
+				Node *ret;
+				if (height(_left->left) >= height(_left->right)) {
+					/* single rotation right */
+					ret = copy(_left, _left->data, retain(_left->left),
+					           copy(_from, _data, retain(_left->right), _right));
+				} else {
+					/* double rotation, left then right */
+					Node *pivot = _left->right;
+					ret = copy(pivot, pivot->data,
+					           copy(_left, _left->data, retain(_left->left), retain(pivot->left)),
+					           copy(_from, _data, retain(pivot->right), _right));
+				}
+				release(_left);
+				return ret;
+			}
+
+			if (right > left + 1) {
+				Node *ret;
+				if (height(_right->right) >= height(_right->left)) {
+					/* single rotation left */
+					ret = copy(_right, _right->data,
+					           copy(_from, _data, _left, retain(_right->left)),
+					           retain(_right->right));
+				} else {
+					/* double rotation, right then left */
+					Node *pivot = _right->left;
+					ret = copy(pivot, pivot->data,
+					           copy(_from, _data, _left, retain(pivot->left)),
+					           copy(_right, _right->data, retain(pivot->right), retain(_right->right)));
+				}
+				release(_right);
+				return ret;
+			}
+
+			return copy(_from, _data, _left, _right);
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		typename PersistentAVLTree<Key, Data, OwnsKeys>::Node *PersistentAVLTree<Key, Data, OwnsKeys>::insertNode(Node *_node, Key const &_key, Data const &_data)
+		{
+			if (!_node)
+				return create(_key, _data, nullptr, nullptr);
+
+			int cmp = Compare(_key, _node->id);
+			if (cmp < 0) {
+				Node *left = insertNode(_node->left, _key, _data);
+				if (!left)
+					return nullptr;
+				return balance(_node, _node->data, left, retain(_node->right));
+			} else if (cmp > 0) {
+				Node *right = insertNode(_node->right, _key, _data);
+				if (!right)
+					return nullptr;
+				return balance(_node, _node->data, retain(_node->left), right);
+			}
+
+			return nullptr;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		typename PersistentAVLTree<Key, Data, OwnsKeys>::Node *PersistentAVLTree<Key, Data, OwnsKeys>::replaceNode(Node *_node, Key const &_key, Data const &_data)
+		{
+			if (!_node)
+				return nullptr;
+
+			int cmp = Compare(_key, _node->id);
+			if (cmp < 0) {
+				Node *left = replaceNode(_node->left, _key, _data);
+				if (!left)
+					return nullptr;
+				return copy(_node, _node->data, left, retain(_node->right));
+			} else if (cmp > 0) {
+				Node *right = replaceNode(_node->right, _key, _data);
+				if (!right)
+					return nullptr;
+				return copy(_node, _node->data, retain(_node->left), right);
+			}
+
+			return copy(_node, _data, retain(_node->left), retain(_node->right));
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		typename PersistentAVLTree<Key, Data, OwnsKeys>::Node *PersistentAVLTree<Key, Data, OwnsKeys>::eraseMin(Node *_node)
+		{
+			if (!_node->left)
+				return retain(_node->right);
+
+			return balance(_node, _node->data, eraseMin(_node->left), retain(_node->right));
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		typename PersistentAVLTree<Key, Data, OwnsKeys>::Node *PersistentAVLTree<Key, Data, OwnsKeys>::eraseNode(Node *_node, Key const &_key, bool *_found)
+		{
+			if (!_node) {
+				*_found = false;
+				return nullptr;
+			}
+
+			int cmp = Compare(_key, _node->id);
+			if (cmp < 0) {
+				Node *left = eraseNode(_node->left, _key, _found);
+				if (!*_found)
+					return nullptr;
+				return balance(_node, _node->data, left, retain(_node->right));
+			} else if (cmp > 0) {
+				Node *right = eraseNode(_node->right, _key, _found);
+				if (!*_found)
+					return nullptr;
+				return balance(_node, _node->data, retain(_node->left), right);
+			}
+
+			*_found = true;
+			if (!_node->left)
+				return retain(_node->right);
+			if (!_node->right)
+				return retain(_node->left);
+
+			/* Pull the successor up into this position */
+			Node *successor = _node->right;
+			while (successor->left)
+				successor = successor->left;
+
+			return balance(successor, successor->data, retain(_node->left), eraseMin(_node->right));
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		typename PersistentAVLTree<Key, Data, OwnsKeys>::Node *PersistentAVLTree<Key, Data, OwnsKeys>::findNode(Key const &_key) const
+		{
+			Node *node = m_root;
+			while (node) {
+				int cmp = Compare(_key, node->id);
+				if (cmp < 0)
+					node = node->left;
+				else if (cmp > 0)
+					node = node->right;
+				else
+					return node;
+			}
+			return nullptr;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		template <class Visitor>
+		uint32_t PersistentAVLTree<Key, Data, OwnsKeys>::visitRange(const Node *_node, Key const &_lo, Key const &_hi, Visitor &_fn)
+		{
+			uint32_t count = 0;
+			while (_node) {
+				bool aboveLo = Compare(_node->id, _lo) >= 0;
+				bool belowHi = Compare(_node->id, _hi) < 0;
+				if (aboveLo && _node->left)
+					count += visitRange(_node->left, _lo, _hi, _fn);
+				if (aboveLo && belowHi) {
+					_fn(_node->id, _node->data);
+					count++;
+				}
+				if (!belowHi)
+					break;
+				_node = _node->right;
+			}
+			return count;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool PersistentAVLTree<Key, Data, OwnsKeys>::insert(Key const &_key, Data const &_rec)
+		{
+			Node *root = insertNode(m_root, _key, _rec);
+			if (!root)
+				return false;
+
+			release(m_root);
+			m_root = root;
+			m_size++;
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool PersistentAVLTree<Key, Data, OwnsKeys>::replace(Key const &_key, Data const &_rec)
+		{
+			Node *root = replaceNode(m_root, _key, _rec);
+			if (!root)
+				return false;
+
+			release(m_root);
+			m_root = root;
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool PersistentAVLTree<Key, Data, OwnsKeys>::erase(Key const &_key)
+		{
+			bool found = false;
+			Node *root = eraseNode(m_root, _key, &found);
+			if (!found)
+				return false;
+
+			release(m_root);
+			m_root = root;
+			m_size--;
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		template <class TypedData>
+		TypedData PersistentAVLTree<Key, Data, OwnsKeys>::find(Key const &_key, TypedData const &_default) const
+		{
+			Node *node = findNode(_key);
+			if (!node)
+				return _default;
+
+			return (TypedData)(node->data);
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		bool PersistentAVLTree<Key, Data, OwnsKeys>::exists(Key const &_key) const
+		{
+			return findNode(_key) != nullptr;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		void PersistentAVLTree<Key, Data, OwnsKeys>::empty()
+		{
+			release(m_root);
+			m_root = nullptr;
+			m_size = 0;
+		}
+	}
+}
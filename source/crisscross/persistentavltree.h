@@ -0,0 +1,345 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_persistentavltree_h
+#define __included_cc_persistentavltree_h
+
+#include <crisscross/cc_attr.h>
+#include <crisscross/internal_mem.h>
+#include <crisscross/compare.h>
+#include <crisscross/node.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		/*! \brief An AVL tree whose old versions stay valid after it is modified. */
+		/*!
+		 * Nodes are never changed once built. An insertion or deletion copies only
+		 * the O(log n) nodes on the path to the key, and the new version shares
+		 * every other subtree with the old one. Copying a tree is therefore O(1),
+		 * and a copy is a snapshot: later changes to either tree don't show up in
+		 * the other.
+		 *
+		 * Nodes are reference counted with atomic counters, so snapshots of the
+		 * same tree can be read and released from any number of threads without
+		 * further synchronization. A single tree object must still not be
+		 * modified by one thread while another uses it; hand each thread its own
+		 * copy, or publish versions through a SnapshotCell.
+		 *
+		 * Since nodes outlive the tree which built them, they come from the
+		 * global heap rather than a NodePool.
+		 */
+		template <class Key, class Data, bool OwnsKeys = true>
+		class PersistentAVLTree
+		{
+			protected:
+				/*! \brief The tree's node type. */
+				typedef PersistentAVLNode<Key, Data, OwnsKeys> Node;
+
+				/*! \brief The root node of this version of the tree. */
+				Node *m_root;
+
+				/*! \brief The number of keys in this version of the tree. */
+				uint32_t m_size;
+
+				/*! \brief Adds a reference to a node. */
+				static inline Node *retain(Node *_node)
+				{
+					if (_node)
+						_node->refs.fetch_add(1, std::memory_order_relaxed);
+					return _node;
+				}
+
+				/*! \brief Drops a reference to a node, freeing it and its unshared subtrees when it was the last. */
+				static void release(Node *_node);
+
+				/*! \brief Gets the height of a subtree. */
+				static inline int height(const Node *_node)
+				{
+					return _node ? _node->height : 0;
+				}
+
+				/*! \brief Builds a new node. */
+				/*!
+				 * \param _key The key for the node. It is duplicated if the tree owns its keys.
+				 * \param _data The data for the node.
+				 * \param _left The left subtree. The new node takes over the caller's reference.
+				 * \param _right The right subtree. The new node takes over the caller's reference.
+				 * \return The new node, holding one reference.
+				 */
+				static Node *create(Key const &_key, Data const &_data, Node *_left, Node *_right);
+
+				/*! \brief Builds a new node which shares the key of an existing one. */
+				/*!
+				 * Unlike create(), never duplicates the key, so rebuilding the path
+				 * to a change costs no key copies.
+				 * \param _from The node whose key to share.
+				 * \param _data The data for the node.
+				 * \param _left The left subtree. The new node takes over the caller's reference.
+				 * \param _right The right subtree. The new node takes over the caller's reference.
+				 * \return The new node, holding one reference.
+				 */
+				static Node *copy(const Node *_from, Data const &_data, Node *_left, Node *_right);
+
+				/*! \brief Builds a new node, rotating if the subtrees' heights differ by two. */
+				/*!
+				 * Takes the same parameters as copy(), and takes over the references to
+				 * _left and _right in the same way.
+				 * \return The root of the balanced subtree, holding one reference.
+				 */
+				static Node *balance(const Node *_from, Data const &_data, Node *_left, Node *_right);
+
+				/*! \brief Builds a copy of a subtree with a key added. */
+				/*!
+				 * \param _node The subtree to copy from. It isn't modified.
+				 * \param _key The key to add.
+				 * \param _data The data to add.
+				 * \return The new subtree, or nullptr if _key was already present.
+				 */
+				static Node *insertNode(Node *_node, Key const &_key, Data const &_data);
+
+				/*! \brief Builds a copy of a subtree with a key's data changed. */
+				/*!
+				 * \param _node The subtree to copy from. It isn't modified.
+				 * \param _key The key to change.
+				 * \param _data The new data.
+				 * \return The new subtree, or nullptr if _key wasn't present.
+				 */
+				static Node *replaceNode(Node *_node, Key const &_key, Data const &_data);
+
+				/*! \brief Builds a copy of a subtree with a key removed. */
+				/*!
+				 * \param _node The subtree to copy from. It isn't modified.
+				 * \param _key The key to remove.
+				 * \param _found Set to whether _key was present.
+				 * \return The new subtree, which may be empty. Meaningless if _key wasn't present.
+				 */
+				static Node *eraseNode(Node *_node, Key const &_key, bool *_found);
+
+				/*! \brief Builds a copy of a non-empty subtree with its smallest key removed. */
+				static Node *eraseMin(Node *_node);
+
+				/*! \brief Finds the node holding a key. */
+				Node *findNode(Key const &_key) const;
+
+				/*! \brief Recursively visits the keys of a subtree which are in [_lo, _hi). */
+				template <class Visitor>
+				static uint32_t visitRange(const Node *_node, Key const &_lo, Key const &_hi, Visitor &_fn);
+
+			public:
+				/*! \brief The constructor. */
+				PersistentAVLTree();
+
+				/*! \brief The copy constructor. */
+				/*!
+				 * Takes a snapshot of the other tree in O(1) time.
+				 */
+				PersistentAVLTree(const PersistentAVLTree<Key, Data, OwnsKeys> &_other);
+
+				/*! \brief The move constructor. */
+				PersistentAVLTree(PersistentAVLTree<Key, Data, OwnsKeys> &&_other);
+
+				/*! \brief The assignment operator. */
+				/*!
+				 * Replaces this tree with a snapshot of the other one in O(1) time.
+				 */
+				PersistentAVLTree<Key, Data, OwnsKeys> &operator =(const PersistentAVLTree<Key, Data, OwnsKeys> &_other);
+
+				/*! \brief The move assignment operator. */
+				PersistentAVLTree<Key, Data, OwnsKeys> &operator =(PersistentAVLTree<Key, Data, OwnsKeys> &&_other);
+
+				/*! \brief The destructor. */
+				~PersistentAVLTree();
+
+				/*! \brief Takes a snapshot of the tree. */
+				/*!
+				 * \return A tree with the current contents, unaffected by later changes to this one.
+				 */
+				inline PersistentAVLTree<Key, Data, OwnsKeys> snapshot() const
+				{
+					return *this;
+				}
+
+				/*! \brief Inserts data into the tree. */
+				/*!
+				 * Copies the O(log n) nodes on the path to the key. Snapshots taken
+				 * earlier are unaffected.
+				 * \param _key The key of the data.
+				 * \param _rec The data to insert.
+				 * \return True on success, false if the key was already in the tree.
+				 */
+				bool insert(Key const &_key, Data const &_rec);
+
+				/*! \brief Change the data at the given node. */
+				/*!
+				 * \param _key The key of the node to be modified.
+				 * \param _rec The data to insert.
+				 * \return True on success, false if the key isn't in the tree.
+				 */
+				bool replace(Key const &_key, Data const &_rec);
+
+				/*! \brief Deletes a node from the tree, specified by the node's key. */
+				/*!
+				 * \warning This won't free the memory occupied by the data, so the data must be freed separately.
+				 * \param _key The key of the node to delete.
+				 * \return True on success, false if the key isn't in the tree.
+				 */
+				bool erase(Key const &_key);
+
+				/*! \brief Finds a node in the tree and returns the data at that node. */
+				/*!
+				 * \param _key The key of the node to find.
+				 * \param _default The value to return if the item couldn't be found.
+				 * \return If found, returns the data at the node, otherwise _default is returned.
+				 */
+				template <class TypedData = Data>
+				TypedData find(Key const &_key, TypedData const &_default = nullptr) const;
+
+				/*! \brief Tests whether a key is in the tree or not. */
+				/*!
+				 * \param _key The key of the node to find.
+				 * \return True if the key is in the tree, false if not.
+				 */
+				bool exists(Key const &_key) const;
+
+				/*! \brief Empties the tree. */
+				/*!
+				 * Nodes still shared with snapshots are kept alive by them.
+				 * \warning This won't free the memory occupied by the data.
+				 */
+				void empty();
+
+				/*! \brief Indicates the size of the tree. */
+				/*!
+				 * \return Size of the tree.
+				 */
+				cc_forceinline uint32_t size() const
+				{
+					return m_size;
+				}
+
+				/*! \brief Tests whether two trees are the same version. */
+				/*!
+				 * \param _other The tree to compare with.
+				 * \return True if both trees share the same root, so neither has changed since one was copied from the other.
+				 */
+				inline bool same_version(const PersistentAVLTree<Key, Data, OwnsKeys> &_other) const
+				{
+					return m_root == _other.m_root;
+				}
+
+				/*! \brief Visits the keys in [_lo, _hi) in order. */
+				/*!
+				 * \param _lo The smallest key to visit.
+				 * \param _hi The key to stop at. It isn't visited.
+				 * \param _fn Called as _fn(key, data) for each key in the range.
+				 * \return The number of keys visited.
+				 */
+				template <class Visitor>
+				inline uint32_t for_each_in_range(Key const &_lo, Key const &_hi, Visitor _fn) const
+				{
+					return visitRange(m_root, _lo, _hi, _fn);
+				}
+		};
+
+		/*! \brief Hands out the latest version of a persistent tree to other threads. */
+		/*!
+		 * A writer builds a new version privately and store()s it. Readers load()
+		 * a snapshot and then read it for as long as they like without any
+		 * synchronization.
+		 *
+		 * Readers never block or take a lock: load() announces itself in one of
+		 * two reader counters, copies the published root and leaves again. A
+		 * writer swaps in the new version, then waits for both counters to drain
+		 * once before it frees the old version, so it only waits for loads which
+		 * were already in flight. Writers are serialized with each other.
+		 */
+		template <class Tree>
+		class SnapshotCell
+		{
+			private:
+				/*! \brief Private copy constructor. */
+				SnapshotCell(const SnapshotCell<Tree> &) = delete;
+
+				/*! \brief Private assignment operator. */
+				SnapshotCell<Tree> &operator =(const SnapshotCell<Tree> &) = delete;
+
+			protected:
+				/*! \brief The latest published version. */
+				std::atomic<Tree *> m_current;
+
+				/*! \brief Picks the counter which new readers announce themselves in. */
+				mutable std::atomic<unsigned int> m_epoch;
+
+				/*! \brief The number of loads in flight, by epoch parity. */
+				mutable std::atomic<unsigned int> m_readers[2];
+
+				/*! \brief Serializes writers. Readers never take it. */
+				std::mutex m_writeLock;
+
+			public:
+				/*! \brief The constructor. */
+				SnapshotCell()
+					: m_current(new Tree()), m_epoch(0)
+				{
+					m_readers[0] = 0;
+					m_readers[1] = 0;
+				}
+
+				/*! \brief The destructor. */
+				~SnapshotCell()
+				{
+					delete m_current.load();
+				}
+
+				/*! \brief Takes a snapshot of the latest published version. */
+				Tree load() const
+				{
+					std::atomic<unsigned int> &readers = m_readers[m_epoch.load() & 1];
+					readers.fetch_add(1);
+					Tree snapshot(*m_current.load());
+					readers.fetch_sub(1);
+					return snapshot;
+				}
+
+				/*! \brief Publishes a new version. */
+				/*!
+				 * \param _tree The version to publish. Readers which loaded an older
+				 *    version keep it until they drop their snapshot.
+				 */
+				void store(Tree const &_tree)
+				{
+					Tree *fresh = new Tree(_tree);
+					std::lock_guard<std::mutex> lock(m_writeLock);
+					Tree *old = m_current.exchange(fresh);
+
+					/* A reader may have picked its counter just before a flip, so drain both */
+					for (int pass = 0; pass < 2; pass++)
+					{
+						unsigned int epoch = m_epoch.fetch_add(1);
+						while (m_readers[epoch & 1].load() != 0)
+							std::this_thread::yield();
+					}
+
+					delete old;
+				}
+		};
+	}
+}
+
+#include <crisscross/persistentavltree.cpp>
+
+#endif
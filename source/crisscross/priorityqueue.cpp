@@ -0,0 +1,254 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_priorityqueue_h
+#error "This file shouldn't be compiled directly."
+#endif
+
+#include <utility>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		template <class Key, class Data, unsigned int Arity>
+		PriorityQueue<Key, Data, Arity>::PriorityQueue()
+		{
+		}
+
+		template <class Key, class Data, unsigned int Arity>
+		PriorityQueue<Key, Data, Arity>::~PriorityQueue()
+		{
+		}
+
+		template <class Key, class Data, unsigned int Arity>
+		void PriorityQueue<Key, Data, Arity>::siftUp(uint32_t _pos)
+		{
+			/* Carry the entry in a hole, rather than swapping at every level */
+			Key key = std::move(m_keys[_pos]);
+			Data data = std::move(m_data[_pos]);
+			Handle handle = m_handles[_pos];
+
+			while (_pos > 0) {
+				uint32_t parent = (_pos - 1) / Arity;
+				if (Compare(key, m_keys[parent]) >= 0)
+					break;
+				move(parent, _pos);
+				_pos = parent;
+			}
+
+			m_keys[_pos] = std::move(key);
+			m_data[_pos] = std::move(data);
+			m_handles[_pos] = handle;
+			m_positions[handle] = _pos;
+		}
+
+		template <class Key, class Data, unsigned int Arity>
+		void PriorityQueue<Key, Data, Arity>::siftDown(uint32_t _pos)
+		{
+			uint32_t count = size();
+			Key key = std::move(m_keys[_pos]);
+			Data data = std::move(m_data[_pos]);
+			Handle handle = m_handles[_pos];
+
+			while (true) {
+				uint32_t first = _pos * Arity + 1;
+				if (first >= count)
+					break;
+
+				uint32_t last = count - first < Arity ? count : first + Arity;
+				uint32_t best = first;
+				for (uint32_t child = first + 1; child < last; child++) {
+					if (Compare(m_keys[child], m_keys[best]) < 0)
+						best = child;
+				}
+
+				if (Compare(m_keys[best], key) >= 0)
+					break;
+
+				/* The next level's keys are all in one place, so start fetching them early */
+				uint32_t grandchild = best * Arity + 1;
+				if (grandchild < count)
+					cc_prefetch(&m_keys[grandchild]);
+
+				move(best, _pos);
+				_pos = best;
+			}
+
+			m_keys[_pos] = std::move(key);
+			m_data[_pos] = std::move(data);
+			m_handles[_pos] = handle;
+			m_positions[handle] = _pos;
+		}
+
+		template <class Key, class Data, unsigned int Arity>
+		typename PriorityQueue<Key, Data, Arity>::Handle PriorityQueue<Key, Data, Arity>::allocHandle()
+		{
+			if (!m_freeHandles.empty()) {
+				Handle handle = m_freeHandles.back();
+				m_freeHandles.pop_back();
+				return handle;
+			}
+
+			m_positions.push_back(InvalidHandle);
+			return (Handle)(m_positions.size() - 1);
+		}
+
+		template <class Key, class Data, unsigned int Arity>
+		void PriorityQueue<Key, Data, Arity>::removeAt(uint32_t _pos)
+		{
+			uint32_t last = size() - 1;
+			Handle handle = m_handles[_pos];
+
+			m_positions[handle] = InvalidHandle;
+			m_freeHandles.push_back(handle);
+
+			if (_pos != last)
+				move(last, _pos);
+
+			m_keys.pop_back();
+			m_data.pop_back();
+			m_handles.pop_back();
+
+			/* The last entry may belong above or below the hole it filled */
+			if (_pos < last) {
+				siftDown(_pos);
+				siftUp(_pos);
+			}
+		}
+
+		template <class Key, class Data, unsigned int Arity>
+		typename PriorityQueue<Key, Data, Arity>::Handle PriorityQueue<Key, Data, Arity>::push(Key const &_key, Data const &_data)
+		{
+			Handle handle = allocHandle();
+			uint32_t pos = size();
+
+			m_keys.push_back(_key);
+			m_data.push_back(_data);
+			m_handles.push_back(handle);
+			m_positions[handle] = pos;
+
+			siftUp(pos);
+			return handle;
+		}
+
+		template <class Key, class Data, unsigned int Arity>
+		Data PriorityQueue<Key, Data, Arity>::pop()
+		{
+			CoreAssert(!m_keys.empty());
+
+			Data ret = std::move(m_data[0]);
+			removeAt(0);
+			return ret;
+		}
+
+		template <class Key, class Data, unsigned int Arity>
+		bool PriorityQueue<Key, Data, Arity>::decrease_key(Handle _handle, Key const &_key)
+		{
+			if (!contains(_handle))
+				return false;
+
+			uint32_t pos = m_positions[_handle];
+			if (Compare(_key, m_keys[pos]) > 0)
+				return false;
+
+			m_keys[pos] = _key;
+			siftUp(pos);
+			return true;
+		}
+
+		template <class Key, class Data, unsigned int Arity>
+		bool PriorityQueue<Key, Data, Arity>::update_key(Handle _handle, Key const &_key)
+		{
+			if (!contains(_handle))
+				return false;
+
+			uint32_t pos = m_positions[_handle];
+			int cmp = Compare(_key, m_keys[pos]);
+			m_keys[pos] = _key;
+			if (cmp < 0)
+				siftUp(pos);
+			else if (cmp > 0)
+				siftDown(pos);
+			return true;
+		}
+
+		template <class Key, class Data, unsigned int Arity>
+		bool PriorityQueue<Key, Data, Arity>::erase(Handle _handle)
+		{
+			if (!contains(_handle))
+				return false;
+
+			removeAt(m_positions[_handle]);
+			return true;
+		}
+
+		template <class Key, class Data, unsigned int Arity>
+		bool PriorityQueue<Key, Data, Arity>::heapify(DArray<Key> const *_keys, DArray<Data> const *_data)
+		{
+			for (uint32_t i = 0; i < _keys->size(); i++) {
+				if (_keys->valid(i) && !_data->valid(i))
+					return false;
+			}
+
+			empty();
+			m_keys.reserve(_keys->used());
+			m_data.reserve(_keys->used());
+			m_handles.reserve(_keys->used());
+			m_positions.assign(_keys->size(), InvalidHandle);
+
+			/* Unused slots' handles are handed out by later pushes, lowest first */
+			for (uint32_t i = _keys->size(); i-- > 0;) {
+				if (!_keys->valid(i))
+					m_freeHandles.push_back(i);
+			}
+
+			for (uint32_t i = 0; i < _keys->size(); i++) {
+				if (!_keys->valid(i))
+					continue;
+				m_positions[i] = size();
+				m_keys.push_back((*_keys)[i]);
+				m_data.push_back((*_data)[i]);
+				m_handles.push_back(i);
+			}
+
+			/* Floyd's method: sift down every internal node, from the bottom up */
+			uint32_t count = size();
+			if (count > 1) {
+				for (uint32_t pos = (count - 2) / Arity + 1; pos-- > 0;)
+					siftDown(pos);
+			}
+
+			return true;
+		}
+
+		template <class Key, class Data, unsigned int Arity>
+		void PriorityQueue<Key, Data, Arity>::empty()
+		{
+			m_keys.clear();
+			m_data.clear();
+			m_handles.clear();
+			m_positions.clear();
+			m_freeHandles.clear();
+		}
+
+		template <class Key, class Data, unsigned int Arity>
+		size_t PriorityQueue<Key, Data, Arity>::mem_usage() const
+		{
+			return sizeof(*this) +
+			       m_keys.capacity() * sizeof(Key) +
+			       m_data.capacity() * sizeof(Data) +
+			       m_handles.capacity() * sizeof(Handle) +
+			       m_positions.capacity() * sizeof(uint32_t) +
+			       m_freeHandles.capacity() * sizeof(Handle);
+		}
+	}
+}
@@ -0,0 +1,258 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_priorityqueue_h
+#define __included_cc_priorityqueue_h
+
+#include <crisscross/cc_attr.h>
+#include <crisscross/compare.h>
+#include <crisscross/darray.h>
+#include <crisscross/debug.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		/*! \brief An indexed d-ary min-heap. */
+		/*!
+		 * Keeps the smallest key (by Compare) at the top. A wider heap is shallower
+		 * than a binary one, and since a node's children sit next to each other,
+		 * sifting down reads Arity keys from one or two cache lines per level. Keys
+		 * are stored apart from the data, so those reads only touch keys.
+		 *
+		 * Every push returns a Handle, which stays valid until the entry is popped
+		 * or erased, and can be used to change the entry's key or remove it. A
+		 * handle is reused once its entry leaves the queue.
+		 *
+		 * push, pop, erase and key changes all run in O(log n), and never allocate
+		 * once the queue has grown to its working size.
+		 */
+		template <class Key, class Data, unsigned int Arity = 4>
+		class PriorityQueue
+		{
+			static_assert(Arity >= 2, "PriorityQueue needs at least two children per node");
+
+			private:
+				/*! \brief Private copy constructor. */
+				/*!
+				 * If your code needs to invoke the copy constructor, you've probably written
+				 * the code wrong. A queue copy is generally unnecessary, and in cases that it
+				 * is, it can be achieved by other means.
+				 */
+				PriorityQueue(const PriorityQueue<Key, Data, Arity> &) = delete;
+
+				/*! \brief Private assignment operator. */
+				/*!
+				 * If your code needs to invoke the assignment operator, you've probably written
+				 * the code wrong. A queue copy is generally unnecessary, and in cases that it
+				 * is, it can be achieved by other means.
+				 */
+				PriorityQueue<Key, Data, Arity> &operator =(const PriorityQueue<Key, Data, Arity> &) = delete;
+
+			public:
+				/*! \brief Identifies an entry for as long as it is in the queue. */
+				typedef uint32_t Handle;
+
+				/*! \brief A handle which never refers to an entry. */
+				static constexpr Handle InvalidHandle = (Handle)-1;
+
+			protected:
+				/*! \brief The keys, in heap order. */
+				std::vector<Key> m_keys;
+
+				/*! \brief The data, at the same positions as the keys. */
+				std::vector<Data> m_data;
+
+				/*! \brief The handle of the entry at each position. */
+				std::vector<Handle> m_handles;
+
+				/*! \brief The position of each handle's entry, or InvalidHandle if it's not in use. */
+				std::vector<uint32_t> m_positions;
+
+				/*! \brief Handles which are free to be reused. */
+				std::vector<Handle> m_freeHandles;
+
+				/*! \brief Moves an entry up towards the top until its parent isn't larger. */
+				/*!
+				 * \param _pos The position of the entry.
+				 */
+				void siftUp(uint32_t _pos);
+
+				/*! \brief Moves an entry down until none of its children are smaller. */
+				/*!
+				 * \param _pos The position of the entry.
+				 */
+				void siftDown(uint32_t _pos);
+
+				/*! \brief Moves the entry at one position to another, updating its handle. */
+				cc_forceinline void move(uint32_t _from, uint32_t _to)
+				{
+					m_keys[_to] = std::move(m_keys[_from]);
+					m_data[_to] = std::move(m_data[_from]);
+					m_handles[_to] = m_handles[_from];
+					m_positions[m_handles[_to]] = _to;
+				}
+
+				/*! \brief Removes the entry at the given position. */
+				void removeAt(uint32_t _pos);
+
+				/*! \brief Gets a handle for a new entry. */
+				Handle allocHandle();
+
+			public:
+				/*! \brief The constructor. */
+				PriorityQueue();
+
+				/*! \brief The destructor. */
+				~PriorityQueue();
+
+				/*! \brief Adds an entry to the queue. */
+				/*!
+				 * \param _key The entry's priority. Smaller keys come out first.
+				 * \param _data The data to store with it.
+				 * \return The entry's handle.
+				 */
+				Handle push(Key const &_key, Data const &_data);
+
+				/*! \brief Removes the entry with the smallest key. */
+				/*!
+				 * \warning The queue must not be empty.
+				 * \return The data of the removed entry.
+				 */
+				Data pop();
+
+				/*! \brief Gets the data of the entry with the smallest key, without removing it. */
+				/*!
+				 * \warning The queue must not be empty.
+				 * \return The data of the smallest entry.
+				 */
+				inline Data const &top() const
+				{
+					CoreAssert(!m_keys.empty());
+					return m_data[0];
+				}
+
+				/*! \brief Gets the smallest key in the queue. */
+				/*!
+				 * \warning The queue must not be empty.
+				 * \return The smallest key.
+				 */
+				inline Key const &top_key() const
+				{
+					CoreAssert(!m_keys.empty());
+					return m_keys[0];
+				}
+
+				/*! \brief Gets the handle of the entry with the smallest key. */
+				/*!
+				 * \return The handle, or InvalidHandle if the queue is empty.
+				 */
+				inline Handle top_handle() const
+				{
+					return m_keys.empty() ? InvalidHandle : m_handles[0];
+				}
+
+				/*! \brief Tests whether a handle refers to an entry in the queue. */
+				/*!
+				 * \param _handle The handle to test.
+				 * \return True if the handle's entry is in the queue.
+				 */
+				inline bool contains(Handle _handle) const
+				{
+					return _handle < m_positions.size() && m_positions[_handle] != InvalidHandle;
+				}
+
+				/*! \brief Gets the key of an entry. */
+				/*!
+				 * \param _handle The entry's handle. It must be in the queue.
+				 * \return The entry's key.
+				 */
+				inline Key const &key(Handle _handle) const
+				{
+					CoreAssert(contains(_handle));
+					return m_keys[m_positions[_handle]];
+				}
+
+				/*! \brief Gets the data of an entry. */
+				/*!
+				 * \param _handle The entry's handle. It must be in the queue.
+				 * \return The entry's data.
+				 */
+				inline Data &data(Handle _handle)
+				{
+					CoreAssert(contains(_handle));
+					return m_data[m_positions[_handle]];
+				}
+
+				/*! \brief Lowers an entry's key, moving it towards the top. */
+				/*!
+				 * \param _handle The entry's handle.
+				 * \param _key The new key. It must not be larger than the old one.
+				 * \return True on success, false if the handle isn't in the queue or the key is larger.
+				 */
+				bool decrease_key(Handle _handle, Key const &_key);
+
+				/*! \brief Changes an entry's key, in either direction. */
+				/*!
+				 * \param _handle The entry's handle.
+				 * \param _key The new key.
+				 * \return True on success, false if the handle isn't in the queue.
+				 */
+				bool update_key(Handle _handle, Key const &_key);
+
+				/*! \brief Removes an entry from the queue. */
+				/*!
+				 * \param _handle The entry's handle.
+				 * \return True on success, false if the handle isn't in the queue.
+				 */
+				bool erase(Handle _handle);
+
+				/*! \brief Replaces the queue's contents with unordered data, in linear time. */
+				/*!
+				 * Cheaper than pushing the entries one at a time. The entry at index i of
+				 * the arrays gets handle i.
+				 * \param _keys The keys, in any order.
+				 * \param _data The data for each key, at the same indices.
+				 * \return True on success, false if some key has no data. On failure, the
+				 *    queue is left unchanged.
+				 */
+				bool heapify(DArray<Key> const *_keys, DArray<Data> const *_data);
+
+				/*! \brief Removes every entry from the queue. */
+				/*!
+				 * \warning This won't free the memory occupied by the data, so the data must be freed separately.
+				 */
+				void empty();
+
+				/*! \brief Indicates the number of entries in the queue. */
+				/*!
+				 * \return Number of entries in the queue.
+				 */
+				inline uint32_t size() const
+				{
+					return (uint32_t)m_keys.size();
+				}
+
+				/*! \brief Returns the memory usage of the queue. */
+				/*!
+				 * \return Memory usage in bytes.
+				 */
+				size_t mem_usage() const;
+		};
+	}
+}
+
+#include <crisscross/priorityqueue.cpp>
+
+#endif
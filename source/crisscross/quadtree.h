@@ -12,13 +12,29 @@
 #ifndef __included_cc_quadtree_h
 #define __included_cc_quadtree_h
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <vector>
 #include <functional>
 
 #include <crisscross/cc_attr.h>
 #include <crisscross/compare.h>
+#include <crisscross/nodepool.h>
 #include <crisscross/vec2.h>
 
+#if defined(__AVX2__)
+#define CC_QUADTREE_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CC_QUADTREE_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 #if __cplusplus >= 202002L || __cpp_generic_lambdas >= 201707
 #define QUADTREE_SEARCH_CALLBACK_SUPPORTED
 #endif
@@ -68,6 +84,118 @@ namespace CrissCross
 		using QuadtreeSearchFunction = std::function<QuadtreeCallbackResponse (T const &)>;
 #endif
 
+		/*! @cond */
+		/*
+		 * Tests up to eight objects against a circle at once, and returns one
+		 * bit per object which touches it. The objects' fields are read from
+		 * separate arrays, so each one is a single vector load.
+		 */
+		static inline uint32_t QtCircleHits(const float *xs, const float *ys, const float *radii, uint32_t count, float x, float y, float radius)
+		{
+#if defined(CC_QUADTREE_AVX2)
+			if (count == 8) {
+				__m256 dx = _mm256_sub_ps(_mm256_set1_ps(x), _mm256_loadu_ps(xs));
+				__m256 dy = _mm256_sub_ps(_mm256_set1_ps(y), _mm256_loadu_ps(ys));
+				__m256 reach = _mm256_add_ps(_mm256_set1_ps(radius), _mm256_loadu_ps(radii));
+				__m256 distance = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+				return (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(distance, _mm256_mul_ps(reach, reach), _CMP_LE_OQ));
+			}
+#elif defined(CC_QUADTREE_SSE2)
+			if (count == 8) {
+				uint32_t hits = 0;
+				for (int half = 0; half < 8; half += 4) {
+					__m128 dx = _mm_sub_ps(_mm_set1_ps(x), _mm_loadu_ps(xs + half));
+					__m128 dy = _mm_sub_ps(_mm_set1_ps(y), _mm_loadu_ps(ys + half));
+					__m128 reach = _mm_add_ps(_mm_set1_ps(radius), _mm_loadu_ps(radii + half));
+					__m128 distance = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+					hits |= (uint32_t)_mm_movemask_ps(_mm_cmple_ps(distance, _mm_mul_ps(reach, reach))) << half;
+				}
+				return hits;
+			}
+#endif
+			uint32_t hits = 0;
+			for (uint32_t i = 0; i < count; i++) {
+				float dx = x - xs[i],
+				      dy = y - ys[i],
+				      reach = radius + radii[i];
+				if (dx * dx + dy * dy <= reach * reach)
+					hits |= 1U << i;
+			}
+			return hits;
+		}
+
+		/*
+		 * Tests up to eight objects against an axis-aligned rectangle at once,
+		 * by the distance from each object's centre to the nearest point of the
+		 * rectangle.
+		 */
+		static inline uint32_t QtRectHits(const float *xs, const float *ys, const float *radii, uint32_t count, float minX, float minY, float maxX, float maxY)
+		{
+#if defined(CC_QUADTREE_AVX2)
+			if (count == 8) {
+				__m256 x = _mm256_loadu_ps(xs), y = _mm256_loadu_ps(ys), zero = _mm256_setzero_ps();
+				__m256 dx = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_set1_ps(minX), x), _mm256_sub_ps(x, _mm256_set1_ps(maxX))), zero);
+				__m256 dy = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_set1_ps(minY), y), _mm256_sub_ps(y, _mm256_set1_ps(maxY))), zero);
+				__m256 radius = _mm256_loadu_ps(radii);
+				__m256 distance = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+				return (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(distance, _mm256_mul_ps(radius, radius), _CMP_LE_OQ));
+			}
+#elif defined(CC_QUADTREE_SSE2)
+			if (count == 8) {
+				uint32_t hits = 0;
+				for (int half = 0; half < 8; half += 4) {
+					__m128 x = _mm_loadu_ps(xs + half), y = _mm_loadu_ps(ys + half), zero = _mm_setzero_ps();
+					__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(minX), x), _mm_sub_ps(x, _mm_set1_ps(maxX))), zero);
+					__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(minY), y), _mm_sub_ps(y, _mm_set1_ps(maxY))), zero);
+					__m128 radius = _mm_loadu_ps(radii + half);
+					__m128 distance = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+					hits |= (uint32_t)_mm_movemask_ps(_mm_cmple_ps(distance, _mm_mul_ps(radius, radius))) << half;
+				}
+				return hits;
+			}
+#endif
+			uint32_t hits = 0;
+			for (uint32_t i = 0; i < count; i++) {
+				float dx = std::max(std::max(minX - xs[i], xs[i] - maxX), 0.0f),
+				      dy = std::max(std::max(minY - ys[i], ys[i] - maxY), 0.0f);
+				if (dx * dx + dy * dy <= radii[i] * radii[i])
+					hits |= 1U << i;
+			}
+			return hits;
+		}
+
+		static inline unsigned int QtFirstBit(uint32_t _mask)
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward(&index, _mask);
+			return index;
+#else
+			return __builtin_ctz(_mask);
+#endif
+		}
+		/*! @endcond */
+
+		/*! \brief A quadtree for finding objects near a point. */
+		/*!
+		 * Each square of the tree splits into four once it holds more than
+		 * MaxNodesPerLevel objects, down to MaxDepth levels. An object which
+		 * crosses the middle of a square stays in that square instead of
+		 * going into one of its quarters.
+		 *
+		 * The four quarters of a square are allocated together from a NodePool,
+		 * stored in Morton (Z) order: lower left, lower right, upper left, upper
+		 * right. The objects themselves all live in one set of arrays, and each
+		 * square refers to a range of them, so splitting and merging squares only
+		 * moves objects around inside those arrays. A square whose range fills up
+		 * moves it to the end. Once the gaps left behind outnumber the objects,
+		 * the arrays are rewritten square by square in Z-order, which keeps
+		 * objects that are close together in space close together in memory.
+		 *
+		 * Positions, radii and data are kept in separate arrays, so a search
+		 * tests eight objects at a time with AVX2 or SSE2 where they're
+		 * available, and only reads the data of objects it hits.
+		 */
 		template <class T,
 		          class VectorType,
 		          int MaxDepth = 7,
@@ -75,25 +203,203 @@ namespace CrissCross
 		class Quadtree final
 		{
 			protected:
-				using nodetype_t = QtNode<T, VectorType>;
+				struct Quad;
 
-				VectorType llPosition;
-				VectorType trPosition;
-				int descentLevel;
-				Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel> *ll;
-				Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel> *lr;
-				Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel> *tl;
-				Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel> *tr;
-				std::vector<nodetype_t> nodes;
+				/* A square of the tree. Its objects are at [first, first + count) in the arrays. */
+				struct Cell
+				{
+					float minX, minY, maxX, maxY;
+					Quad *children;
+					uint32_t first;
+					uint32_t count;
+					uint32_t capacity;
+					int descentLevel;
+				};
 
-				/* Constructor for deeper levels */
-				Quadtree(VectorType const &lower_left, VectorType const &upper_right, int _descentLevel);
+				/* The four quarters of a square, in Morton order */
+				struct Quad
+				{
+					Cell cells[4];
+				};
+
+				/* The objects, one array per field */
+				struct Items
+				{
+					std::vector<float> xs;
+					std::vector<float> ys;
+					std::vector<float> radii;
+					std::vector<T> data;
+
+					inline size_t size() const
+					{
+						return xs.size();
+					}
+
+					/* Makes room for _size objects, growing geometrically */
+					void reserve(size_t _size)
+					{
+						if (xs.capacity() >= _size)
+							return;
+						size_t capacity = std::max(_size, xs.capacity() * 2);
+						xs.reserve(capacity);
+						ys.reserve(capacity);
+						radii.reserve(capacity);
+						data.reserve(capacity);
+					}
+
+					void push_back(float _x, float _y, float _radius, T const &_object)
+					{
+						xs.push_back(_x);
+						ys.push_back(_y);
+						radii.push_back(_radius);
+						data.push_back(_object);
+					}
+
+					/* The arrays must have room, if _from is this */
+					void push_back(Items const &_from, size_t _index)
+					{
+						push_back(_from.xs[_index], _from.ys[_index], _from.radii[_index], _from.data[_index]);
+					}
+
+					void fill(size_t _count, float _x, float _y, float _radius, T const &_object)
+					{
+						xs.insert(xs.end(), _count, _x);
+						ys.insert(ys.end(), _count, _y);
+						radii.insert(radii.end(), _count, _radius);
+						data.insert(data.end(), _count, _object);
+					}
+
+					void set(size_t _index, float _x, float _y, float _radius, T const &_object)
+					{
+						xs[_index] = _x;
+						ys[_index] = _y;
+						radii[_index] = _radius;
+						data[_index] = _object;
+					}
+
+					void swap(size_t _a, size_t _b)
+					{
+						std::swap(xs[_a], xs[_b]);
+						std::swap(ys[_a], ys[_b]);
+						std::swap(radii[_a], radii[_b]);
+						std::swap(data[_a], data[_b]);
+					}
+
+					void swap(Items &_other)
+					{
+						xs.swap(_other.xs);
+						ys.swap(_other.ys);
+						radii.swap(_other.radii);
+						data.swap(_other.data);
+					}
+
+					void clear()
+					{
+						xs.clear();
+						ys.clear();
+						radii.clear();
+						data.clear();
+					}
+				};
+
+				/* A square waiting to be searched, and the area its objects can be in */
+				struct Frontier
+				{
+					float distance;
+					Cell const *cell;
+					float minX, minY, maxX, maxY;
+					/* Only the square's own objects are left to search */
+					bool objectsOnly;
+				};
+
+				/* A square a ray enters, or with no square, an object it hits, and how far along the ray */
+				struct RayStep
+				{
+					float distance;
+					Cell const *cell;
+					uint32_t object;
+					float minX, minY, maxX, maxY;
+				};
+
+				/* Heap order for a ray: the nearest on top, and objects before squares at the same distance */
+				struct RayOrder
+				{
+					inline bool operator()(RayStep const &a, RayStep const &b) const
+					{
+						if (a.distance != b.distance)
+							return a.distance > b.distance;
+						return a.cell && !b.cell;
+					}
+				};
+
+				/* Heap order for the frontier: the nearest on top, and the deepest of those at the same distance */
+				struct SearchLater
+				{
+					inline bool operator()(Frontier const &a, Frontier const &b) const
+					{
+						if (a.distance != b.distance)
+							return a.distance > b.distance;
+						return a.cell->descentLevel > b.cell->descentLevel;
+					}
+				};
+
+				/* One of the nearest objects found so far */
+				struct Neighbour
+				{
+					float distance;
+					T object;
+				};
+
+				/* Heap order for the objects found: the farthest on top */
+				struct Nearer
+				{
+					inline bool operator()(Neighbour const &a, Neighbour const &b) const
+					{
+						return a.distance < b.distance;
+					}
+				};
+
+				Cell root;
+				NodePool<Quad> quads;
+				Items items;
+				Items spare;
+				size_t itemCount;
+				size_t gapCount;
 
 				static constexpr bool InRange(float lower_bound, float upper_bound, float point);
-				static constexpr bool CircleCollision(VectorType circle1, float radius1, VectorType circle2, float radius2);
 
-				void Descend();
-				void Ascend();
+				static void InitCell(Cell &cell, float minX, float minY, float maxX, float maxY, int descentLevel);
+				static int Quadrant(Cell const &cell, float x, float y, float radius);
+				static bool IsEmpty(Cell const &cell, bool _childOnly);
+				static float MinDistance(Frontier const &area, float x, float y);
+				static bool RayEntry(RayStep const &area, float x, float y, float dx, float dy, float maxDistance, float &entry);
+				static bool Report(std::vector<T> &array, T const &object, size_t maxResults
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+				                   , QuadtreeSearchFunction<T> const &pretest
+				                   , QuadtreeSearchFunction<T> const &matchtest
+#endif
+				                   );
+
+				void Append(Cell &cell, float x, float y, float radius, T const &_object);
+				void Descend(Cell &cell);
+				void Ascend(Cell &cell);
+				void FreeChildren(Cell &cell);
+				void CompactCell(Cell &cell);
+				bool RemoveObject(Cell &cell, T const &_object, VectorType const &position, float radius);
+				bool SearchCircle(Cell const &cell, std::vector<T> &array, VectorType const &circle, float radius, size_t maxResults
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+				                  , QuadtreeSearchFunction<T> const &pretest
+				                  , QuadtreeSearchFunction<T> const &matchtest
+#endif
+				                  ) const;
+				bool SearchRect(Cell const &cell, std::vector<T> &array, float minX, float minY, float maxX, float maxY, size_t maxResults
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+				                , QuadtreeSearchFunction<T> const &pretest
+				                , QuadtreeSearchFunction<T> const &matchtest
+#endif
+				                ) const;
+				void Collect(Cell const &cell, std::vector<T> & _elements, uint32_t &maxDepthSeen, uint32_t &maxNodesSeen, uint32_t currentDepth) const;
+				void CollectStats(Cell const &cell, std::vector<QtStats<VectorType> > &rects, uint32_t currentDepth) const;
 			public:
 #ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
 				using predicate_t = QuadtreeSearchFunction<T>;
@@ -106,6 +412,14 @@ namespace CrissCross
 				bool IsEmpty(bool _childOnly);
 				void InsertObject(T const &_object, VectorType const &position, float _collisionRadius);
 				bool RemoveObject(T const &_object, VectorType const &position, float _collisionRadius);
+
+				/*! \brief Finds the objects which touch a circle. */
+				/*!
+				 * Objects are tested against the circle first, and pretest and matchtest
+				 * are only called for the ones which touch it. pretest can reject an
+				 * object, and matchtest decides whether it's accepted and whether the
+				 * search goes on.
+				 */
 				QuadtreeSearchResult ObjectsInCircle(std::vector<T> &array, VectorType const &circle, float radius, size_t maxResults
 #ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
 				                                     , predicate_t pretest
@@ -113,6 +427,88 @@ namespace CrissCross
 #endif
 				                                     ) const;
 
+				/*! \brief Finds the objects which touch an axis-aligned rectangle. */
+				/*!
+				 * The same as ObjectsInCircle, but for the rectangle between lower_left
+				 * and upper_right, such as a viewport.
+				 */
+				QuadtreeSearchResult ObjectsInRect(std::vector<T> &array, VectorType const &lower_left, VectorType const &upper_right, size_t maxResults
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+				                                   , predicate_t pretest
+				                                   , predicate_t matchtest
+#endif
+				                                   ) const;
+
+				/*! \brief Finds the objects a ray hits, nearest first. */
+				/*!
+				 * Squares are visited in the order the ray enters them, and each object
+				 * is passed to pretest and matchtest in the order the ray hits it, so a
+				 * search which stops early never visits squares farther along the ray.
+				 * An object whose circle holds the origin is hit at distance zero.
+				 *
+				 * \param array The objects hit are appended here, nearest first.
+				 * \param origin Where the ray starts.
+				 * \param direction Which way the ray goes. It doesn't need to be normalized.
+				 * \param maxDistance How far the ray goes.
+				 * \param maxResults The most objects to find, when there's no matchtest to stop the search.
+				 */
+				QuadtreeSearchResult RayCast(std::vector<T> &array, VectorType const &origin, VectorType const &direction, float maxDistance, size_t maxResults
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+				                             , predicate_t pretest
+				                             , predicate_t matchtest
+#endif
+				                             ) const;
+
+				/*! \brief Tests whether any object touches a line segment. */
+				/*!
+				 * A ray cast from _from which stops at the first hit, for line of sight
+				 * tests. Objects pretest rejects don't count.
+				 */
+				bool SegmentIntersects(VectorType const &_from, VectorType const &_to
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+				                       , predicate_t pretest
+#endif
+				                       ) const;
+
+				/*! \brief Finds the k objects nearest to a point. */
+				/*!
+				 * Distances are measured to the edge of each object's collision circle,
+				 * so an object whose circle covers the point is at distance zero. The
+				 * tree is searched nearest square first, and squares which are farther
+				 * away than the k nearest objects found so far are skipped.
+				 *
+				 * pretest is only called for objects which are nearer than the ones
+				 * found so far, and objects it rejects are passed over.
+				 *
+				 * \param array The objects found are appended here, nearest first.
+				 * \param point The point to search around.
+				 * \param k The most objects to find.
+				 */
+				QuadtreeSearchResult NearestK(std::vector<T> &array, VectorType const &point, size_t k
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+				                              , predicate_t pretest
+#endif
+				                              ) const;
+
+				/*! \brief Finds the object nearest to a point. */
+				/*!
+				 * The same as NearestK with k of one.
+				 * \param _object Set to the object found, if there is one.
+				 * \param point The point to search around.
+				 */
+				QuadtreeSearchResult Nearest(T &_object, VectorType const &point
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+				                             , predicate_t pretest
+#endif
+				                             ) const;
+
+				/*! \brief Rewrites the object arrays in Z-order, closing the gaps. */
+				/*!
+				 * This happens on its own as the tree changes, but it's worth calling
+				 * after loading a scene which won't change much afterwards.
+				 */
+				void Compact();
+
 				void Collect(std::vector<T> & _elements, uint32_t &maxDepthSeen, uint32_t &maxNodesSeen, uint32_t currentDepth = 0);
 				void CollectStats(std::vector<statstype_t> &rects, uint32_t currentDepth = 0);
 		};
@@ -120,36 +516,44 @@ namespace CrissCross
 		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
 		void Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::Collect(std::vector<T> & _elements, uint32_t &maxDepthSeen, uint32_t &maxNodesSeen, uint32_t currentDepth)
 		{
-			if (nodes.size() > maxNodesSeen)
-				maxNodesSeen = nodes.size();
+			Collect(root, _elements, maxDepthSeen, maxNodesSeen, currentDepth);
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		void Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::Collect(Cell const &cell, std::vector<T> & _elements, uint32_t &maxDepthSeen, uint32_t &maxNodesSeen, uint32_t currentDepth) const
+		{
+			if (cell.count > maxNodesSeen)
+				maxNodesSeen = cell.count;
 			if (currentDepth > maxDepthSeen)
 				maxDepthSeen = currentDepth;
-			for (auto & elem : nodes) {
-				_elements.push_back(elem.data);
+			for (uint32_t i = 0; i < cell.count; i++) {
+				_elements.push_back(items.data[cell.first + i]);
 			}
-			if (!ll)
+			if (!cell.children)
 				return;
-			ll->Collect(_elements, maxDepthSeen, maxNodesSeen, currentDepth + 1);
-			lr->Collect(_elements, maxDepthSeen, maxNodesSeen, currentDepth + 1);
-			tl->Collect(_elements, maxDepthSeen, maxNodesSeen, currentDepth + 1);
-			tr->Collect(_elements, maxDepthSeen, maxNodesSeen, currentDepth + 1);
+			for (int q = 0; q < 4; q++)
+				Collect(cell.children->cells[q], _elements, maxDepthSeen, maxNodesSeen, currentDepth + 1);
 		}
 
 		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
 		void Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::CollectStats(std::vector<statstype_t> &_rects, uint32_t currentDepth)
+		{
+			CollectStats(root, _rects, currentDepth);
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		void Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::CollectStats(Cell const &cell, std::vector<statstype_t> &_rects, uint32_t currentDepth) const
 		{
 			statstype_t rect;
-			rect.pos_ll = llPosition;
-			rect.pos_tr = trPosition;
+			rect.pos_ll = VectorType(cell.minX, cell.minY);
+			rect.pos_tr = VectorType(cell.maxX, cell.maxY);
 			rect.depth = currentDepth;
-			rect.elements = nodes.size();
+			rect.elements = cell.count;
 			_rects.push_back(rect);
-			if (!ll)
+			if (!cell.children)
 				return;
-			ll->CollectStats(_rects, currentDepth + 1);
-			lr->CollectStats(_rects, currentDepth + 1);
-			tl->CollectStats(_rects, currentDepth + 1);
-			tr->CollectStats(_rects, currentDepth + 1);
+			for (int q = 0; q < 4; q++)
+				CollectStats(cell.children->cells[q], _rects, currentDepth + 1);
 		}
 
 		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
@@ -159,12 +563,127 @@ namespace CrissCross
 		}
 
 		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
-		constexpr bool Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::CircleCollision(VectorType circle1, float radius1, VectorType circle2, float radius2)
+		void Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::InitCell(Cell &cell, float minX, float minY, float maxX, float maxY, int descentLevel)
+		{
+			cell.minX = minX;
+			cell.minY = minY;
+			cell.maxX = maxX;
+			cell.maxY = maxY;
+			cell.children = nullptr;
+			cell.first = 0;
+			cell.count = 0;
+			cell.capacity = 0;
+			cell.descentLevel = descentLevel;
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		int Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::Quadrant(Cell const &cell, float x, float y, float radius)
+		{
+			float midX = (cell.minX + cell.maxX) * 0.5f,
+			      midY = (cell.minY + cell.maxY) * 0.5f;
+
+			if (InRange(x - radius, x + radius, midX) ||
+			    InRange(y - radius, y + radius, midY)) {
+				/*
+				 * Crosses the border between quarters, so it belongs to this
+				 * square instead of a smaller one.
+				 */
+				return -1;
+			}
+
+			return (x > midX ? 1 : 0) | (y > midY ? 2 : 0);
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		void Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::Append(Cell &cell, float x, float y, float radius, T const &_object)
+		{
+			if (cell.count == cell.capacity) {
+				/*
+				 * Move the square's range to the end of the arrays, with room to grow.
+				 * A leaf which can still split never holds more than MaxNodesPerLevel.
+				 */
+				uint32_t capacity = cell.capacity ? cell.capacity * 2 : 4;
+				if (!cell.children && cell.descentLevel > 0 && capacity < MaxNodesPerLevel)
+					capacity = MaxNodesPerLevel;
+				size_t first = items.size();
+				items.reserve(first + capacity);
+				for (uint32_t i = 0; i < cell.count; i++)
+					items.push_back(items, cell.first + i);
+				items.fill(capacity - cell.count, x, y, radius, _object);
+				gapCount += cell.capacity;
+				cell.first = (uint32_t)first;
+				cell.capacity = capacity;
+			}
+
+			items.set(cell.first + cell.count++, x, y, radius, _object);
+			itemCount++;
+
+			if (gapCount > itemCount + MaxNodesPerLevel * 4)
+				Compact();
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		void Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::Compact()
+		{
+			spare.clear();
+			CompactCell(root);
+			items.swap(spare);
+			gapCount = 0;
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		void Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::CompactCell(Cell &cell)
+		{
+			/* Leave some room to grow, so the next insert doesn't move the range again */
+			uint32_t capacity = cell.count + cell.count / 2;
+			if (!cell.children && cell.descentLevel > 0 && capacity > MaxNodesPerLevel)
+				capacity = MaxNodesPerLevel > cell.count ? MaxNodesPerLevel : cell.count;
+
+			uint32_t first = (uint32_t)spare.size();
+			for (uint32_t i = 0; i < cell.count; i++)
+				spare.push_back(items, cell.first + i);
+			if (cell.count)
+				spare.fill(capacity - cell.count, items.xs[cell.first], items.ys[cell.first], items.radii[cell.first], items.data[cell.first]);
+			cell.first = first;
+			cell.capacity = cell.count ? capacity : 0;
+
+			if (!cell.children)
+				return;
+			for (int q = 0; q < 4; q++)
+				CompactCell(cell.children->cells[q]);
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		bool Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::Report(std::vector<T> &array, T const &object, size_t maxResults
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+		                                                                 , predicate_t const &pretest
+		                                                                 , predicate_t const &matchtest
+#endif
+		                                                                 )
 		{
-			VectorType diff = circle1 - circle2;
-			float maximumDistanceSquared = (radius1 + radius2) * (radius1 + radius2);
-			float actualDistanceSquared = diff.x * diff.x + diff.y * diff.y;
-			return actualDistanceSquared <= maximumDistanceSquared;
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+			/* The callbacks decide when to stop instead */
+			(void)maxResults;
+
+			if (pretest(object) == QuadtreeCallbackResponse::REJECT)
+				return false;
+
+			QuadtreeCallbackResponse response = matchtest(object);
+
+			if (response == QuadtreeCallbackResponse::ACCEPT ||
+			    response == QuadtreeCallbackResponse::ACCEPT_AND_STOP) {
+				array.push_back(object);
+			}
+			if (response == QuadtreeCallbackResponse::STOP_ITERATION ||
+			    response == QuadtreeCallbackResponse::ACCEPT_AND_STOP ||
+			    response == QuadtreeCallbackResponse::REJECT_AND_STOP) {
+				return true;
+			}
+			return false;
+#else
+			array.push_back(object);
+			return array.size() >= maxResults;
+#endif
 		}
 
 		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
@@ -175,100 +694,271 @@ namespace CrissCross
 #endif
 		                                                                                          ) const
 		{
-			/* find objects stored in this quadtree */
-			for (typename std::vector<nodetype_t>::const_iterator i = nodes.begin();
-			     i != nodes.end();
-			     i++) {
-				nodetype_t const &node = *i;
+			if (SearchCircle(root, array, circle, radius, maxResults
 #ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
-				QuadtreeCallbackResponse response = pretest(node.data);
-#else
-				QuadtreeCallbackResponse response = QuadtreeCallbackResponse::ACCEPT;
+			                 , pretest, matchtest
 #endif
+			                 ))
+				return QuadtreeSearchResult::ABORTED;
 
-				/* Do early test for criteria match/mismatch, which should be cheaper than the circle collision test */
-				bool testCollision = response != QuadtreeCallbackResponse::REJECT;
+			if (array.size() > 0)
+				return QuadtreeSearchResult::SUCCESS;
+			else
+				return QuadtreeSearchResult::NOT_FOUND;
+		}
 
-				/* If the early check didn't explicitly reject it, test for circle collision. */
-				if (testCollision && CircleCollision(circle, radius, node.pos, node.collisionRadius)) {
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		bool Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::SearchCircle(Cell const &cell, std::vector<T> &array, VectorType const &circle, float radius, size_t maxResults
 #ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
-					response = matchtest(node.data);
-
-					if (response == QuadtreeCallbackResponse::ACCEPT ||
-					    response == QuadtreeCallbackResponse::ACCEPT_AND_STOP) {
-						array.push_back(node.data);
-					}
-					if (response == QuadtreeCallbackResponse::STOP_ITERATION ||
-					    response == QuadtreeCallbackResponse::ACCEPT_AND_STOP ||
-					    response == QuadtreeCallbackResponse::REJECT_AND_STOP) {
-						return QuadtreeSearchResult::ABORTED;
-					}
-#else
-					array.push_back(node.data);
-					if (array.size() >= maxResults)
-						return QuadtreeSearchResult::ABORTED;
+		                                                                       , predicate_t const &pretest
+		                                                                       , predicate_t const &matchtest
 #endif
+		                                                                       ) const
+		{
+			/* find objects stored in this square, eight at a time */
+			for (uint32_t base = 0; base < cell.count; base += 8) {
+				size_t first = cell.first + base;
+				uint32_t hits = QtCircleHits(items.xs.data() + first, items.ys.data() + first, items.radii.data() + first,
+				                             std::min<uint32_t>(8, cell.count - base), circle.x, circle.y, radius);
+				while (hits) {
+					T const &object = items.data[first + QtFirstBit(hits)];
+					hits &= hits - 1;
+					if (Report(array, object, maxResults
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+					           , pretest, matchtest
+#endif
+					           ))
+						return true;
 				}
 			}
 
-			if (!ll) {  /* if no subtrees, return this as-is */
-				if (array.size() > 0)
-					return QuadtreeSearchResult::SUCCESS;
-				else
-					return QuadtreeSearchResult::NOT_FOUND;
-			}
+			if (!cell.children)
+				return false;
 
-			/* find objects stored in the child quadtrees */
+			/* find objects stored in the quarters */
 			float x = circle.x,
 			      y = circle.y,
 			      left = x - radius,
 			      right = x + radius,
 			      top = y + radius,
 			      bottom = y - radius,
-			      midX = (llPosition.x + trPosition.x) * 0.5f,
-			      midY = (llPosition.y + trPosition.y) * 0.5f;
+			      midX = (cell.minX + cell.maxX) * 0.5f,
+			      midY = (cell.minY + cell.maxY) * 0.5f;
+
+			/* One bit per quarter the circle reaches, in the same order as the quarters */
+			int reach = 0;
+			if (bottom <= midY && left <= midX) reach |= 1;
+			if (bottom <= midY && right >= midX) reach |= 2;
+			if (top >= midY && left <= midX) reach |= 4;
+			if (top >= midY && right >= midX) reach |= 8;
 
-			if (top >= midY && left <= midX) {
-				/* need to descend into top left quadtree */
-				if (tl->ObjectsInCircle(array, circle, radius, maxResults
+			for (int q = 0; q < 4; q++) {
+				if (!(reach & (1 << q)))
+					continue;
+				if (SearchCircle(cell.children->cells[q], array, circle, radius, maxResults
 #ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
-				                        , pretest, matchtest
+				                 , pretest, matchtest
 #endif
-				                        ) == QuadtreeSearchResult::ABORTED) {
-					return QuadtreeSearchResult::ABORTED;
-				}
+				                 ))
+					return true;
 			}
 
-			if (top >= midY && right >= midX) {
-				/* top right quadtree */
-				if (tr->ObjectsInCircle(array, circle, radius, maxResults
+			return false;
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		QuadtreeSearchResult Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::ObjectsInRect(std::vector<T> &array, VectorType const &lower_left, VectorType const &upper_right, size_t maxResults
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+		                                                                                        , predicate_t pretest
+		                                                                                        , predicate_t matchtest
+#endif
+		                                                                                        ) const
+		{
+			if (SearchRect(root, array, lower_left.x, lower_left.y, upper_right.x, upper_right.y, maxResults
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+			               , pretest, matchtest
+#endif
+			               ))
+				return QuadtreeSearchResult::ABORTED;
+
+			if (array.size() > 0)
+				return QuadtreeSearchResult::SUCCESS;
+			else
+				return QuadtreeSearchResult::NOT_FOUND;
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		bool Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::SearchRect(Cell const &cell, std::vector<T> &array, float minX, float minY, float maxX, float maxY, size_t maxResults
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+		                                                                     , predicate_t const &pretest
+		                                                                     , predicate_t const &matchtest
+#endif
+		                                                                     ) const
+		{
+			/* find objects stored in this square, eight at a time */
+			for (uint32_t base = 0; base < cell.count; base += 8) {
+				size_t first = cell.first + base;
+				uint32_t hits = QtRectHits(items.xs.data() + first, items.ys.data() + first, items.radii.data() + first,
+				                           std::min<uint32_t>(8, cell.count - base), minX, minY, maxX, maxY);
+				while (hits) {
+					T const &object = items.data[first + QtFirstBit(hits)];
+					hits &= hits - 1;
+					if (Report(array, object, maxResults
 #ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
-				                        , pretest, matchtest
+					           , pretest, matchtest
 #endif
-				                        ) == QuadtreeSearchResult::ABORTED) {
-					return QuadtreeSearchResult::ABORTED;
+					           ))
+						return true;
 				}
 			}
 
-			if (bottom <= midY && right >= midX) {
-				/* lower right quadtree */
-				if (lr->ObjectsInCircle(array, circle, radius, maxResults
+			if (!cell.children)
+				return false;
+
+			/* find objects stored in the quarters the rectangle overlaps */
+			float midX = (cell.minX + cell.maxX) * 0.5f,
+			      midY = (cell.minY + cell.maxY) * 0.5f;
+
+			int reach = 0;
+			if (minY <= midY && minX <= midX) reach |= 1;
+			if (minY <= midY && maxX >= midX) reach |= 2;
+			if (maxY >= midY && minX <= midX) reach |= 4;
+			if (maxY >= midY && maxX >= midX) reach |= 8;
+
+			for (int q = 0; q < 4; q++) {
+				if (!(reach & (1 << q)))
+					continue;
+				if (SearchRect(cell.children->cells[q], array, minX, minY, maxX, maxY, maxResults
 #ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
-				                        , pretest, matchtest
+				               , pretest, matchtest
 #endif
-				                        ) == QuadtreeSearchResult::ABORTED) {
-					return QuadtreeSearchResult::ABORTED;
-				}
+				               ))
+					return true;
 			}
 
-			if (bottom <= midY && left <= midX) {
-				/* lower left quadtree */
-				if (ll->ObjectsInCircle(array, circle, radius, maxResults
+			return false;
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		bool Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::RayEntry(RayStep const &area, float x, float y, float dx, float dy, float maxDistance, float &entry)
+		{
+			/* Clip the ray to the area's slabs, one axis at a time */
+			float enter = 0.0f, leave = maxDistance;
+
+			if (dx != 0.0f) {
+				float a = (area.minX - x) / dx,
+				      b = (area.maxX - x) / dx;
+				enter = std::max(enter, std::min(a, b));
+				leave = std::min(leave, std::max(a, b));
+			} else if (x < area.minX || x > area.maxX) {
+				return false;
+			}
+
+			if (dy != 0.0f) {
+				float a = (area.minY - y) / dy,
+				      b = (area.maxY - y) / dy;
+				enter = std::max(enter, std::min(a, b));
+				leave = std::min(leave, std::max(a, b));
+			} else if (y < area.minY || y > area.maxY) {
+				return false;
+			}
+
+			entry = enter;
+			return enter <= leave;
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		QuadtreeSearchResult Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::RayCast(std::vector<T> &array, VectorType const &origin, VectorType const &direction, float maxDistance, size_t maxResults
 #ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
-				                        , pretest, matchtest
+		                                                                                  , predicate_t pretest
+		                                                                                  , predicate_t matchtest
 #endif
-				                        ) == QuadtreeSearchResult::ABORTED) {
-					return QuadtreeSearchResult::ABORTED;
+		                                                                                  ) const
+		{
+			const float infinity = std::numeric_limits<float>::infinity();
+			float x = origin.x,
+			      y = origin.y,
+			      dx = direction.x,
+			      dy = direction.y,
+			      length = std::sqrt(dx * dx + dy * dy);
+			if (length > 0.0f) {
+				dx /= length;
+				dy /= length;
+			}
+
+			/*
+			 * Squares and the objects hit in them share one heap, ordered by how far
+			 * along the ray they are. A square is never nearer than the objects in
+			 * it, so each object comes off the heap only once nothing still waiting
+			 * could be hit before it. As with NearestK, a square's area is only
+			 * bounded by the middle lines above it.
+			 */
+			std::vector<RayStep> steps;
+			RayStep start = { 0.0f, &root, 0, -infinity, -infinity, infinity, infinity };
+			if (RayEntry(start, x, y, dx, dy, maxDistance, start.distance))
+				steps.push_back(start);
+
+			while (!steps.empty()) {
+				std::pop_heap(steps.begin(), steps.end(), RayOrder());
+				RayStep step = steps.back();
+				steps.pop_back();
+
+				if (!step.cell) {
+					if (Report(array, items.data[step.object], maxResults
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+					           , pretest, matchtest
+#endif
+					           ))
+						return QuadtreeSearchResult::ABORTED;
+					continue;
+				}
+
+				Cell const &cell = *step.cell;
+				for (uint32_t i = cell.first; i < cell.first + cell.count; i++) {
+					/* Solve |origin + t * direction - centre| = radius for the nearest t */
+					float fx = x - items.xs[i],
+					      fy = y - items.ys[i],
+					      radius = items.radii[i],
+					      b = fx * dx + fy * dy,
+					      c = fx * fx + fy * fy - radius * radius,
+					      t = 0.0f;
+					if (c > 0.0f) {
+						float discriminant = b * b - c;
+						if (discriminant < 0.0f)
+							continue;
+						t = -b - std::sqrt(discriminant);
+						/* The circle is behind the origin */
+						if (t < 0.0f)
+							continue;
+					}
+					if (t > maxDistance)
+						continue;
+					RayStep hit = { t, nullptr, i, 0.0f, 0.0f, 0.0f, 0.0f };
+					steps.push_back(hit);
+					std::push_heap(steps.begin(), steps.end(), RayOrder());
+				}
+
+				if (!cell.children)
+					continue;
+
+				float midX = (cell.minX + cell.maxX) * 0.5f,
+				      midY = (cell.minY + cell.maxY) * 0.5f;
+				for (int q = 0; q < 4; q++) {
+					RayStep quarter = {
+						0.0f,
+						&cell.children->cells[q],
+						0,
+						(q & 1) ? midX : step.minX,
+						(q & 2) ? midY : step.minY,
+						(q & 1) ? step.maxX : midX,
+						(q & 2) ? step.maxY : midY
+					};
+					if (!quarter.cell->count && !quarter.cell->children)
+						continue;
+					if (!RayEntry(quarter, x, y, dx, dy, maxDistance, quarter.distance))
+						continue;
+					steps.push_back(quarter);
+					std::push_heap(steps.begin(), steps.end(), RayOrder());
 				}
 			}
 
@@ -279,117 +969,326 @@ namespace CrissCross
 		}
 
 		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
-		void Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::Descend()
+		bool Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::SegmentIntersects(VectorType const &_from, VectorType const &_to
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+		                                                                            , predicate_t pretest
+#endif
+		                                                                            ) const
+		{
+			std::vector<T> found;
+			float dx = _to.x - _from.x,
+			      dy = _to.y - _from.y;
+			return RayCast(found, _from, VectorType(dx, dy), std::sqrt(dx * dx + dy * dy), 1
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+			               , pretest
+			               , [](T const &) { return QuadtreeCallbackResponse::ACCEPT_AND_STOP; }
+#endif
+			               ) != QuadtreeSearchResult::NOT_FOUND;
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		float Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::MinDistance(Frontier const &area, float x, float y)
+		{
+			float dx = std::max(std::max(area.minX - x, x - area.maxX), 0.0f),
+			      dy = std::max(std::max(area.minY - y, y - area.maxY), 0.0f);
+			return std::sqrt(dx * dx + dy * dy);
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		QuadtreeSearchResult Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::NearestK(std::vector<T> &array, VectorType const &point, size_t k
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+		                                                                                   , predicate_t pretest
+#endif
+		                                                                                   ) const
 		{
-			float leftX = llPosition.x,
-			      rightX = trPosition.x,
-			      topY = trPosition.y,
-			      bottomY = llPosition.y,
+			if (k == 0)
+				return QuadtreeSearchResult::NOT_FOUND;
+
+			/*
+			 * Objects outside the tree's bounds go in the outermost squares, so
+			 * the area of a square is only bounded by the middle lines of the
+			 * squares above it, and the root's area is the whole plane.
+			 */
+			const float infinity = std::numeric_limits<float>::infinity();
+			float x = point.x,
+			      y = point.y;
+
+			/*
+			 * Both are plain heaps in vectors: the frontier with the nearest square
+			 * on top, and the best with the farthest of the k nearest objects on
+			 * top, so it can be replaced when a nearer one turns up.
+			 */
+			std::vector<Frontier> frontier;
+			std::vector<Neighbour> best;
+			best.reserve(k < 64 ? k : 64);
+			/* The distance an object has to beat, once k have been found */
+			float worst = infinity;
+
+			Frontier start = { 0.0f, &root, -infinity, -infinity, infinity, infinity, false };
+			frontier.push_back(start);
+
+			while (!frontier.empty() && frontier.front().distance < worst) {
+				std::pop_heap(frontier.begin(), frontier.end(), SearchLater());
+				Frontier area = frontier.back();
+				frontier.pop_back();
+				Cell const &cell = *area.cell;
+
+				if (cell.children && !area.objectsOnly) {
+					/*
+					 * Objects stay in a square when they cross its middle lines,
+					 * so they're often farther away than the quarter the point is
+					 * in. Search them after the quarters at the same distance, so
+					 * more of them can be ruled out.
+					 */
+					if (cell.count) {
+						area.objectsOnly = true;
+						frontier.push_back(area);
+						std::push_heap(frontier.begin(), frontier.end(), SearchLater());
+					}
+
+					float midX = (cell.minX + cell.maxX) * 0.5f,
+					      midY = (cell.minY + cell.maxY) * 0.5f;
+					for (int q = 0; q < 4; q++) {
+						Frontier quarter = {
+							0.0f,
+							&cell.children->cells[q],
+							(q & 1) ? midX : area.minX,
+							(q & 2) ? midY : area.minY,
+							(q & 1) ? area.maxX : midX,
+							(q & 2) ? area.maxY : midY,
+							false
+						};
+						if (!quarter.cell->count && !quarter.cell->children)
+							continue;
+						quarter.distance = MinDistance(quarter, x, y);
+						if (quarter.distance >= worst)
+							continue;
+						frontier.push_back(quarter);
+						std::push_heap(frontier.begin(), frontier.end(), SearchLater());
+					}
+					continue;
+				}
+
+				/*
+				 * An object is nearer than the farthest found so far only if it
+				 * touches a circle of that radius, so test eight at a time first.
+				 */
+				for (uint32_t base = 0; base < cell.count; base += 8) {
+					size_t first = cell.first + base;
+					uint32_t hits = QtCircleHits(items.xs.data() + first, items.ys.data() + first, items.radii.data() + first,
+					                             std::min<uint32_t>(8, cell.count - base), x, y, worst);
+					while (hits) {
+						size_t i = first + QtFirstBit(hits);
+						hits &= hits - 1;
+						float dx = x - items.xs[i],
+						      dy = y - items.ys[i],
+						      distance = std::max(std::sqrt(dx * dx + dy * dy) - items.radii[i], 0.0f);
+						if (distance >= worst)
+							continue;
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+						if (pretest(items.data[i]) == QuadtreeCallbackResponse::REJECT)
+							continue;
+#endif
+						if (best.size() == k) {
+							std::pop_heap(best.begin(), best.end(), Nearer());
+							best.pop_back();
+						}
+						Neighbour found = { distance, items.data[i] };
+						best.push_back(found);
+						std::push_heap(best.begin(), best.end(), Nearer());
+						if (best.size() == k)
+							worst = best.front().distance;
+					}
+				}
+			}
+
+			if (best.empty())
+				return QuadtreeSearchResult::NOT_FOUND;
+
+			std::sort_heap(best.begin(), best.end(), Nearer());
+			for (size_t i = 0; i < best.size(); i++)
+				array.push_back(best[i].object);
+			return QuadtreeSearchResult::SUCCESS;
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		QuadtreeSearchResult Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::Nearest(T &_object, VectorType const &point
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+		                                                                                  , predicate_t pretest
+#endif
+		                                                                                  ) const
+		{
+			std::vector<T> found;
+			QuadtreeSearchResult result = NearestK(found, point, 1
+#ifdef QUADTREE_SEARCH_CALLBACK_SUPPORTED
+			                                       , pretest
+#endif
+			                                       );
+			if (result == QuadtreeSearchResult::SUCCESS)
+				_object = found[0];
+			return result;
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		void Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::Descend(Cell &cell)
+		{
+			float leftX = cell.minX,
+			      rightX = cell.maxX,
+			      topY = cell.maxY,
+			      bottomY = cell.minY,
 			      midX = (leftX + rightX) * 0.5f,
 			      midY = (topY + bottomY) * 0.5f;
 
-			ll = new Quadtree(VectorType(leftX, bottomY), VectorType(midX, midY), descentLevel - 1);
-			lr = new Quadtree(VectorType(midX, bottomY), VectorType(rightX, midY), descentLevel - 1);
-			tl = new Quadtree(VectorType(leftX, midY), VectorType(midX, topY), descentLevel - 1);
-			tr = new Quadtree(VectorType(midX, midY), VectorType(rightX, topY), descentLevel - 1);
-			/* distribute all current nodes */
-			std::vector<nodetype_t> oldCopy = std::move(nodes);
-			nodes.clear();
-			for (auto & node : oldCopy)
-				InsertObject(node.data, node.pos, node.collisionRadius);
+			Quad *quad = quads.construct();
+			InitCell(quad->cells[0], leftX, bottomY, midX, midY, cell.descentLevel - 1);
+			InitCell(quad->cells[1], midX, bottomY, rightX, midY, cell.descentLevel - 1);
+			InitCell(quad->cells[2], leftX, midY, midX, topY, cell.descentLevel - 1);
+			InitCell(quad->cells[3], midX, midY, rightX, topY, cell.descentLevel - 1);
+			cell.children = quad;
+
+			/*
+			 * Sort the square's objects in place into five runs: the ones which
+			 * stay here, then one run per quarter. Each quarter takes its run as
+			 * its range, so nothing is copied out of the arrays.
+			 */
+			uint32_t counts[5] = { 0, 0, 0, 0, 0 };
+			for (uint32_t i = cell.first; i < cell.first + cell.count; i++)
+				counts[Quadrant(cell, items.xs[i], items.ys[i], items.radii[i]) + 1]++;
+
+			uint32_t next[5], end[5];
+			next[0] = cell.first;
+			for (int b = 0; b < 5; b++) {
+				end[b] = next[b] + counts[b];
+				if (b < 4)
+					next[b + 1] = end[b];
+			}
+			for (int q = 0; q < 4; q++) {
+				quad->cells[q].first = next[q + 1];
+				quad->cells[q].count = counts[q + 1];
+				quad->cells[q].capacity = counts[q + 1];
+			}
+
+			for (int b = 0; b < 5; b++) {
+				while (next[b] < end[b]) {
+					uint32_t i = next[b];
+					int target = Quadrant(cell, items.xs[i], items.ys[i], items.radii[i]) + 1;
+					if (target == b)
+						next[b]++;
+					else
+						items.swap(i, next[target]++);
+				}
+			}
+
+			gapCount += cell.capacity - cell.count;
+			cell.count = counts[0];
+			cell.capacity = counts[0];
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		void Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::Ascend(Cell &cell)
+		{
+			if (!IsEmpty(cell, true))
+				return;
+			FreeChildren(cell);
 		}
 
 		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
-		void Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::Ascend()
+		void Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::FreeChildren(Cell &cell)
 		{
-			if (!IsEmpty(true))
+			if (!cell.children)
 				return;
-			delete ll; ll = nullptr;
-			delete lr; lr = nullptr;
-			delete tl; tl = nullptr;
-			delete tr; tr = nullptr;
+			for (int q = 0; q < 4; q++) {
+				FreeChildren(cell.children->cells[q]);
+				gapCount += cell.children->cells[q].capacity;
+			}
+			quads.destroy(cell.children);
+			cell.children = nullptr;
 		}
 
 		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
 		bool Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::IsEmpty(bool _childOnly)
+		{
+			return IsEmpty(root, _childOnly);
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		bool Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::IsEmpty(Cell const &cell, bool _childOnly)
 		{
 			if (!_childOnly) {
-				if (nodes.size() > 0)
+				if (cell.count > 0)
 					return false;
 			}
-			if (!ll)
+			if (!cell.children)
 				return true;
-			if (!ll->IsEmpty(false)) return false;
-			if (!lr->IsEmpty(false)) return false;
-			if (!tl->IsEmpty(false)) return false;
-			if (!tr->IsEmpty(false)) return false;
+			for (int q = 0; q < 4; q++) {
+				if (!IsEmpty(cell.children->cells[q], false))
+					return false;
+			}
 			return true;
 		}
 
 		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
 		void Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::Empty()
 		{
-			nodes.clear();
-			if (!ll)
-				return;
-			ll->Empty();
-			lr->Empty();
-			tl->Empty();
-			tr->Empty();
+			FreeChildren(root);
+			items.clear();
+			root.first = 0;
+			root.count = 0;
+			root.capacity = 0;
+			itemCount = 0;
+			gapCount = 0;
 		}
 
 		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
 		bool Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::RemoveObject(T const &_object, VectorType const &_position, float radius)
 		{
-			/* find objects stored in this quadtree */
-			for (auto node = nodes.begin(); node != nodes.end(); node++) {
-				if (CircleCollision(_position, radius, node->pos, node->collisionRadius)) {
-					if (node->data == _object) {
-						std::swap(*node, nodes.back());
-						nodes.pop_back();
+			return RemoveObject(root, _object, _position, radius);
+		}
+
+		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
+		bool Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::RemoveObject(Cell &cell, T const &_object, VectorType const &_position, float radius)
+		{
+			/* find objects stored in this square */
+			for (uint32_t base = 0; base < cell.count; base += 8) {
+				size_t first = cell.first + base;
+				uint32_t hits = QtCircleHits(items.xs.data() + first, items.ys.data() + first, items.radii.data() + first,
+				                             std::min<uint32_t>(8, cell.count - base), _position.x, _position.y, radius);
+				while (hits) {
+					size_t index = first + QtFirstBit(hits);
+					hits &= hits - 1;
+					if (items.data[index] == _object) {
+						items.swap(index, cell.first + cell.count - 1);
+						cell.count--;
+						itemCount--;
 						return true;
 					}
 				}
 			}
 
-			if (!ll)  /* if no subtrees, return this as-is */
+			if (!cell.children)  /* if no quarters, return this as-is */
 				return false;
 
-			/* find objects stored in the child quadtrees */
+			/* find objects stored in the quarters */
 			float x = _position.x,
 			      y = _position.y,
 			      left = x - radius,
 			      right = x + radius,
 			      top = y + radius,
 			      bottom = y - radius,
-			      midX = (llPosition.x + trPosition.x) * 0.5f,
-			      midY = (llPosition.y + trPosition.y) * 0.5f;
+			      midX = (cell.minX + cell.maxX) * 0.5f,
+			      midY = (cell.minY + cell.maxY) * 0.5f;
 
-			if (bottom < midY && left < midX) {
-				/* lower left quadtree */
-				if (ll->RemoveObject(_object, _position, radius)) {
-					Ascend();
-					return true;
-				}
-			}
-			if (bottom < midY && right > midX) {
-				/* lower right quadtree */
-				if (lr->RemoveObject(_object, _position, radius)) {
-					Ascend();
-					return true;
-				}
-			}
-			if (top > midY && left < midX) {
-				/* need to descend into top left quadtree */
-				if (tl->RemoveObject(_object, _position, radius)) {
-					Ascend();
-					return true;
-				}
-			}
-			if (top > midY && right > midX)	{
-				/* top right quadtree */
-				if (tr->RemoveObject(_object, _position, radius)) {
-					Ascend();
+			int reach = 0;
+			if (bottom <= midY && left <= midX) reach |= 1;
+			if (bottom <= midY && right >= midX) reach |= 2;
+			if (top >= midY && left <= midX) reach |= 4;
+			if (top >= midY && right >= midX) reach |= 8;
+
+			for (int q = 0; q < 4; q++) {
+				if (!(reach & (1 << q)))
+					continue;
+				if (RemoveObject(cell.children->cells[q], _object, _position, radius)) {
+					Ascend(cell);
 					return true;
 				}
 			}
@@ -399,81 +1298,39 @@ namespace CrissCross
 		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
 		void Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::InsertObject(T const &_object, VectorType const &_position, float radius)
 		{
-			if (descentLevel == 0 || (!ll && nodes.size() < MaxNodesPerLevel)) {
-				nodes.push_back(nodetype_t(_object, _position, radius));
-			} else {
-				if (!ll)
-					Descend();
-
-				/* get relevant information for neatness checking */
-				float x = _position.x,
-				      y = _position.y,
-				      left = x - radius,
-				      right = x + radius,
-				      top = y + radius,
-				      bottom = y - radius,
-				      midX = (llPosition.x + trPosition.x) * 0.5f,
-				      midY = (llPosition.y + trPosition.y) * 0.5f;
-
-				if (InRange(left, right, midX) ||
-				    InRange(top, bottom, midY))	{
-					/*
-					 * Crosses the border between trees, so we insert at this
-					 * level instead of a lower one.
-					 */
-					nodes.push_back(nodetype_t(_object, _position, radius));
-				} else {
-					/* Find target quadrant for insertion. */
-					Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel> *target = nullptr;
-					if (y <= midY) {
-						if (x <= midX)
-							target = ll;
-						else
-							target = lr;
-					} else {
-						if (x <= midX)
-							target = tl;
-						else
-							target = tr;
-					}
-					CoreAssert(target != nullptr);
-					target->InsertObject(_object, _position, radius);
+			float x = _position.x,
+			      y = _position.y;
+			Cell *cell = &root;
+			while (true) {
+				if (cell->descentLevel == 0 || (!cell->children && cell->count < MaxNodesPerLevel)) {
+					Append(*cell, x, y, radius, _object);
+					return;
+				}
+
+				if (!cell->children)
+					Descend(*cell);
+
+				int quadrant = Quadrant(*cell, x, y, radius);
+				if (quadrant < 0) {
+					Append(*cell, x, y, radius, _object);
+					return;
 				}
+				cell = &cell->children->cells[quadrant];
 			}
 		}
 
 		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
 		Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::Quadtree(VectorType const &lower_left, VectorType const &upper_right)
-			:   llPosition(lower_left),
-			trPosition(upper_right),
-			ll(nullptr),
-			lr(nullptr),
-			tl(nullptr),
-			tr(nullptr),
-			descentLevel(MaxDepth)
-		{
-		}
-
-		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
-		Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::Quadtree(VectorType const &lower_left, VectorType const &upper_right, int _descentLevel)
-			:   llPosition(lower_left),
-			trPosition(upper_right),
-			ll(nullptr),
-			lr(nullptr),
-			tl(nullptr),
-			tr(nullptr),
-			descentLevel(_descentLevel)
+			: itemCount(0), gapCount(0)
 		{
+			InitCell(root, lower_left.x, lower_left.y, upper_right.x, upper_right.y, MaxDepth);
 		}
 
 		template <class T, class VectorType, int MaxDepth, int MaxNodesPerLevel>
 		Quadtree<T, VectorType, MaxDepth, MaxNodesPerLevel>::~Quadtree()
 		{
-			delete ll; ll = nullptr;
-			delete lr; lr = nullptr;
-			delete tl; tl = nullptr;
-			delete tr; tr = nullptr;
-			nodes.clear();
+			/* Quads are plain data, so the pool frees them all at once */
+			items.clear();
 		}
 	}
 }
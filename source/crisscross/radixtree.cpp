@@ -0,0 +1,767 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_radixtree_h
+#error "This file shouldn't be compiled directly."
+#endif
+
+namespace CrissCross
+{
+	namespace Data
+	{
+#ifdef CC_RADIXTREE_SSE2
+		/*! @cond */
+		static inline unsigned int RadixFirstBit(unsigned int _mask)
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward(&index, _mask);
+			return index;
+#else
+			return __builtin_ctz(_mask);
+#endif
+		}
+		/*! @endcond */
+#endif
+
+		template <class Data, bool OwnsKeys>
+		RadixTree<Data, OwnsKeys>::RadixTree()
+			: m_root(nullptr), m_size(0)
+		{
+		}
+
+		template <class Data, bool OwnsKeys>
+		RadixTree<Data, OwnsKeys>::~RadixTree()
+		{
+			empty();
+		}
+
+		template <class Data, bool OwnsKeys>
+		typename RadixTree<Data, OwnsKeys>::Node **RadixTree<Data, OwnsKeys>::findChild(Node *_node, unsigned char _byte)
+		{
+			switch (_node->type) {
+			case NODE4:
+			{
+				Node4 *n = (Node4 *)_node;
+				for (int i = 0; i < n->count; i++)
+					if (n->keys[i] == _byte)
+						return &n->children[i];
+				return nullptr;
+			}
+			case NODE16:
+			{
+				Node16 *n = (Node16 *)_node;
+#ifdef CC_RADIXTREE_SSE2
+				__m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8((char)_byte), _mm_loadu_si128((const __m128i *)n->keys));
+				unsigned int mask = (unsigned int)_mm_movemask_epi8(cmp) & ((1u << n->count) - 1);
+				return mask ? &n->children[RadixFirstBit(mask)] : nullptr;
+#else
+				for (int i = 0; i < n->count; i++)
+					if (n->keys[i] == _byte)
+						return &n->children[i];
+				return nullptr;
+#endif
+			}
+			case NODE48:
+			{
+				Node48 *n = (Node48 *)_node;
+				int index = n->childIndex[_byte];
+				return index ? &n->children[index - 1] : nullptr;
+			}
+			case NODE256:
+			{
+				Node256 *n = (Node256 *)_node;
+				return n->children[_byte] ? &n->children[_byte] : nullptr;
+			}
+			}
+			return nullptr;
+		}
+
+		template <class Data, bool OwnsKeys>
+		int RadixTree<Data, OwnsKeys>::lowerChild(const Node *_node, unsigned char _byte)
+		{
+			switch (_node->type) {
+			case NODE4:
+			{
+				const Node4 *n = (const Node4 *)_node;
+				int i = 0;
+				while (i < n->count && n->keys[i] < _byte)
+					i++;
+				return i;
+			}
+			case NODE16:
+			{
+				const Node16 *n = (const Node16 *)_node;
+#ifdef CC_RADIXTREE_SSE2
+				/* SSE2 only compares signed bytes, so flip the top bits first */
+				const __m128i bias = _mm_set1_epi8((char)0x80);
+				__m128i keys = _mm_xor_si128(_mm_loadu_si128((const __m128i *)n->keys), bias);
+				__m128i byte = _mm_xor_si128(_mm_set1_epi8((char)_byte), bias);
+				unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmplt_epi8(keys, byte)) & ((1u << n->count) - 1);
+
+				/* The keys are sorted, so the ones below _byte form a run at the start */
+				return (int)RadixFirstBit(~mask);
+#else
+				int i = 0;
+				while (i < n->count && n->keys[i] < _byte)
+					i++;
+				return i;
+#endif
+			}
+			default:
+				return _byte;
+			}
+		}
+
+		template <class Data, bool OwnsKeys>
+		typename RadixTree<Data, OwnsKeys>::Node *RadixTree<Data, OwnsKeys>::nextChild(const Node *_node, int &_pos)
+		{
+			switch (_node->type) {
+			case NODE4:
+			{
+				const Node4 *n = (const Node4 *)_node;
+				return _pos < n->count ? n->children[_pos] : nullptr;
+			}
+			case NODE16:
+			{
+				const Node16 *n = (const Node16 *)_node;
+				return _pos < n->count ? n->children[_pos] : nullptr;
+			}
+			case NODE48:
+			{
+				const Node48 *n = (const Node48 *)_node;
+				for (; _pos < 256; _pos++)
+					if (n->childIndex[_pos])
+						return n->children[n->childIndex[_pos] - 1];
+				return nullptr;
+			}
+			case NODE256:
+			{
+				const Node256 *n = (const Node256 *)_node;
+				for (; _pos < 256; _pos++)
+					if (n->children[_pos])
+						return n->children[_pos];
+				return nullptr;
+			}
+			}
+			return nullptr;
+		}
+
+		template <class Data, bool OwnsKeys>
+		unsigned char RadixTree<Data, OwnsKeys>::childByte(const Node *_node, int _pos)
+		{
+			switch (_node->type) {
+			case NODE4:
+				return ((const Node4 *)_node)->keys[_pos];
+			case NODE16:
+				return ((const Node16 *)_node)->keys[_pos];
+			default:
+				return (unsigned char)_pos;
+			}
+		}
+
+		template <class Data, bool OwnsKeys>
+		typename RadixTree<Data, OwnsKeys>::Leaf *RadixTree<Data, OwnsKeys>::minimum(Node *_node)
+		{
+			while (!isLeaf(_node)) {
+				int pos = 0;
+				_node = nextChild(_node, pos);
+			}
+			return asLeaf(_node);
+		}
+
+		template <class Data, bool OwnsKeys>
+		uint32_t RadixTree<Data, OwnsKeys>::prefixMatch(Node *_node, const char *_key, size_t _depth)
+		{
+			const unsigned char *key = (const unsigned char *)_key + _depth;
+			uint32_t stored = _node->prefixLen < MaxPrefix ? _node->prefixLen : MaxPrefix;
+			uint32_t i;
+			for (i = 0; i < stored; i++)
+				if (_node->prefix[i] != key[i])
+					return i;
+
+			if (_node->prefixLen > MaxPrefix) {
+				/* Every key below the node shares the prefix, so any of them will do */
+				const unsigned char *full = (const unsigned char *)minimum(_node)->key + _depth;
+				for (; i < _node->prefixLen; i++)
+					if (full[i] != key[i])
+						return i;
+			}
+			return i;
+		}
+
+		template <class Data, bool OwnsKeys>
+		unsigned char RadixTree<Data, OwnsKeys>::prefixByte(Node *_node, size_t _depth, uint32_t _index)
+		{
+			if (_index < MaxPrefix)
+				return _node->prefix[_index];
+			return (unsigned char)minimum(_node)->key[_depth + _index];
+		}
+
+		template <class Data, bool OwnsKeys>
+		typename RadixTree<Data, OwnsKeys>::Leaf *RadixTree<Data, OwnsKeys>::makeLeaf(Key _key, Data const &_data)
+		{
+			uint32_t length = (uint32_t)strlen(_key);
+			return m_leafPool.construct(OwnsKeys ? Duplicate(_key) : _key, length, _data);
+		}
+
+		template <class Data, bool OwnsKeys>
+		void RadixTree<Data, OwnsKeys>::freeLeaf(Leaf *_leaf)
+		{
+			if (OwnsKeys)
+				Dealloc(_leaf->key);
+			m_leafPool.destroy(_leaf);
+		}
+
+		template <class Data, bool OwnsKeys>
+		void RadixTree<Data, OwnsKeys>::freeNode(Node *_node)
+		{
+			switch (_node->type) {
+			case NODE4:   m_pool4.destroy((Node4 *)_node); break;
+			case NODE16:  m_pool16.destroy((Node16 *)_node); break;
+			case NODE48:  m_pool48.destroy((Node48 *)_node); break;
+			case NODE256: m_pool256.destroy((Node256 *)_node); break;
+			}
+		}
+
+		/*! @cond */
+		template <class Dst, class Src>
+		static inline void RadixCopyHeader(Dst *_dst, const Src *_src)
+		{
+			_dst->count = _src->count;
+			_dst->prefixLen = _src->prefixLen;
+			memcpy(_dst->prefix, _src->prefix, sizeof(_dst->prefix));
+		}
+		/*! @endcond */
+
+		template <class Data, bool OwnsKeys>
+		void RadixTree<Data, OwnsKeys>::addChild(Node **_ref, Node *_node, unsigned char _byte, Node *_child)
+		{
+			switch (_node->type) {
+			case NODE4:
+			{
+				Node4 *n = (Node4 *)_node;
+				if (n->count < 4) {
+					int pos = lowerChild(n, _byte);
+					memmove(n->keys + pos + 1, n->keys + pos, n->count - pos);
+					memmove(n->children + pos + 1, n->children + pos, (n->count - pos) * sizeof(Node *));
+					n->keys[pos] = _byte;
+					n->children[pos] = _child;
+					n->count++;
+					return;
+				}
+
+				Node16 *grown = m_pool16.construct();
+				RadixCopyHeader(grown, n);
+				memcpy(grown->keys, n->keys, sizeof(n->keys));
+				memcpy(grown->children, n->children, sizeof(n->children));
+				*_ref = grown;
+				m_pool4.destroy(n);
+				addChild(_ref, grown, _byte, _child);
+				return;
+			}
+			case NODE16:
+			{
+				Node16 *n = (Node16 *)_node;
+				if (n->count < 16) {
+					int pos = lowerChild(n, _byte);
+					memmove(n->keys + pos + 1, n->keys + pos, n->count - pos);
+					memmove(n->children + pos + 1, n->children + pos, (n->count - pos) * sizeof(Node *));
+					n->keys[pos] = _byte;
+					n->children[pos] = _child;
+					n->count++;
+					return;
+				}
+
+				Node48 *grown = m_pool48.construct();
+				RadixCopyHeader(grown, n);
+				memcpy(grown->children, n->children, sizeof(n->children));
+				for (int i = 0; i < 16; i++)
+					grown->childIndex[n->keys[i]] = (unsigned char)(i + 1);
+				*_ref = grown;
+				m_pool16.destroy(n);
+				addChild(_ref, grown, _byte, _child);
+				return;
+			}
+			case NODE48:
+			{
+				Node48 *n = (Node48 *)_node;
+				if (n->count < 48) {
+					int pos = 0;
+					while (n->children[pos])
+						pos++;
+					n->children[pos] = _child;
+					n->childIndex[_byte] = (unsigned char)(pos + 1);
+					n->count++;
+					return;
+				}
+
+				Node256 *grown = m_pool256.construct();
+				RadixCopyHeader(grown, n);
+				for (int i = 0; i < 256; i++)
+					if (n->childIndex[i])
+						grown->children[i] = n->children[n->childIndex[i] - 1];
+				*_ref = grown;
+				m_pool48.destroy(n);
+				addChild(_ref, grown, _byte, _child);
+				return;
+			}
+			case NODE256:
+			{
+				Node256 *n = (Node256 *)_node;
+				n->children[_byte] = _child;
+				n->count++;
+				return;
+			}
+			}
+		}
+
+		template <class Data, bool OwnsKeys>
+		void RadixTree<Data, OwnsKeys>::removeChild(Node **_ref, Node *_node, unsigned char _byte, Node **_slot)
+		{
+			/* Nodes shrink a little below the size they grow at, so a key added and
+			 * removed at the boundary doesn't resize the node every time */
+			switch (_node->type) {
+			case NODE4:
+			{
+				Node4 *n = (Node4 *)_node;
+				int pos = (int)(_slot - n->children);
+				memmove(n->keys + pos, n->keys + pos + 1, n->count - pos - 1);
+				memmove(n->children + pos, n->children + pos + 1, (n->count - pos - 1) * sizeof(Node *));
+				n->count--;
+				if (n->count > 1)
+					return;
+
+				/* Merge the node into its only child, joining their prefixes */
+				Node *child = n->children[0];
+				if (!isLeaf(child)) {
+					unsigned char prefix[MaxPrefix];
+					uint32_t len = n->prefixLen < MaxPrefix ? n->prefixLen : MaxPrefix;
+					memcpy(prefix, n->prefix, len);
+					if (len < MaxPrefix)
+						prefix[len++] = n->keys[0];
+					if (len < MaxPrefix) {
+						uint32_t sub = child->prefixLen < MaxPrefix - len ? child->prefixLen : MaxPrefix - len;
+						memcpy(prefix + len, child->prefix, sub);
+						len += sub;
+					}
+					memcpy(child->prefix, prefix, len);
+					child->prefixLen += n->prefixLen + 1;
+				}
+				*_ref = child;
+				m_pool4.destroy(n);
+				return;
+			}
+			case NODE16:
+			{
+				Node16 *n = (Node16 *)_node;
+				int pos = (int)(_slot - n->children);
+				memmove(n->keys + pos, n->keys + pos + 1, n->count - pos - 1);
+				memmove(n->children + pos, n->children + pos + 1, (n->count - pos - 1) * sizeof(Node *));
+				n->count--;
+				if (n->count > 3)
+					return;
+
+				Node4 *shrunk = m_pool4.construct();
+				RadixCopyHeader(shrunk, n);
+				memcpy(shrunk->keys, n->keys, n->count);
+				memcpy(shrunk->children, n->children, n->count * sizeof(Node *));
+				*_ref = shrunk;
+				m_pool16.destroy(n);
+				return;
+			}
+			case NODE48:
+			{
+				Node48 *n = (Node48 *)_node;
+				n->children[n->childIndex[_byte] - 1] = nullptr;
+				n->childIndex[_byte] = 0;
+				n->count--;
+				if (n->count > 12)
+					return;
+
+				Node16 *shrunk = m_pool16.construct();
+				RadixCopyHeader(shrunk, n);
+				int count = 0;
+				for (int i = 0; i < 256; i++) {
+					if (n->childIndex[i]) {
+						shrunk->keys[count] = (unsigned char)i;
+						shrunk->children[count] = n->children[n->childIndex[i] - 1];
+						count++;
+					}
+				}
+				*_ref = shrunk;
+				m_pool48.destroy(n);
+				return;
+			}
+			case NODE256:
+			{
+				Node256 *n = (Node256 *)_node;
+				n->children[_byte] = nullptr;
+				n->count--;
+				if (n->count > 37)
+					return;
+
+				Node48 *shrunk = m_pool48.construct();
+				RadixCopyHeader(shrunk, n);
+				int count = 0;
+				for (int i = 0; i < 256; i++) {
+					if (n->children[i]) {
+						shrunk->children[count] = n->children[i];
+						shrunk->childIndex[i] = (unsigned char)(count + 1);
+						count++;
+					}
+				}
+				*_ref = shrunk;
+				m_pool256.destroy(n);
+				return;
+			}
+			}
+		}
+
+		template <class Data, bool OwnsKeys>
+		bool RadixTree<Data, OwnsKeys>::insert(Key const &_key, Data const &_data)
+		{
+			Node **ref = &m_root;
+			size_t depth = 0;
+
+			while (true) {
+				Node *node = *ref;
+				if (!node) {
+					*ref = tagLeaf(makeLeaf(_key, _data));
+					m_size++;
+					return true;
+				}
+
+				if (isLeaf(node)) {
+					/* Lazy expansion: split the leaf only as far as the two keys agree */
+					Leaf *leaf = asLeaf(node);
+					if (depth > leaf->length)
+						return false;
+
+					size_t i = depth;
+					while (leaf->key[i] == _key[i]) {
+						if (!_key[i])
+							return false;
+						i++;
+					}
+
+					Node *split = m_pool4.construct();
+					split->prefixLen = (uint32_t)(i - depth);
+					memcpy(split->prefix, _key + depth, split->prefixLen < MaxPrefix ? split->prefixLen : MaxPrefix);
+					addChild(&split, split, (unsigned char)leaf->key[i], node);
+					addChild(&split, split, (unsigned char)_key[i], tagLeaf(makeLeaf(_key, _data)));
+					*ref = split;
+					m_size++;
+					return true;
+				}
+
+				if (node->prefixLen) {
+					uint32_t matched = prefixMatch(node, _key, depth);
+					if (matched < node->prefixLen) {
+						/* The key leaves the compressed path part way along, so split it there */
+						Node *split = m_pool4.construct();
+						split->prefixLen = matched;
+						memcpy(split->prefix, node->prefix, matched < MaxPrefix ? matched : MaxPrefix);
+
+						unsigned char byte;
+						if (node->prefixLen <= MaxPrefix) {
+							byte = node->prefix[matched];
+							node->prefixLen -= matched + 1;
+							memmove(node->prefix, node->prefix + matched + 1, node->prefixLen);
+						} else {
+							const char *full = minimum(node)->key + depth;
+							byte = (unsigned char)full[matched];
+							node->prefixLen -= matched + 1;
+							memcpy(node->prefix, full + matched + 1, node->prefixLen < MaxPrefix ? node->prefixLen : MaxPrefix);
+						}
+
+						addChild(&split, split, byte, node);
+						addChild(&split, split, (unsigned char)_key[depth + matched], tagLeaf(makeLeaf(_key, _data)));
+						*ref = split;
+						m_size++;
+						return true;
+					}
+					depth += node->prefixLen;
+				}
+
+				Node **child = findChild(node, (unsigned char)_key[depth]);
+				if (!child) {
+					addChild(ref, node, (unsigned char)_key[depth], tagLeaf(makeLeaf(_key, _data)));
+					m_size++;
+					return true;
+				}
+
+				ref = child;
+				depth++;
+			}
+		}
+
+		template <class Data, bool OwnsKeys>
+		bool RadixTree<Data, OwnsKeys>::erase(Key const &_key)
+		{
+			Node *node = m_root;
+			if (!node)
+				return false;
+
+			if (isLeaf(node)) {
+				Leaf *leaf = asLeaf(node);
+				if (!leafMatches(leaf, _key, 0))
+					return false;
+				m_root = nullptr;
+				freeLeaf(leaf);
+				m_size--;
+				return true;
+			}
+
+			Node **ref = &m_root;
+			size_t depth = 0;
+			while (true) {
+				if (node->prefixLen) {
+					if (prefixMatch(node, _key, depth) != node->prefixLen)
+						return false;
+					depth += node->prefixLen;
+				}
+
+				unsigned char byte = (unsigned char)_key[depth];
+				Node **slot = findChild(node, byte);
+				if (!slot)
+					return false;
+
+				Node *child = *slot;
+				if (isLeaf(child)) {
+					Leaf *leaf = asLeaf(child);
+					if (!leafMatches(leaf, _key, depth + 1))
+						return false;
+					removeChild(ref, node, byte, slot);
+					freeLeaf(leaf);
+					m_size--;
+					return true;
+				}
+
+				ref = slot;
+				node = child;
+				depth++;
+			}
+		}
+
+		template <class Data, bool OwnsKeys>
+		typename RadixTree<Data, OwnsKeys>::Leaf *RadixTree<Data, OwnsKeys>::findLeaf(Key const &_key) const
+		{
+			Node *node = m_root;
+			size_t depth = 0;
+			while (node) {
+				if (isLeaf(node)) {
+					Leaf *leaf = asLeaf(node);
+					return leafMatches(leaf, _key, depth) ? leaf : nullptr;
+				}
+
+				if (node->prefixLen) {
+					if (prefixMatch(node, _key, depth) != node->prefixLen)
+						return nullptr;
+					depth += node->prefixLen;
+				}
+
+				Node **child = findChild(node, (unsigned char)_key[depth]);
+				if (!child)
+					return nullptr;
+				node = *child;
+				depth++;
+			}
+			return nullptr;
+		}
+
+		template <class Data, bool OwnsKeys>
+		template <class TypedData>
+		TypedData RadixTree<Data, OwnsKeys>::find(Key const &_key, TypedData const &_default) const
+		{
+			Leaf *leaf = findLeaf(_key);
+			if (!leaf)
+				return _default;
+
+			return (TypedData)leaf->data;
+		}
+
+		template <class Data, bool OwnsKeys>
+		bool RadixTree<Data, OwnsKeys>::exists(Key const &_key) const
+		{
+			return findLeaf(_key) != nullptr;
+		}
+
+		template <class Data, bool OwnsKeys>
+		bool RadixTree<Data, OwnsKeys>::replace(Key const &_key, Data const &_data)
+		{
+			Leaf *leaf = findLeaf(_key);
+			if (!leaf)
+				return false;
+
+			leaf->data = _data;
+			return true;
+		}
+
+		template <class Data, bool OwnsKeys>
+		void RadixTree<Data, OwnsKeys>::destroy(Node *_node)
+		{
+			if (isLeaf(_node)) {
+				freeLeaf(asLeaf(_node));
+				return;
+			}
+
+			int pos = 0;
+			for (Node *child = nextChild(_node, pos); child; child = nextChild(_node, ++pos))
+				destroy(child);
+			freeNode(_node);
+		}
+
+		template <class Data, bool OwnsKeys>
+		void RadixTree<Data, OwnsKeys>::empty()
+		{
+			/* Without keys to free or leaves to destruct, the pools can just drop everything */
+			if (m_root && (OwnsKeys || !NodePool<Leaf>::TrivialTeardown))
+				destroy(m_root);
+
+			m_pool4.release();
+			m_pool16.release();
+			m_pool48.release();
+			m_pool256.release();
+			m_leafPool.release();
+			m_root = nullptr;
+			m_size = 0;
+		}
+
+		template <class Data, bool OwnsKeys>
+		typename RadixTree<Data, OwnsKeys>::iterator RadixTree<Data, OwnsKeys>::begin() const
+		{
+			iterator it;
+			if (m_root)
+				it.descend(m_root);
+			return it;
+		}
+
+		template <class Data, bool OwnsKeys>
+		typename RadixTree<Data, OwnsKeys>::iterator RadixTree<Data, OwnsKeys>::lower_bound(Key const &_key) const
+		{
+			iterator it;
+			Node *node = m_root;
+			size_t depth = 0;
+			if (!node)
+				return it;
+
+			while (true) {
+				if (isLeaf(node)) {
+					Leaf *leaf = asLeaf(node);
+					it.m_leaf = leaf;
+					if (depth <= leaf->length && strcmp(leaf->key + depth, _key + depth) < 0)
+						it.advance();
+					return it;
+				}
+
+				uint32_t matched = prefixMatch(node, _key, depth);
+				if (matched < node->prefixLen) {
+					/* The whole subtree sorts on one side of the key */
+					if ((unsigned char)_key[depth + matched] < prefixByte(node, depth, matched))
+						it.descend(node);
+					else
+						it.advance();
+					return it;
+				}
+				depth += node->prefixLen;
+
+				unsigned char byte = (unsigned char)_key[depth];
+				typename iterator::Frame frame = { node, lowerChild(node, byte) };
+				Node *child = nextChild(node, frame.pos);
+				if (!child) {
+					it.advance();
+					return it;
+				}
+
+				it.m_path.push_back(frame);
+				if (childByte(node, frame.pos) != byte) {
+					it.descend(child);
+					return it;
+				}
+
+				node = child;
+				depth++;
+			}
+		}
+
+		template <class Data, bool OwnsKeys>
+		template <class Visitor>
+		uint32_t RadixTree<Data, OwnsKeys>::for_each_in_range(Key const &_lo, Key const &_hi, Visitor _fn) const
+		{
+			uint32_t count = 0;
+			for (iterator it = lower_bound(_lo); it.valid() && strcmp(it.key(), _hi) < 0; ++it) {
+				_fn(it.key(), it.data());
+				count++;
+			}
+			return count;
+		}
+
+		template <class Data, bool OwnsKeys>
+		template <class Visitor>
+		uint32_t RadixTree<Data, OwnsKeys>::visit(Node *_node, Visitor &_fn)
+		{
+			if (isLeaf(_node)) {
+				Leaf *leaf = asLeaf(_node);
+				_fn(leaf->key, leaf->data);
+				return 1;
+			}
+
+			uint32_t count = 0;
+			int pos = 0;
+			for (Node *child = nextChild(_node, pos); child; child = nextChild(_node, ++pos))
+				count += visit(child, _fn);
+			return count;
+		}
+
+		template <class Data, bool OwnsKeys>
+		template <class Visitor>
+		uint32_t RadixTree<Data, OwnsKeys>::for_each_with_prefix(const char *_prefix, Visitor _fn) const
+		{
+			size_t length = strlen(_prefix), depth = 0;
+			Node *node = m_root;
+			while (node) {
+				if (isLeaf(node)) {
+					Leaf *leaf = asLeaf(node);
+					if (strncmp(leaf->key, _prefix, length) != 0)
+						return 0;
+					_fn(leaf->key, leaf->data);
+					return 1;
+				}
+
+				/* The prefix may run out part way along a compressed path */
+				for (uint32_t i = 0; i < node->prefixLen; i++) {
+					if (depth + i == length)
+						return visit(node, _fn);
+					if (prefixByte(node, depth, i) != (unsigned char)_prefix[depth + i])
+						return 0;
+				}
+				depth += node->prefixLen;
+				if (depth == length)
+					return visit(node, _fn);
+
+				Node **child = findChild(node, (unsigned char)_prefix[depth]);
+				if (!child)
+					return 0;
+				node = *child;
+				depth++;
+			}
+			return 0;
+		}
+
+		template <class Data, bool OwnsKeys>
+		uint32_t RadixTree<Data, OwnsKeys>::mem_usage() const
+		{
+			return (uint32_t)(sizeof(*this) + m_pool4.mem_usage() + m_pool16.mem_usage() +
+			                  m_pool48.mem_usage() + m_pool256.mem_usage() + m_leafPool.mem_usage());
+		}
+	}
+}
@@ -0,0 +1,503 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_radixtree_h
+#define __included_cc_radixtree_h
+
+#include <crisscross/cc_attr.h>
+#include <crisscross/internal_mem.h>
+#include <crisscross/nodepool.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CC_RADIXTREE_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		/*! \brief An adaptive radix tree keyed by C strings. */
+		/*!
+		 * Instead of comparing whole keys at each level like the binary trees do,
+		 * a radix tree consumes one byte of the key per level, so a lookup costs
+		 * O(key length) no matter how many keys there are, and a prefix shared by
+		 * many keys is never compared more than once.
+		 *
+		 * Inner nodes come in four sizes, holding up to 4, 16, 48 or 256 children,
+		 * and grow or shrink as children come and go. Node16 is searched with SSE2
+		 * where it's available. A chain of nodes with a single child is collapsed
+		 * into a prefix stored in the next node down (path compression), and a key
+		 * with no siblings is stored as a leaf as high up as possible (lazy
+		 * expansion), so long URL- or path-like keys don't make deep trees.
+		 *
+		 * Keys are compared byte for byte and ordered as strcmp orders them. Note
+		 * that this is case sensitive, unlike Compare\<const char *\> in builds
+		 * without CASE_SENSITIVE_COMPARE.
+		 *
+		 * When OwnsKeys is false, the tree stores the caller's key pointers, which
+		 * must stay valid and unchanged until they are erased.
+		 */
+		template <class Data, bool OwnsKeys = true>
+		class RadixTree
+		{
+			public:
+				/*! \brief The type of the tree's keys. */
+				typedef const char *Key;
+
+			private:
+				/*! \brief Private copy constructor. */
+				RadixTree(const RadixTree<Data, OwnsKeys> &) = delete;
+
+				/*! \brief Private assignment operator. */
+				RadixTree<Data, OwnsKeys> &operator =(const RadixTree<Data, OwnsKeys> &) = delete;
+
+			protected:
+				/*! \brief The number of prefix bytes stored in each inner node. */
+				/*!
+				 * Longer prefixes keep only their first MaxPrefix bytes, and the rest
+				 * are checked against a key found below the node.
+				 */
+				static constexpr uint32_t MaxPrefix = 8;
+
+				/*! \brief The kinds of inner node. */
+				enum NodeType : uint8_t
+				{
+					NODE4,
+					NODE16,
+					NODE48,
+					NODE256
+				};
+
+				/*! \brief The header shared by every inner node. */
+				/*!
+				 * Child links point either at another inner node or, with the lowest
+				 * bit set, at a Leaf.
+				 */
+				struct Node
+				{
+					NodeType type;
+					uint16_t count;
+					uint32_t prefixLen;
+					unsigned char prefix[MaxPrefix];
+
+					Node(NodeType _type) : type(_type), count(0), prefixLen(0)
+					{
+					}
+				};
+
+				/*! \brief An inner node with up to 4 children, kept sorted by key byte. */
+				struct Node4 : Node
+				{
+					unsigned char keys[4];
+					Node *children[4];
+
+					Node4() : Node(NODE4)
+					{
+					}
+				};
+
+				/*! \brief An inner node with up to 16 children, kept sorted by key byte. */
+				struct Node16 : Node
+				{
+					unsigned char keys[16];
+					Node *children[16];
+
+					Node16() : Node(NODE16)
+					{
+					}
+				};
+
+				/*! \brief An inner node with up to 48 children, reached through a byte-indexed table. */
+				struct Node48 : Node
+				{
+					/*! \brief For each key byte, one more than the index of its child, or 0. */
+					unsigned char childIndex[256];
+					Node *children[48];
+
+					Node48() : Node(NODE48)
+					{
+						memset(childIndex, 0, sizeof(childIndex));
+						memset(children, 0, sizeof(children));
+					}
+				};
+
+				/*! \brief An inner node with a child slot for every key byte. */
+				struct Node256 : Node
+				{
+					Node *children[256];
+
+					Node256() : Node(NODE256)
+					{
+						memset(children, 0, sizeof(children));
+					}
+				};
+
+				/*! \brief A stored key and its data. */
+				struct Leaf
+				{
+					Key key;
+					uint32_t length;
+					Data data;
+
+					Leaf(Key _key, uint32_t _length, Data const &_data) : key(_key), length(_length), data(_data)
+					{
+					}
+				};
+
+				/*! \brief The root node, or nullptr if the tree is empty. */
+				Node *m_root;
+
+				/*! \brief The current tree size. */
+				uint32_t m_size;
+
+				NodePool<Node4> m_pool4;
+				NodePool<Node16> m_pool16;
+				NodePool<Node48> m_pool48;
+				NodePool<Node256> m_pool256;
+				NodePool<Leaf> m_leafPool;
+
+				static cc_forceinline bool isLeaf(const Node *_node)
+				{
+					return ((uintptr_t)_node & 1) != 0;
+				}
+
+				static cc_forceinline Leaf *asLeaf(const Node *_node)
+				{
+					return (Leaf *)((uintptr_t)_node & ~(uintptr_t)1);
+				}
+
+				static cc_forceinline Node *tagLeaf(Leaf *_leaf)
+				{
+					return (Node *)((uintptr_t)_leaf | 1);
+				}
+
+				/*! \brief Finds the child slot for a key byte. */
+				/*!
+				 * \return The address of the child link, or nullptr if there is no such child.
+				 */
+				static Node **findChild(Node *_node, unsigned char _byte);
+
+				/*! \brief Finds the position of the first child whose key byte is not less than _byte. */
+				/*!
+				 * Positions are indices into the sorted arrays of Node4 and Node16, and
+				 * key bytes for Node48 and Node256.
+				 */
+				static int lowerChild(const Node *_node, unsigned char _byte);
+
+				/*! \brief Finds the first child at or after a position. */
+				/*!
+				 * \param _node The node to look in.
+				 * \param _pos The position to start at. Updated to the child's position.
+				 * \return The child, or nullptr if there are no more.
+				 */
+				static Node *nextChild(const Node *_node, int &_pos);
+
+				/*! \brief Gets the key byte of the child at a position. */
+				static unsigned char childByte(const Node *_node, int _pos);
+
+				/*! \brief Finds the smallest leaf below a node. */
+				static Leaf *minimum(Node *_node);
+
+				/*! \brief Counts how many bytes of a node's prefix match a key. */
+				/*!
+				 * \param _node The node whose prefix is checked.
+				 * \param _key The key.
+				 * \param _depth The position in _key where the prefix starts.
+				 * \return The length of the match, which is the prefix length if it all matches.
+				 */
+				static uint32_t prefixMatch(Node *_node, const char *_key, size_t _depth);
+
+				/*! \brief Gets a byte of a node's prefix, looking beyond the stored bytes if necessary. */
+				static unsigned char prefixByte(Node *_node, size_t _depth, uint32_t _index);
+
+				/*! \brief Tests whether a leaf holds a key. */
+				/*!
+				 * \param _leaf The leaf.
+				 * \param _key The key.
+				 * \param _depth The number of leading bytes already known to match.
+				 */
+				static cc_forceinline bool leafMatches(const Leaf *_leaf, const char *_key, size_t _depth)
+				{
+					/* Past the terminator means the terminator itself was matched */
+					return _depth > _leaf->length || strcmp(_leaf->key + _depth, _key + _depth) == 0;
+				}
+
+				/*! \brief Finds the leaf holding a key. */
+				/*!
+				 * \return The leaf, or nullptr if the key isn't in the tree.
+				 */
+				Leaf *findLeaf(Key const &_key) const;
+
+				/*! \brief Makes a leaf for a new key. */
+				Leaf *makeLeaf(Key _key, Data const &_data);
+
+				/*! \brief Destroys a leaf and frees its key, if the tree owns it. */
+				void freeLeaf(Leaf *_leaf);
+
+				/*! \brief Destroys an inner node, without touching its children. */
+				void freeNode(Node *_node);
+
+				/*! \brief Adds a child to a node, replacing the node with a bigger one if it's full. */
+				/*!
+				 * \param _ref The link to _node, updated if the node is replaced.
+				 * \param _node The node to add to.
+				 * \param _byte The child's key byte, which must not be in use.
+				 * \param _child The child.
+				 */
+				void addChild(Node **_ref, Node *_node, unsigned char _byte, Node *_child);
+
+				/*! \brief Removes a child from a node, replacing the node with a smaller one if it's sparse. */
+				/*!
+				 * A node left with one child is merged into that child.
+				 * \param _ref The link to _node, updated if the node is replaced.
+				 * \param _node The node to remove from.
+				 * \param _byte The child's key byte.
+				 * \param _slot The child's link, as returned by findChild().
+				 */
+				void removeChild(Node **_ref, Node *_node, unsigned char _byte, Node **_slot);
+
+				/*! \brief Destroys a subtree. */
+				void destroy(Node *_node);
+
+				/*! \brief Calls a visitor for every leaf of a subtree, in order. */
+				template <class Visitor>
+				static uint32_t visit(Node *_node, Visitor &_fn);
+
+			public:
+				/*! \brief A forward in-order iterator over the tree. */
+				/*!
+				 * Since the nodes have no parent links, the iterator keeps the path
+				 * from the root to its current leaf.
+				 * \warning Inserting into or erasing from the tree invalidates its iterators.
+				 */
+				class iterator
+				{
+					friend class RadixTree<Data, OwnsKeys>;
+
+					protected:
+						/*! \brief An inner node on the path, and the position of the child taken. */
+						struct Frame
+						{
+							Node *node;
+							int pos;
+						};
+
+						/*! \brief The inner nodes above the current leaf. */
+						std::vector<Frame> m_path;
+
+						/*! \brief The current leaf, or nullptr past the end. */
+						Leaf *m_leaf;
+
+						/*! \brief Moves to the smallest leaf of a subtree. */
+						void descend(Node *_node)
+						{
+							while (!isLeaf(_node)) {
+								Frame frame = { _node, 0 };
+								Node *child = nextChild(_node, frame.pos);
+								m_path.push_back(frame);
+								_node = child;
+							}
+							m_leaf = asLeaf(_node);
+						}
+
+						/*! \brief Moves to the first leaf after the subtree below the last frame's child. */
+						void advance()
+						{
+							while (!m_path.empty()) {
+								Frame &frame = m_path.back();
+								frame.pos++;
+								Node *child = nextChild(frame.node, frame.pos);
+								if (child) {
+									descend(child);
+									return;
+								}
+								m_path.pop_back();
+							}
+							m_leaf = nullptr;
+						}
+
+					public:
+						/*! \brief The default constructor. */
+						iterator() : m_leaf(nullptr)
+						{
+						}
+
+						/*! \brief Tests whether the iterator points at a key. */
+						/*!
+						 * \return False when the iterator is past the end.
+						 */
+						inline bool valid() const
+						{
+							return m_leaf != nullptr;
+						}
+
+						/*! \brief Gets the current key. */
+						inline Key const &key() const
+						{
+							return m_leaf->key;
+						}
+
+						/*! \brief Gets the data stored with the current key. */
+						inline Data &data() const
+						{
+							return m_leaf->data;
+						}
+
+						/*! \brief Steps to the next key in order. */
+						iterator &operator ++()
+						{
+							advance();
+							return *this;
+						}
+
+						/*! \brief Steps to the next key in order. */
+						iterator operator ++(int)
+						{
+							iterator ret = *this;
+							++*this;
+							return ret;
+						}
+
+						inline bool operator ==(iterator const &_other) const
+						{
+							return m_leaf == _other.m_leaf;
+						}
+
+						inline bool operator !=(iterator const &_other) const
+						{
+							return m_leaf != _other.m_leaf;
+						}
+				};
+
+				/*! \brief The default constructor. */
+				RadixTree();
+
+				/*! \brief The destructor. */
+				~RadixTree();
+
+				/*! \brief Inserts data into the tree. */
+				/*!
+				 * \param _key The key of the data.
+				 * \param _data The data to insert.
+				 * \return True on success, false if the key was already there.
+				 */
+				bool insert(Key const &_key, Data const &_data);
+
+				/*! \brief Deletes a node from the tree, specified by the node's key. */
+				/*!
+				 * \warning This won't free the memory occupied by the data, so the data must be freed separately.
+				 * \param _key The key of the node to delete.
+				 * \return True on success, false on failure
+				 */
+				bool erase(Key const &_key);
+
+				/*! \brief Finds a node in the tree and returns the data at that node. */
+				/*!
+				 * \param _key The key of the node to find.
+				 * \param _default The value to return if the item couldn't be found.
+				 * \return If found, returns the data at the node, otherwise _default is returned.
+				 */
+				template <class TypedData = Data>
+				TypedData find(Key const &_key, TypedData const &_default = nullptr) const;
+
+				/*! \brief Tests whether a key is in the tree or not. */
+				/*!
+				 * \param _key The key of the node to find.
+				 * \return True if the key is in the tree, false if not.
+				 */
+				bool exists(Key const &_key) const;
+
+				/*! \brief Change the data at the given node. */
+				/*!
+				 * \param _key The key of the node to be modified.
+				 * \param _data The data to insert.
+				 * \return True on success, false on failure.
+				 */
+				bool replace(Key const &_key, Data const &_data);
+
+				/*! \brief Empties the entire tree. */
+				/*!
+				 * \warning This won't free the memory occupied by the data.
+				 */
+				void empty();
+
+				/*! \brief Indicates the size of the tree. */
+				/*!
+				 * \return Size of the tree.
+				 */
+				inline uint32_t size() const
+				{
+					return m_size;
+				}
+
+				/*! \brief Gets an iterator at the smallest key. */
+				/*!
+				 * \return An iterator at the first key, or end() if the tree is empty.
+				 */
+				iterator begin() const;
+
+				/*! \brief Gets the past-the-end iterator. */
+				/*!
+				 * \return An iterator which points past the last key.
+				 */
+				inline iterator end() const
+				{
+					return iterator();
+				}
+
+				/*! \brief Finds the first key not less than the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return An iterator at the first key >= _key, or end() if there is none.
+				 */
+				iterator lower_bound(Key const &_key) const;
+
+				/*! \brief Visits the keys in [_lo, _hi) in order. */
+				/*!
+				 * \param _lo The smallest key to visit.
+				 * \param _hi The key to stop at. It isn't visited.
+				 * \param _fn Called as _fn(key, data) for each key in the range.
+				 * \return The number of keys visited.
+				 */
+				template <class Visitor>
+				uint32_t for_each_in_range(Key const &_lo, Key const &_hi, Visitor _fn) const;
+
+				/*! \brief Visits every key starting with a prefix, in order. */
+				/*!
+				 * Only the subtree below the prefix is walked, so this costs
+				 * O(prefix length + matches).
+				 * \param _prefix The prefix. An empty prefix visits every key.
+				 * \param _fn Called as _fn(key, data) for each matching key.
+				 * \return The number of keys visited.
+				 */
+				template <class Visitor>
+				uint32_t for_each_with_prefix(const char *_prefix, Visitor _fn) const;
+
+				/*! \brief Returns the overhead caused by the data structure. */
+				/*!
+				 * \return Memory usage in bytes, not counting keys owned by the tree.
+				 */
+				uint32_t mem_usage() const;
+		};
+	}
+}
+
+#include <crisscross/radixtree.cpp>
+
+#endif
@@ -19,33 +19,39 @@
 #include <crisscross/debug.h>
 #include <crisscross/rbtree.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace CrissCross
 {
 	namespace Data
 	{
-		template <class Key, class Data, bool OwnsKeys>
-		RedBlackTree<Key, Data, OwnsKeys>::RedBlackTree()
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::RedBlackTree()
 		{
-			nullNode = new RedBlackNode<Key, Data, OwnsKeys>();
+			nullNode = new RedBlackNode<Key, Data, OwnsKeys, OrderStatistics>();
 			nullNode->left = nullNode->right = nullNode->parent = nullNode;
 			nullNode->color = BLACK;
 			nullNode->id = NullKey<Key>();
+			if constexpr (OrderStatistics)
+				nullNode->count = 0;
 			rootNode = nullNode;
 			m_size = 0;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		RedBlackTree<Key, Data, OwnsKeys>::~RedBlackTree()
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::~RedBlackTree()
 		{
 			killAll();
 			nullNode->right = nullNode->left = nullptr;
 			delete nullNode;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		void RedBlackTree<Key, Data, OwnsKeys>::rotateLeft(RedBlackNode<Key, Data, OwnsKeys> * x)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		void RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::rotateLeft(RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> * x)
 		{
-			RedBlackNode<Key, Data, OwnsKeys> *y = x->right;
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *y = x->right;
 
 			/* establish x->right link */
 			x->right = y->left;
@@ -69,12 +75,15 @@ namespace CrissCross
 			y->left = x;
 			if (valid(x))
 				x->parent = y;
+
+			recount(x);
+			recount(y);
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		void RedBlackTree<Key, Data, OwnsKeys>::rotateRight(RedBlackNode<Key, Data, OwnsKeys> * x)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		void RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::rotateRight(RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> * x)
 		{
-			RedBlackNode<Key, Data, OwnsKeys> *y = x->left;
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *y = x->left;
 
 			/* establish x->left link */
 			x->left = y->right;
@@ -98,16 +107,19 @@ namespace CrissCross
 			y->right = x;
 			if (valid(x))
 				x->parent = y;
+
+			recount(x);
+			recount(y);
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		void RedBlackTree<Key, Data, OwnsKeys>::insertFixup(RedBlackNode<Key, Data, OwnsKeys> * x)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		void RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::insertFixup(RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> * x)
 		{
 			/* check Red-Black properties */
 			while (x != rootNode && x->parent->color == RED) {
 				/* we have a violation */
 				if (x->parent == x->parent->parent->left) {
-					RedBlackNode<Key, Data, OwnsKeys> *y = x->parent->parent->right;
+					RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *y = x->parent->parent->right;
 
 					if (valid(y) && y->color == RED) {
 						/* uncle is RED */
@@ -130,7 +142,7 @@ namespace CrissCross
 					}
 				} else {
 					/* mirror image of above code */
-					RedBlackNode<Key, Data, OwnsKeys> *y = x->parent->parent->left;
+					RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *y = x->parent->parent->left;
 
 					if (valid(y) && y->color == RED) {
 						/* uncle is RED */
@@ -154,10 +166,10 @@ namespace CrissCross
 			rootNode->color = BLACK;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		bool RedBlackTree<Key, Data, OwnsKeys>::replace(Key const &key, Data const & rec)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::replace(Key const &key, Data const & rec)
 		{
-			RedBlackNode<Key, Data, OwnsKeys> *current;
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *current;
 			current = findNode(key);
 			if (!valid(current)) return false;
 
@@ -165,16 +177,18 @@ namespace CrissCross
 			return true;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		bool RedBlackTree<Key, Data, OwnsKeys>::insert(Key const &key, Data const & rec)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::insert(Key const &key, Data const & rec)
 		{
-			RedBlackNode<Key, Data, OwnsKeys> *current, *parent = nullNode, *x = nullNode;
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *current, *parent = nullNode;
+			typename KeyPrefix<Key>::Type prefix = KeyPrefix<Key>::Make(key);
+			int ret = 0;
 
 			/* find future parent */
 			current = rootNode;
 			while (valid(current)) {
 				parent = current;
-				int ret = Compare(key, current->id);
+				ret = CompareWithNode(key, prefix, current);
 				if (ret < 0)
 					current = current->left;
 				else if (ret > 0)
@@ -183,46 +197,69 @@ namespace CrissCross
 					return false;
 			}
 
-			/* setup new node */
-			if ((x = new RedBlackNode<Key, Data, OwnsKeys>()) == 0) {
-				return false;
-			}
+			attach(parent, ret, key, rec);
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		typename RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::iterator RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::insert(iterator const &_hint, Key const &_key, Data const &_rec)
+		{
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *parent;
+			int side;
+
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *node = iterator::fingerSearch(&rootNode, nullNode, _hint.node(), _key, &parent, &side);
+			if (!node)
+				node = attach(parent ? parent : nullNode, side, _key, _rec);
 
-			x->parent = parent;
+			return iterator(node, &rootNode, nullNode);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::attach(RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *_parent, int _side, Key const &_key, Data const &_rec)
+		{
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *x = m_pool.construct();
+
+			/* setup new node */
+			x->parent = _parent;
 			x->left = nullNode;
 			x->right = nullNode;
 			x->color = RED;
 			if (OwnsKeys)
-				x->id = Duplicate(key);
+				x->id = Duplicate(_key);
 			else
-				x->id = key;
-			x->data = rec;
+				x->id = _key;
+			x->cachePrefix(x->id);
+			x->data = _rec;
 
 			/* insert node in tree */
-			if (valid(parent)) {
-				if (Compare(key, parent->id) <= 0)
-					parent->left = x;
+			if (valid(_parent)) {
+				if (_side < 0)
+					_parent->left = x;
 				else
-					parent->right = x;
+					_parent->right = x;
 			} else {
 				rootNode = x;
 			}
 
 			m_size++;
 
+			if constexpr (OrderStatistics) {
+				for (RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *current = _parent; valid(current); current = current->parent)
+					current->count++;
+			}
+			augmentPath(x);
+
 			insertFixup(x);
 
-			return true;
+			return x;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		void RedBlackTree<Key, Data, OwnsKeys>::deleteFixup(RedBlackNode<Key, Data, OwnsKeys> * x)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		void RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::deleteFixup(RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> * x)
 		{
-			if (!valid(x)) return;
-
 			while (x != rootNode && x->color == BLACK) {
 				if (x == x->parent->left) {
-					RedBlackNode<Key, Data, OwnsKeys> *w = x->parent->right;
+					RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *w = x->parent->right;
 
 					if (w->color == RED) {
 						w->color = BLACK;
@@ -249,7 +286,7 @@ namespace CrissCross
 						x = rootNode;
 					}
 				} else {
-					RedBlackNode<Key, Data, OwnsKeys> *w = x->parent->left;
+					RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *w = x->parent->left;
 
 					if (w->color == RED) {
 						w->color = BLACK;
@@ -280,22 +317,22 @@ namespace CrissCross
 			x->color = BLACK;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		bool RedBlackTree<Key, Data, OwnsKeys>::erase(Key const &key)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::erase(Key const &key)
 		{
-			RedBlackNode<Key, Data, OwnsKeys> *z;
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *z;
 
 			/*  delete node z from tree */
 
 			/* find node in tree */
+			typename KeyPrefix<Key>::Type prefix = KeyPrefix<Key>::Make(key);
 			z = rootNode;
 
 			while (valid(z)) {
-				if (Compare(key, z->id) == 0)
+				int cmp = CompareWithNode(key, prefix, z);
+				if (cmp == 0)
 					break;
-				else{
-					z = (Compare(key, z->id) <= 0) ? z->left : z->right;
-				}
+				z = (cmp < 0) ? z->left : z->right;
 			}
 
 			if (z == nullNode) {
@@ -305,10 +342,10 @@ namespace CrissCross
 			return killNode(z);
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		bool RedBlackTree<Key, Data, OwnsKeys>::killNode(RedBlackNode<Key, Data, OwnsKeys> * z)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::killNode(RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> * z)
 		{
-			RedBlackNode<Key, Data, OwnsKeys> *x, *y;
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *x, *y;
 
 			if (!valid(z->left) || !valid(z->right)) {
 				/* y has a null node as a child */
@@ -327,8 +364,9 @@ namespace CrissCross
 			else
 				x = y->right;
 
-			/* remove y from the parent chain */
-			if (valid(x)) x->parent = y->parent;
+			/* remove y from the parent chain. x may be nullNode, whose parent */
+			/* link deleteFixup relies on to find its way back up */
+			x->parent = y->parent;
 
 			if (valid(y->parent)) {
 				if (y == y->parent->left)
@@ -345,29 +383,35 @@ namespace CrissCross
 					z->id = Duplicate(y->id);
 				else
 					z->id = y->id;
+				z->cachePrefix(z->id);
 				z->data = y->data;
 			} else {
 				if (OwnsKeys)
 					Dealloc(y->id);
 			}
 
+			if constexpr (OrderStatistics) {
+				for (RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *p = y->parent; valid(p); p = p->parent)
+					p->count--;
+			}
+			augmentPath(y->parent);
+
 			if (y->color == BLACK)
 				deleteFixup(x);
+			nullNode->parent = nullNode;
 
 			m_size--;
 
-			y->left = nullptr;
-			y->right = nullptr;
-			delete y;
+			m_pool.destroy(y);
 
 			return true;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
 		template <class TypedData>
-		TypedData RedBlackTree<Key, Data, OwnsKeys>::find(Key const &_key, TypedData const &_default) const
+		TypedData RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::find(Key const &_key, TypedData const &_default) const
 		{
-			RedBlackNode<Key, Data, OwnsKeys> *node = findNode(_key);
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *node = findNode(_key);
 
 			if (!valid(node))
 				return _default;
@@ -375,13 +419,23 @@ namespace CrissCross
 			return (TypedData)(node->data);
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		RedBlackNode<Key, Data, OwnsKeys> * RedBlackTree<Key, Data, OwnsKeys>::findNode(Key const &_key) const
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		typename RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::iterator RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::find_near(iterator const &_hint, Key const &_key) const
+		{
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *parent;
+			int side;
+
+			return iterator(iterator::fingerSearch(&rootNode, nullNode, _hint.node(), _key, &parent, &side), &rootNode, nullNode);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> * RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::findNode(Key const &_key) const
 		{
-			RedBlackNode<Key, Data, OwnsKeys> *p_current = rootNode;
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *p_current = rootNode;
+			typename KeyPrefix<Key>::Type prefix = KeyPrefix<Key>::Make(_key);
 
 			while (valid(p_current)) {
-				int cmp = Compare(_key, p_current->id);
+				int cmp = CompareWithNode(_key, prefix, p_current);
 				if (cmp < 0)
 					p_current = p_current->left;
 				else if (cmp > 0)
@@ -394,52 +448,75 @@ namespace CrissCross
 			return nullptr;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		bool RedBlackTree<Key, Data, OwnsKeys>::exists(Key const &_key) const
-		{
-			RedBlackNode<Key, Data, OwnsKeys> *p_current = findNode(_key);
-			if (!valid(p_current)) return false;
-			else return true;
-		}
-
-		template <class Key, class Data, bool OwnsKeys>
-		void RedBlackTree<Key, Data, OwnsKeys>::killAll(RedBlackNode<Key, Data, OwnsKeys> *rec)
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		template <class TypedData>
+		size_t RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::find_batch(Key const *_keys, size_t _count, TypedData *_out, TypedData const &_default) const
 		{
-			if (!valid(rec)) {
-				return;
-			}
-
-			/* First kill our subnodes: */
-			if (valid(rec->left))
-				killAll(rec->left);
+			const size_t width = 16;
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *cursor[width];
+			typename KeyPrefix<Key>::Type prefix[width];
+			size_t found = 0;
+
+			for (size_t base = 0; base < _count; base += width) {
+				size_t n = _count - base < width ? _count - base : width;
+				size_t active = n;
+
+				for (size_t i = 0; i < n; i++) {
+					cursor[i] = valid(rootNode) ? rootNode : nullptr;
+					prefix[i] = KeyPrefix<Key>::Make(_keys[base + i]);
+					_out[base + i] = _default;
+					if (!cursor[i])
+						active--;
+				}
 
-			if (valid(rec->right))
-				killAll(rec->right);
+				/* Every search takes one step per pass, so the node each one reads
+				 * next was prefetched a whole pass earlier. */
+				while (active) {
+					for (size_t i = 0; i < n; i++) {
+						if (!cursor[i])
+							continue;
+
+						int cmp = CompareWithNode(_keys[base + i], prefix[i], cursor[i]);
+						if (cmp == 0) {
+							_out[base + i] = (TypedData)(cursor[i]->data);
+							found++;
+							cursor[i] = nullptr;
+							active--;
+							continue;
+						}
 
-			if (valid(rec->parent)) {                /* We're not root. */
-				if (rec->parent->left == rec)
-					rec->parent->left = nullNode;
-				else
-					rec->parent->right = nullNode;
+						cursor[i] = cmp < 0 ? cursor[i]->left : cursor[i]->right;
+						if (!valid(cursor[i])) {
+							cursor[i] = nullptr;
+							active--;
+							continue;
+						}
+						cc_prefetch(cursor[i]);
+					}
+				}
 			}
 
-			if (OwnsKeys)
-				Dealloc(rec->id);
-			rec->left = nullptr;
-			rec->right = nullptr;
-			delete rec;
+			return found;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		void RedBlackTree<Key, Data, OwnsKeys>::killAll()
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::exists(Key const &_key) const
 		{
-			killAll(rootNode);
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *p_current = findNode(_key);
+			if (!valid(p_current)) return false;
+			else return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		void RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::killAll()
+		{
+			m_pool.releaseTree(rootNode, nullNode);
 			rootNode = nullNode;
 			m_size = 0;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		uint32_t RedBlackTree<Key, Data, OwnsKeys>::mem_usage() const
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		uint32_t RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::mem_usage() const
 		{
 			uint32_t ret = sizeof(*this);
 			if (!valid(rootNode)) return ret;
@@ -448,9 +525,9 @@ namespace CrissCross
 			return ret;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
 		template <class TypedData>
-		DArray<TypedData> *RedBlackTree<Key, Data, OwnsKeys>::ConvertToDArray() const
+		DArray<TypedData> *RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::ConvertToDArray() const
 		{
 			DArray<TypedData> *darray = new DArray<TypedData>();
 			darray->setSize(m_size);
@@ -458,8 +535,8 @@ namespace CrissCross
 			return darray;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		DArray<Key> *RedBlackTree<Key, Data, OwnsKeys>::ConvertIndexToDArray() const
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		DArray<Key> *RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::ConvertIndexToDArray() const
 		{
 			DArray<Key> *darray = new DArray<Key>();
 			darray->setSize(m_size);
@@ -467,9 +544,9 @@ namespace CrissCross
 			return darray;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
 		template <class TypedData>
-		void RedBlackTree<Key, Data, OwnsKeys>::RecursiveConvertToDArray(DArray<TypedData> *darray, RedBlackNode<Key, Data, OwnsKeys> *btree) const
+		void RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::RecursiveConvertToDArray(DArray<TypedData> *darray, RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *btree) const
 		{
 			if (!valid(btree)) return;
 
@@ -478,8 +555,8 @@ namespace CrissCross
 			RecursiveConvertToDArray(darray, btree->right);
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		void RedBlackTree<Key, Data, OwnsKeys>::RecursiveConvertIndexToDArray(DArray<Key> *darray, RedBlackNode<Key, Data, OwnsKeys> *btree) const
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		void RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::RecursiveConvertIndexToDArray(DArray<Key> *darray, RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *btree) const
 		{
 			if (!valid(btree)) return;
 
@@ -487,5 +564,151 @@ namespace CrissCross
 			darray->insert(btree->id);
 			RecursiveConvertIndexToDArray(darray, btree->right);
 		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		template <class Source>
+		RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::buildSubtree(Source const *_src, RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> **_slots, uint32_t _lo, uint32_t _hi, RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *_parent, uint32_t _depth, uint32_t _redDepth)
+		{
+			if (_lo >= _hi)
+				return nullNode;
+
+			uint32_t count = _hi - _lo;
+			uint32_t mid = _lo + count / 2;
+
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *node = _slots ? new (_slots[mid]) RedBlackNode<Key, Data, OwnsKeys, OrderStatistics>() : m_pool.construct();
+			node->parent = _parent;
+			node->color = (_depth == _redDepth) ? RED : BLACK;
+			if constexpr (OrderStatistics)
+				node->count = count;
+			if (OwnsKeys)
+				node->id = Duplicate(_src->key(mid));
+			else
+				node->id = _src->key(mid);
+			node->cachePrefix(node->id);
+			node->data = _src->data(mid);
+
+#ifdef _OPENMP
+			if (_slots && count >= BuildTaskCutoff) {
+				#pragma omp task
+				node->left = buildSubtree(_src, _slots, _lo, mid, node, _depth + 1, _redDepth);
+				node->right = buildSubtree(_src, _slots, mid + 1, _hi, node, _depth + 1, _redDepth);
+				#pragma omp taskwait
+				augment(node);
+				return node;
+			}
+#endif
+
+			node->left = buildSubtree(_src, _slots, _lo, mid, node, _depth + 1, _redDepth);
+			node->right = buildSubtree(_src, _slots, mid + 1, _hi, node, _depth + 1, _redDepth);
+			augment(node);
+			return node;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		template <class Source>
+		void RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::build(Source const *_src)
+		{
+			uint32_t count = _src->size();
+
+			killAll();
+
+			/* Every leaf of the balanced shape sits on one of the bottom two */
+			/* levels. Coloring the bottom level red evens out the black height. */
+			uint32_t height = 0;
+			for (uint32_t n = count; n; n >>= 1)
+				height++;
+			uint32_t redDepth = (height > 1) ? height - 1 : (uint32_t)-1;
+
+#ifdef _OPENMP
+			if (count >= BuildTaskCutoff * 4 && omp_get_max_threads() > 1) {
+				/* The pool isn't thread-safe, so hand out all the storage up front */
+				RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> **slots = new RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *[count];
+				for (uint32_t i = 0; i < count; i++)
+					slots[i] = m_pool.allocate();
+
+				#pragma omp parallel
+				#pragma omp single
+				rootNode = buildSubtree(_src, slots, 0, count, nullNode, 0, redDepth);
+
+				delete [] slots;
+				m_size = count;
+				return;
+			}
+#endif
+
+			rootNode = buildSubtree(_src, (RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> **)nullptr, 0, count, nullNode, 0, redDepth);
+			m_size = count;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::build_from_sorted(Key const *_keys, Data const *_data, uint32_t _count)
+		{
+			SortedArraySource<Key, Data> src(_keys, _data, _count);
+			if (!src.sorted())
+				return false;
+
+			build(&src);
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		bool RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::build_from_sorted(DArray<Key> const *_keys, DArray<Data> const *_data)
+		{
+			SortedDArraySource<Key, Data> src(_keys, _data);
+			if (!src.sorted())
+				return false;
+
+			build(&src);
+			return true;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		typename RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::iterator RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::select(uint32_t _index) const
+		{
+			static_assert(OrderStatistics, "select() needs a tree with OrderStatistics enabled");
+
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *node = rootNode;
+			while (valid(node)) {
+				uint32_t left = subtreeSize(node->left);
+				if (_index < left) {
+					node = node->left;
+				} else if (_index > left) {
+					_index -= left + 1;
+					node = node->right;
+				} else {
+					return iterator(node, &rootNode, nullNode);
+				}
+			}
+
+			return end();
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		uint32_t RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::rank(Key const &_key) const
+		{
+			static_assert(OrderStatistics, "rank() needs a tree with OrderStatistics enabled");
+
+			uint32_t ret = 0;
+			RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *node = rootNode;
+			while (valid(node)) {
+				if (Compare(node->id, _key) < 0) {
+					ret += subtreeSize(node->left) + 1;
+					node = node->right;
+				} else {
+					node = node->left;
+				}
+			}
+
+			return ret;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool OrderStatistics>
+		uint32_t RedBlackTree<Key, Data, OwnsKeys, OrderStatistics>::count_range(Key const &_lo, Key const &_hi) const
+		{
+			if (Compare(_lo, _hi) >= 0)
+				return 0;
+
+			return rank(_hi) - rank(_lo);
+		}
 	}
 }
@@ -16,6 +16,11 @@
 #include <crisscross/internal_mem.h>
 #include <crisscross/darray.h>
 #include <crisscross/node.h>
+#include <crisscross/nodepool.h>
+#include <crisscross/sortedsource.h>
+#include <crisscross/treeiterator.h>
+
+#include <utility>
 
 namespace CrissCross
 {
@@ -27,7 +32,7 @@ namespace CrissCross
 		 * operations and are efficient in practice: they can search, insert, and delete
 		 * in O(log n) time, where n is total number of elements in the tree.
 		 */
-		template <class Key, class Data, bool OwnsKeys = true>
+		template <class Key, class Data, bool OwnsKeys = true, bool OrderStatistics = false>
 		class RedBlackTree
 		{
 			private:
@@ -37,7 +42,7 @@ namespace CrissCross
 				 * the code wrong. A tree copy is generally unnecessary, and in cases that it
 				 * is, it can be achieved by other means.
 				 */
-				RedBlackTree(const RedBlackTree<Key, Data, OwnsKeys> &) = delete;
+				RedBlackTree(const RedBlackTree<Key, Data, OwnsKeys, OrderStatistics> &) = delete;
 
 				/*! \brief Private assignment operator. */
 				/*!
@@ -45,46 +50,137 @@ namespace CrissCross
 				 * the code wrong. A tree copy is generally unnecessary, and in cases that it
 				 * is, it can be achieved by other means.
 				 */
-				RedBlackTree<Key, Data, OwnsKeys> &operator =(const RedBlackTree<Key, Data, OwnsKeys> &) = delete;
+				RedBlackTree<Key, Data, OwnsKeys, OrderStatistics> &operator =(const RedBlackTree<Key, Data, OwnsKeys, OrderStatistics> &) = delete;
 
 			protected:
 
 				/*! \brief The root node at the top of the tree. */
-				RedBlackNode<Key, Data, OwnsKeys> *rootNode;
+				RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *rootNode;
 
 				/*! \brief The "null" node. Added so we don't need special cases to check for null pointers. */
-				RedBlackNode<Key, Data, OwnsKeys> *nullNode;
+				RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *nullNode;
 
 				/*! \brief The cached size() return value. Changes on each tree modification (insertions and deletions). */
 				uint32_t m_size;
 
-				void RecursiveConvertIndexToDArray(DArray <Key> *_darray, RedBlackNode<Key, Data, OwnsKeys> *_btree) const;
+				/*! \brief The allocator for the tree's nodes. */
+				NodePool<RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> > m_pool;
+
+				void RecursiveConvertIndexToDArray(DArray <Key> *_darray, RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *_btree) const;
 
 				template <class TypedData>
-				void RecursiveConvertToDArray(DArray <TypedData> *_darray, RedBlackNode<Key, Data, OwnsKeys> *_btree) const;
+				void RecursiveConvertToDArray(DArray <TypedData> *_darray, RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *_btree) const;
+
+				void rotateLeft(RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> * _x);
+				void rotateRight(RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> * _x);
+				void insertFixup(RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> * _x);
+				void deleteFixup(RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> * _x);
 
-				void rotateLeft(RedBlackNode<Key, Data, OwnsKeys> * _x);
-				void rotateRight(RedBlackNode<Key, Data, OwnsKeys> * _x);
-				void insertFixup(RedBlackNode<Key, Data, OwnsKeys> * _x);
-				void deleteFixup(RedBlackNode<Key, Data, OwnsKeys> * _x);
+				/*! \brief Links a new node under the node found by a search, and rebalances. */
+				/*!
+				 * \param _parent The new node's parent, or nullNode for an empty tree.
+				 * \param _side Negative to attach to the left of _parent, positive for the right.
+				 * \param _key The key of the new node.
+				 * \param _rec The data of the new node.
+				 * \return The new node.
+				 */
+				RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *attach(RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *_parent, int _side, Key const &_key, Data const &_rec);
 
 				void killAll();
-				void killAll(RedBlackNode<Key, Data, OwnsKeys> *rec);
 
-				bool killNode(RedBlackNode<Key, Data, OwnsKeys> * z);
+				bool killNode(RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> * z);
+
+				RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *findNode(Key const &key) const;
 
-				RedBlackNode<Key, Data, OwnsKeys> *findNode(Key const &key) const;
+				/*! \brief Subtrees at least this large are built as separate tasks. */
+				static constexpr uint32_t BuildTaskCutoff = 8192;
+
+				/*! \brief Recursively builds a perfectly balanced subtree from presorted items */
+				/*!
+				 * The middle item becomes the root, so the left side is never smaller than the right.
+				 * \param _src The presorted items.
+				 * \param _slots Storage for every node, by item index, or nullptr to allocate from the pool.
+				 * \param _lo The first item of the subtree.
+				 * \param _hi One past the last item of the subtree.
+				 * \param _parent The parent of the subtree.
+				 * \param _depth The depth of the subtree's root.
+				 * \param _redDepth The depth at which nodes are colored red.
+				 * \return The root of the subtree.
+				 */
+				template <class Source>
+				RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *buildSubtree(Source const *_src, RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> **_slots, uint32_t _lo, uint32_t _hi, RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *_parent, uint32_t _depth, uint32_t _redDepth);
+
+				/*! \brief Replaces the tree's contents with presorted items */
+				/*!
+				 * \param _src The presorted items. Must already be checked with sorted().
+				 */
+				template <class Source>
+				void build(Source const *_src);
 
 				/*! \brief Verifies that a node is valid. */
 				/*!
 				 * \param _node A node pointer.
 				 * \return True if the node is a valid node, false otherwise.
 				 */
-				inline bool valid(const RedBlackNode<Key, Data, OwnsKeys> *_node) const
+				inline bool valid(const RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *_node) const
 				{
 					return (_node != nullptr && _node != nullNode);
 				}
 
+				/*! \brief Gets the number of nodes in a subtree. */
+				/*!
+				 * \param _node The root of the subtree, or nullNode.
+				 * \return The subtree size, or 0 if the tree doesn't track order statistics.
+				 */
+				inline uint32_t subtreeSize(const RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *_node) const
+				{
+					if constexpr (OrderStatistics)
+						return valid(_node) ? _node->count : 0;
+					else
+						return 0;
+				}
+
+				/*! \brief Recomputes a node's subtree size and NodeAugment state from its children. */
+				/*!
+				 * Does nothing for nullNode, or if the tree tracks neither.
+				 * \param _node The node to update.
+				 */
+				inline void recount(RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *_node)
+				{
+					if constexpr (OrderStatistics) {
+						if (valid(_node))
+							_node->count = 1 + subtreeSize(_node->left) + subtreeSize(_node->right);
+					}
+					augment(_node);
+				}
+
+				/*! \brief Recomputes a node's NodeAugment state from its children. */
+				/*!
+				 * Does nothing for nullNode, or if the tree's nodes aren't augmented.
+				 * \param _node The node to update.
+				 */
+				inline void augment(RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *_node)
+				{
+					if constexpr (NodeAugment<Key, Data>::Enabled) {
+						if (valid(_node))
+							NodeAugment<Key, Data>::update(_node,
+							                               valid(_node->left) ? _node->left : nullptr,
+							                               valid(_node->right) ? _node->right : nullptr);
+					}
+				}
+
+				/*! \brief Recomputes the NodeAugment state of a node and all its ancestors. */
+				/*!
+				 * \param _node The lowest node whose subtree changed.
+				 */
+				inline void augmentPath(RedBlackNode<Key, Data, OwnsKeys, OrderStatistics> *_node)
+				{
+					if constexpr (NodeAugment<Key, Data>::Enabled) {
+						for (; valid(_node); _node = _node->parent)
+							augment(_node);
+					}
+				}
+
 			public:
 				/*! @cond */
 				typedef enum { BLACK, RED } nodeColor;
@@ -129,6 +225,21 @@ namespace CrissCross
 				template <class TypedData = Data>
 				TypedData find(Key const &_key, TypedData const &_default = nullptr) const;
 
+				/*! \brief Finds many keys at once. */
+				/*!
+				 * Equivalent to calling find() on each key, but a group of searches descends
+				 * the tree together, one level per pass. Each pass prefetches the next node
+				 * of every search before any of them is read, so the cache misses of the
+				 * whole group overlap instead of being taken one after another.
+				 * \param _keys The keys to find.
+				 * \param _count The number of keys.
+				 * \param _out Receives the data for each key, or _default if it wasn't found.
+				 * \param _default The value to store for keys which couldn't be found.
+				 * \return The number of keys found.
+				 */
+				template <class TypedData = Data>
+				size_t find_batch(Key const *_keys, size_t _count, TypedData *_out, TypedData const &_default = nullptr) const;
+
 				/*! \brief Empties the entire tree. */
 				/*!
 				 * \warning This won't free the memory occupied by the data, so the data must be freed
@@ -157,6 +268,136 @@ namespace CrissCross
 				 */
 				bool exists(Key const &_key) const;
 
+				/*! \brief Replaces the tree's contents with presorted data, in linear time. */
+				/*!
+				 * Builds a perfectly balanced tree directly, without searching or
+				 * rebalancing. Large trees are built in parallel when OpenMP is enabled.
+				 * \param _keys The keys, in strictly ascending order.
+				 * \param _data The data for each key.
+				 * \param _count The number of items in both arrays.
+				 * \return True on success, false if the keys aren't strictly ascending. On
+				 *    failure, the tree is left unchanged.
+				 */
+				bool build_from_sorted(Key const *_keys, Data const *_data, uint32_t _count);
+
+				/*! \brief Replaces the tree's contents with presorted data, in linear time. */
+				/*!
+				 * \param _keys The keys, in strictly ascending order. Unused slots are skipped.
+				 * \param _data The data for each key, at the same indices as the keys.
+				 * \return True on success, false if the keys aren't strictly ascending or
+				 *    some key has no data. On failure, the tree is left unchanged.
+				 */
+				bool build_from_sorted(DArray<Key> const *_keys, DArray<Data> const *_data);
+
+				/*! \brief A bidirectional in-order iterator over the tree. */
+				typedef TreeIterator<RedBlackNode<Key, Data, OwnsKeys, OrderStatistics>, Key, Data> iterator;
+
+				/*! \brief Gets an iterator at the smallest key. */
+				/*!
+				 * \return An iterator at the first key, or end() if the tree is empty.
+				 */
+				inline iterator begin() const
+				{
+					return iterator::first(&rootNode, nullNode);
+				}
+
+				/*! \brief Gets the past-the-end iterator. */
+				/*!
+				 * \return An iterator which points past the last key.
+				 */
+				inline iterator end() const
+				{
+					return iterator(nullptr, &rootNode, nullNode);
+				}
+
+				/*! \brief Finds the first key not less than the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return An iterator at the first key >= _key, or end() if there is none.
+				 */
+				inline iterator lower_bound(Key const &_key) const
+				{
+					return iterator::lowerBound(&rootNode, nullNode, _key);
+				}
+
+				/*! \brief Finds the first key greater than the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return An iterator at the first key > _key, or end() if there is none.
+				 */
+				inline iterator upper_bound(Key const &_key) const
+				{
+					return iterator::upperBound(&rootNode, nullNode, _key);
+				}
+
+				/*! \brief Finds the range of keys equal to the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return The pair lower_bound(_key), upper_bound(_key).
+				 */
+				inline std::pair<iterator, iterator> equal_range(Key const &_key) const
+				{
+					return std::make_pair(lower_bound(_key), upper_bound(_key));
+				}
+
+				/*! \brief Inserts data into the tree, searching from a nearby key instead of the root. */
+				/*!
+				 * Inserting keys in order, or clustered together, costs amortized O(1) each
+				 * when every insert is hinted with the iterator returned by the one before.
+				 * \param _hint An iterator at a key near _key. end() searches from the root.
+				 * \param _key The key of the data.
+				 * \param _rec The data to insert.
+				 * \return An iterator at the key, whether it was inserted or already in the tree.
+				 *    Only size() tells the two apart, as an existing key's data isn't changed.
+				 */
+				iterator insert(iterator const &_hint, Key const &_key, Data const &_rec);
+
+				/*! \brief Finds a key, searching from a nearby key instead of the root. */
+				/*!
+				 * \param _hint An iterator at a key near _key. end() searches from the root.
+				 * \param _key The key to search for.
+				 * \return An iterator at the key, or end() if it isn't in the tree.
+				 */
+				iterator find_near(iterator const &_hint, Key const &_key) const;
+
+				/*! \brief Visits the keys in [_lo, _hi) in order, without copying the tree. */
+				/*!
+				 * \param _lo The smallest key to visit.
+				 * \param _hi The key to stop at. It isn't visited.
+				 * \param _fn Called as _fn(key, data) for each key in the range.
+				 * \return The number of keys visited.
+				 */
+				template <class Visitor>
+				inline uint32_t for_each_in_range(Key const &_lo, Key const &_hi, Visitor _fn) const
+				{
+					return iterator::forEachInRange(&rootNode, nullNode, _lo, _hi, _fn);
+				}
+
+				/*! \brief Finds the key at the given position in sorted order. */
+				/*!
+				 * Runs in O(log n). Only available when OrderStatistics is enabled.
+				 * \param _index The zero-based position, so 0 is the smallest key.
+				 * \return An iterator at the key, or end() if _index is out of range.
+				 */
+				iterator select(uint32_t _index) const;
+
+				/*! \brief Counts the keys less than the given key. */
+				/*!
+				 * Runs in O(log n). Only available when OrderStatistics is enabled.
+				 * \param _key The key to rank. It doesn't need to be in the tree.
+				 * \return The number of keys less than _key.
+				 */
+				uint32_t rank(Key const &_key) const;
+
+				/*! \brief Counts the keys in [_lo, _hi). */
+				/*!
+				 * Runs in O(log n). Only available when OrderStatistics is enabled.
+				 * \param _lo The smallest key to count.
+				 * \param _hi The key to stop at. It isn't counted.
+				 * \return The number of keys k with _lo <= k < _hi.
+				 */
+				uint32_t count_range(Key const &_lo, Key const &_hi) const;
+
 				/*! \brief Converts the tree data into a linearized DArray. */
 				/*!
 				 * \return A DArray containing the data of the tree.
@@ -211,7 +452,7 @@ namespace CrissCross
 				/*! @endcond */
 #endif
 
-				template <class K, class D, bool O>
+				template <class K, class D, bool O, bool S>
 				friend class RedBlackNode;
 		};
 	}
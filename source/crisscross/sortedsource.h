@@ -0,0 +1,158 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_sortedsource_h
+#define __included_cc_sortedsource_h
+
+#include <vector>
+
+#include <crisscross/compare.h>
+#include <crisscross/darray.h>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		/*! \brief Presents a pair of plain arrays to the bulk tree builders. */
+		template <class Key, class Data>
+		class SortedArraySource
+		{
+			protected:
+				/*! \brief The keys, in ascending order. */
+				Key const *m_keys;
+
+				/*! \brief The data, in the same order as the keys. */
+				Data const *m_data;
+
+				/*! \brief The number of items. */
+				uint32_t m_count;
+
+			public:
+				/*! \brief The constructor. */
+				/*!
+				 * \param _keys The keys, in ascending order.
+				 * \param _data The data for each key.
+				 * \param _count The number of items in both arrays.
+				 */
+				SortedArraySource(Key const *_keys, Data const *_data, uint32_t _count)
+					: m_keys(_keys), m_data(_data), m_count(_count)
+				{
+				}
+
+				/*! \brief Indicates the number of items. */
+				inline uint32_t size() const
+				{
+					return m_count;
+				}
+
+				/*! \brief Gets the key at the given position. */
+				inline Key const &key(uint32_t _index) const
+				{
+					return m_keys[_index];
+				}
+
+				/*! \brief Gets the data at the given position. */
+				inline Data const &data(uint32_t _index) const
+				{
+					return m_data[_index];
+				}
+
+				/*! \brief Checks that the keys are strictly ascending. */
+				/*!
+				 * \return True if every key is greater than the one before it.
+				 */
+				bool sorted() const
+				{
+					for (uint32_t i = 1; i < m_count; i++) {
+						if (Compare(m_keys[i - 1], m_keys[i]) >= 0)
+							return false;
+					}
+					return true;
+				}
+		};
+
+		/*! \brief Presents a pair of DArrays to the bulk tree builders. */
+		/*!
+		 * Only the slots in use in the key array are considered, so the output of
+		 * ConvertIndexToDArray() and ConvertToDArray() can be passed straight in.
+		 */
+		template <class Key, class Data>
+		class SortedDArraySource
+		{
+			protected:
+				/*! \brief The keys, in ascending order. */
+				DArray<Key> const *m_keys;
+
+				/*! \brief The data, at the same indices as the keys. */
+				DArray<Data> const *m_data;
+
+				/*! \brief The indices of the used slots in m_keys. */
+				std::vector<uint32_t> m_slots;
+
+				/*! \brief Whether every key slot has data to go with it. */
+				bool m_matched;
+
+			public:
+				/*! \brief The constructor. */
+				/*!
+				 * \param _keys The keys, in ascending order.
+				 * \param _data The data for each key, at the same indices.
+				 */
+				SortedDArraySource(DArray<Key> const *_keys, DArray<Data> const *_data)
+					: m_keys(_keys), m_data(_data), m_matched(true)
+				{
+					m_slots.reserve(_keys->used());
+					for (uint32_t i = 0; i < _keys->size(); i++) {
+						if (!_keys->valid(i))
+							continue;
+						if (!_data->valid(i))
+							m_matched = false;
+						m_slots.push_back(i);
+					}
+				}
+
+				/*! \brief Indicates the number of items. */
+				inline uint32_t size() const
+				{
+					return (uint32_t)m_slots.size();
+				}
+
+				/*! \brief Gets the key at the given position. */
+				inline Key key(uint32_t _index) const
+				{
+					return m_keys->get(m_slots[_index]);
+				}
+
+				/*! \brief Gets the data at the given position. */
+				inline Data data(uint32_t _index) const
+				{
+					return m_data->get(m_slots[_index]);
+				}
+
+				/*! \brief Checks that the keys are strictly ascending and all have data. */
+				/*!
+				 * \return True if the source can be used to build a tree.
+				 */
+				bool sorted() const
+				{
+					if (!m_matched)
+						return false;
+					for (uint32_t i = 1; i < size(); i++) {
+						if (Compare(key(i - 1), key(i)) >= 0)
+							return false;
+					}
+					return true;
+				}
+		};
+	}
+}
+
+#endif
@@ -21,29 +21,28 @@ namespace CrissCross
 {
 	namespace Data
 	{
-		template <class Key, class Data, bool OwnsKeys>
-		SplayTree<Key, Data, OwnsKeys>::SplayTree()
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		SplayTree<Key, Data, OwnsKeys, ThreadSafe>::SplayTree()
 		{
 			root = nullptr;
 			m_size = 0;
+			m_header.id = NullKey<Key>();
+			m_splayChance = AlwaysSplay;
+			m_semiSplayDepth = 0;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		SplayTree<Key, Data, OwnsKeys>::~SplayTree()
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		SplayTree<Key, Data, OwnsKeys, ThreadSafe>::~SplayTree()
 		{
-			while (m_size > 0)
-				erase(root->id);
+			empty();
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		bool SplayTree<Key, Data, OwnsKeys>::insert(Key const &key, Data const &x)
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		bool SplayTree<Key, Data, OwnsKeys, ThreadSafe>::insert(Key const &key, Data const &x)
 		{
-			static SplayNode<Key, Data, OwnsKeys> *newNode = nullptr;
+			std::unique_lock<OptionalSharedMutex<ThreadSafe> > lock(m_lock);
 
-			if (newNode == nullptr)
-				newNode = new SplayNode<Key, Data, OwnsKeys>;
-			else if (OwnsKeys)
-				Dealloc(newNode->id);
+			SplayNode<Key, Data, OwnsKeys> *newNode = m_pool.construct();
 
 			if (OwnsKeys)
 				newNode->id = Duplicate(key);
@@ -76,17 +75,18 @@ namespace CrissCross
 					root->parent = newNode;
 					root->right = nullptr;
 					root = newNode;
-				} else
+				} else {
+					m_pool.destroy(newNode);
 					return false;
+				}
 			}
 
 			m_size++;
-			newNode = nullptr;               /* So next insert will call new */
 			return true;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		bool SplayTree<Key, Data, OwnsKeys>::killNode(SplayNode<Key, Data, OwnsKeys> * z)
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		bool SplayTree<Key, Data, OwnsKeys, ThreadSafe>::killNode(SplayNode<Key, Data, OwnsKeys> * z)
 		{
 			SplayNode<Key, Data, OwnsKeys> *x, *y;
 
@@ -132,17 +132,16 @@ namespace CrissCross
 
 			m_size--;
 
-			y->left = nullptr;
-			y->right = nullptr;
-			delete y;
+			m_pool.destroy(y);
 
 			return true;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		bool SplayTree<Key, Data, OwnsKeys>::erase(Key const &key)
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		bool SplayTree<Key, Data, OwnsKeys, ThreadSafe>::erase(Key const &key)
 		{
 			SplayNode<Key, Data, OwnsKeys> *newTree;
+			std::unique_lock<OptionalSharedMutex<ThreadSafe> > lock(m_lock);
 
 			if (!root) return false;
 
@@ -162,45 +161,43 @@ namespace CrissCross
 				newTree = root->left;
 				splay(key, newTree);
 				newTree->right = root->right;
+				if (newTree->right)
+					newTree->right->parent = newTree;
 			}
+			if (newTree)
+				newTree->parent = nullptr;
 
 			m_size--;
 
-			root->left = nullptr;
-			root->right = nullptr;
-			delete root;
+			m_pool.destroy(root);
 
 			root = newTree;
 
 			return true;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		bool SplayTree<Key, Data, OwnsKeys>::exists(Key const &key) const
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		bool SplayTree<Key, Data, OwnsKeys, ThreadSafe>::exists(Key const &key) const
 		{
-			splay(key, root);
-
-			if (root == nullptr || Compare(root->id, key) != 0)
-				return false;
-
-			return true;
+			return lookup(key, nullptr);
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
 		template <class TypedData>
-		TypedData SplayTree<Key, Data, OwnsKeys>::find(Key const &key, TypedData const &_default) const
+		TypedData SplayTree<Key, Data, OwnsKeys, ThreadSafe>::find(Key const &key, TypedData const &_default) const
 		{
-			SplayNode<Key, Data, OwnsKeys> *node = findNode(key);
-
-			if (!node)
+			Data data;
+			if (!lookup(key, &data))
 				return _default;
 
-			return (TypedData)(root->data);
+			return (TypedData)data;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		bool SplayTree<Key, Data, OwnsKeys>::replace(Key const &key, Data const &data)
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		bool SplayTree<Key, Data, OwnsKeys, ThreadSafe>::replace(Key const &key, Data const &data)
 		{
+			std::unique_lock<OptionalSharedMutex<ThreadSafe> > lock(m_lock);
+
 			splay(key, root);
 
 			if (root == nullptr || Compare(root->id, key) != 0)
@@ -210,8 +207,8 @@ namespace CrissCross
 			return true;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		SplayNode<Key, Data, OwnsKeys> *SplayTree<Key, Data, OwnsKeys>::findNode(Key const &key) const
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		SplayNode<Key, Data, OwnsKeys> *SplayTree<Key, Data, OwnsKeys, ThreadSafe>::findNode(Key const &key) const
 		{
 			splay(key, root);
 
@@ -221,20 +218,127 @@ namespace CrissCross
 			return root;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		void SplayTree<Key, Data, OwnsKeys>::empty()
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		bool SplayTree<Key, Data, OwnsKeys, ThreadSafe>::shouldSplay(uint32_t _chance)
+		{
+			if (_chance == AlwaysSplay)
+				return true;
+
+			/* Each thread gets its own generator, seeded from its id so threads don't splay in lockstep */
+			static thread_local uint32_t state = 0;
+			if (state == 0) {
+				size_t id = std::hash<std::thread::id>()(std::this_thread::get_id());
+				state = ((uint32_t)id ^ (uint32_t)(id >> 16)) * 0x9E3779B9u | 1;
+			}
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state < _chance;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		bool SplayTree<Key, Data, OwnsKeys, ThreadSafe>::lookup(Key const &key, Data *data) const
 		{
-			while (m_size > 0)
-				erase(root->id);
+			uint32_t splayChance = m_splayChance.load(std::memory_order_relaxed);
+			uint32_t semiSplayDepth = m_semiSplayDepth.load(std::memory_order_relaxed);
+
+			if (splayChance == AlwaysSplay && semiSplayDepth == 0) {
+				std::unique_lock<OptionalSharedMutex<ThreadSafe> > lock(m_lock);
+				SplayNode<Key, Data, OwnsKeys> *node = findNode(key);
+				if (!node)
+					return false;
+				if (data)
+					*data = node->data;
+				return true;
+			}
+
+			bool found = false;
+			{
+				std::shared_lock<OptionalSharedMutex<ThreadSafe> > lock(m_lock);
+				SplayNode<Key, Data, OwnsKeys> *node = root;
+				uint32_t depth = 0;
+				while (node) {
+					depth++;
+					int cmp = Compare(key, node->id);
+					if (cmp < 0) {
+						node = node->left;
+					} else if (cmp > 0) {
+						node = node->right;
+					} else {
+						found = true;
+						if (data)
+							*data = node->data;
+						break;
+					}
+				}
+
+				if (depth <= semiSplayDepth || !shouldSplay(splayChance))
+					return found;
+			}
+
+			/* The tree may have changed since, so search again */
+			std::unique_lock<OptionalSharedMutex<ThreadSafe> > lock(m_lock);
+			if (semiSplayDepth == 0) {
+				splay(key, root);
+				return found;
+			}
+
+			SplayNode<Key, Data, OwnsKeys> *node = root, *last = nullptr;
+			uint32_t depth = 0;
+			while (node) {
+				last = node;
+				depth++;
+				int cmp = Compare(key, node->id);
+				if (cmp < 0)
+					node = node->left;
+				else if (cmp > 0)
+					node = node->right;
+				else
+					break;
+			}
+			if (last && depth > semiSplayDepth)
+				semiSplay(last);
+
+			return found;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		void SplayTree<Key, Data, OwnsKeys>::splay(Key const &key, SplayNode<Key, Data, OwnsKeys> * & t) const
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		void SplayTree<Key, Data, OwnsKeys, ThreadSafe>::set_splay_probability(double _probability)
+		{
+			std::unique_lock<OptionalSharedMutex<ThreadSafe> > lock(m_lock);
+			if (_probability >= 1.0)
+				m_splayChance = AlwaysSplay;
+			else if (_probability <= 0.0)
+				m_splayChance = 0;
+			else
+				m_splayChance = (uint32_t)(_probability * 4294967296.0);
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		void SplayTree<Key, Data, OwnsKeys, ThreadSafe>::set_semi_splay_depth(uint32_t _depth)
+		{
+			std::unique_lock<OptionalSharedMutex<ThreadSafe> > lock(m_lock);
+			m_semiSplayDepth = _depth;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		void SplayTree<Key, Data, OwnsKeys, ThreadSafe>::empty()
+		{
+			std::unique_lock<OptionalSharedMutex<ThreadSafe> > lock(m_lock);
+
+			m_pool.releaseTree(root);
+			root = nullptr;
+			m_size = 0;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		void SplayTree<Key, Data, OwnsKeys, ThreadSafe>::splay(Key const &key, SplayNode<Key, Data, OwnsKeys> * & t) const
 		{
 			if (!t) return;
 
 			SplayNode<Key, Data, OwnsKeys> *leftTreeMax, *rightTreeMin;
-			static SplayNode<Key, Data, OwnsKeys> header;
+			SplayNode<Key, Data, OwnsKeys> *parent = t->parent;
+			SplayNode<Key, Data, OwnsKeys> &header = m_header;
 
 			header.left = header.right = nullptr;
 
@@ -253,6 +357,7 @@ namespace CrissCross
 
 					/* Link Right */
 					rightTreeMin->left = t;
+					t->parent = rightTreeMin;
 					rightTreeMin = t;
 					t = t->left;
 				} else if (Compare(t->id, key) < 0) {
@@ -267,22 +372,33 @@ namespace CrissCross
 
 					/* Link Left */
 					leftTreeMax->right = t;
+					t->parent = leftTreeMax;
 					leftTreeMax = t;
 					t = t->right;
 				} else
 					break;
 
+			/* Reassemble, keeping the parent links valid for iterators */
 			leftTreeMax->right = t->left;
+			if (t->left)
+				t->left->parent = leftTreeMax;
 			rightTreeMin->left = t->right;
+			if (t->right)
+				t->right->parent = rightTreeMin;
 			t->left = header.right;
+			if (t->left)
+				t->left->parent = t;
 			t->right = header.left;
+			if (t->right)
+				t->right->parent = t;
+			t->parent = parent;
 
 			header.left = header.right = nullptr;
 		}
 
 
-		template <class Key, class Data, bool OwnsKeys>
-		void SplayTree<Key, Data, OwnsKeys>::rotateWithLeftChild(SplayNode<Key, Data, OwnsKeys> * & k2) const
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		void SplayTree<Key, Data, OwnsKeys, ThreadSafe>::rotateWithLeftChild(SplayNode<Key, Data, OwnsKeys> * & k2) const
 		{
 			SplayNode<Key, Data, OwnsKeys> *k1 = k2->left;
 			k2->left = k1->right;
@@ -295,8 +411,8 @@ namespace CrissCross
 			k2 = k1;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		void SplayTree<Key, Data, OwnsKeys>::rotateWithRightChild(SplayNode<Key, Data, OwnsKeys> * & k1) const
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		void SplayTree<Key, Data, OwnsKeys, ThreadSafe>::rotateWithRightChild(SplayNode<Key, Data, OwnsKeys> * & k1) const
 		{
 			SplayNode<Key, Data, OwnsKeys> *k2 = k1->right;
 			k1->right = k2->left;
@@ -309,9 +425,60 @@ namespace CrissCross
 			k1 = k2;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		uint32_t SplayTree<Key, Data, OwnsKeys>::mem_usage() const
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		void SplayTree<Key, Data, OwnsKeys, ThreadSafe>::rotateUp(SplayNode<Key, Data, OwnsKeys> *_node) const
+		{
+			SplayNode<Key, Data, OwnsKeys> *parent = _node->parent, *grandparent = parent->parent;
+
+			if (_node == parent->left) {
+				parent->left = _node->right;
+				if (parent->left)
+					parent->left->parent = parent;
+				_node->right = parent;
+			} else {
+				parent->right = _node->left;
+				if (parent->right)
+					parent->right->parent = parent;
+				_node->left = parent;
+			}
+
+			parent->parent = _node;
+			_node->parent = grandparent;
+			if (!grandparent)
+				root = _node;
+			else if (grandparent->left == parent)
+				grandparent->left = _node;
+			else
+				grandparent->right = _node;
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		void SplayTree<Key, Data, OwnsKeys, ThreadSafe>::semiSplay(SplayNode<Key, Data, OwnsKeys> *_node) const
+		{
+			while (_node->parent) {
+				SplayNode<Key, Data, OwnsKeys> *parent = _node->parent, *grandparent = parent->parent;
+				if (!grandparent) {
+					/* zig */
+					rotateUp(_node);
+					break;
+				}
+
+				if ((_node == parent->left) == (parent == grandparent->left)) {
+					/* zig-zig: only the parent moves up, and the walk carries on from it */
+					rotateUp(parent);
+					_node = parent;
+				} else {
+					/* zig-zag, as in a full splay */
+					rotateUp(_node);
+					rotateUp(_node);
+				}
+			}
+		}
+
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		uint32_t SplayTree<Key, Data, OwnsKeys, ThreadSafe>::mem_usage() const
 		{
+			std::shared_lock<OptionalSharedMutex<ThreadSafe> > lock(m_lock);
 			uint32_t ret = sizeof(*this);
 			if (!root) return ret;
 
@@ -319,28 +486,30 @@ namespace CrissCross
 			return ret;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
 		template <class TypedData>
-		DArray<TypedData> *SplayTree<Key, Data, OwnsKeys>::ConvertToDArray() const
+		DArray<TypedData> *SplayTree<Key, Data, OwnsKeys, ThreadSafe>::ConvertToDArray() const
 		{
+			std::shared_lock<OptionalSharedMutex<ThreadSafe> > lock(m_lock);
 			DArray<TypedData> *darray = new DArray<TypedData>();
 			darray->setSize(m_size);
 			RecursiveConvertToDArray<TypedData>(darray, root);
 			return darray;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		DArray<Key> *SplayTree<Key, Data, OwnsKeys>::ConvertIndexToDArray() const
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		DArray<Key> *SplayTree<Key, Data, OwnsKeys, ThreadSafe>::ConvertIndexToDArray() const
 		{
+			std::shared_lock<OptionalSharedMutex<ThreadSafe> > lock(m_lock);
 			DArray<Key> *darray = new DArray<Key>();
 			darray->setSize(m_size);
 			RecursiveConvertIndexToDArray(darray, root);
 			return darray;
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
 		template <class TypedData>
-		void SplayTree<Key, Data, OwnsKeys>::RecursiveConvertToDArray(DArray<TypedData> *darray, SplayNode<Key, Data, OwnsKeys> *btree) const
+		void SplayTree<Key, Data, OwnsKeys, ThreadSafe>::RecursiveConvertToDArray(DArray<TypedData> *darray, SplayNode<Key, Data, OwnsKeys> *btree) const
 		{
 			if (!btree) return;
 
@@ -349,8 +518,8 @@ namespace CrissCross
 			RecursiveConvertToDArray(darray, btree->right);
 		}
 
-		template <class Key, class Data, bool OwnsKeys>
-		void SplayTree<Key, Data, OwnsKeys>::RecursiveConvertIndexToDArray(DArray<Key> *darray, SplayNode<Key, Data, OwnsKeys> *btree) const
+		template <class Key, class Data, bool OwnsKeys, bool ThreadSafe>
+		void SplayTree<Key, Data, OwnsKeys, ThreadSafe>::RecursiveConvertIndexToDArray(DArray<Key> *darray, SplayNode<Key, Data, OwnsKeys> *btree) const
 		{
 			if (!btree) return;
 
@@ -16,16 +16,53 @@
 #include <crisscross/internal_mem.h>
 #include <crisscross/darray.h>
 #include <crisscross/node.h>
+#include <crisscross/nodepool.h>
+#include <crisscross/treeiterator.h>
+
+#include <atomic>
+#include <functional>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
 
 namespace CrissCross
 {
 	namespace Data
 	{
+		/*! \brief A reader-writer lock which compiles away when it isn't wanted. */
+		template <bool Enabled>
+		class OptionalSharedMutex
+		{
+			public:
+				inline void lock() {}
+				inline void unlock() {}
+				inline void lock_shared() {}
+				inline void unlock_shared() {}
+		};
+
+		/*! \brief A reader-writer lock which compiles away when it isn't wanted. */
+		template <>
+		class OptionalSharedMutex<true> : public std::shared_mutex
+		{
+		};
+
 		/*! \brief A splay tree implementation. */
 		/*!
 		 *      This is a tree which does NOT allow duplicate keys.
+		 *
+		 *      By default every lookup splays the key to the root, so each read is
+		 *      also a write. set_splay_probability() and set_semi_splay_depth()
+		 *      make lookups restructure the tree only some of the time, which keeps
+		 *      most of the adaptivity to skewed access patterns while leaving hot
+		 *      paths untouched.
+		 *
+		 *      With ThreadSafe set, the tree guards itself with a reader-writer lock.
+		 *      Lookups which don't restructure run side by side under the shared
+		 *      lock; the rest, and all modifications, take it exclusively. Iterators
+		 *      and for_each_in_range() don't take the lock, so they must not run
+		 *      alongside any other use of the tree.
 		 */
-		template <class Key, class Data, bool OwnsKeys = true>
+		template <class Key, class Data, bool OwnsKeys = true, bool ThreadSafe = false>
 		class SplayTree
 		{
 			private:
@@ -36,7 +73,7 @@ namespace CrissCross
 				 * the code wrong. A tree copy is generally unnecessary, and in cases that it
 				 * is, it can be achieved by other means.
 				 */
-				SplayTree(const SplayTree<Key, Data, OwnsKeys> &) = delete;
+				SplayTree(const SplayTree<Key, Data, OwnsKeys, ThreadSafe> &) = delete;
 
 				/*! \brief Private assignment operator. */
 				/*!
@@ -44,8 +81,9 @@ namespace CrissCross
 				 * the code wrong. A tree copy is generally unnecessary, and in cases that it
 				 * is, it can be achieved by other means.
 				 */
-				SplayTree<Key, Data, OwnsKeys> &operator =(const SplayTree<Key, Data, OwnsKeys> &) = delete;
+				SplayTree<Key, Data, OwnsKeys, ThreadSafe> &operator =(const SplayTree<Key, Data, OwnsKeys, ThreadSafe> &) = delete;
 
+			protected:
 				/* Mutable because splaying is an operation which changes */
 				/* the structure of the tree. */
 				mutable SplayNode<Key, Data, OwnsKeys> *root;
@@ -56,11 +94,35 @@ namespace CrissCross
 				void rotateWithLeftChild(SplayNode<Key, Data, OwnsKeys> * &k2) const;
 				void rotateWithRightChild(SplayNode<Key, Data, OwnsKeys> * &k1) const;
 				void splay(Key const &key, SplayNode<Key, Data, OwnsKeys> * &t) const;
+				void rotateUp(SplayNode<Key, Data, OwnsKeys> *_node) const;
+				void semiSplay(SplayNode<Key, Data, OwnsKeys> *_node) const;
+
+				/* Scratch node used to assemble the halves of a top-down splay */
+				mutable SplayNode<Key, Data, OwnsKeys> m_header;
+
+				/* Guards the tree when ThreadSafe is set */
+				mutable OptionalSharedMutex<ThreadSafe> m_lock;
+
+				/* Lookups restructure when a random 32-bit number is below this.
+				   Atomic, since lookups read it before they know which lock to take. */
+				std::atomic<uint32_t> m_splayChance;
+
+				/* Lookups only restructure nodes deeper than this, by semi-splaying */
+				std::atomic<uint32_t> m_semiSplayDepth;
+
+				/* The value of m_splayChance which means every lookup */
+				static constexpr uint32_t AlwaysSplay = 0xFFFFFFFFu;
+
+				static bool shouldSplay(uint32_t _chance);
+				bool lookup(Key const &key, Data *data) const;
 
 				SplayNode<Key, Data, OwnsKeys> *findNode(Key const &key) const;
 
 				uint32_t m_size;
 
+				/* The allocator for the tree's nodes. */
+				NodePool<SplayNode<Key, Data, OwnsKeys> > m_pool;
+
 				void RecursiveConvertIndexToDArray(DArray <Key> *_darray, SplayNode<Key, Data, OwnsKeys> *_btree) const;
 
 				template <class TypedData>
@@ -133,9 +195,93 @@ namespace CrissCross
 				 */
 				inline uint32_t size() const
 				{
+					std::shared_lock<OptionalSharedMutex<ThreadSafe> > lock(m_lock);
 					return m_size;
 				}
 
+				/*! \brief Sets the fraction of lookups which restructure the tree. */
+				/*!
+				 * Insertions, replacements and deletions always splay.
+				 * \param _probability Between 0 (lookups never splay) and 1 (every
+				 *    lookup splays, the default).
+				 */
+				void set_splay_probability(double _probability);
+
+				/*! \brief Makes lookups semi-splay keys found deep in the tree. */
+				/*!
+				 * A semi-splay roughly halves the depth of the accessed node and the
+				 * path above it, rather than bringing the node all the way to the root,
+				 * so it touches far fewer nodes for about the same long-run benefit.
+				 * Lookups of nodes no deeper than _depth don't restructure at all.
+				 * \param _depth The depth below which lookups semi-splay, counting the
+				 *    root as 1. 0 (the default) makes lookups fully splay every time.
+				 */
+				void set_semi_splay_depth(uint32_t _depth);
+
+				/*! \brief A bidirectional in-order iterator over the tree. */
+				typedef TreeIterator<SplayNode<Key, Data, OwnsKeys>, Key, Data> iterator;
+
+				/*! \brief Gets an iterator at the smallest key. */
+				/*!
+				 * \return An iterator at the first key, or end() if the tree is empty.
+				 */
+				inline iterator begin() const
+				{
+					return iterator::first(&root, nullptr);
+				}
+
+				/*! \brief Gets the past-the-end iterator. */
+				/*!
+				 * \return An iterator which points past the last key.
+				 */
+				inline iterator end() const
+				{
+					return iterator(nullptr, &root, nullptr);
+				}
+
+				/*! \brief Finds the first key not less than the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return An iterator at the first key >= _key, or end() if there is none.
+				 */
+				inline iterator lower_bound(Key const &_key) const
+				{
+					return iterator::lowerBound(&root, nullptr, _key);
+				}
+
+				/*! \brief Finds the first key greater than the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return An iterator at the first key > _key, or end() if there is none.
+				 */
+				inline iterator upper_bound(Key const &_key) const
+				{
+					return iterator::upperBound(&root, nullptr, _key);
+				}
+
+				/*! \brief Finds the range of keys equal to the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return The pair lower_bound(_key), upper_bound(_key).
+				 */
+				inline std::pair<iterator, iterator> equal_range(Key const &_key) const
+				{
+					return std::make_pair(lower_bound(_key), upper_bound(_key));
+				}
+
+				/*! \brief Visits the keys in [_lo, _hi) in order, without copying the tree. */
+				/*!
+				 * \param _lo The smallest key to visit.
+				 * \param _hi The key to stop at. It isn't visited.
+				 * \param _fn Called as _fn(key, data) for each key in the range.
+				 * \return The number of keys visited.
+				 */
+				template <class Visitor>
+				inline uint32_t for_each_in_range(Key const &_lo, Key const &_hi, Visitor _fn) const
+				{
+					return iterator::forEachInRange(&root, nullptr, _lo, _hi, _fn);
+				}
+
 				/*! \brief Converts the tree data into a linearized DArray. */
 				/*!
 				 * \return A DArray containing the data of the tree.
@@ -0,0 +1,235 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_staticindex_h
+#error "This file shouldn't be compiled directly."
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <vector>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		template <class Key, class Data>
+		StaticIndex<Key, Data>::StaticIndex()
+			: m_keys(nullptr), m_data(nullptr), m_size(0), m_storage(nullptr)
+		{
+		}
+
+		template <class Key, class Data>
+		StaticIndex<Key, Data>::~StaticIndex()
+		{
+			release();
+		}
+
+		template <class Key, class Data>
+		void StaticIndex<Key, Data>::release()
+		{
+			if (m_storage)
+				::operator delete(m_storage, std::align_val_t(CacheLineSize));
+			m_storage = nullptr;
+			m_file.Close();
+			m_keys = nullptr;
+			m_data = nullptr;
+			m_size = 0;
+		}
+
+		template <class Key, class Data>
+		void StaticIndex<Key, Data>::empty()
+		{
+			release();
+		}
+
+		template <class Key, class Data>
+		template <class Source>
+		void StaticIndex<Key, Data>::build(Source const *_src)
+		{
+			uint32_t count = _src->size();
+			size_t offset = dataOffset(count);
+			void *storage = ::operator new(offset + sizeof(Data) * ((size_t)count + 1), std::align_val_t(CacheLineSize));
+			Key *keys = (Key *)storage;
+			Data *data = (Data *)((char *)storage + offset);
+			memset((void *)&keys[0], 0, sizeof(Key));
+			memset((void *)&data[0], 0, sizeof(Data));
+
+			release();
+			m_storage = storage;
+			m_keys = keys;
+			m_data = data;
+			m_size = count;
+
+			/* An in-order walk of the implicit tree visits the slots in key order */
+			uint32_t slot = firstSlot();
+			for (uint32_t i = 0; i < count; i++) {
+				keys[slot] = _src->key(i);
+				data[slot] = _src->data(i);
+				slot = successor(slot);
+			}
+		}
+
+		template <class Key, class Data>
+		bool StaticIndex<Key, Data>::build_from_sorted(Key const *_keys, Data const *_data, uint32_t _count)
+		{
+			SortedArraySource<Key, Data> src(_keys, _data, _count);
+			if (!src.sorted())
+				return false;
+
+			build(&src);
+			return true;
+		}
+
+		template <class Key, class Data>
+		bool StaticIndex<Key, Data>::build_from_sorted(DArray<Key> const *_keys, DArray<Data> const *_data)
+		{
+			SortedDArraySource<Key, Data> src(_keys, _data);
+			if (!src.sorted())
+				return false;
+
+			build(&src);
+			return true;
+		}
+
+		template <class Key, class Data>
+		template <class Tree>
+		void StaticIndex<Key, Data>::build_from_tree(Tree const &_tree)
+		{
+			std::vector<Key> keys;
+			std::vector<Data> data;
+			keys.reserve(_tree.size());
+			data.reserve(_tree.size());
+			for (typename Tree::iterator it = _tree.begin(); it != _tree.end(); ++it) {
+				keys.push_back(it.key());
+				data.push_back(it.data());
+			}
+
+			/* Trees hand out their keys in order, so there's nothing to check */
+			SortedArraySource<Key, Data> src(keys.data(), data.data(), (uint32_t)keys.size());
+			build(&src);
+		}
+
+		template <class Key, class Data>
+		uint32_t StaticIndex<Key, Data>::lowerBoundSlot(Key const &_key) const
+		{
+			/* Sixteen slots further down are four levels below this one */
+			const size_t n = m_size;
+			size_t slot = 1;
+			while (slot <= n) {
+				cc_prefetch((const char *)m_keys + sizeof(Key) * 16 * slot);
+				slot = 2 * slot + (Compare(m_keys[slot], _key) < 0);
+			}
+
+			/* Undo the trailing right turns, and the left turn before them */
+			slot += 1;
+			while (!(slot & 1))
+				slot >>= 1;
+			return (uint32_t)(slot >> 1);
+		}
+
+		template <class Key, class Data>
+		template <class TypedData>
+		TypedData StaticIndex<Key, Data>::find(Key const &_key, TypedData const &_default) const
+		{
+			uint32_t slot = lowerBoundSlot(_key);
+			if (!slot || Compare(m_keys[slot], _key) != 0)
+				return _default;
+
+			return (TypedData)m_data[slot];
+		}
+
+		template <class Key, class Data>
+		bool StaticIndex<Key, Data>::exists(Key const &_key) const
+		{
+			uint32_t slot = lowerBoundSlot(_key);
+			return slot && Compare(m_keys[slot], _key) == 0;
+		}
+
+		template <class Key, class Data>
+		bool StaticIndex<Key, Data>::save(const char *_path) const
+		{
+			FILE *file = fopen(_path, "wb");
+			if (!file)
+				return false;
+
+			FileHeader header;
+			memset(&header, 0, sizeof(header));
+			memcpy(header.magic, "CCSI", 4);
+			header.version = 1;
+			header.keySize = sizeof(Key);
+			header.dataSize = sizeof(Data);
+			header.count = m_size;
+			header.byteOrder = 0x01020304;
+			header.dataOffset = dataOffset(m_size);
+
+			/* The header takes a whole cache line, so the arrays stay aligned when mapped */
+			static_assert(sizeof(FileHeader) == CacheLineSize, "the header must fill one cache line");
+
+			bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+			if (m_size) {
+				static const char padding[CacheLineSize] = { 0 };
+				size_t keyBytes = sizeof(Key) * ((size_t)m_size + 1);
+				ok = ok && fwrite(m_keys, keyBytes, 1, file) == 1;
+				ok = ok && (header.dataOffset == keyBytes || fwrite(padding, (size_t)header.dataOffset - keyBytes, 1, file) == 1);
+				ok = ok && fwrite(m_data, sizeof(Data) * ((size_t)m_size + 1), 1, file) == 1;
+			}
+
+			if (fclose(file) != 0)
+				ok = false;
+			return ok;
+		}
+
+		template <class Key, class Data>
+		bool StaticIndex<Key, Data>::load(const char *_path)
+		{
+			release();
+			if (!m_file.Open(_path))
+				return false;
+
+			const FileHeader *header = (const FileHeader *)m_file.Data();
+			size_t size = m_file.Size();
+			if (size < sizeof(FileHeader) || memcmp(header->magic, "CCSI", 4) != 0 ||
+			    header->version != 1 || header->byteOrder != 0x01020304 ||
+			    header->keySize != sizeof(Key) || header->dataSize != sizeof(Data) ||
+			    header->dataOffset != dataOffset(header->count)) {
+				release();
+				return false;
+			}
+
+			size_t needed = sizeof(FileHeader);
+			if (header->count)
+				needed += (size_t)header->dataOffset + sizeof(Data) * ((size_t)header->count + 1);
+			if (size < needed) {
+				release();
+				return false;
+			}
+
+			if (header->count) {
+				m_keys = (Key const *)((const char *)m_file.Data() + sizeof(FileHeader));
+				m_data = (Data const *)((const char *)m_keys + header->dataOffset);
+			}
+			m_size = header->count;
+			return true;
+		}
+
+		template <class Key, class Data>
+		size_t StaticIndex<Key, Data>::mem_usage() const
+		{
+			size_t ret = sizeof(*this);
+			if (m_storage)
+				ret += dataOffset(m_size) + sizeof(Data) * ((size_t)m_size + 1);
+			ret += m_file.Size();
+			return ret;
+		}
+	}
+}
@@ -0,0 +1,302 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_staticindex_h
+#define __included_cc_staticindex_h
+
+#include <crisscross/cc_attr.h>
+#include <crisscross/compare.h>
+#include <crisscross/darray.h>
+#include <crisscross/mappedfile.h>
+#include <crisscross/sortedsource.h>
+
+#include <type_traits>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		/*! \brief A read-only sorted index laid out for fast searching. */
+		/*!
+		 * The keys are stored in one array in Eytzinger (breadth-first) order: the
+		 * children of slot k are slots 2k and 2k+1. A search walks down from slot
+		 * 1 without any pointers or unpredictable branches, and fetches the
+		 * cache lines four levels ahead while it compares, so the top levels stay
+		 * hot in cache and the lower ones arrive before they are needed.
+		 *
+		 * An index is built once, from presorted arrays or from any tree with
+		 * iterators, and can't be modified afterwards. It can be saved to a file
+		 * and memory-mapped back in, which makes loading a large index nearly free.
+		 *
+		 * Keys and data are copied byte for byte, so both must be trivially
+		 * copyable. Keys which are pointers, such as strings, can't be used.
+		 */
+		template <class Key, class Data>
+		class StaticIndex
+		{
+			static_assert(std::is_trivially_copyable<Key>::value && !std::is_pointer<Key>::value,
+			              "StaticIndex keys must be plain values");
+			static_assert(std::is_trivially_copyable<Data>::value, "StaticIndex data must be trivially copyable");
+
+			private:
+				/*! \brief Private copy constructor. */
+				StaticIndex(const StaticIndex<Key, Data> &) = delete;
+
+				/*! \brief Private assignment operator. */
+				StaticIndex<Key, Data> &operator =(const StaticIndex<Key, Data> &) = delete;
+
+			protected:
+				/*! \brief The alignment of the key and data arrays. */
+				static constexpr size_t CacheLineSize = 64;
+
+				/*! \brief The layout of the start of a saved index. */
+				struct FileHeader
+				{
+					char magic[4];
+					uint32_t version;
+					uint32_t keySize;
+					uint32_t dataSize;
+					uint32_t count;
+					uint32_t byteOrder;
+					uint64_t dataOffset;
+					char reserved[32];
+				};
+
+				/*! \brief The keys, in Eytzinger order from index 1. */
+				Key const *m_keys;
+
+				/*! \brief The data, at the same indices as the keys. */
+				Data const *m_data;
+
+				/*! \brief The number of items. */
+				uint32_t m_size;
+
+				/*! \brief Memory allocated for a built index, or nullptr. */
+				void *m_storage;
+
+				/*! \brief The file a loaded index is mapped from. */
+				CrissCross::IO::MappedFile m_file;
+
+				/*! \brief Gets the offset of the data array from the start of the key array. */
+				static inline size_t dataOffset(uint32_t _count)
+				{
+					size_t keys = sizeof(Key) * ((size_t)_count + 1);
+					return (keys + CacheLineSize - 1) & ~(CacheLineSize - 1);
+				}
+
+				/*! \brief Gets the slot holding the smallest key. */
+				/*!
+				 * \return The leftmost slot, or 0 if the index is empty.
+				 */
+				inline uint32_t firstSlot() const
+				{
+					uint32_t slot = m_size ? 1 : 0;
+					while (slot && 2 * (size_t)slot <= m_size)
+						slot *= 2;
+					return slot;
+				}
+
+				/*! \brief Gets the slot after _slot in key order. */
+				/*!
+				 * \return The next slot, or 0 after the last one.
+				 */
+				inline uint32_t successor(uint32_t _slot) const
+				{
+					if (2 * (size_t)_slot + 1 <= m_size) {
+						_slot = 2 * _slot + 1;
+						while (2 * (size_t)_slot <= m_size)
+							_slot *= 2;
+						return _slot;
+					}
+					while (_slot & 1)
+						_slot >>= 1;
+					return _slot >> 1;
+				}
+
+				/*! \brief Finds the first slot whose key is not less than a key. */
+				/*!
+				 * \return The slot, or 0 if every key is less than _key.
+				 */
+				uint32_t lowerBoundSlot(Key const &_key) const;
+
+				/*! \brief Frees the index's storage or unmaps its file. */
+				void release();
+
+				/*! \brief Replaces the contents with presorted items. */
+				template <class Source>
+				void build(Source const *_src);
+
+			public:
+				/*! \brief A forward iterator over the index, in key order. */
+				class iterator
+				{
+					protected:
+						const StaticIndex<Key, Data> *m_index;
+						uint32_t m_slot;
+
+					public:
+						iterator(const StaticIndex<Key, Data> *_index, uint32_t _slot)
+							: m_index(_index), m_slot(_slot)
+						{
+						}
+
+						/*! \brief Whether the iterator points at an item. */
+						inline bool valid() const
+						{
+							return m_slot != 0;
+						}
+
+						/*! \brief Gets the key at the iterator. */
+						inline Key const &key() const
+						{
+							return m_index->m_keys[m_slot];
+						}
+
+						/*! \brief Gets the data at the iterator. */
+						inline Data const &data() const
+						{
+							return m_index->m_data[m_slot];
+						}
+
+						/*! \brief Steps to the next key. */
+						inline iterator &operator ++()
+						{
+							m_slot = m_index->successor(m_slot);
+							return *this;
+						}
+
+						inline bool operator ==(iterator const &_other) const
+						{
+							return m_slot == _other.m_slot;
+						}
+
+						inline bool operator !=(iterator const &_other) const
+						{
+							return m_slot != _other.m_slot;
+						}
+				};
+
+				/*! \brief The constructor. */
+				StaticIndex();
+
+				/*! \brief The destructor. */
+				~StaticIndex();
+
+				/*! \brief Replaces the contents with presorted data. */
+				/*!
+				 * \param _keys The keys, in strictly ascending order.
+				 * \param _data The data for each key.
+				 * \param _count The number of items in both arrays.
+				 * \return True on success, false if the keys aren't strictly ascending. On
+				 *    failure, the index is left unchanged.
+				 */
+				bool build_from_sorted(Key const *_keys, Data const *_data, uint32_t _count);
+
+				/*! \brief Replaces the contents with presorted data. */
+				/*!
+				 * \param _keys The keys, in strictly ascending order. Unused slots are skipped.
+				 * \param _data The data for each key, at the same indices as the keys.
+				 * \return True on success, false if the keys aren't strictly ascending or
+				 *    some key has no data. On failure, the index is left unchanged.
+				 */
+				bool build_from_sorted(DArray<Key> const *_keys, DArray<Data> const *_data);
+
+				/*! \brief Replaces the contents with a snapshot of a tree. */
+				/*!
+				 * Works with any tree that has begin() and end() iterators, such as
+				 * AVLTree, RedBlackTree or SplayTree.
+				 * \param _tree The tree to copy.
+				 */
+				template <class Tree>
+				void build_from_tree(Tree const &_tree);
+
+				/*! \brief Writes the index to a file. */
+				/*!
+				 * The file can be loaded on any machine with the same byte order and
+				 * the same key and data sizes.
+				 * \param _path The path of the file to write.
+				 * \return True on success, false if the file couldn't be written.
+				 */
+				bool save(const char *_path) const;
+
+				/*! \brief Replaces the contents with an index saved by save(). */
+				/*!
+				 * The file is mapped into memory rather than read, so this takes the
+				 * same time for any size of index. It stays mapped until the index is
+				 * rebuilt, reloaded or destroyed.
+				 * \param _path The path of the file to load.
+				 * \return True on success, false if the file is missing or doesn't hold a
+				 *    compatible index. On failure, the index is empty.
+				 */
+				bool load(const char *_path);
+
+				/*! \brief Finds a key and returns its data. */
+				/*!
+				 * \param _key The key to find.
+				 * \param _default The value to return if the key couldn't be found.
+				 * \return If found, returns the data for the key, otherwise _default is returned.
+				 */
+				template <class TypedData = Data>
+				TypedData find(Key const &_key, TypedData const &_default = TypedData()) const;
+
+				/*! \brief Tests whether a key is in the index or not. */
+				/*!
+				 * \param _key The key to find.
+				 * \return True if the key is in the index, false if not.
+				 */
+				bool exists(Key const &_key) const;
+
+				/*! \brief Finds the first key not less than the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return An iterator at the first key >= _key, or end() if there is none.
+				 */
+				inline iterator lower_bound(Key const &_key) const
+				{
+					return iterator(this, lowerBoundSlot(_key));
+				}
+
+				/*! \brief Gets an iterator at the smallest key. */
+				inline iterator begin() const
+				{
+					return iterator(this, firstSlot());
+				}
+
+				/*! \brief Gets the past-the-end iterator. */
+				inline iterator end() const
+				{
+					return iterator(this, 0);
+				}
+
+				/*! \brief Empties the index. */
+				void empty();
+
+				/*! \brief Indicates the size of the index. */
+				/*!
+				 * \return The number of keys.
+				 */
+				inline uint32_t size() const
+				{
+					return m_size;
+				}
+
+				/*! \brief Returns the memory held by the index. */
+				/*!
+				 * \return Memory usage in bytes, counting a mapped file at its full size.
+				 */
+				size_t mem_usage() const;
+		};
+	}
+}
+
+#include <crisscross/staticindex.cpp>
+
+#endif
@@ -22,15 +22,13 @@ namespace CrissCross
 		{
 			m_root = nullptr;
 			m_size = 0;
+			m_maxSize = 0;
 		}
 
 		template <class Key, class Data, bool OwnsKeys>
 		STree<Key, Data, OwnsKeys>::~STree()
 		{
-			if (m_root)
-				Dealloc(m_root->id);
-
-			delete m_root;
+			m_pool.releaseTree(m_root);
 			m_root = nullptr;
 		}
 
@@ -53,31 +51,34 @@ namespace CrissCross
 			}
 
 			--m_size;
-			Dealloc(node->id);
 
 			if (node->left && node->right) {
+				/* Take over the successor's contents and unlink the successor instead */
 				SNode<Key, Data, OwnsKeys> *min = node->right;
 				while (min->left)
 					min = min->left;
-				node->id = min->id;
+				std::swap(node->id, min->id);
 				node->data = min->data;
-				min->parent->left = min->right;
+				ploc = (min->parent == node) ? &node->right : &min->parent->left;
 				node = min;
-			} else if (node->left) {
-				node->left->parent = node->parent;
-				*ploc = node->left;
-			} else if (node->right) {
-				node->right->parent = node->parent;
-				*ploc = node->right;
 			}
 
+			SNode<Key, Data, OwnsKeys> *child = node->left ? node->left : node->right;
+			if (child)
+				child->parent = node->parent;
+			*ploc = child;
+
 			node->left = nullptr;
 			node->right = nullptr;
 
-			if (m_root == node)
-				m_root = nullptr;
+			m_pool.destroy(node);
 
-			delete node;
+			/* Too many deletions since the last full rebuild may have left it too tall */
+			if (m_size * 3 < m_maxSize * 2) {
+				if (m_root)
+					rebuild(m_root);
+				m_maxSize = m_size;
+			}
 
 			return true;
 		}
@@ -96,8 +97,10 @@ namespace CrissCross
 		bool STree<Key, Data, OwnsKeys>::insert(Key const &_key, Data const &_data)
 		{
 			SNode<Key, Data, OwnsKeys> *parent = m_root;
+			uint32_t depth = 0;
 			int cmp = 0;
 			while (valid(parent)) {
+				depth++;
 				cmp = Compare(_key, parent->id);
 				if (cmp < 0) {
 					if (!parent->left)
@@ -112,8 +115,11 @@ namespace CrissCross
 				}
 			}
 
-			SNode<Key, Data, OwnsKeys> *newnode = new SNode<Key, Data, OwnsKeys>();
-			newnode->id = Duplicate(_key);
+			SNode<Key, Data, OwnsKeys> *newnode = m_pool.construct();
+			if (OwnsKeys)
+				newnode->id = Duplicate(_key);
+			else
+				newnode->id = _key;
 			newnode->data = _data;
 			newnode->parent = parent;
 
@@ -130,9 +136,89 @@ namespace CrissCross
 			}
 
 			++m_size;
+			if (m_size > m_maxSize)
+				m_maxSize = m_size;
+
+			/* Most insertions land well within log2(n), so skip computing the real limit */
+			uint32_t log2size = 0;
+			for (uint32_t n = m_size; n > 1; n >>= 1)
+				log2size++;
+			if (depth <= log2size || depth <= heightLimit(m_size))
+				return true;
+
+			/* Walk up to the first ancestor which is out of balance, and rebuild there */
+			SNode<Key, Data, OwnsKeys> *node = newnode, *scapegoat = newnode->parent;
+			uint32_t nodeSize = 1;
+			while (scapegoat) {
+				SNode<Key, Data, OwnsKeys> *sibling = (scapegoat->left == node) ? scapegoat->right : scapegoat->left;
+				uint32_t scapegoatSize = nodeSize + 1 + countNodes(sibling);
+				if (nodeSize * 3 > scapegoatSize * 2)
+					break;
+				node = scapegoat;
+				nodeSize = scapegoatSize;
+				scapegoat = scapegoat->parent;
+			}
+
+			if (scapegoat)
+				rebuild(scapegoat);
+
 			return true;
 		}
 
+		template <class Key, class Data, bool OwnsKeys>
+		uint32_t STree<Key, Data, OwnsKeys>::heightLimit(uint32_t _size)
+		{
+			uint32_t ret = 0;
+			for (double n = _size; n >= 1.5; n /= 1.5)
+				ret++;
+			return ret;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		uint32_t STree<Key, Data, OwnsKeys>::countNodes(const SNode<Key, Data, OwnsKeys> *_node)
+		{
+			if (!_node)
+				return 0;
+
+			return 1 + countNodes(_node->left) + countNodes(_node->right);
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		void STree<Key, Data, OwnsKeys>::flatten(SNode<Key, Data, OwnsKeys> *_node)
+		{
+			while (_node) {
+				flatten(_node->left);
+				m_scratch.push_back(_node);
+				_node = _node->right;
+			}
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		SNode<Key, Data, OwnsKeys> *STree<Key, Data, OwnsKeys>::buildBalanced(uint32_t _lo, uint32_t _hi, SNode<Key, Data, OwnsKeys> *_parent)
+		{
+			if (_lo >= _hi)
+				return nullptr;
+
+			uint32_t mid = _lo + (_hi - _lo) / 2;
+			SNode<Key, Data, OwnsKeys> *node = m_scratch[mid];
+			node->parent = _parent;
+			node->left = buildBalanced(_lo, mid, node);
+			node->right = buildBalanced(mid + 1, _hi, node);
+			return node;
+		}
+
+		template <class Key, class Data, bool OwnsKeys>
+		void STree<Key, Data, OwnsKeys>::rebuild(SNode<Key, Data, OwnsKeys> *_node)
+		{
+			SNode<Key, Data, OwnsKeys> *parent = _node->parent;
+			SNode<Key, Data, OwnsKeys> **slot = !parent ? &m_root :
+			               (parent->left == _node) ? &parent->left : &parent->right;
+
+			m_scratch.clear();
+			flatten(_node);
+			*slot = buildBalanced(0, (uint32_t)m_scratch.size(), parent);
+		}
+
 		template <class Key, class Data, bool OwnsKeys>
 		SNode<Key, Data, OwnsKeys> *STree<Key, Data, OwnsKeys>::findNode(Key const &_key) const
 		{
@@ -16,16 +16,27 @@
 #include <crisscross/internal_mem.h>
 #include <crisscross/darray.h>
 #include <crisscross/node.h>
+#include <crisscross/nodepool.h>
+#include <crisscross/treeiterator.h>
+
+#include <utility>
+#include <vector>
 
 namespace CrissCross
 {
 	namespace Data
 	{
-		/*! \brief A very simple binary search tree. */
-		/*! This binary search tree is designed to be a template for
-		 * future tree designs and is not intended for general use. It
-		 * has no self-balancing features, but is a fully functional
-		 * binary search tree.
+		/*! \brief A simple binary search tree, kept balanced as a scapegoat tree. */
+		/*! Nodes carry no balance information at all. Instead, when an insertion
+		 * lands deeper than log1.5(n), the tree walks back up to the first
+		 * ancestor whose subtree is lopsided (one side holding more than 2/3 of
+		 * it) and rebuilds that subtree perfectly balanced. When deletions shrink
+		 * the tree below 2/3 of its largest size, the whole tree is rebuilt.
+		 *
+		 * This keeps the height within log1.5(n) + 1, so lookups are O(log n)
+		 * even for ordered input, while lookups and the node layout stay as
+		 * simple as an unbalanced tree's. Insertions and deletions are amortized
+		 * O(log n).
 		 */
 		template <class Key, class Data, bool OwnsKeys = true>
 		class STree
@@ -36,8 +47,6 @@ namespace CrissCross
 				 * If your code needs to invoke the copy constructor, you've probably written
 				 * the code wrong. A tree copy is generally unnecessary, and in cases that it
 				 * is, it can be achieved by other means.
-				 * \deprecated This is a reference implementation. Do not use it for real world
-				 * applications.
 				 */
 				STree(const STree<Key, Data, OwnsKeys> &) = delete;
 
@@ -56,6 +65,15 @@ namespace CrissCross
 				/*! \brief The current tree size. */
 				uint32_t m_size;
 
+				/*! \brief The largest size since the whole tree was last rebuilt. */
+				uint32_t m_maxSize;
+
+				/*! \brief Scratch space for rebuilding subtrees. */
+				std::vector<SNode<Key, Data, OwnsKeys> *> m_scratch;
+
+				/*! \brief The allocator for the tree's nodes. */
+				NodePool<SNode<Key, Data, OwnsKeys> > m_pool;
+
 				/*! \brief Find a node in the tree */
 				/*!
 				 * Get a pointer to a node with the specified key value
@@ -79,6 +97,34 @@ namespace CrissCross
 				template <class TypedData>
 				void RecursiveConvertToDArray(DArray <TypedData> *_darray, SNode<Key, Data, OwnsKeys> *_btree) const;
 
+				/*! \brief Gets the deepest an insertion may land before the tree is rebalanced. */
+				/*!
+				 * \param _size The size of the tree.
+				 * \return floor(log1.5(_size)), counting the root as depth 0.
+				 */
+				static uint32_t heightLimit(uint32_t _size);
+
+				/*! \brief Counts the nodes in a subtree. */
+				static uint32_t countNodes(const SNode<Key, Data, OwnsKeys> *_node);
+
+				/*! \brief Appends a subtree's nodes to m_scratch in order. */
+				void flatten(SNode<Key, Data, OwnsKeys> *_node);
+
+				/*! \brief Links m_scratch[_lo, _hi) into a perfectly balanced subtree. */
+				/*!
+				 * \param _lo The first node of the subtree.
+				 * \param _hi One past the last node of the subtree.
+				 * \param _parent The parent of the subtree.
+				 * \return The root of the subtree.
+				 */
+				SNode<Key, Data, OwnsKeys> *buildBalanced(uint32_t _lo, uint32_t _hi, SNode<Key, Data, OwnsKeys> *_parent);
+
+				/*! \brief Rebuilds a subtree perfectly balanced, in place. */
+				/*!
+				 * \param _node The root of the subtree.
+				 */
+				void rebuild(SNode<Key, Data, OwnsKeys> *_node);
+
 				/*! \brief Verifies that a node is valid. */
 				/*!
 				 * \param _node A node pointer.
@@ -92,7 +138,7 @@ namespace CrissCross
 			public:
 
 				/*! \brief The default constructor. */
-				_CC_DEPRECATE_SLOW STree();
+				STree();
 
 				/*! \brief The destructor. */
 				virtual ~STree();
@@ -147,7 +193,7 @@ namespace CrissCross
 				 */
 				inline void empty()
 				{
-					delete m_root; m_root = nullptr; m_size = 0;
+					m_pool.releaseTree(m_root); m_root = nullptr; m_size = 0; m_maxSize = 0;
 				}
 
 				/*! \brief Indicates the size of the tree. */
@@ -167,6 +213,70 @@ namespace CrissCross
 				 */
 				bool replace(Key const &_key, Data const &_data);
 
+				/*! \brief A bidirectional in-order iterator over the tree. */
+				typedef TreeIterator<SNode<Key, Data, OwnsKeys>, Key, Data> iterator;
+
+				/*! \brief Gets an iterator at the smallest key. */
+				/*!
+				 * \return An iterator at the first key, or end() if the tree is empty.
+				 */
+				inline iterator begin() const
+				{
+					return iterator::first(&m_root, nullptr);
+				}
+
+				/*! \brief Gets the past-the-end iterator. */
+				/*!
+				 * \return An iterator which points past the last key.
+				 */
+				inline iterator end() const
+				{
+					return iterator(nullptr, &m_root, nullptr);
+				}
+
+				/*! \brief Finds the first key not less than the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return An iterator at the first key >= _key, or end() if there is none.
+				 */
+				inline iterator lower_bound(Key const &_key) const
+				{
+					return iterator::lowerBound(&m_root, nullptr, _key);
+				}
+
+				/*! \brief Finds the first key greater than the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return An iterator at the first key > _key, or end() if there is none.
+				 */
+				inline iterator upper_bound(Key const &_key) const
+				{
+					return iterator::upperBound(&m_root, nullptr, _key);
+				}
+
+				/*! \brief Finds the range of keys equal to the given key. */
+				/*!
+				 * \param _key The key to search for.
+				 * \return The pair lower_bound(_key), upper_bound(_key).
+				 */
+				inline std::pair<iterator, iterator> equal_range(Key const &_key) const
+				{
+					return std::make_pair(lower_bound(_key), upper_bound(_key));
+				}
+
+				/*! \brief Visits the keys in [_lo, _hi) in order, without copying the tree. */
+				/*!
+				 * \param _lo The smallest key to visit.
+				 * \param _hi The key to stop at. It isn't visited.
+				 * \param _fn Called as _fn(key, data) for each key in the range.
+				 * \return The number of keys visited.
+				 */
+				template <class Visitor>
+				inline uint32_t for_each_in_range(Key const &_lo, Key const &_hi, Visitor _fn) const
+				{
+					return iterator::forEachInRange(&m_root, nullptr, _lo, _hi, _fn);
+				}
+
 				/*! \brief Converts the tree data into a linearized DArray. */
 				/*!
 				 * \return A DArray containing the data of the tree.
@@ -0,0 +1,322 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#ifndef __included_cc_treeiterator_h
+#define __included_cc_treeiterator_h
+
+#include <crisscross/cc_attr.h>
+#include <crisscross/compare.h>
+#include <crisscross/node.h>
+
+namespace CrissCross
+{
+	namespace Data
+	{
+		/*! \brief A bidirectional in-order iterator over a binary search tree. */
+		/*!
+		 * Works with any of the binary tree node types, by following the left,
+		 * right and parent links. Stepping allocates nothing and costs amortized
+		 * O(1), so walking a range of k keys costs O(log n + k).
+		 *
+		 * Trees which use a sentinel instead of nullptr for their leaves (such as
+		 * RedBlackTree) pass it in as _nil.
+		 *
+		 * \warning Inserting into or erasing from the tree invalidates its iterators.
+		 */
+		template <class Node, class Key, class Data>
+		class TreeIterator
+		{
+			protected:
+				/*! \brief The current node, or nullptr past the end. */
+				Node *m_node;
+
+				/*! \brief The tree's root pointer, used to step back from the end. */
+				Node * const *m_root;
+
+				/*! \brief The tree's sentinel leaf, if it has one. */
+				const Node *m_nil;
+
+				/*! \brief Tests whether a link leads nowhere. */
+				cc_forceinline bool isNil(const Node *_node) const
+				{
+					return !_node || _node == m_nil;
+				}
+
+				/*! \brief Finds the leftmost node of a subtree. */
+				Node *minimum(Node *_node) const
+				{
+					while (!isNil(_node->left))
+						_node = _node->left;
+					return _node;
+				}
+
+				/*! \brief Finds the rightmost node of a subtree. */
+				Node *maximum(Node *_node) const
+				{
+					while (!isNil(_node->right))
+						_node = _node->right;
+					return _node;
+				}
+
+			public:
+				/*! \brief The default constructor. */
+				TreeIterator() : m_node(nullptr), m_root(nullptr), m_nil(nullptr)
+				{
+				}
+
+				/*! \brief The constructor. */
+				/*!
+				 * \param _node The node to start at. Either nullptr or _nil means the end.
+				 * \param _root The address of the tree's root pointer.
+				 * \param _nil The tree's sentinel leaf, if any.
+				 */
+				TreeIterator(Node *_node, Node * const *_root, const Node *_nil = nullptr)
+					: m_node(_node), m_root(_root), m_nil(_nil)
+				{
+					if (isNil(m_node))
+						m_node = nullptr;
+				}
+
+				/*! \brief Tests whether the iterator points at a node. */
+				/*!
+				 * \return False when the iterator is past the end.
+				 */
+				inline bool valid() const
+				{
+					return m_node != nullptr;
+				}
+
+				/*! \brief Gets the key of the current node. */
+				inline Key const &key() const
+				{
+					return m_node->id;
+				}
+
+				/*! \brief Gets the data of the current node. */
+				inline Data &data() const
+				{
+					return m_node->data;
+				}
+
+				/*! \brief Gets the current node, or nullptr past the end. */
+				inline Node *node() const
+				{
+					return m_node;
+				}
+
+				/*! \brief Steps to the next key in order. */
+				TreeIterator &operator ++()
+				{
+					if (!isNil(m_node->right)) {
+						m_node = minimum(m_node->right);
+						return *this;
+					}
+
+					Node *parent = m_node->parent;
+					while (!isNil(parent) && m_node == parent->right) {
+						m_node = parent;
+						parent = parent->parent;
+					}
+					m_node = isNil(parent) ? nullptr : parent;
+					return *this;
+				}
+
+				/*! \brief Steps to the previous key in order. */
+				/*!
+				 * Stepping back from the end gives the last key in the tree.
+				 */
+				TreeIterator &operator --()
+				{
+					if (!m_node) {
+						m_node = isNil(*m_root) ? nullptr : maximum(*m_root);
+						return *this;
+					}
+
+					if (!isNil(m_node->left)) {
+						m_node = maximum(m_node->left);
+						return *this;
+					}
+
+					Node *parent = m_node->parent;
+					while (!isNil(parent) && m_node == parent->left) {
+						m_node = parent;
+						parent = parent->parent;
+					}
+					m_node = isNil(parent) ? nullptr : parent;
+					return *this;
+				}
+
+				/*! \brief Steps to the next key in order. */
+				TreeIterator operator ++(int)
+				{
+					TreeIterator ret = *this;
+					++*this;
+					return ret;
+				}
+
+				/*! \brief Steps to the previous key in order. */
+				TreeIterator operator --(int)
+				{
+					TreeIterator ret = *this;
+					--*this;
+					return ret;
+				}
+
+				inline bool operator ==(TreeIterator const &_other) const
+				{
+					return m_node == _other.m_node;
+				}
+
+				inline bool operator !=(TreeIterator const &_other) const
+				{
+					return m_node != _other.m_node;
+				}
+
+				/*! \brief Creates an iterator at the smallest key in a tree. */
+				/*!
+				 * \param _root The address of the tree's root pointer.
+				 * \param _nil The tree's sentinel leaf, if any.
+				 */
+				static TreeIterator first(Node * const *_root, const Node *_nil = nullptr)
+				{
+					TreeIterator ret(nullptr, _root, _nil);
+					if (!ret.isNil(*_root))
+						ret.m_node = ret.minimum(*_root);
+					return ret;
+				}
+
+				/*! \brief Creates an iterator at the first key not less than _key. */
+				/*!
+				 * \param _root The address of the tree's root pointer.
+				 * \param _nil The tree's sentinel leaf, if any.
+				 * \param _key The key to search for.
+				 */
+				static TreeIterator lowerBound(Node * const *_root, const Node *_nil, Key const &_key)
+				{
+					TreeIterator ret(nullptr, _root, _nil);
+					Node *node = *_root;
+					while (!ret.isNil(node)) {
+						if (Compare(node->id, _key) < 0) {
+							node = node->right;
+						} else {
+							ret.m_node = node;
+							node = node->left;
+						}
+					}
+					return ret;
+				}
+
+				/*! \brief Creates an iterator at the first key greater than _key. */
+				/*!
+				 * \param _root The address of the tree's root pointer.
+				 * \param _nil The tree's sentinel leaf, if any.
+				 * \param _key The key to search for.
+				 */
+				static TreeIterator upperBound(Node * const *_root, const Node *_nil, Key const &_key)
+				{
+					TreeIterator ret(nullptr, _root, _nil);
+					Node *node = *_root;
+					while (!ret.isNil(node)) {
+						if (Compare(node->id, _key) <= 0) {
+							node = node->right;
+						} else {
+							ret.m_node = node;
+							node = node->left;
+						}
+					}
+					return ret;
+				}
+
+				/*! \brief Searches for a key, starting from a node near it instead of the root. */
+				/*!
+				 * Climbs from _start only as far as the nearest ancestor whose subtree
+				 * must hold the key, then descends from there. Finding a key d positions
+				 * away from _start costs O(log d), so sequential or clustered accesses
+				 * cost amortized O(1) each instead of O(log n).
+				 * \param _root The address of the tree's root pointer.
+				 * \param _nil The tree's sentinel leaf, if any.
+				 * \param _start The node to start at. If it's nullptr or _nil, the search starts at the root.
+				 * \param _key The key to search for.
+				 * \param _parent If the key isn't found, receives the node it would be attached under (or nullptr for an empty tree).
+				 * \param _side If the key isn't found, receives which side of _parent it belongs on: negative for left, positive for right.
+				 * \return The node holding the key, or nullptr if there is none.
+				 */
+				static Node *fingerSearch(Node * const *_root, const Node *_nil, Node *_start, Key const &_key, Node **_parent, int *_side)
+				{
+					TreeIterator ret(nullptr, _root, _nil);
+					typename KeyPrefix<Key>::Type prefix = KeyPrefix<Key>::Make(_key);
+					Node *node = ret.isNil(_start) ? *_root : _start;
+
+					*_parent = nullptr;
+					*_side = 0;
+					if (ret.isNil(node))
+						return nullptr;
+
+					int cmp = CompareWithNode(_key, prefix, node);
+
+					/* Climb to the lowest ancestor whose key lies on the other side of
+					 * _key. Everything between the two is in node's subtree. */
+					while (cmp != 0) {
+						Node *child = node, *parent = node->parent;
+						while (!ret.isNil(parent) && child == (cmp > 0 ? parent->right : parent->left)) {
+							child = parent;
+							parent = parent->parent;
+						}
+						if (ret.isNil(parent))
+							break;
+
+						int parentCmp = CompareWithNode(_key, prefix, parent);
+						if (parentCmp != 0 && (parentCmp > 0) != (cmp > 0))
+							break;
+
+						node = parent;
+						cmp = parentCmp;
+					}
+
+					/* Then descend as usual */
+					while (cmp != 0) {
+						Node *next = cmp < 0 ? node->left : node->right;
+						if (ret.isNil(next)) {
+							*_parent = node;
+							*_side = cmp;
+							return nullptr;
+						}
+						node = next;
+						cmp = CompareWithNode(_key, prefix, node);
+					}
+
+					return node;
+				}
+
+				/*! \brief Visits every key in [_lo, _hi) in order. */
+				/*!
+				 * \param _root The address of the tree's root pointer.
+				 * \param _nil The tree's sentinel leaf, if any.
+				 * \param _lo The smallest key to visit.
+				 * \param _hi The key to stop at. It isn't visited.
+				 * \param _fn Called as _fn(key, data) for each key in the range.
+				 * \return The number of keys visited.
+				 */
+				template <class Visitor>
+				static uint32_t forEachInRange(Node * const *_root, const Node *_nil, Key const &_lo, Key const &_hi, Visitor &_fn)
+				{
+					uint32_t count = 0;
+					for (TreeIterator it = lowerBound(_root, _nil, _lo); it.valid() && Compare(it.key(), _hi) < 0; ++it) {
+						_fn(it.key(), it.data());
+						count++;
+					}
+					return count;
+				}
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ *   CrissCross
+ *   A multi-purpose cross-platform library.
+ *
+ *   A product of Uplink Laboratories.
+ *
+ *   (c) 2006-2022 Steven Noonan.
+ *   Licensed under the New BSD License.
+ *
+ */
+
+#include <crisscross/universal_include.h>
+#include <crisscross/mappedfile.h>
+
+#if defined (TARGET_OS_WINDOWS)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace CrissCross
+{
+	namespace IO
+	{
+		struct MappedFileImpl {
+#if defined (TARGET_OS_WINDOWS)
+			HANDLE m_file;
+			HANDLE m_mapping;
+#else
+			int m_fd;
+#endif
+		};
+
+		MappedFile::MappedFile()
+			: m_impl(new MappedFileImpl), m_data(nullptr), m_size(0)
+		{
+#if defined (TARGET_OS_WINDOWS)
+			m_impl->m_file = INVALID_HANDLE_VALUE;
+			m_impl->m_mapping = nullptr;
+#else
+			m_impl->m_fd = -1;
+#endif
+		}
+
+		MappedFile::~MappedFile()
+		{
+			Close();
+			delete m_impl;
+		}
+
+		bool MappedFile::Open(const char *_path)
+		{
+			Close();
+
+#if defined (TARGET_OS_WINDOWS)
+			m_impl->m_file = CreateFileA(_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (m_impl->m_file == INVALID_HANDLE_VALUE)
+				return false;
+
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(m_impl->m_file, &size) || size.QuadPart == 0) {
+				Close();
+				return false;
+			}
+
+			m_impl->m_mapping = CreateFileMappingA(m_impl->m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (!m_impl->m_mapping) {
+				Close();
+				return false;
+			}
+
+			m_data = MapViewOfFile(m_impl->m_mapping, FILE_MAP_READ, 0, 0, 0);
+			if (!m_data) {
+				Close();
+				return false;
+			}
+			m_size = (size_t)size.QuadPart;
+#else
+			m_impl->m_fd = open(_path, O_RDONLY);
+			if (m_impl->m_fd < 0)
+				return false;
+
+			struct stat st;
+			if (fstat(m_impl->m_fd, &st) != 0 || st.st_size == 0) {
+				Close();
+				return false;
+			}
+
+			void *data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, m_impl->m_fd, 0);
+			if (data == MAP_FAILED) {
+				Close();
+				return false;
+			}
+			m_data = data;
+			m_size = (size_t)st.st_size;
+#endif
+			return true;
+		}
+
+		void MappedFile::Close()
+		{
+#if defined (TARGET_OS_WINDOWS)
+			if (m_data)
+				UnmapViewOfFile(m_data);
+			if (m_impl->m_mapping)
+				CloseHandle(m_impl->m_mapping);
+			if (m_impl->m_file != INVALID_HANDLE_VALUE)
+				CloseHandle(m_impl->m_file);
+			m_impl->m_mapping = nullptr;
+			m_impl->m_file = INVALID_HANDLE_VALUE;
+#else
+			if (m_data)
+				munmap((void *)m_data, m_size);
+			if (m_impl->m_fd >= 0)
+				close(m_impl->m_fd);
+			m_impl->m_fd = -1;
+#endif
+			m_data = nullptr;
+			m_size = 0;
+		}
+	}
+}